@@ -15,6 +15,7 @@
 ////////////////*/
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /*////////////////////
 //   Preprocessor   //
@@ -64,6 +65,16 @@ namespace data {
 #define LLDATAIN_DDS_MAGIC_LE      0x20534444U
 #endif
 
+/// @summary The FourCC 'DDSZ' using little-endian byte ordering.
+#ifndef LLDATAIN_DDSZ_MAGIC_LE
+#define LLDATAIN_DDSZ_MAGIC_LE     0x5A534444U
+#endif
+
+/// @summary The FourCC 'ATLS' using little-endian byte ordering.
+#ifndef LLDATAIN_ATLAS_MAGIC_LE
+#define LLDATAIN_ATLAS_MAGIC_LE    0x534C5441U
+#endif
+
 /*/////////////////
 //   Data Types  //
 /////////////////*/
@@ -353,6 +364,14 @@ enum dds_alpha_mode_e
     DDS_ALPHA_MODE_CUSTOM                   = 0x00000004U
 };
 
+/// @summary Values for ddsz_header_t::Codec, identifying the algorithm used
+/// to supercompress the subresources of a DDS payload.
+enum ddsz_codec_e
+{
+    DDSZ_CODEC_NONE                         = 0x0000U,
+    DDSZ_CODEC_LZ                           = 0x0001U
+};
+
 /// @summary An enumeration defining the types of JSON nodes that can be stored
 /// within a JSON document. The type is stored as a 4-byte field.
 enum json_item_type_e
@@ -382,8 +401,9 @@ enum text_encoding_e
     TEXT_ENCODING_FORCE_32BIT               = 0x7FFFFFFFL
 };
 
-/// @summary Defines the color map types supported by the image format. This
-/// library only supports loading of TGA_COLORMAPTYPE_NONE images.
+/// @summary Defines the color map types supported by the image format. Images
+/// with TGA_COLORMAPTYPE_INCLUDED can be palettized, or true-color images that
+/// carry an unused color map.
 enum tga_colormaptype_e
 {
     TGA_COLORMAPTYPE_NONE                   = 0,
@@ -402,6 +422,21 @@ enum tga_imagetype_e
     TGA_IMAGETYPE_RLE_GRAY                  = 11
 };
 
+/// @summary Defines the byte order of the 32-bit pixels written by
+/// tga_decode_rgba32() and read by tga_encode_rows().
+enum tga_pixel_order_e
+{
+    TGA_PIXEL_ORDER_RGBA                    = 0, /// R, G, B, A; matches DXGI_FORMAT_R8G8B8A8_UNORM.
+    TGA_PIXEL_ORDER_BGRA                    = 1  /// B, G, R, A; matches DXGI_FORMAT_B8G8R8A8_UNORM.
+};
+
+/// @summary Defines the compression methods supported by the PNG encoder.
+enum png_compression_e
+{
+    PNG_COMPRESSION_STORE                   = 0, /// Unfiltered rows in stored deflate blocks.
+    PNG_COMPRESSION_FAST                    = 1  /// Sub or Up filtered rows, greedy LZ77 with fixed Huffman codes.
+};
+
 /// @summary Defines the recognized compression types.
 enum wav_compression_type_e
 {
@@ -412,6 +447,34 @@ enum wav_compression_type_e
     WAVE_COMPRESISON_EXPERIMENTAL           = 0xFFFF
 };
 
+/// @summary Defines the fields present at the start of a texture atlas rect
+/// table. The header is followed immediately by RectCount atlas_rect_t.
+#pragma pack(push, 1)
+struct atlas_header_t
+{
+    uint32_t Magic;             /// LLDATAIN_ATLAS_MAGIC_LE ('ATLS').
+    uint16_t Version;           /// The table format version. Currently, 1.
+    uint16_t PageCount;         /// The number of pages (DDS array elements).
+    uint16_t PageWidth;         /// The width of each page, in pixels.
+    uint16_t PageHeight;        /// The height of each page, in pixels.
+    uint32_t RectCount;         /// The number of atlas_rect_t following the header.
+};
+#pragma pack(pop)
+
+/// @summary Describes the location of a single image within a texture atlas.
+/// Rects are stored in the order the source images were specified, and do not
+/// include any padding or edge extrusion.
+#pragma pack(push, 1)
+struct atlas_rect_t
+{
+    uint16_t Page;              /// The zero-based index of the page containing the image.
+    uint16_t X;                 /// The x-coordinate of the upper-left corner, in pixels.
+    uint16_t Y;                 /// The y-coordinate of the upper-left corner, in pixels.
+    uint16_t Width;             /// The width of the image, in pixels.
+    uint16_t Height;            /// The height of the image, in pixels.
+};
+#pragma pack(pop)
+
 /// @summary Defines the fields present on the main file header.
 #pragma pack(push, 1)
 struct bmfont_header_t
@@ -616,6 +679,89 @@ struct dds_level_desc_t
     uint32_t Format;          /// One of dxgi_format_e.
 };
 
+/// @summary Describes a DDS file opened with data::dds_open(). The file is
+/// mapped into memory copy-on-write, and the level descriptors point directly
+/// into the mapping, so no level data is copied. Modifications to the level
+/// data are private to the process and are never written back to the file.
+struct dds_file_t
+{
+    void               *Data;             /// Pointer to the start of the mapped file.
+    size_t              DataSize;         /// The size of the mapped file, in bytes.
+    dds_header_t        Header;           /// The base surface header.
+    dds_header_dxt10_t  HeaderEx;         /// The extended surface header, if HasHeaderEx is true.
+    bool                HasHeaderEx;      /// true if the file has a DX10 extended header.
+    uint32_t            Format;           /// One of dxgi_format_e.
+    size_t              ItemCount;        /// The number of array elements (times six for cubemaps.)
+    size_t              LevelCount;       /// The number of levels in each mipmap chain.
+    size_t              SubresourceCount; /// The number of entries in Levels (ItemCount * LevelCount.)
+    dds_level_desc_t   *Levels;           /// Level descriptors, in data::dds_describe() order.
+    uintptr_t           FileHandle;       /// Platform file handle. Internal use only.
+    uintptr_t           MapHandle;        /// Platform file mapping handle. Internal use only.
+};
+
+/// @summary The fixed-size header at the start of a KTX2 file, including the
+/// index of the data format descriptor, key/value and supercompression global
+/// data sections. See https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+#pragma pack(push, 1)
+struct ktx2_header_t
+{
+    uint8_t  Identifier[12];         /// AB 4B 54 58 20 32 30 BB 0D 0A 1A 0A.
+    uint32_t VkFormat;               /// The VkFormat of the image data, or 0 (VK_FORMAT_UNDEFINED).
+    uint32_t TypeSize;               /// The size of the data type, in bytes, used for endian conversion.
+    uint32_t PixelWidth;             /// The width of the base level, in pixels.
+    uint32_t PixelHeight;            /// The height of the base level, in pixels, or 0 for 1D images.
+    uint32_t PixelDepth;             /// The depth of the base level, in pixels, or 0 for 1D and 2D images.
+    uint32_t LayerCount;             /// The number of array elements, or 0 if not an array.
+    uint32_t FaceCount;              /// The number of cubemap faces (6), or 1.
+    uint32_t LevelCount;             /// The number of mipmap levels.
+    uint32_t SupercompressionScheme; /// The supercompression scheme, or 0 for none.
+    uint32_t DfdByteOffset;          /// The offset of the data format descriptor.
+    uint32_t DfdByteLength;          /// The size of the data format descriptor, in bytes.
+    uint32_t KvdByteOffset;          /// The offset of the key/value data, or 0.
+    uint32_t KvdByteLength;          /// The size of the key/value data, in bytes.
+    uint64_t SgdByteOffset;          /// The offset of the supercompression global data, or 0.
+    uint64_t SgdByteLength;          /// The size of the supercompression global data, in bytes.
+};
+#pragma pack(pop)
+
+/// @summary An entry in the level index of a KTX2 file, which immediately 
+/// follows the ktx2_header_t. Level 0, the base level, is the first entry.
+#pragma pack(push, 1)
+struct ktx2_level_index_t
+{
+    uint64_t ByteOffset;             /// The offset of the level data from the start of the file.
+    uint64_t ByteLength;             /// The size of the level data, in bytes.
+    uint64_t UncompressedByteLength; /// The size of the level data before supercompression.
+};
+#pragma pack(pop)
+
+/// @summary The header at the start of a supercompressed DDS (.ddsz) file. It
+/// is followed by HeaderSize bytes of the original DDS (magic, dds_header_t
+/// and dds_header_dxt10_t), then ChunkCount ddsz_chunk_t entries, then the
+/// compressed data. There is one chunk per subresource, in dds_describe order.
+#pragma pack(push, 1)
+struct ddsz_header_t
+{
+    uint32_t Magic;                  /// LLDATAIN_DDSZ_MAGIC_LE.
+    uint16_t Version;                /// The container version, currently 1.
+    uint16_t Codec;                  /// One of ddsz_codec_e.
+    uint32_t ChunkCount;             /// The number of entries in the chunk table.
+    uint32_t HeaderSize;             /// The size of the embedded DDS headers, in bytes.
+    uint64_t DataSize;               /// The size of the uncompressed DDS payload, in bytes.
+};
+#pragma pack(pop)
+
+/// @summary An entry in the chunk table of a supercompressed DDS. A chunk
+/// whose CompressedSize equals its UncompressedSize is stored uncompressed.
+#pragma pack(push, 1)
+struct ddsz_chunk_t
+{
+    uint64_t Offset;                 /// The offset of the chunk data from the start of the file.
+    uint32_t CompressedSize;         /// The size of the chunk data in the file, in bytes.
+    uint32_t UncompressedSize;       /// The size of the decompressed subresource, in bytes.
+};
+#pragma pack(pop)
+
 /// @summary Describes an error that was encountered while parsing a JSON document.
 struct json_error_t
 {
@@ -757,12 +903,25 @@ struct tga_desc_t
     size_t   ImageWidth;      /// The width of the image, in pixels.
     size_t   ImageHeight;     /// The height of the image, in pixels.
     size_t   BitsPerPixel;    /// The number of bits per-pixel, including alpha.
+    size_t   AttributeBits;   /// The number of alpha bits per-pixel.
     size_t   PixelDataSize;   /// Buffer size required to store decoded pixel data.
+    size_t   EncodedDataSize; /// The number of bytes from PixelData to the end of the input buffer.
     size_t   ColormapDataSize;/// The size of the colormap data block, in bytes.
     void    *ColormapData;    /// Pointer to the start of the colormap data.
     void    *PixelData;       /// Pointer to the start of the image data.
 };
 
+/// @summary Describes a band of rows of a PNG image compressed by
+/// png_encode_band(). Bands are independent of each other, so the bands of
+/// an image can be encoded in parallel and then combined by png_encode_bands().
+struct png_band_t
+{
+    void    *Data;            /// The compressed data of the band.
+    size_t   Size;            /// The number of bytes of compressed data.
+    size_t   FilteredSize;    /// The number of bytes of filtered row data in the band.
+    uint32_t Adler;           /// The Adler-32 checksum of the filtered row data.
+};
+
 /*////////////////
 //   Functions  //
 ////////////////*/
@@ -858,6 +1017,20 @@ LLDATAIN_PUBLIC char* load_text(char const *path, size_t *out_buffer_size, data:
 /// @return A buffer containing the loaded data, or NULL.
 LLDATAIN_PUBLIC void* load_binary(char const *path, size_t *out_buffer_size);
 
+/// @summary Retrieves the current position of a stdio stream. Supports
+/// positions beyond 2GB where the platform provides a 64-bit ftell.
+/// @param file The stream to query.
+/// @return The byte offset from the start of the stream, or -1 on error.
+LLDATAIN_PUBLIC int64_t file_tell(FILE *file);
+
+/// @summary Sets the position of a stdio stream. Supports positions beyond
+/// 2GB where the platform provides a 64-bit fseek.
+/// @param file The stream to reposition.
+/// @param offset The byte offset, relative to origin.
+/// @param origin One of SEEK_SET, SEEK_CUR or SEEK_END.
+/// @return true if the stream was repositioned.
+LLDATAIN_PUBLIC bool file_seek(FILE *file, int64_t offset, int origin);
+
 /// @summary Reads the surface header present in all DDS files.
 /// @param data The buffer from which the header data should be read.
 /// @param data_size The maximum number of bytes to read from the input buffer.
@@ -960,6 +1133,120 @@ LLDATAIN_PUBLIC size_t dds_describe(
     data::dds_level_desc_t         *out_levels,
     size_t                          max_levels);
 
+/// @summary Maps a DDS file into memory, validates its headers and builds the
+/// table of subresources. Every subresource must lie entirely within the file.
+/// @param path The NULL-terminated path of the file to open.
+/// @return The file description, or NULL if the file cannot be mapped or is
+/// not a valid DDS. Call data::dds_close() to unmap the file.
+LLDATAIN_PUBLIC data::dds_file_t* dds_open(char const *path);
+
+/// @summary Releases the memory holding the pages of a subresource of a file
+/// opened with data::dds_open(), so that streaming through a large file does
+/// not keep all of it resident. The data is reloaded from the file if it is
+/// accessed again; any in-place modifications to it may be lost.
+/// @param file The file returned by data::dds_open().
+/// @param level The subresource, which must be one of file->Levels.
+LLDATAIN_PUBLIC void dds_discard(data::dds_file_t *file, data::dds_level_desc_t const *level);
+
+/// @summary Unmaps a file opened with data::dds_open() and frees the level
+/// descriptor table. Pointers into the file data are invalid after this call.
+/// @param file The file returned by data::dds_open(), or NULL.
+LLDATAIN_PUBLIC void dds_close(data::dds_file_t *file);
+
+/// @summary Determines the format of the texels produced when decoding a
+/// block-compressed format with data::bc_decode_block() or bc_decode_rows().
+/// BC1, BC2 and BC3 decode to RGBA. BC4 decodes to red and BC5 to red and
+/// green, with blue set to zero and alpha set to one.
+/// @param format One of dxgi_format_e.
+/// @return DXGI_FORMAT_R8G8B8A8_UNORM (or _UNORM_SRGB), DXGI_FORMAT_R8G8B8A8_SNORM
+/// for BC4_SNORM and BC5_SNORM, or DXGI_FORMAT_UNKNOWN if format cannot be decoded.
+LLDATAIN_PUBLIC uint32_t bc_decode_format(uint32_t format);
+
+/// @summary Decodes a single 4x4 block to four rows of four 4-byte texels.
+/// @param dst The location of the first texel of the block in the destination.
+/// @param dst_pitch The number of bytes between rows of the destination.
+/// @param block The encoded block.
+/// @param format One of dxgi_format_e.
+/// @return true if the block was decoded, or false if format is not supported.
+LLDATAIN_PUBLIC bool bc_decode_block(void *dst, size_t dst_pitch, void const *block, uint32_t format);
+
+/// @summary Decodes a band of rows of 4x4 blocks from one slice of a block-
+/// compressed level. Each row of blocks produces four rows of level->Width
+/// 4-byte texels, including any padding to a multiple of four. Bands do not
+/// share any state, so a level can be decoded on several threads at once.
+/// @param dst The destination for the decoded texels, which must hold at least
+/// 4 * row_count rows of dst_pitch bytes.
+/// @param dst_pitch The number of bytes between rows of the destination. Must
+/// be at least level->Width * 4.
+/// @param level The level to decode, as returned by data::dds_describe().
+/// @param slice The zero-based slice of the level to decode.
+/// @param first_row The zero-based index of the first row of blocks to decode.
+/// @param row_count The number of rows of blocks to decode.
+/// @return true if the rows were decoded, or false if the format is not
+/// supported or the rows are outside of the level.
+LLDATAIN_PUBLIC bool bc_decode_rows(
+    void                         *dst,
+    size_t                        dst_pitch,
+    data::dds_level_desc_t const *level,
+    size_t                        slice,
+    size_t                        first_row,
+    size_t                        row_count);
+
+/// @summary Computes the maximum size of the output of data::lz_compress().
+/// @param src_size The size of the uncompressed data, in bytes.
+/// @return The maximum number of bytes produced by compressing src_size bytes.
+LLDATAIN_PUBLIC size_t lz_compress_bound(size_t src_size);
+
+/// @summary Compresses a block of data using the LZ block format, which uses
+/// the same sequence encoding as LZ4: a token byte holding the literal and
+/// match lengths, the literals, and a 16-bit match offset.
+/// @param dst The buffer to which the compressed data will be written.
+/// @param dst_size The maximum number of bytes that can be written to dst.
+/// @param src The data to compress.
+/// @param src_size The number of bytes to compress. Must be less than 4GB.
+/// @return The number of bytes written to dst, or 0 if dst is too small.
+LLDATAIN_PUBLIC size_t lz_compress(void *dst, size_t dst_size, void const *src, size_t src_size);
+
+/// @summary Decompresses a block of data produced by data::lz_compress(). The
+/// input is validated, so malformed data cannot write outside of dst.
+/// @param dst The buffer to which the decompressed data will be written.
+/// @param dst_size The maximum number of bytes that can be written to dst.
+/// @param src The compressed data.
+/// @param src_size The number of bytes of compressed data.
+/// @return The number of bytes written to dst, or 0 if the data is malformed.
+LLDATAIN_PUBLIC size_t lz_decompress(void *dst, size_t dst_size, void const *src, size_t src_size);
+
+/// @summary Reads the header of a supercompressed DDS.
+/// @param data The buffer from which the header data should be read.
+/// @param data_size The maximum number of bytes to read from the input buffer.
+/// @param out_header Pointer to the structure to populate.
+/// @return true if the file appears to be a valid supercompressed DDS file.
+LLDATAIN_PUBLIC bool ddsz_header(void const *data, size_t data_size, data::ddsz_header_t *out_header);
+
+/// @summary Retrieves the chunk table of a supercompressed DDS. The chunks
+/// are independent and may be decompressed in parallel with lz_decompress().
+/// @param data The buffer from which the data should be read.
+/// @param data_size The maximum number of bytes to read from the input buffer.
+/// @param out_chunks A buffer of ddsz_header_t::ChunkCount chunk descriptors
+/// to populate with data (or max_chunks, whichever is less.)
+/// @param max_chunks The maximum number of items to write to out_chunks.
+/// @return The number of chunk descriptors written to out_chunks.
+LLDATAIN_PUBLIC size_t ddsz_describe(void const *data, size_t data_size, data::ddsz_chunk_t *out_chunks, size_t max_chunks);
+
+/// @summary Determines the size of the DDS file stored in a supercompressed DDS.
+/// @param header The header of the supercompressed DDS.
+/// @return The number of bytes required to hold the decompressed DDS file.
+LLDATAIN_PUBLIC size_t ddsz_dds_size(data::ddsz_header_t const *header);
+
+/// @summary Restores the original DDS file from a supercompressed DDS. The
+/// result can be passed to dds_header() and dds_describe().
+/// @param dst The buffer to which the DDS file will be written.
+/// @param dst_size The size of dst. Must be at least ddsz_dds_size() bytes.
+/// @param data The supercompressed DDS data.
+/// @param data_size The number of bytes of supercompressed DDS data.
+/// @return The number of bytes written to dst, or 0 if the data is invalid.
+LLDATAIN_PUBLIC size_t ddsz_decompress(void *dst, size_t dst_size, void const *data, size_t data_size);
+
 /// @summary Describes the format of uncompressed PCM sound data stored in a
 /// RIFF WAVE container. Compressed audio is not supported.
 /// @param data The buffer from which data should be read.
@@ -1097,10 +1384,9 @@ LLDATAIN_PUBLIC bool tga_describe(void const *data, size_t data_size, data::tga_
 /// @return true if the image data was decoded and written to the output buffer.
 LLDATAIN_PUBLIC bool tga_decode_r8(void *dst, size_t dst_size, data::tga_desc_t const *desc);
 
-/// @summary Decodes 16/24/32 bit TGA data into a caller-managed buffer. Pixels
-/// are logically stored in ARGB order, but on a little-endian machine appear
-/// in BGRA byte order. Use GL_BGRA/GL_UNSIGNED_INT_8_8_8_8_REV to upload this
-/// data to OpenGL most efficiently. Uncompressed, palettized and RLE-encoded
+/// @summary Decodes 15/16/24/32 bit TGA data into a caller-managed buffer.
+/// Pixels are written in R, G, B, A byte order, and rows are written in the
+/// order they are stored in the file. Uncompressed, palettized and RLE-encoded
 /// images are supported, but grayscale images should use tga_decode_r8().
 /// @param dst The buffer to write to, of at least ImageWidth * ImageHeight * 4 bytes.
 /// @param dst_size The maximum number of bytes to write to the destination buffer.
@@ -1108,6 +1394,140 @@ LLDATAIN_PUBLIC bool tga_decode_r8(void *dst, size_t dst_size, data::tga_desc_t
 /// @return true if the image data was decoded and written to the output buffer.
 LLDATAIN_PUBLIC bool tga_decode_argb32(void *dst, size_t dst_size, data::tga_desc_t const *desc);
 
+/// @summary Decodes 15/16/24/32 bit or palettized TGA data into a caller-managed
+/// buffer in the byte order needed by the caller, with the top row of the image
+/// first. The conversion uses SSSE3 or AVX2 when the host processor supports them.
+/// @param dst The buffer to write to, of at least ImageWidth * ImageHeight * 4 bytes.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param desc A description of the data in the TGA image.
+/// @param order One of tga_pixel_order_e specifying the byte order of the output.
+/// @return true if the image data was decoded and written to the output buffer.
+LLDATAIN_PUBLIC bool tga_decode_rgba32(void *dst, size_t dst_size, data::tga_desc_t const *desc, uint32_t order);
+
+/// @summary Computes the maximum size of a TGA image written by tga_encode().
+/// @param width The width of the image, in pixels.
+/// @param height The height of the image, in pixels.
+/// @param bits_per_pixel The number of bits per-pixel in the TGA, either 24 or 32.
+/// @return The maximum number of bytes written by tga_encode(), including the header.
+LLDATAIN_PUBLIC size_t tga_encode_bound(size_t width, size_t height, size_t bits_per_pixel);
+
+/// @summary Writes the header of a true-color TGA image with its origin at the
+/// upper left corner, so rows are stored top to bottom.
+/// @param dst The buffer to write to, of at least sizeof(tga_header_t) bytes.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param width The width of the image, in pixels, between 1 and 65535.
+/// @param height The height of the image, in pixels, between 1 and 65535.
+/// @param bits_per_pixel The number of bits per-pixel in the TGA, either 24 or 32.
+/// @param rle true to declare RLE-encoded pixel data, or false for raw pixel data.
+/// @return The number of bytes written to dst, or 0 if an argument is invalid.
+LLDATAIN_PUBLIC size_t tga_encode_header(void *dst, size_t dst_size, size_t width, size_t height, size_t bits_per_pixel, bool rle);
+
+/// @summary Encodes rows of 32-bit pixels as TGA pixel data. RLE packets never
+/// cross the end of a row, so separate runs of rows can be encoded in parallel
+/// and concatenated after the header written by tga_encode_header(). 24-bit
+/// output discards the alpha channel.
+/// @param dst The buffer to write to.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param src The first source row, in the byte order given by order.
+/// @param src_pitch The number of bytes between the start of each source row.
+/// @param width The number of pixels in each row.
+/// @param row_count The number of rows to encode.
+/// @param order One of tga_pixel_order_e specifying the byte order of the source pixels.
+/// @param bits_per_pixel The number of bits per-pixel in the TGA, either 24 or 32.
+/// @param rle true to write RLE packets, or false to write raw pixel data.
+/// @return The number of bytes written to dst, or 0 if dst is too small.
+LLDATAIN_PUBLIC size_t tga_encode_rows(void *dst, size_t dst_size, void const *src, size_t src_pitch, size_t width, size_t row_count, uint32_t order, size_t bits_per_pixel, bool rle);
+
+/// @summary Encodes a complete TGA image, header and pixel data, from 32-bit pixels.
+/// @param dst The buffer to write to, of at least tga_encode_bound() bytes.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param src The top row of the image, in the byte order given by order.
+/// @param src_pitch The number of bytes between the start of each source row.
+/// @param width The width of the image, in pixels, between 1 and 65535.
+/// @param height The height of the image, in pixels, between 1 and 65535.
+/// @param order One of tga_pixel_order_e specifying the byte order of the source pixels.
+/// @param bits_per_pixel The number of bits per-pixel in the TGA, either 24 or 32.
+/// @param rle true to write RLE packets, or false to write raw pixel data.
+/// @return The number of bytes written to dst, or 0 if an argument is invalid or dst is too small.
+LLDATAIN_PUBLIC size_t tga_encode(void *dst, size_t dst_size, void const *src, size_t src_pitch, size_t width, size_t height, uint32_t order, size_t bits_per_pixel, bool rle);
+
+/// @summary Computes the maximum size of a band compressed by png_encode_band().
+/// The bound is the size of the filtered rows stored without compression;
+/// png_encode_band() falls back to stored blocks for data that does not compress.
+/// @param width The width of the image, in pixels.
+/// @param row_count The number of rows in the band.
+/// @param channels The number of 8-bit channels per-pixel, between 1 and 4.
+/// @return The maximum number of bytes written by png_encode_band().
+LLDATAIN_PUBLIC size_t png_band_bound(size_t width, size_t row_count, size_t channels);
+
+/// @summary Filters and compresses a band of rows of an image as a sequence of
+/// deflate blocks that do not refer to data outside of the band. Bands other
+/// than the last end on a byte boundary with an empty stored block, so the
+/// bands of an image can be encoded in parallel and then combined in order
+/// by png_encode_bands().
+/// @param dst The buffer to write to, of at least png_band_bound() bytes.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param src The top row of the image. Pixels have channels 8-bit values in
+/// PNG order: gray, gray and alpha, RGB or RGBA.
+/// @param src_pitch The number of bytes between the start of each source row.
+/// @param width The width of the image, in pixels.
+/// @param first_row The zero-based index of the first row in the band. The row
+/// above the band is read by the Up filter.
+/// @param row_count The number of rows in the band.
+/// @param channels The number of 8-bit channels per-pixel, between 1 and 4.
+/// @param compression One of png_compression_e.
+/// @param last true if the band contains the last row of the image.
+/// @param out_band On return, describes the compressed band. Data is set to dst.
+/// @return The number of bytes written to dst, or 0 if an argument is invalid
+/// or memory could not be allocated for the filtered rows.
+LLDATAIN_PUBLIC size_t png_encode_band(
+    void               *dst,
+    size_t              dst_size,
+    void const         *src,
+    size_t              src_pitch,
+    size_t              width,
+    size_t              first_row,
+    size_t              row_count,
+    size_t              channels,
+    uint32_t            compression,
+    bool                last,
+    data::png_band_t   *out_band);
+
+/// @summary Writes a complete PNG image from the compressed bands of its rows.
+/// Each band is stored in its own IDAT chunk, and the Adler-32 checksum of the
+/// zlib stream is combined from the checksums of the bands.
+/// @param dst The buffer to write to, or NULL to compute the required size.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param width The width of the image, in pixels.
+/// @param height The height of the image, in pixels.
+/// @param channels The number of 8-bit channels per-pixel, between 1 and 4.
+/// @param bands The bands of the image, in top to bottom order. The data of
+/// a band may already be at its final position in dst.
+/// @param band_count The number of items in bands.
+/// @return The number of bytes written to (or required for) dst, or 0 if
+/// the bands do not cover the image or dst is too small.
+LLDATAIN_PUBLIC size_t png_encode_bands(void *dst, size_t dst_size, size_t width, size_t height, size_t channels, data::png_band_t const *bands, size_t band_count);
+
+/// @summary Computes the maximum size of a PNG image written by png_encode().
+/// @param width The width of the image, in pixels.
+/// @param height The height of the image, in pixels.
+/// @param channels The number of 8-bit channels per-pixel, between 1 and 4.
+/// @return The maximum number of bytes written by png_encode().
+LLDATAIN_PUBLIC size_t png_encode_bound(size_t width, size_t height, size_t channels);
+
+/// @summary Encodes a complete 8-bit PNG image as a single band.
+/// @param dst The buffer to write to, of at least png_encode_bound() bytes.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param src The top row of the image. Pixels have channels 8-bit values in
+/// PNG order: gray, gray and alpha, RGB or RGBA.
+/// @param src_pitch The number of bytes between the start of each source row.
+/// @param width The width of the image, in pixels.
+/// @param height The height of the image, in pixels.
+/// @param channels The number of 8-bit channels per-pixel, between 1 and 4.
+/// @param compression One of png_compression_e.
+/// @return The number of bytes written to dst, or 0 if an argument is invalid or dst is too small.
+LLDATAIN_PUBLIC size_t png_encode(void *dst, size_t dst_size, void const *src, size_t src_pitch, size_t width, size_t height, size_t channels, uint32_t compression);
+
 /// @summary Generates a little-endian FOURCC.
 /// @param a...d The four characters comprising the code.
 /// @return The packed four-cc value, in little-endian format.
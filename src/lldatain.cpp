@@ -15,6 +15,42 @@
 #include <stdlib.h>
 #include "lldatain.hpp"
 
+/// @summary Abstract platform differences for memory-mapped file I/O.
+#if defined(_WIN32) || defined(_WIN64)
+    #define  WIN32_LEAN_AND_MEAN
+    #define  NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+/// @summary Enable SSE2 code paths where the target guarantees SSE2 support.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define  LLDATAIN_SSE2   1
+#else
+    #define  LLDATAIN_SSE2   0
+#endif
+
+/// @summary Enable SSSE3 and AVX2 code paths, selected at runtime, on x86
+/// targets where the compiler can generate them for individual functions.
+#if LLDATAIN_SSE2 && (defined(__GNUC__) || defined(_MSC_VER)) && \
+    (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+    #include <intrin.h>
+    #define  LLDATAIN_TARGET(isa)
+    #else
+    #define  LLDATAIN_TARGET(isa) __attribute__((target(isa)))
+    #endif
+    #define  LLDATAIN_X86_SIMD 1
+#else
+    #define  LLDATAIN_X86_SIMD 0
+#endif
+
 /*/////////////////
 //   Constants   //
 /////////////////*/
@@ -42,6 +78,14 @@
     #define FPOS_TYPE     int64_t
 #endif
 
+/// @summary Flags returned by simd_features() for the optional instruction
+/// sets used by the pixel conversion routines.
+enum simd_feature_e
+{
+    SIMD_SSSE3 = (1 << 0),
+    SIMD_AVX2  = (1 << 1)
+};
+
 /// @summary Boilerplate to populate a JSON error description and clean up.
 #define JSON_ERROR(it, desc, err)                                             \
     if (err != NULL)                                                          \
@@ -112,6 +156,196 @@ static signed char const Base64_Indices[] =
     -1, -1, -1, -1, -1, -1, -1, -1
 };
 
+/// @summary The minimum length of a match in the LZ block format.
+static size_t const      LZ_MIN_MATCH     = 4;
+
+/// @summary The maximum distance between a match and its source, which must
+/// fit in the 16-bit offset field of a sequence.
+static size_t const      LZ_MAX_OFFSET    = 65535;
+
+/// @summary The number of bytes at the end of a block that are always stored
+/// as literals. A match never starts within LZ_MATCH_LIMIT bytes of the end,
+/// which lets the decoder copy in 8-byte steps without checking every byte.
+static size_t const      LZ_LAST_LITERALS = 5;
+static size_t const      LZ_MATCH_LIMIT   = 12;
+
+/// @summary The number of bits used to index the encoder's match hash table.
+static size_t const      LZ_HASH_BITS     = 12;
+
+/// @summary The table used to compute the CRC-32 of PNG chunks, one byte at a
+/// time, for the reflected polynomial 0xEDB88320.
+static uint32_t const    Crc32_Table[256] =
+{
+    0x00000000U, 0x77073096U, 0xEE0E612CU, 0x990951BAU, 0x076DC419U, 0x706AF48FU,
+    0xE963A535U, 0x9E6495A3U, 0x0EDB8832U, 0x79DCB8A4U, 0xE0D5E91EU, 0x97D2D988U,
+    0x09B64C2BU, 0x7EB17CBDU, 0xE7B82D07U, 0x90BF1D91U, 0x1DB71064U, 0x6AB020F2U,
+    0xF3B97148U, 0x84BE41DEU, 0x1ADAD47DU, 0x6DDDE4EBU, 0xF4D4B551U, 0x83D385C7U,
+    0x136C9856U, 0x646BA8C0U, 0xFD62F97AU, 0x8A65C9ECU, 0x14015C4FU, 0x63066CD9U,
+    0xFA0F3D63U, 0x8D080DF5U, 0x3B6E20C8U, 0x4C69105EU, 0xD56041E4U, 0xA2677172U,
+    0x3C03E4D1U, 0x4B04D447U, 0xD20D85FDU, 0xA50AB56BU, 0x35B5A8FAU, 0x42B2986CU,
+    0xDBBBC9D6U, 0xACBCF940U, 0x32D86CE3U, 0x45DF5C75U, 0xDCD60DCFU, 0xABD13D59U,
+    0x26D930ACU, 0x51DE003AU, 0xC8D75180U, 0xBFD06116U, 0x21B4F4B5U, 0x56B3C423U,
+    0xCFBA9599U, 0xB8BDA50FU, 0x2802B89EU, 0x5F058808U, 0xC60CD9B2U, 0xB10BE924U,
+    0x2F6F7C87U, 0x58684C11U, 0xC1611DABU, 0xB6662D3DU, 0x76DC4190U, 0x01DB7106U,
+    0x98D220BCU, 0xEFD5102AU, 0x71B18589U, 0x06B6B51FU, 0x9FBFE4A5U, 0xE8B8D433U,
+    0x7807C9A2U, 0x0F00F934U, 0x9609A88EU, 0xE10E9818U, 0x7F6A0DBBU, 0x086D3D2DU,
+    0x91646C97U, 0xE6635C01U, 0x6B6B51F4U, 0x1C6C6162U, 0x856530D8U, 0xF262004EU,
+    0x6C0695EDU, 0x1B01A57BU, 0x8208F4C1U, 0xF50FC457U, 0x65B0D9C6U, 0x12B7E950U,
+    0x8BBEB8EAU, 0xFCB9887CU, 0x62DD1DDFU, 0x15DA2D49U, 0x8CD37CF3U, 0xFBD44C65U,
+    0x4DB26158U, 0x3AB551CEU, 0xA3BC0074U, 0xD4BB30E2U, 0x4ADFA541U, 0x3DD895D7U,
+    0xA4D1C46DU, 0xD3D6F4FBU, 0x4369E96AU, 0x346ED9FCU, 0xAD678846U, 0xDA60B8D0U,
+    0x44042D73U, 0x33031DE5U, 0xAA0A4C5FU, 0xDD0D7CC9U, 0x5005713CU, 0x270241AAU,
+    0xBE0B1010U, 0xC90C2086U, 0x5768B525U, 0x206F85B3U, 0xB966D409U, 0xCE61E49FU,
+    0x5EDEF90EU, 0x29D9C998U, 0xB0D09822U, 0xC7D7A8B4U, 0x59B33D17U, 0x2EB40D81U,
+    0xB7BD5C3BU, 0xC0BA6CADU, 0xEDB88320U, 0x9ABFB3B6U, 0x03B6E20CU, 0x74B1D29AU,
+    0xEAD54739U, 0x9DD277AFU, 0x04DB2615U, 0x73DC1683U, 0xE3630B12U, 0x94643B84U,
+    0x0D6D6A3EU, 0x7A6A5AA8U, 0xE40ECF0BU, 0x9309FF9DU, 0x0A00AE27U, 0x7D079EB1U,
+    0xF00F9344U, 0x8708A3D2U, 0x1E01F268U, 0x6906C2FEU, 0xF762575DU, 0x806567CBU,
+    0x196C3671U, 0x6E6B06E7U, 0xFED41B76U, 0x89D32BE0U, 0x10DA7A5AU, 0x67DD4ACCU,
+    0xF9B9DF6FU, 0x8EBEEFF9U, 0x17B7BE43U, 0x60B08ED5U, 0xD6D6A3E8U, 0xA1D1937EU,
+    0x38D8C2C4U, 0x4FDFF252U, 0xD1BB67F1U, 0xA6BC5767U, 0x3FB506DDU, 0x48B2364BU,
+    0xD80D2BDAU, 0xAF0A1B4CU, 0x36034AF6U, 0x41047A60U, 0xDF60EFC3U, 0xA867DF55U,
+    0x316E8EEFU, 0x4669BE79U, 0xCB61B38CU, 0xBC66831AU, 0x256FD2A0U, 0x5268E236U,
+    0xCC0C7795U, 0xBB0B4703U, 0x220216B9U, 0x5505262FU, 0xC5BA3BBEU, 0xB2BD0B28U,
+    0x2BB45A92U, 0x5CB36A04U, 0xC2D7FFA7U, 0xB5D0CF31U, 0x2CD99E8BU, 0x5BDEAE1DU,
+    0x9B64C2B0U, 0xEC63F226U, 0x756AA39CU, 0x026D930AU, 0x9C0906A9U, 0xEB0E363FU,
+    0x72076785U, 0x05005713U, 0x95BF4A82U, 0xE2B87A14U, 0x7BB12BAEU, 0x0CB61B38U,
+    0x92D28E9BU, 0xE5D5BE0DU, 0x7CDCEFB7U, 0x0BDBDF21U, 0x86D3D2D4U, 0xF1D4E242U,
+    0x68DDB3F8U, 0x1FDA836EU, 0x81BE16CDU, 0xF6B9265BU, 0x6FB077E1U, 0x18B74777U,
+    0x88085AE6U, 0xFF0F6A70U, 0x66063BCAU, 0x11010B5CU, 0x8F659EFFU, 0xF862AE69U,
+    0x616BFFD3U, 0x166CCF45U, 0xA00AE278U, 0xD70DD2EEU, 0x4E048354U, 0x3903B3C2U,
+    0xA7672661U, 0xD06016F7U, 0x4969474DU, 0x3E6E77DBU, 0xAED16A4AU, 0xD9D65ADCU,
+    0x40DF0B66U, 0x37D83BF0U, 0xA9BCAE53U, 0xDEBB9EC5U, 0x47B2CF7FU, 0x30B5FFE9U,
+    0xBDBDF21CU, 0xCABAC28AU, 0x53B39330U, 0x24B4A3A6U, 0xBAD03605U, 0xCDD70693U,
+    0x54DE5729U, 0x23D967BFU, 0xB3667A2EU, 0xC4614AB8U, 0x5D681B02U, 0x2A6F2B94U,
+    0xB40BBE37U, 0xC30C8EA1U, 0x5A05DF1BU, 0x2D02EF8DU
+};
+
+/// @summary The number of bits used to index the deflate encoder's match hash table.
+static size_t const      DEFLATE_HASH_BITS   = 15;
+
+/// @summary The maximum distance between a deflate match and its source.
+static size_t const      DEFLATE_MAX_OFFSET  = 32768;
+
+/// @summary The minimum and maximum lengths of a deflate match. The encoder
+/// only looks for matches of at least four bytes.
+static size_t const      DEFLATE_MIN_MATCH   = 4;
+static size_t const      DEFLATE_MAX_MATCH   = 258;
+
+/// @summary The maximum number of bytes in a stored deflate block.
+static size_t const      DEFLATE_MAX_STORED  = 65535;
+
+/// @summary The bit-reversed fixed Huffman codes of the 288 deflate literal/length
+/// symbols, ready to be written least-significant bit first. Symbols 0-143
+/// have 8-bit codes, 144-255 have 9-bit codes, 256-279 have 7-bit codes and
+/// 280-287 have 8-bit codes.
+static uint16_t const    Deflate_Fixed_Codes[288] =
+{
+    0x00C, 0x08C, 0x04C, 0x0CC, 0x02C, 0x0AC, 0x06C, 0x0EC, 0x01C, 0x09C, 0x05C, 0x0DC,
+    0x03C, 0x0BC, 0x07C, 0x0FC, 0x002, 0x082, 0x042, 0x0C2, 0x022, 0x0A2, 0x062, 0x0E2,
+    0x012, 0x092, 0x052, 0x0D2, 0x032, 0x0B2, 0x072, 0x0F2, 0x00A, 0x08A, 0x04A, 0x0CA,
+    0x02A, 0x0AA, 0x06A, 0x0EA, 0x01A, 0x09A, 0x05A, 0x0DA, 0x03A, 0x0BA, 0x07A, 0x0FA,
+    0x006, 0x086, 0x046, 0x0C6, 0x026, 0x0A6, 0x066, 0x0E6, 0x016, 0x096, 0x056, 0x0D6,
+    0x036, 0x0B6, 0x076, 0x0F6, 0x00E, 0x08E, 0x04E, 0x0CE, 0x02E, 0x0AE, 0x06E, 0x0EE,
+    0x01E, 0x09E, 0x05E, 0x0DE, 0x03E, 0x0BE, 0x07E, 0x0FE, 0x001, 0x081, 0x041, 0x0C1,
+    0x021, 0x0A1, 0x061, 0x0E1, 0x011, 0x091, 0x051, 0x0D1, 0x031, 0x0B1, 0x071, 0x0F1,
+    0x009, 0x089, 0x049, 0x0C9, 0x029, 0x0A9, 0x069, 0x0E9, 0x019, 0x099, 0x059, 0x0D9,
+    0x039, 0x0B9, 0x079, 0x0F9, 0x005, 0x085, 0x045, 0x0C5, 0x025, 0x0A5, 0x065, 0x0E5,
+    0x015, 0x095, 0x055, 0x0D5, 0x035, 0x0B5, 0x075, 0x0F5, 0x00D, 0x08D, 0x04D, 0x0CD,
+    0x02D, 0x0AD, 0x06D, 0x0ED, 0x01D, 0x09D, 0x05D, 0x0DD, 0x03D, 0x0BD, 0x07D, 0x0FD,
+    0x013, 0x113, 0x093, 0x193, 0x053, 0x153, 0x0D3, 0x1D3, 0x033, 0x133, 0x0B3, 0x1B3,
+    0x073, 0x173, 0x0F3, 0x1F3, 0x00B, 0x10B, 0x08B, 0x18B, 0x04B, 0x14B, 0x0CB, 0x1CB,
+    0x02B, 0x12B, 0x0AB, 0x1AB, 0x06B, 0x16B, 0x0EB, 0x1EB, 0x01B, 0x11B, 0x09B, 0x19B,
+    0x05B, 0x15B, 0x0DB, 0x1DB, 0x03B, 0x13B, 0x0BB, 0x1BB, 0x07B, 0x17B, 0x0FB, 0x1FB,
+    0x007, 0x107, 0x087, 0x187, 0x047, 0x147, 0x0C7, 0x1C7, 0x027, 0x127, 0x0A7, 0x1A7,
+    0x067, 0x167, 0x0E7, 0x1E7, 0x017, 0x117, 0x097, 0x197, 0x057, 0x157, 0x0D7, 0x1D7,
+    0x037, 0x137, 0x0B7, 0x1B7, 0x077, 0x177, 0x0F7, 0x1F7, 0x00F, 0x10F, 0x08F, 0x18F,
+    0x04F, 0x14F, 0x0CF, 0x1CF, 0x02F, 0x12F, 0x0AF, 0x1AF, 0x06F, 0x16F, 0x0EF, 0x1EF,
+    0x01F, 0x11F, 0x09F, 0x19F, 0x05F, 0x15F, 0x0DF, 0x1DF, 0x03F, 0x13F, 0x0BF, 0x1BF,
+    0x07F, 0x17F, 0x0FF, 0x1FF, 0x000, 0x040, 0x020, 0x060, 0x010, 0x050, 0x030, 0x070,
+    0x008, 0x048, 0x028, 0x068, 0x018, 0x058, 0x038, 0x078, 0x004, 0x044, 0x024, 0x064,
+    0x014, 0x054, 0x034, 0x074, 0x003, 0x083, 0x043, 0x0C3, 0x023, 0x0A3, 0x063, 0x0E3
+};
+
+/// @summary Maps a match length minus 3 to the index of its deflate length code.
+static uint8_t const     Deflate_Length_Code[256] =
+{
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  8,  9,  9, 10, 10, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15,
+    16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17,
+    18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19, 19,
+    20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
+    21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+    22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+    23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23,
+    24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+    24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+    25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+    25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+    26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+    26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+    27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
+    27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 28
+};
+
+/// @summary The base match length and the number of extra bits of each
+/// deflate length code, symbols 257 through 285.
+static uint16_t const    Deflate_Length_Base[29]  =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static uint8_t const     Deflate_Length_Extra[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0
+};
+
+/// @summary The bit-reversed 5-bit fixed code, base distance and number of
+/// extra bits of each deflate distance code.
+static uint8_t const     Deflate_Dist_Codes[30]   =
+{
+    0, 16, 8, 24, 4, 20, 12, 28, 2, 18, 10, 26, 6, 22, 14, 30, 1, 17, 9, 25,
+    5, 21, 13, 29, 3, 19, 11, 27, 7, 23
+};
+static uint16_t const    Deflate_Dist_Base[30]    =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+    769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static uint8_t const     Deflate_Dist_Extra[30]   =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+    11, 11, 12, 12, 13, 13
+};
+
+/*//////////////////
+//   Data Types   //
+//////////////////*/
+/// @summary Describes how the pixels of a TGA image are converted to 32-bit
+/// output pixels by tga_convert_span().
+struct tga_pixel_format_t
+{
+    size_t          Bytes;       /// The number of bytes per source pixel or colormap index.
+    bool            BGRA;        /// true to write BGRA byte order, or false to write RGBA.
+    bool            Alpha16;     /// true if the top bit of a 16-bit pixel is alpha.
+    uint32_t        SIMD;        /// The simd_feature_e flags returned by simd_features().
+    uint32_t const *Palette;     /// The converted colormap, or NULL for true-color pixels.
+    size_t          PaletteSize; /// The number of entries in Palette.
+    size_t          PaletteBase; /// The colormap index of the first entry in Palette.
+};
+
+/// @summary Maintains the state of the bit stream written by the deflate
+/// encoder. Bits are written least-significant bit first.
+struct deflate_writer_t
+{
+    uint8_t        *Out;         /// The next byte of the output buffer to write.
+    uint8_t        *End;         /// The end of the output buffer.
+    uint64_t        Bits;        /// Bits not yet written to the output buffer.
+    size_t          Count;       /// The number of valid bits in Bits.
+    bool            Overflow;    /// true if the output buffer is full.
+};
+
 /*///////////////////////
 //   Local Functions   //
 ///////////////////////*/
@@ -127,6 +361,117 @@ static uint64_t file_size(FILE *file)
     return uint64_t(endp);
 }
 
+/// @summary Maps an entire file into memory with copy-on-write semantics, so
+/// the caller may modify the data in-place without affecting the file.
+/// @param path The NULL-terminated path of the file to map.
+/// @param out_size On return, set to the size of the mapping, in bytes.
+/// @param out_file On return, set to the platform file handle.
+/// @param out_map On return, set to the platform file mapping handle.
+/// @return A pointer to the start of the mapping, or NULL. Empty files cannot be mapped.
+static void* map_file(char const *path, size_t *out_size, uintptr_t *out_file, uintptr_t *out_map)
+{
+    *out_size = 0; *out_file = 0; *out_map = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER size;
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || uint64_t(size.QuadPart) > uint64_t(size_t(-1)))
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE map = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (map == NULL)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+    void *addr = MapViewOfFile(map, FILE_MAP_COPY, 0, 0, 0);
+    if (addr == NULL)
+    {
+        CloseHandle(map);
+        CloseHandle(file);
+        return NULL;
+    }
+    *out_size = size_t(size.QuadPart);
+    *out_file = uintptr_t(file);
+    *out_map  = uintptr_t(map);
+    return addr;
+#else
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || uint64_t(st.st_size) > uint64_t(size_t(-1)))
+    {
+        close(fd);
+        return NULL;
+    }
+    void *addr = mmap(NULL, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    *out_size = size_t(st.st_size);
+    *out_file = uintptr_t(fd);
+    *out_map  = 0;
+    return addr;
+#endif
+}
+
+/// @summary Releases a mapping created with map_file().
+/// @param addr The address returned by map_file().
+/// @param size The size of the mapping, in bytes.
+/// @param file The platform file handle returned by map_file().
+/// @param map The platform file mapping handle returned by map_file().
+static void unmap_file(void *addr, size_t size, uintptr_t file, uintptr_t map)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void) size;
+    UnmapViewOfFile(addr);
+    CloseHandle((HANDLE) map);
+    CloseHandle((HANDLE) file);
+#else
+    (void) map;
+    munmap(addr, size);
+    close(int(file));
+#endif
+}
+
+/// @summary Releases the physical memory backing the whole pages of a range of
+/// a mapping created with map_file(). The pages are reloaded from the file if
+/// accessed again, and any modifications made to them are lost on POSIX.
+/// @param addr The start of the range.
+/// @param size The size of the range, in bytes.
+static void discard_pages(void *addr, size_t size)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    uintptr_t page  = uintptr_t(info.dwPageSize);
+#else
+    uintptr_t page  = uintptr_t(sysconf(_SC_PAGESIZE));
+#endif
+    uintptr_t first = (uintptr_t(addr) + page - 1) & ~(page - 1);
+    uintptr_t last  = (uintptr_t(addr) + size) & ~(page - 1);
+    if (last <= first)
+    {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    // unlocking pages that are not locked removes them from the working set.
+    VirtualUnlock((void*) first, size_t(last - first));
+#else
+    madvise((void*) first, size_t(last - first), MADV_DONTNEED);
+#endif
+}
+
 /// @summary Utility function to return a pointer to the data at a given byte
 /// offset from the start of a buffer, cast to the desired type.
 /// @param buf Pointer to the buffer.
@@ -207,6 +552,97 @@ static uint8_t const* find_chunk(void const *start, void const *end, uint32_t id
     return NULL;
 }
 
+/// @summary Reads an unaligned 32-bit value from a buffer.
+/// @param p Pointer to the first byte to read.
+/// @return The 32-bit value.
+static inline uint32_t lz_read32(uint8_t const *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(uint32_t));
+    return v;
+}
+
+/// @summary Hashes the four bytes at the start of a potential match.
+/// @param v The four bytes, read as a 32-bit value.
+/// @return An index into the encoder's hash table.
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/// @summary Writes the extension bytes of a literal or match length that
+/// does not fit in the 4 bits of the token.
+/// @param op The current output position.
+/// @param len The length remaining after subtracting 15.
+/// @return The updated output position.
+static inline uint8_t* lz_write_length(uint8_t *op, size_t len)
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len  -= 255;
+    }
+    *op++ = uint8_t(len);
+    return op;
+}
+
+/// @summary Reads the extension bytes of a literal or match length.
+/// @param ip The current input position, updated on return.
+/// @param end The end of the input buffer.
+/// @param len The length to extend.
+/// @return false if the input ended before the length was complete.
+static inline bool lz_read_length(uint8_t const *&ip, uint8_t const *end, size_t &len)
+{
+    uint8_t b;
+    do
+    {
+        if (ip >= end) return false;
+        b    = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+/// @summary Writes a sequence of literals, optionally followed by a match.
+/// @param op The current output position.
+/// @param end The end of the output buffer.
+/// @param lit Pointer to the first literal byte.
+/// @param lit_len The number of literal bytes.
+/// @param offset The match offset, or 0 for the final literal-only sequence.
+/// @param match_len The match length, at least LZ_MIN_MATCH if offset is non-zero.
+/// @return The updated output position, or NULL if the output buffer is full.
+static uint8_t* lz_write_sequence(uint8_t *op, uint8_t *end, uint8_t const *lit, size_t lit_len, size_t offset, size_t match_len)
+{
+    size_t   ml    = offset ? match_len - LZ_MIN_MATCH : 0;
+    size_t   need  = 1 + lit_len + (lit_len / 255) + 1 + (offset ? 2 + (ml / 255) + 1 : 0);
+    uint8_t *token = op;
+    if (size_t(end - op) < need)
+        return NULL;
+
+    *op++ = 0;
+    if (lit_len >= 15)
+    {
+        *token = 15 << 4;
+        op     = lz_write_length(op, lit_len - 15);
+    }
+    else *token = uint8_t(lit_len << 4);
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (offset)
+    {
+        *op++ = uint8_t(offset & 0xFF);
+        *op++ = uint8_t(offset >> 8);
+        if (ml >= 15)
+        {
+            *token |= 15;
+            op      = lz_write_length(op, ml - 15);
+        }
+        else *token |= uint8_t(ml);
+    }
+    return op;
+}
+
 /// @summary Determines if a character represents a decimal digit.
 /// @param ch The input character.
 /// @return true if ch is any of '0', '1', '2', '3', '4', '5', '6', '7', '8' or '9'.
@@ -341,30 +777,1268 @@ static void json_print(FILE *fp, data::json_item_t *node, size_t indent_level)
             }
             break;
 
-        case data::JSON_TYPE_STRING:
-            fprintf(fp, "\"%s\"", node->Value.string);
-            break;
+        case data::JSON_TYPE_STRING:
+            fprintf(fp, "\"%s\"", node->Value.string);
+            break;
+
+        case data::JSON_TYPE_INTEGER:
+            // @note: #define __STDC_FORMAT_MACROS
+            // @note: #include <inttypes.h>
+            // fprintf(fp, "%"PRIu64, node->Value.integer);
+            break;
+
+        case data::JSON_TYPE_NUMBER:
+            fprintf(fp, "%f", node->Value.number);
+            break;
+
+        case data::JSON_TYPE_BOOLEAN:
+            fprintf(fp, node->value.Boolean ? "true" : "false");
+            break;
+
+        case data::JSON_TYPE_NULL:
+            fprintf(fp, "null");
+            break;
+    }
+}
+#endif /* #if 0 */
+
+/// @summary Expands a 5:6:5 color to a packed little-endian RGBA8 value with
+/// an alpha of 255, replicating the high bits into the low bits.
+/// @param c The 16-bit 5:6:5 color.
+/// @param rgb On return, stores the expanded red, green and blue channels.
+static inline void rgb565_expand(uint32_t c, uint32_t rgb[3])
+{
+    uint32_t r = (c >> 11) & 31;
+    uint32_t g = (c >>  5) & 63;
+    uint32_t b =  c        & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/// @summary Builds the four-entry palette of a BC1-style color block as packed
+/// RGBA8 values. Interpolation matches the rounding used by stb_dxt.
+/// @param block The 8-byte color block.
+/// @param four_color true to always decode in four-color mode, as BC2 and BC3
+/// do. Otherwise, a block with c0 <= c1 is decoded in three-color mode, where
+/// the fourth entry is transparent black.
+/// @param pal On return, stores the palette entries.
+static inline void bc1_palette(uint8_t const *block, bool four_color, uint32_t pal[4])
+{
+    uint32_t c0 = uint32_t(block[0]) | (uint32_t(block[1]) << 8);
+    uint32_t c1 = uint32_t(block[2]) | (uint32_t(block[3]) << 8);
+    uint32_t e0[3];
+    uint32_t e1[3];
+    uint32_t p2[3];
+    uint32_t p3[3];
+    rgb565_expand(c0, e0);
+    rgb565_expand(c1, e1);
+    if (four_color || c0 > c1)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            p2[k] = (2 * e0[k] + e1[k]) / 3;
+            p3[k] = (e0[k] + 2 * e1[k]) / 3;
+        }
+        pal[3] = p3[0] | (p3[1] << 8) | (p3[2] << 16) | 0xFF000000U;
+    }
+    else
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            p2[k] = (e0[k] + e1[k]) / 2;
+        }
+        pal[3] = 0;
+    }
+    pal[0] = e0[0] | (e0[1] << 8) | (e0[2] << 16) | 0xFF000000U;
+    pal[1] = e1[0] | (e1[1] << 8) | (e1[2] << 16) | 0xFF000000U;
+    pal[2] = p2[0] | (p2[1] << 8) | (p2[2] << 16) | 0xFF000000U;
+}
+
+/// @summary Decodes a BC1-style color block to 4x4 RGBA8 texels.
+/// @param dst The first texel of the block in the destination image.
+/// @param pitch The number of bytes between rows of the destination image.
+/// @param block The 8-byte color block.
+/// @param four_color true to always decode in four-color mode.
+/// @param alpha The 16 alpha values of the block in row-major order, or NULL
+/// to use the alpha of the palette entries.
+static inline void bc1_decode(uint8_t *dst, size_t pitch, uint8_t const *block, bool four_color, uint8_t const *alpha)
+{
+    uint32_t pal[4];
+    uint32_t bits = uint32_t(block[4]) | (uint32_t(block[5]) << 8) | (uint32_t(block[6]) << 16) | (uint32_t(block[7]) << 24);
+    bc1_palette(block, four_color, pal);
+#if LLDATAIN_SSE2
+    // shift each texel's 2-bit index into bits 6 and 7 of its 32-bit lane,
+    // then select the palette entry with a mask per index value.
+    __m128i const zero  = _mm_setzero_si128();
+    __m128i const shift = _mm_set_epi32(1, 4, 16, 64);
+    __m128i const imask = _mm_set1_epi32(0xC0);
+    __m128i const sel1  = _mm_set1_epi32(0x40);
+    __m128i const sel2  = _mm_set1_epi32(0x80);
+    __m128i const rgb   = _mm_set1_epi32(0x00FFFFFF);
+    __m128i const p0    = _mm_set1_epi32(int(pal[0]));
+    __m128i const p1    = _mm_set1_epi32(int(pal[1]));
+    __m128i const p2    = _mm_set1_epi32(int(pal[2]));
+    __m128i const p3    = _mm_set1_epi32(int(pal[3]));
+    for (size_t y = 0; y < 4; ++y, bits >>= 8, dst += pitch)
+    {
+        __m128i idx = _mm_and_si128(_mm_mullo_epi16(_mm_set1_epi32(int(bits & 0xFF)), shift), imask);
+        __m128i m1  = _mm_cmpeq_epi32(idx, sel1);
+        __m128i m2  = _mm_cmpeq_epi32(idx, sel2);
+        __m128i m3  = _mm_cmpeq_epi32(idx, imask);
+        __m128i out = _mm_or_si128(_mm_and_si128(m1, p1), _mm_andnot_si128(_mm_or_si128(m1, _mm_or_si128(m2, m3)), p0));
+        out = _mm_or_si128(out, _mm_or_si128(_mm_and_si128(m2, p2), _mm_and_si128(m3, p3)));
+        if (alpha != NULL)
+        {   // widen four alpha bytes to the top byte of each lane.
+            int32_t a;
+            memcpy(&a, alpha + y * 4, sizeof(int32_t));
+            __m128i va = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a), zero), zero);
+            out = _mm_or_si128(_mm_and_si128(out, rgb), _mm_slli_epi32(va, 24));
+        }
+        _mm_storeu_si128((__m128i*) dst, out);
+    }
+#else
+    for (size_t y = 0; y < 4; ++y, dst += pitch)
+    {
+        for (size_t x = 0; x < 4; ++x, bits >>= 2)
+        {
+            uint32_t c = pal[bits & 3];
+            dst[x * 4 + 0] = uint8_t(c);
+            dst[x * 4 + 1] = uint8_t(c >>  8);
+            dst[x * 4 + 2] = uint8_t(c >> 16);
+            dst[x * 4 + 3] = alpha != NULL ? alpha[y * 4 + x] : uint8_t(c >> 24);
+        }
+    }
+#endif
+}
+
+/// @summary Decodes a BC3-style interpolated alpha block, which is also used
+/// for each channel of BC4 and BC5.
+/// @param block The 8-byte alpha block.
+/// @param snorm true if the endpoints and values are signed (BC4_SNORM, BC5_SNORM).
+/// @param values On return, stores the 16 values of the block in row-major
+/// order. Signed values are stored in two's complement.
+static inline void bc_alpha_values(uint8_t const *block, bool snorm, uint8_t values[16])
+{
+    int      pal[8];
+    uint32_t lo = uint32_t(block[2]) | (uint32_t(block[3]) << 8) | (uint32_t(block[4]) << 16);
+    uint32_t hi = uint32_t(block[5]) | (uint32_t(block[6]) << 8) | (uint32_t(block[7]) << 16);
+    if (snorm)
+    {   // -128 is treated as -127.
+        pal[0] = max2<int>(-127, int(int8_t(block[0])));
+        pal[1] = max2<int>(-127, int(int8_t(block[1])));
+    }
+    else
+    {
+        pal[0] = block[0];
+        pal[1] = block[1];
+    }
+    if (pal[0] > pal[1])
+    {
+        for (int i = 2; i < 8; ++i) pal[i] = ((8 - i) * pal[0] + (i - 1) * pal[1]) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; ++i) pal[i] = ((6 - i) * pal[0] + (i - 1) * pal[1]) / 5;
+        pal[6] = snorm ? -127 : 0;
+        pal[7] = snorm ?  127 : 255;
+    }
+    // each group of 24 bits holds the 3-bit indices of eight texels.
+    for (size_t i = 0; i < 8; ++i, lo >>= 3, hi >>= 3)
+    {
+        values[i]     = uint8_t(pal[lo & 7]);
+        values[i + 8] = uint8_t(pal[hi & 7]);
+    }
+}
+
+/// @summary Decodes a BC2 explicit alpha block. Each 4-bit value is expanded
+/// to 8 bits.
+/// @param block The 8-byte alpha block.
+/// @param values On return, stores the 16 alpha values in row-major order.
+static inline void bc2_alpha_values(uint8_t const *block, uint8_t values[16])
+{
+    for (size_t i = 0; i < 8; ++i)
+    {
+        values[i * 2 + 0] = uint8_t((block[i] & 15) * 17);
+        values[i * 2 + 1] = uint8_t((block[i] >> 4) * 17);
+    }
+}
+
+/// @summary Writes 4x4 texels with red and green taken from BC4 or BC5 data,
+/// blue set to zero and alpha set to one.
+/// @param dst The first texel of the block in the destination image.
+/// @param pitch The number of bytes between rows of the destination image.
+/// @param red The 16 red values of the block in row-major order.
+/// @param green The 16 green values of the block, or NULL to store zero.
+/// @param one The value of alpha, 255 for UNORM or 127 for SNORM formats.
+static inline void bc_store_rg(uint8_t *dst, size_t pitch, uint8_t const *red, uint8_t const *green, uint8_t one)
+{
+#if LLDATAIN_SSE2
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const vr   = _mm_loadu_si128((__m128i const*) red);
+    __m128i const vg   = green != NULL ? _mm_loadu_si128((__m128i const*) green) : zero;
+    __m128i const vba  = _mm_set1_epi16(short(uint16_t(one) << 8));
+    __m128i const rg0  = _mm_unpacklo_epi8(vr, vg);
+    __m128i const rg1  = _mm_unpackhi_epi8(vr, vg);
+    _mm_storeu_si128((__m128i*)(dst            ), _mm_unpacklo_epi16(rg0, vba));
+    _mm_storeu_si128((__m128i*)(dst + pitch    ), _mm_unpackhi_epi16(rg0, vba));
+    _mm_storeu_si128((__m128i*)(dst + pitch * 2), _mm_unpacklo_epi16(rg1, vba));
+    _mm_storeu_si128((__m128i*)(dst + pitch * 3), _mm_unpackhi_epi16(rg1, vba));
+    (void) zero;
+#else
+    for (size_t y = 0; y < 4; ++y, dst += pitch)
+    {
+        for (size_t x = 0; x < 4; ++x)
+        {
+            dst[x * 4 + 0] = red[y * 4 + x];
+            dst[x * 4 + 1] = green != NULL ? green[y * 4 + x] : 0;
+            dst[x * 4 + 2] = 0;
+            dst[x * 4 + 3] = one;
+        }
+    }
+#endif
+}
+
+/// @summary Decodes a single block of any format supported by data::bc_decode_block().
+/// @param dst The first texel of the block in the destination image.
+/// @param pitch The number of bytes between rows of the destination image.
+/// @param block The encoded block.
+/// @param format One of dxgi_format_e.
+static inline void bc_decode(uint8_t *dst, size_t pitch, uint8_t const *block, uint32_t format)
+{
+    uint8_t v0[16];
+    uint8_t v1[16];
+    switch (format)
+    {
+        case data::DXGI_FORMAT_BC1_TYPELESS:
+        case data::DXGI_FORMAT_BC1_UNORM:
+        case data::DXGI_FORMAT_BC1_UNORM_SRGB:
+            bc1_decode(dst, pitch, block, false, NULL);
+            break;
+        case data::DXGI_FORMAT_BC2_TYPELESS:
+        case data::DXGI_FORMAT_BC2_UNORM:
+        case data::DXGI_FORMAT_BC2_UNORM_SRGB:
+            bc2_alpha_values(block, v0);
+            bc1_decode(dst, pitch, block + 8, true, v0);
+            break;
+        case data::DXGI_FORMAT_BC3_TYPELESS:
+        case data::DXGI_FORMAT_BC3_UNORM:
+        case data::DXGI_FORMAT_BC3_UNORM_SRGB:
+            bc_alpha_values(block, false, v0);
+            bc1_decode(dst, pitch, block + 8, true, v0);
+            break;
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+            bc_alpha_values(block, false, v0);
+            bc_store_rg(dst, pitch, v0, NULL, 255);
+            break;
+        case data::DXGI_FORMAT_BC4_SNORM:
+            bc_alpha_values(block, true, v0);
+            bc_store_rg(dst, pitch, v0, NULL, 127);
+            break;
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+            bc_alpha_values(block, false, v0);
+            bc_alpha_values(block + 8, false, v1);
+            bc_store_rg(dst, pitch, v0, v1, 255);
+            break;
+        case data::DXGI_FORMAT_BC5_SNORM:
+            bc_alpha_values(block, true, v0);
+            bc_alpha_values(block + 8, true, v1);
+            bc_store_rg(dst, pitch, v0, v1, 127);
+            break;
+        default:
+            break;
+    }
+}
+
+/// @summary Queries the optional SIMD instruction sets supported by the host
+/// processor and operating system.
+/// @return A combination of simd_feature_e flags.
+static uint32_t simd_features(void)
+{
+    uint32_t flags = 0;
+#if LLDATAIN_X86_SIMD && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) flags |= SIMD_SSSE3;
+    if (__builtin_cpu_supports("avx2" )) flags |= SIMD_AVX2;
+#elif LLDATAIN_X86_SIMD && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int nids = info[0];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx     = (info[2] & (1 << 28)) != 0;
+    if (info[2] & (1 << 9)) flags |= SIMD_SSSE3;
+    if (nids >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+    {   // the OS must also save the upper halves of the YMM registers.
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) flags |= SIMD_AVX2;
+    }
+#endif
+    return flags;
+}
+
+#if LLDATAIN_X86_SIMD
+/// @summary Converts 16 bytes, of which the first 12 are used, to 16 base64
+/// characters. The 6-bit indices are extracted with multiplies in place of
+/// shifts, then offset to ASCII by a table indexed by the range of each index.
+/// @param in The input bytes.
+/// @return The base64 characters.
+LLDATAIN_TARGET("ssse3")
+static inline __m128i base64_encode_block_ssse3(__m128i in)
+{
+    __m128i const lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                      '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m128i t0  = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    __m128i t1  = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+    __m128i idx = _mm_or_si128(t0, t1);
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12.
+    __m128i sel = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    sel = _mm_or_si128(sel, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+    return _mm_add_epi8(idx, _mm_shuffle_epi8(lut, sel));
+}
+
+/// @summary Base64-encodes input 12 bytes at a time.
+/// @param dst The destination characters.
+/// @param src The input data.
+/// @param src_size The number of bytes available at src.
+/// @return The number of input bytes encoded, a multiple of 12. The caller encodes the rest.
+LLDATAIN_TARGET("ssse3")
+static size_t base64_encode_ssse3(char *dst, uint8_t const *src, size_t src_size)
+{
+    size_t i = 0;
+    for ( ; src_size - i >= 16; i += 12, dst += 16)
+    {   // 16 bytes are loaded but only 12 are used.
+        __m128i in = _mm_loadu_si128((__m128i const*) (src + i));
+        _mm_storeu_si128((__m128i*) dst, base64_encode_block_ssse3(in));
+    }
+    return i;
+}
+
+/// @summary Base64-encodes input 24 bytes at a time.
+/// @param dst The destination characters.
+/// @param src The input data.
+/// @param src_size The number of bytes available at src.
+/// @return The number of input bytes encoded, a multiple of 24. The caller encodes the rest.
+LLDATAIN_TARGET("avx2")
+static size_t base64_encode_avx2(char *dst, uint8_t const *src, size_t src_size)
+{
+    __m256i const lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                         '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                         'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                         '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m256i const shuf = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                          1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    size_t        i    = 0;
+    for ( ; src_size - i >= 28; i += 24, dst += 32)
+    {   // each lane receives 12 bytes; the in-lane shuffle cannot cross lanes.
+        __m128i lo  = _mm_loadu_si128((__m128i const*) (src + i));
+        __m128i hi  = _mm_loadu_si128((__m128i const*) (src + i + 12));
+        __m256i in  = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuf);
+        __m256i t0  = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+        __m256i t1  = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+        __m256i idx = _mm256_or_si256(t0, t1);
+        __m256i sel = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        sel = _mm256_or_si256(sel, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*) dst, _mm256_add_epi8(idx, _mm256_shuffle_epi8(lut, sel)));
+    }
+    return i;
+}
+
+/// @summary Base64-decodes input 16 characters at a time. The characters are
+/// classified by their high and low nibbles; a block containing anything
+/// other than the 64 characters of the alphabet, including padding, is left
+/// to the caller. Exactly 12 bytes are stored per block, so the output
+/// buffer matches the scalar decoder byte for byte.
+/// @param dst The destination bytes.
+/// @param dst_size The number of bytes available at dst.
+/// @param src The base64 characters.
+/// @param src_size The number of characters available at src.
+/// @return The number of characters decoded, a multiple of 16, each 16 producing 12 bytes.
+LLDATAIN_TARGET("ssse3")
+static size_t base64_decode_ssse3(uint8_t *dst, size_t dst_size, char const *src, size_t src_size)
+{
+    __m128i const lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m128i const lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m128i const roll   = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i const nibble = _mm_set1_epi8(0x0F);
+    __m128i const zero   = _mm_setzero_si128();
+    size_t        i      = 0;
+    for ( ; src_size - i >= 16 && dst_size >= 12; i += 16, dst += 12, dst_size -= 12)
+    {
+        __m128i in = _mm_loadu_si128((__m128i const*) (src + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+        __m128i lo = _mm_and_si128(in, nibble);
+        __m128i ok = _mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi)), zero);
+        if (_mm_movemask_epi8(ok) != 0xFFFF)
+            break;
+
+        __m128i v  = _mm_add_epi8(in, _mm_shuffle_epi8(roll, _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hi)));
+        __m128i ab = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        __m128i ad = _mm_madd_epi16(ab, _mm_set1_epi32(0x00011000));
+        __m128i px = _mm_shuffle_epi8(ad, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        uint32_t hi32 = uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(px, 8)));
+        _mm_storel_epi64((__m128i*) dst, px);
+        memcpy(dst + 8, &hi32, 4);
+    }
+    return i;
+}
+
+/// @summary Base64-decodes input 32 characters at a time. See base64_decode_ssse3().
+/// @param dst The destination bytes.
+/// @param dst_size The number of bytes available at dst.
+/// @param src The base64 characters.
+/// @param src_size The number of characters available at src.
+/// @return The number of characters decoded, a multiple of 32, each 32 producing 24 bytes.
+LLDATAIN_TARGET("avx2")
+static size_t base64_decode_avx2(uint8_t *dst, size_t dst_size, char const *src, size_t src_size)
+{
+    __m256i const lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m256i const lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m256i const roll   = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i const pack   = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m256i const nibble = _mm256_set1_epi8(0x0F);
+    __m256i const zero   = _mm256_setzero_si256();
+    size_t        i      = 0;
+    for ( ; src_size - i >= 32 && dst_size >= 24; i += 32, dst += 24, dst_size -= 24)
+    {   // each lane produces 12 bytes, which are moved together before the store.
+        __m256i in = _mm256_loadu_si256((__m256i const*) (src + i));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+        __m256i lo = _mm256_and_si256(in, nibble);
+        __m256i ok = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, hi)), zero);
+        if (_mm256_movemask_epi8(ok) != -1)
+            break;
+
+        __m256i v  = _mm256_add_epi8(in, _mm256_shuffle_epi8(roll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')), hi)));
+        __m256i ab = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        __m256i ad = _mm256_madd_epi16(ab, _mm256_set1_epi32(0x00011000));
+        __m256i px = _mm256_shuffle_epi8(ad, pack);
+        px = _mm256_permutevar8x32_epi32(px, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm_storeu_si128((__m128i*)  dst, _mm256_castsi256_si128(px));
+        _mm_storel_epi64((__m128i*) (dst + 16), _mm256_extracti128_si256(px, 1));
+    }
+    return i;
+}
+#endif
+
+/// @summary Converts a single 15, 16, 24 or 32-bit TGA pixel, stored in
+/// A1R5G5B5 or BGR(A) order, to a 32-bit pixel in RGBA or BGRA byte order.
+/// Five-bit channels are expanded by replicating their high bits.
+/// @param dst The destination pixel.
+/// @param src The source pixel.
+/// @param fmt Describes the source pixels and the output byte order.
+static inline void tga_convert_pixel(uint8_t *dst, uint8_t const *src, tga_pixel_format_t const &fmt)
+{
+    uint8_t r, g, b, a;
+    if (fmt.Bytes == 2)
+    {
+        uint32_t v = uint32_t(src[0]) | (uint32_t(src[1]) << 8);
+        r = uint8_t(((v >> 7) & 0xF8) | ((v >> 12) & 0x07));
+        g = uint8_t(((v >> 2) & 0xF8) | ((v >>  7) & 0x07));
+        b = uint8_t(((v << 3) & 0xF8) | ((v >>  2) & 0x07));
+        a = (fmt.Alpha16 && (v & 0x8000) == 0) ? 0x00 : 0xFF;
+    }
+    else
+    {
+        b = src[0];
+        g = src[1];
+        r = src[2];
+        a = fmt.Bytes == 4 ? src[3] : 0xFF;
+    }
+    dst[0] = fmt.BGRA ? b : r;
+    dst[1] = g;
+    dst[2] = fmt.BGRA ? r : b;
+    dst[3] = a;
+}
+
+#if LLDATAIN_X86_SIMD
+/// @summary Converts 24-bit BGR pixels to 32-bit pixels four at a time.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels available at src.
+/// @param bgra true to write BGRA byte order, or false to write RGBA.
+/// @return The number of pixels converted. The caller converts the rest.
+LLDATAIN_TARGET("ssse3")
+static size_t tga_convert_24_ssse3(uint8_t *dst, uint8_t const *src, size_t count, bool bgra)
+{
+    __m128i const rgba  = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10,  9, -1);
+    __m128i const keep  = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1,  9, 10, 11, -1);
+    __m128i const mask  = bgra ? keep : rgba;
+    __m128i const alpha = _mm_set1_epi32(int(0xFF000000));
+    size_t        i     = 0;
+    for ( ; count - i >= 6; i += 4)
+    {   // 16 bytes are loaded but only 12 are used.
+        __m128i px = _mm_loadu_si128((__m128i const*) (src + i * 3));
+        _mm_storeu_si128((__m128i*) (dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(px, mask), alpha));
+    }
+    return i;
+}
+
+/// @summary Converts 24-bit BGR pixels to 32-bit pixels eight at a time.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels available at src.
+/// @param bgra true to write BGRA byte order, or false to write RGBA.
+/// @return The number of pixels converted. The caller converts the rest.
+LLDATAIN_TARGET("avx2")
+static size_t tga_convert_24_avx2(uint8_t *dst, uint8_t const *src, size_t count, bool bgra)
+{
+    __m256i const rgba  = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10,  9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10,  9, -1);
+    __m256i const keep  = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1,  9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1,  9, 10, 11, -1);
+    __m256i const mask  = bgra ? keep : rgba;
+    __m256i const alpha = _mm256_set1_epi32(int(0xFF000000));
+    size_t        i     = 0;
+    for ( ; count - i >= 10; i += 8)
+    {   // each lane receives four pixels; the in-lane shuffle cannot cross lanes.
+        __m128i lo = _mm_loadu_si128((__m128i const*) (src + i * 3));
+        __m128i hi = _mm_loadu_si128((__m128i const*) (src + i * 3 + 12));
+        __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i*) (dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(px, mask), alpha));
+    }
+    return i;
+}
+
+/// @summary Swaps the red and blue channels of 32-bit pixels four at a time.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels available at src.
+/// @return The number of pixels converted. The caller converts the rest.
+LLDATAIN_TARGET("ssse3")
+static size_t tga_swizzle_32_ssse3(uint8_t *dst, uint8_t const *src, size_t count)
+{
+    __m128i const mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t        i    = 0;
+    for ( ; count - i >= 4; i += 4)
+    {
+        __m128i px = _mm_loadu_si128((__m128i const*) (src + i * 4));
+        _mm_storeu_si128((__m128i*) (dst + i * 4), _mm_shuffle_epi8(px, mask));
+    }
+    return i;
+}
+
+/// @summary Swaps the red and blue channels of 32-bit pixels eight at a time.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels available at src.
+/// @return The number of pixels converted. The caller converts the rest.
+LLDATAIN_TARGET("avx2")
+static size_t tga_swizzle_32_avx2(uint8_t *dst, uint8_t const *src, size_t count)
+{
+    __m256i const mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t        i    = 0;
+    for ( ; count - i >= 8; i += 8)
+    {
+        __m256i px = _mm256_loadu_si256((__m256i const*) (src + i * 4));
+        _mm256_storeu_si256((__m256i*) (dst + i * 4), _mm256_shuffle_epi8(px, mask));
+    }
+    return i;
+}
+#endif
+
+/// @summary Converts a run of TGA pixels to 32-bit pixels in RGBA or BGRA
+/// byte order. Colormap indices are looked up in the converted colormap, and
+/// 24 and 32-bit pixels use the widest available SIMD kernel.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels to convert.
+/// @param fmt Describes the source pixels and the output byte order.
+static void tga_convert_span(uint8_t *dst, uint8_t const *src, size_t count, tga_pixel_format_t const &fmt)
+{
+    size_t i = 0;
+    if (fmt.Palette != NULL)
+    {   // indices outside of the colormap select its first entry.
+        for ( ; i < count; ++i)
+        {
+            size_t index = fmt.Bytes == 1 ? src[i] : (size_t(src[i * 2]) | (size_t(src[i * 2 + 1]) << 8));
+            size_t entry = index - fmt.PaletteBase;
+            if (index < fmt.PaletteBase || entry >= fmt.PaletteSize) entry = 0;
+            memcpy(dst + i * 4, &fmt.Palette[entry], 4);
+        }
+        return;
+    }
+    if (fmt.Bytes == 4 && fmt.BGRA)
+    {   // the pixels are already in the requested order.
+        memcpy(dst, src, count * 4);
+        return;
+    }
+#if LLDATAIN_X86_SIMD
+    if (fmt.Bytes == 3)
+    {
+        if (fmt.SIMD & SIMD_AVX2 ) i  = tga_convert_24_avx2 (dst, src, count, fmt.BGRA);
+        if (fmt.SIMD & SIMD_SSSE3) i += tga_convert_24_ssse3(dst + i * 4, src + i * 3, count - i, fmt.BGRA);
+    }
+    if (fmt.Bytes == 4)
+    {
+        if (fmt.SIMD & SIMD_AVX2 ) i  = tga_swizzle_32_avx2 (dst, src, count);
+        if (fmt.SIMD & SIMD_SSSE3) i += tga_swizzle_32_ssse3(dst + i * 4, src + i * 4, count - i);
+    }
+#endif
+    for ( ; i < count; ++i)
+    {
+        tga_convert_pixel(dst + i * 4, src + i * fmt.Bytes, fmt);
+    }
+}
+
+/// @summary Fills a run of 32-bit pixels with a single value, 16 bytes at a
+/// time where SSE2 is available.
+/// @param dst The destination pixels.
+/// @param pixel The four bytes of the pixel value.
+/// @param count The number of pixels to write.
+static void tga_fill(uint8_t *dst, uint8_t const *pixel, size_t count)
+{
+    uint32_t value;
+    size_t   i = 0;
+    memcpy(&value, pixel, 4);
+#if LLDATAIN_SSE2
+    __m128i  v = _mm_set1_epi32(int(value));
+    for ( ; count - i >= 4; i += 4)
+    {
+        _mm_storeu_si128((__m128i*) (dst + i * 4), v);
+    }
+#endif
+    for ( ; i < count; ++i)
+    {
+        memcpy(dst + i * 4, &value, 4);
+    }
+}
+
+/// @summary Decodes true-color or palettized TGA data, uncompressed or RLE,
+/// into 32-bit pixels. This is the implementation of tga_decode_argb32() and
+/// tga_decode_rgba32(). Packets are decoded a span at a time; runs are filled
+/// with wide stores and raw packets are converted in bulk. Every packet is
+/// checked against the end of the source data.
+/// @param dst The buffer to write to, of at least ImageWidth * ImageHeight * 4 bytes.
+/// @param dst_size The maximum number of bytes to write to the destination buffer.
+/// @param desc A description of the data in the TGA image.
+/// @param bgra true to write BGRA byte order, or false to write RGBA.
+/// @param top_down true to write the top row first regardless of the image
+/// origin, or false to write rows in the order they are stored.
+/// @return true if the image data was decoded and written to the output buffer.
+static bool tga_decode_32(void *dst, size_t dst_size, data::tga_desc_t const *desc, bool bgra, bool top_down)
+{
+    if (desc == NULL || desc->PixelDataSize == 0 || desc->PixelData == NULL)
+        return false; // invalid image description
+    if (dst  == NULL || dst_size < desc->PixelDataSize)
+        return false; // invalid destination buffer
+
+    bool const palette = desc->ImageType == data::TGA_IMAGETYPE_UNCOMPRESSED_PAL || desc->ImageType == data::TGA_IMAGETYPE_RLE_PAL;
+    bool const rle     = desc->ImageType == data::TGA_IMAGETYPE_RLE_TRUE || desc->ImageType == data::TGA_IMAGETYPE_RLE_PAL;
+    bool const direct  = desc->ImageType == data::TGA_IMAGETYPE_UNCOMPRESSED_TRUE || desc->ImageType == data::TGA_IMAGETYPE_RLE_TRUE;
+    size_t     bits    = palette ? desc->CmapEntrySize : desc->BitsPerPixel;
+    if (!palette && !direct)
+        return false; // grayscale images use tga_decode_r8().
+    if (bits != 15 && bits != 16 && bits != 24 && bits != 32)
+        return false; // unsupported pixel or colormap entry size.
+    if (palette && (desc->BitsPerPixel != 8 && desc->BitsPerPixel != 16))
+        return false; // unsupported colormap index size.
+    if (palette && (desc->ColormapType != data::TGA_COLORMAPTYPE_INCLUDED || desc->CmapLength == 0 || desc->ColormapData == NULL))
+        return false; // missing colormap.
+
+    tga_pixel_format_t fmt;
+    fmt.Bytes       = (bits + 7) / 8;
+    fmt.BGRA        = bgra;
+    fmt.Alpha16     = desc->AttributeBits > 0;
+    fmt.SIMD        = simd_features();
+    fmt.Palette     = NULL;
+    fmt.PaletteSize = 0;
+    fmt.PaletteBase = 0;
+
+    uint32_t *pal = NULL;
+    if (palette)
+    {   // convert the colormap once; pixels then become a table lookup.
+        if ((pal = (uint32_t*) malloc(desc->CmapLength * sizeof(uint32_t))) == NULL)
+            return false;
+        tga_convert_span((uint8_t*) pal, (uint8_t const*) desc->ColormapData, desc->CmapLength, fmt);
+        fmt.Bytes       = (desc->BitsPerPixel + 7) / 8;
+        fmt.Palette     = pal;
+        fmt.PaletteSize = desc->CmapLength;
+        fmt.PaletteBase = desc->CmapFirstEntry;
+    }
+
+    size_t   const width  = desc->ImageWidth;
+    size_t   const height = desc->ImageHeight;
+    size_t   const bpp    = fmt.Bytes;
+    size_t   const pitch  = width * 4;
+    bool     const flip   = top_down && desc->OriginBottom;
+    uint8_t       *base   = (uint8_t*) dst;
+    uint8_t const *srcp   = (uint8_t const*) desc->PixelData;
+    uint8_t const *srce   = srcp + desc->EncodedDataSize;
+    bool           res    = true;
+
+    if (!rle)
+    {
+        if (width * height * bpp > desc->EncodedDataSize)
+            res = false; // truncated pixel data.
+        for (size_t row = 0; row < height && res; ++row)
+        {
+            tga_convert_span(base + (flip ? height - 1 - row : row) * pitch, srcp, width, fmt);
+            srcp += width * bpp;
+        }
+    }
+    else
+    {   // packets may span rows, so each is split at the end of the row.
+        size_t   col  = 0;
+        size_t   row  = 0;
+        uint8_t *dstp = base + (flip ? height - 1 : 0) * pitch;
+        while (row < height)
+        {
+            if (srcp >= srce)
+            {   // truncated packet header.
+                res = false;
+                break;
+            }
+            uint8_t hdr = *srcp++;
+            size_t  rl  = (hdr & 0x7F) + 1;
+            bool    run = (hdr & 0x80) != 0;
+            if (size_t(srce - srcp) < (run ? bpp : rl * bpp))
+            {   // truncated packet data.
+                res = false;
+                break;
+            }
+            uint8_t px[4];
+            if (run) tga_convert_span(px, srcp, 1, fmt);
+            while (rl > 0 && row < height)
+            {
+                size_t n = rl < width - col ? rl : width - col;
+                if (run) tga_fill(dstp + col * 4, px, n);
+                else tga_convert_span(dstp + col * 4, srcp, n, fmt);
+                if (!run) srcp += n * bpp;
+                col  += n;
+                rl   -= n;
+                if (col == width && ++row < height)
+                {
+                    col  = 0;
+                    dstp = base + (flip ? height - 1 - row : row) * pitch;
+                }
+            }
+            if (run) srcp += bpp;
+        }
+    }
+    free(pal);
+    return res;
+}
+
+#if LLDATAIN_X86_SIMD
+/// @summary Converts 32-bit pixels to 24-bit TGA pixels, in B, G, R byte
+/// order, four at a time.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels available at src.
+/// @param src_bgra true if the source pixels are in BGRA byte order, or false for RGBA.
+/// @return The number of pixels converted. The caller converts the rest.
+LLDATAIN_TARGET("ssse3")
+static size_t tga_pack_24_ssse3(uint8_t *dst, uint8_t const *src, size_t count, bool src_bgra)
+{
+    __m128i const rgba = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1);
+    __m128i const keep = _mm_setr_epi8(0, 1, 2, 4, 5, 6,  8,  9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i const mask = src_bgra ? keep : rgba;
+    size_t        i    = 0;
+    for ( ; count - i >= 6; i += 4)
+    {   // 16 bytes are stored but only 12 are used; the next store overwrites the rest.
+        __m128i px = _mm_loadu_si128((__m128i const*) (src + i * 4));
+        _mm_storeu_si128((__m128i*) (dst + i * 3), _mm_shuffle_epi8(px, mask));
+    }
+    return i;
+}
+#endif
+
+/// @summary Converts a run of 32-bit pixels to 24 or 32-bit TGA pixels, which
+/// are stored in B, G, R(, A) byte order, using the widest available SIMD kernel.
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param count The number of pixels to convert.
+/// @param bytes The number of bytes per destination pixel, either 3 or 4.
+/// @param src_bgra true if the source pixels are in BGRA byte order, or false for RGBA.
+/// @param simd The simd_feature_e flags returned by simd_features().
+static void tga_encode_span(uint8_t *dst, uint8_t const *src, size_t count, size_t bytes, bool src_bgra, uint32_t simd)
+{
+    size_t const r = src_bgra ? 2 : 0;
+    size_t const b = src_bgra ? 0 : 2;
+    size_t       i = 0;
+    if (bytes == 4 && src_bgra)
+    {   // the pixels are already in TGA order.
+        memcpy(dst, src, count * 4);
+        return;
+    }
+#if LLDATAIN_X86_SIMD
+    if (bytes == 4)
+    {
+        if (simd & SIMD_AVX2 ) i  = tga_swizzle_32_avx2 (dst, src, count);
+        if (simd & SIMD_SSSE3) i += tga_swizzle_32_ssse3(dst + i * 4, src + i * 4, count - i);
+    }
+    if (bytes == 3 && (simd & SIMD_SSSE3))
+    {
+        i = tga_pack_24_ssse3(dst, src, count, src_bgra);
+    }
+#else
+    (void) simd;
+#endif
+    for ( ; i < count; ++i)
+    {
+        uint8_t       *d = dst + i * bytes;
+        uint8_t const *s = src + i * 4;
+        d[0] = s[b];
+        d[1] = s[1];
+        d[2] = s[r];
+        if (bytes == 4) d[3] = s[3];
+    }
+}
+
+/// @summary Counts the pixels at the start of a span that are equal to the
+/// first pixel, up to the 128 pixels that fit in one RLE packet.
+/// @param px The first source pixel.
+/// @param count The number of pixels remaining in the row.
+/// @param mask The bits of each 32-bit pixel that are compared.
+/// @return The length of the run, at least 1.
+static size_t tga_run_length(uint8_t const *px, size_t count, uint32_t mask)
+{
+    uint32_t const v = lz_read32(px) & mask;
+    size_t   const n = min2<size_t>(count, 128);
+    size_t         i = 1;
+#if LLDATAIN_SSE2
+    __m128i  const vv = _mm_set1_epi32(int(v));
+    __m128i  const mm = _mm_set1_epi32(int(mask));
+    for ( ; n - i >= 4; i += 4)
+    {
+        __m128i p    = _mm_and_si128(_mm_loadu_si128((__m128i const*) (px + i * 4)), mm);
+        int     bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(p, vv)));
+        if (bits != 15)
+        {   // the run ends within these four pixels.
+            for ( ; bits & 1; bits >>= 1) ++i;
+            return i;
+        }
+    }
+#endif
+    while (i < n && (lz_read32(px + i * 4) & mask) == v) ++i;
+    return i;
+}
+
+/// @summary Counts the pixels at the start of a span that precede the first
+/// pair of equal neighbours, up to the 128 pixels that fit in one raw packet.
+/// @param px The first source pixel.
+/// @param count The number of pixels remaining in the row.
+/// @param mask The bits of each 32-bit pixel that are compared.
+/// @return The number of pixels to store in a raw packet.
+static size_t tga_raw_length(uint8_t const *px, size_t count, uint32_t mask)
+{
+    size_t const n = min2<size_t>(count, 128);
+    size_t       i = 0;
+#if LLDATAIN_SSE2
+    __m128i const mm = _mm_set1_epi32(int(mask));
+    for ( ; n - i >= 4 && count - i >= 5; i += 4)
+    {   // compare pixels i..i+3 with their right neighbours.
+        __m128i a    = _mm_and_si128(_mm_loadu_si128((__m128i const*) (px + i * 4)), mm);
+        __m128i b    = _mm_and_si128(_mm_loadu_si128((__m128i const*) (px + i * 4 + 4)), mm);
+        int     bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));
+        if (bits != 0)
+        {
+            for ( ; (bits & 1) == 0; bits >>= 1) ++i;
+            return i;
+        }
+    }
+#endif
+    for ( ; i < n; ++i)
+    {
+        if (i + 1 < count && (lz_read32(px + i * 4) & mask) == (lz_read32(px + i * 4 + 4) & mask))
+            break;
+    }
+    return i;
+}
+
+/// @summary Encodes one row of 32-bit pixels as TGA RLE packets. A run of two
+/// or more equal pixels is stored as a run packet, and everything else is
+/// gathered into raw packets.
+/// @param op The current output position.
+/// @param end The end of the output buffer.
+/// @param row The source pixels.
+/// @param width The number of pixels in the row.
+/// @param bytes The number of bytes per destination pixel, either 3 or 4.
+/// @param src_bgra true if the source pixels are in BGRA byte order, or false for RGBA.
+/// @param simd The simd_feature_e flags returned by simd_features().
+/// @return The updated output position, or NULL if the output buffer is full.
+static uint8_t* tga_encode_rle_row(uint8_t *op, uint8_t *end, uint8_t const *row, size_t width, size_t bytes, bool src_bgra, uint32_t simd)
+{
+    uint32_t const mask = bytes == 3 ? 0x00FFFFFFU : 0xFFFFFFFFU;
+    size_t         x    = 0;
+    while (x < width)
+    {
+        uint8_t const *px  = row + x * 4;
+        size_t         run = tga_run_length(px, width - x, mask);
+        size_t         n   = run >= 2 ? 1 : tga_raw_length(px, width - x, mask);
+        if (size_t(end - op) < 1 + n * bytes)
+            return NULL;
+
+        *op++ = uint8_t(run >= 2 ? 0x80 | (run - 1) : n - 1);
+        tga_encode_span(op, px, n, bytes, src_bgra, simd);
+        op += n * bytes;
+        x  += run >= 2 ? run : n;
+    }
+    return op;
+}
+
+/// @summary Writes a 32-bit value in big-endian byte order, as used by PNG.
+/// @param dst The destination buffer.
+/// @param v The value to write.
+static inline void png_store32(uint8_t *dst, uint32_t v)
+{
+    dst[0] = uint8_t(v >> 24);
+    dst[1] = uint8_t(v >> 16);
+    dst[2] = uint8_t(v >>  8);
+    dst[3] = uint8_t(v);
+}
+
+/// @summary Updates a CRC-32 with a block of data. Large blocks are processed
+/// eight bytes at a time using tables derived from Crc32_Table on the stack,
+/// which costs far less to build than the bytewise loop it replaces.
+/// @param crc The CRC of the preceding data, or 0 to start a new CRC.
+/// @param data The data to add to the CRC.
+/// @param size The number of bytes of data.
+/// @return The updated CRC.
+static uint32_t png_crc32(uint32_t crc, uint8_t const *data, size_t size)
+{
+    crc = ~crc;
+    if (size >= 16384)
+    {
+        uint32_t t[8][256];
+        memcpy(t[0], Crc32_Table, sizeof(Crc32_Table));
+        for (size_t k = 1; k < 8; ++k)
+        {
+            for (size_t n = 0; n < 256; ++n)
+                t[k][n] = (t[k-1][n] >> 8) ^ Crc32_Table[t[k-1][n] & 0xFF];
+        }
+        for ( ; size >= 8; size -= 8, data += 8)
+        {
+            uint32_t lo = crc ^ (uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24));
+            uint32_t hi =        uint32_t(data[4]) | (uint32_t(data[5]) << 8) | (uint32_t(data[6]) << 16) | (uint32_t(data[7]) << 24);
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                  t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        }
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = Crc32_Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/// @summary Updates an Adler-32 checksum with a block of data. The sums are
+/// reduced every 5552 bytes, the most that cannot overflow 32 bits. With SSE2,
+/// each 16 bytes add their sum to the first sum and their sum weighted by
+/// 16..1 to the second sum, plus 16 times the first sum before them.
+/// @param adler The checksum of the preceding data, or 1 to start a new checksum.
+/// @param data The data to add to the checksum.
+/// @param size The number of bytes of data.
+/// @return The updated checksum.
+static uint32_t adler32(uint32_t adler, uint8_t const *data, size_t size)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0)
+    {
+        size_t n = min2<size_t>(size, 5552);
+        size_t i = 0;
+#if LLDATAIN_SSE2
+        if (n >= 16)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const whi  = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+            __m128i const wlo  = _mm_setr_epi16( 8,  7,  6,  5,  4,  3,  2, 1);
+            __m128i       vs1  = zero;
+            __m128i       vs2  = zero;
+            __m128i       vps  = zero;
+            uint32_t      s[4];
+            for ( ; n - i >= 16; i += 16)
+            {
+                __m128i v = _mm_loadu_si128((__m128i const*) (data + i));
+                vps = _mm_add_epi32(vps, vs1);
+                vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(v, zero));
+                vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), whi));
+                vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), wlo));
+            }
+            _mm_storeu_si128((__m128i*) s, vps);
+            uint64_t ps = uint64_t(s[0]) + s[1] + s[2] + s[3];
+            _mm_storeu_si128((__m128i*) s, vs2);
+            uint64_t s2 = uint64_t(s[0]) + s[1] + s[2] + s[3];
+            _mm_storeu_si128((__m128i*) s, vs1);
+            uint64_t s1 = uint64_t(s[0]) + s[1] + s[2] + s[3];
+            b = uint32_t((b + uint64_t(i) * a + ps * 16 + s2) % 65521);
+            a = uint32_t((a + s1) % 65521);
+        }
+#endif
+        for ( ; i < n; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a    %= 65521;
+        b    %= 65521;
+        data += n;
+        size -= n;
+    }
+    return (b << 16) | a;
+}
+
+/// @summary Computes the Adler-32 checksum of two concatenated blocks of data
+/// from the checksums of the blocks, as done by zlib's adler32_combine().
+/// @param adler1 The checksum of the first block.
+/// @param adler2 The checksum of the second block.
+/// @param size2 The number of bytes in the second block.
+/// @return The checksum of the concatenated blocks.
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+    uint64_t const base = 65521;
+    uint64_t const rem  = uint64_t(size2 % base);
+    uint64_t       sum1 = adler1 & 0xFFFF;
+    uint64_t       sum2 = (rem * sum1) % base;
+    sum1 += (adler2 & 0xFFFF) + base - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+    if (sum1 >= base) sum1 -= base;
+    if (sum1 >= base) sum1 -= base;
+    if (sum2 >= base * 2) sum2 -= base * 2;
+    if (sum2 >= base) sum2 -= base;
+    return uint32_t(sum1 | (sum2 << 16));
+}
+
+/// @summary Filters one row of a PNG image with the Sub or Up filter, choosing
+/// the one with the smaller sum of absolute differences, a cheap estimate of
+/// how well the row will compress.
+/// @param dst The destination, receiving the filter type byte and the filtered row.
+/// @param row The source row.
+/// @param prev The row above, or NULL for the first row of the image.
+/// @param size The number of bytes in the row.
+/// @param bpp The number of bytes per-pixel.
+static void png_filter_row(uint8_t *dst, uint8_t const *row, uint8_t const *prev, size_t size, size_t bpp)
+{
+    size_t sub = 0;
+    size_t up  = 0;
+    size_t i   = 0;
+    for ( ; i < bpp; ++i)
+    {
+        uint8_t s = row[i];
+        uint8_t u = uint8_t(row[i] - (prev ? prev[i] : 0));
+        sub += s < 128 ? s : 256 - s;
+        up  += u < 128 ? u : 256 - u;
+    }
+#if LLDATAIN_SSE2
+    __m128i const zero = _mm_setzero_si128();
+    __m128i       vsub = zero;
+    __m128i       vup  = zero;
+    for ( ; size - i >= 16; i += 16)
+    {   // |d| of a signed byte is min(d, -d) as unsigned bytes.
+        __m128i r = _mm_loadu_si128((__m128i const*) (row + i));
+        __m128i l = _mm_loadu_si128((__m128i const*) (row + i - bpp));
+        __m128i u = prev ? _mm_loadu_si128((__m128i const*) (prev + i)) : zero;
+        __m128i s = _mm_sub_epi8(r, l);
+        __m128i d = _mm_sub_epi8(r, u);
+        vsub = _mm_add_epi64(vsub, _mm_sad_epu8(_mm_min_epu8(s, _mm_sub_epi8(zero, s)), zero));
+        vup  = _mm_add_epi64(vup , _mm_sad_epu8(_mm_min_epu8(d, _mm_sub_epi8(zero, d)), zero));
+    }
+    sub += size_t(_mm_cvtsi128_si32(vsub)) + size_t(_mm_cvtsi128_si32(_mm_srli_si128(vsub, 8)));
+    up  += size_t(_mm_cvtsi128_si32(vup )) + size_t(_mm_cvtsi128_si32(_mm_srli_si128(vup , 8)));
+#endif
+    for ( ; i < size; ++i)
+    {
+        uint8_t s = uint8_t(row[i] - row[i - bpp]);
+        uint8_t u = uint8_t(row[i] - (prev ? prev[i] : 0));
+        sub += s < 128 ? s : 256 - s;
+        up  += u < 128 ? u : 256 - u;
+    }
+
+    if (up <= sub)
+    {   // without a previous row, Up is the same as no filtering.
+        dst[0] = prev ? 2 : 0;
+        if (prev == NULL)
+        {
+            memcpy(dst + 1, row, size);
+            return;
+        }
+        for (i = 0; i < size; ++i)
+        {
+            dst[1 + i] = uint8_t(row[i] - prev[i]);
+        }
+    }
+    else
+    {
+        dst[0] = 1;
+        for (i = 0; i < bpp; ++i)
+        {
+            dst[1 + i] = row[i];
+        }
+        for ( ; i < size; ++i)
+        {
+            dst[1 + i] = uint8_t(row[i] - row[i - bpp]);
+        }
+    }
+}
+
+/// @summary Appends bits to a deflate bit stream, writing them out 32 bits at
+/// a time. If the output buffer fills up, the writer is flagged as overflowed
+/// and further bits are discarded.
+/// @param w The bit stream writer.
+/// @param bits The bits to write, least-significant bit first.
+/// @param count The number of bits to write, at most 32.
+static inline void deflate_put(deflate_writer_t &w, uint32_t bits, size_t count)
+{
+    w.Bits  |= uint64_t(bits) << w.Count;
+    w.Count += count;
+    if (w.Count >= 32)
+    {
+        if (w.End - w.Out < 4)
+        {
+            w.Overflow = true;
+            w.Bits     = 0;
+            w.Count    = 0;
+            return;
+        }
+        w.Out[0] = uint8_t(w.Bits);
+        w.Out[1] = uint8_t(w.Bits >>  8);
+        w.Out[2] = uint8_t(w.Bits >> 16);
+        w.Out[3] = uint8_t(w.Bits >> 24);
+        w.Out   += 4;
+        w.Bits >>= 32;
+        w.Count -= 32;
+    }
+}
 
-        case data::JSON_TYPE_INTEGER:
-            // @note: #define __STDC_FORMAT_MACROS
-            // @note: #include <inttypes.h>
-            // fprintf(fp, "%"PRIu64, node->Value.integer);
+/// @summary Writes any buffered bits to the output, padding the final byte
+/// with zero bits so the stream ends on a byte boundary.
+/// @param w The bit stream writer.
+static void deflate_align(deflate_writer_t &w)
+{
+    for ( ; w.Count > 0 && !w.Overflow; w.Count = w.Count > 8 ? w.Count - 8 : 0)
+    {
+        if (w.Out == w.End)
+        {
+            w.Overflow = true;
             break;
+        }
+        *w.Out++ = uint8_t(w.Bits);
+        w.Bits >>= 8;
+    }
+    w.Bits  = 0;
+    w.Count = 0;
+}
 
-        case data::JSON_TYPE_NUMBER:
-            fprintf(fp, "%f", node->Value.number);
-            break;
+/// @summary Writes a literal byte using the fixed Huffman code.
+/// @param w The bit stream writer.
+/// @param value The literal byte value.
+static inline void deflate_literal(deflate_writer_t &w, uint8_t value)
+{
+    deflate_put(w, Deflate_Fixed_Codes[value], value < 144 ? 8 : 9);
+}
 
-        case data::JSON_TYPE_BOOLEAN:
-            fprintf(fp, node->value.Boolean ? "true" : "false");
-            break;
+/// @summary Writes a match using the fixed Huffman code, along with the extra
+/// bits of its length and distance codes.
+/// @param w The bit stream writer.
+/// @param length The match length, between 3 and DEFLATE_MAX_MATCH.
+/// @param distance The match distance, between 1 and DEFLATE_MAX_OFFSET.
+static inline void deflate_match(deflate_writer_t &w, size_t length, size_t distance)
+{
+    size_t const lc = Deflate_Length_Code[length - 3];
+    size_t const ln = lc + 257 < 280 ? 7 : 8;
+    size_t const d  = distance - 1;
+    size_t       dc = d;
+    if (d >= 4)
+    {   // two codes per power of two, selected by the second-highest bit.
+        size_t b = 2;
+        while ((d >> b) > 1) ++b;
+        dc = 2 * b + ((d >> (b - 1)) & 1);
+    }
+    deflate_put(w, Deflate_Fixed_Codes[lc + 257] | (uint32_t(length - Deflate_Length_Base[lc]) << ln), ln + Deflate_Length_Extra[lc]);
+    deflate_put(w, Deflate_Dist_Codes[dc] | (uint32_t(distance - Deflate_Dist_Base[dc]) << 5), 5 + Deflate_Dist_Extra[dc]);
+}
 
-        case data::JSON_TYPE_NULL:
-            fprintf(fp, "null");
-            break;
+/// @summary Compresses a block of data as a single deflate block with fixed
+/// Huffman codes, using greedy matching against the most recent position with
+/// the same four-byte hash. The block is not terminated.
+/// @param w The bit stream writer.
+/// @param src The data to compress.
+/// @param size The number of bytes of data. Must be less than 4GB.
+/// @param table The match hash table, of 1 << DEFLATE_HASH_BITS entries.
+/// @param last true to mark the block as the final block of the stream.
+static void deflate_fast(deflate_writer_t &w, uint8_t const *src, size_t size, uint32_t *table, bool last)
+{
+    size_t i = 0;
+    deflate_put(w, (last ? 1 : 0) | (1 << 1), 3);
+    memset(table, 0, sizeof(uint32_t) << DEFLATE_HASH_BITS);
+    while (size - i >= DEFLATE_MIN_MATCH && !w.Overflow)
+    {   // table entries hold the position plus one, so zero is empty.
+        uint32_t seq = lz_read32(src + i);
+        uint32_t h   = (seq * 2654435761U) >> (32 - DEFLATE_HASH_BITS);
+        size_t   ref = table[h];
+        table[h] = uint32_t(i + 1);
+        if (ref == 0 || i + 1 - ref > DEFLATE_MAX_OFFSET || lz_read32(src + ref - 1) != seq)
+        {
+            deflate_literal(w, src[i++]);
+            continue;
+        }
+
+        size_t const max = min2<size_t>(size - i, DEFLATE_MAX_MATCH);
+        size_t       len = DEFLATE_MIN_MATCH;
+        ref -= 1;
+        while (max - len >= 8)
+        {
+            uint64_t a, b;
+            memcpy(&a, src + i   + len, sizeof(uint64_t));
+            memcpy(&b, src + ref + len, sizeof(uint64_t));
+            if (a != b) break;
+            len += 8;
+        }
+        while (len < max && src[i + len] == src[ref + len])
+        {
+            len++;
+        }
+        deflate_match(w, len, i - ref);
+        i += len;
+    }
+    while (i < size)
+    {
+        deflate_literal(w, src[i++]);
     }
+    deflate_put(w, Deflate_Fixed_Codes[256], 7);
+}
+
+/// @summary Writes data as a sequence of stored deflate blocks. The data of a
+/// block may be supplied across several calls; a block header is written
+/// whenever the previous block is full.
+/// @param op The current output position. The caller guarantees there is space
+/// for the data and its block headers.
+/// @param src The data to store.
+/// @param size The number of bytes of data.
+/// @param block_left The number of bytes remaining in the current block, updated on return.
+/// @param stream_left The number of bytes remaining in the stream, updated on return.
+/// @param last true if the stream ends with the final block.
+/// @return The updated output position.
+static uint8_t* deflate_store(uint8_t *op, uint8_t const *src, size_t size, size_t &block_left, size_t &stream_left, bool last)
+{
+    while (size > 0)
+    {
+        if (block_left == 0)
+        {
+            block_left = min2<size_t>(stream_left, DEFLATE_MAX_STORED);
+            op[0] = (last && block_left == stream_left) ? 1 : 0;
+            op[1] = uint8_t( block_left & 0xFF);
+            op[2] = uint8_t( block_left >> 8);
+            op[3] = uint8_t(~block_left & 0xFF);
+            op[4] = uint8_t((~block_left >> 8) & 0xFF);
+            op   += 5;
+        }
+        size_t n = min2<size_t>(size, block_left);
+        memcpy(op, src, n);
+        op          += n;
+        src         += n;
+        size        -= n;
+        block_left  -= n;
+        stream_left -= n;
+    }
+    return op;
 }
-#endif /* #if 0 */
 
 /*////////////////////////
 //   Public Functions   //
@@ -555,6 +2229,17 @@ size_t data::base64_encode(char *dst, size_t dst_size, void const *src, size_t s
         return 0;
     }
 
+#if LLDATAIN_X86_SIMD
+    // encode the bulk of the input 24 or 12 bytes at a time.
+    uint32_t const simd = simd_features();
+    size_t         done = 0;
+    if (simd & SIMD_AVX2 ) done  = base64_encode_avx2 (outp, inp, ins);
+    if (simd & SIMD_SSSE3) done += base64_encode_ssse3(outp + (done / 3) * 4, inp + done, ins - done);
+    outp += (done / 3) * 4;
+    inp  += done;
+    ins  -= done;
+#endif
+
     // process input three bytes at a time.
     while (ins >= 3)
     {
@@ -615,6 +2300,10 @@ size_t data::base64_decode(void *dst, size_t dst_size, char const *src, size_t s
     size_t      curr   =  0;
     size_t      pad    =  0;
     size_t      req    = data::binary_size(src_size, 0);
+#if LLDATAIN_X86_SIMD
+    uint32_t    simd   = simd_features();
+    char const *retry  = src;
+#endif
 
     if (dst_size < (req - 2))
     {
@@ -624,6 +2313,24 @@ size_t data::base64_decode(void *dst, size_t dst_size, char const *src, size_t s
 
     while (inp != end)
     {
+#if LLDATAIN_X86_SIMD
+        if (curr == 0 && inp >= retry)
+        {
+            // decode runs of whole quads of alphabet characters in bulk. the
+            // kernels stop at padding, whitespace or other skipped characters,
+            // which are handled below before trying again 16 characters later.
+            size_t used  = size_t(outp - (uint8_t*) dst);
+            size_t space = used < dst_size ? dst_size - used : 0;
+            size_t n     = 0;
+            if (simd & SIMD_AVX2 ) n  = base64_decode_avx2 (outp, space, inp, size_t(end - inp));
+            if (simd & SIMD_SSSE3) n += base64_decode_ssse3(outp + (n / 4) * 3, space - (n / 4) * 3, inp + n, size_t(end - inp) - n);
+            if (n > 0) pad = 0;
+            outp += (n / 4) * 3;
+            inp  += n;
+            retry = inp + 16;
+            if (inp == end) break;
+        }
+#endif
         char ch = *inp++;
         if (ch != '=')
         {
@@ -800,6 +2507,16 @@ void* data::load_binary(char const *path, size_t *out_buffer_size)
     }
 }
 
+int64_t data::file_tell(FILE *file)
+{
+    return int64_t(FTELLO_FUNC(file));
+}
+
+bool data::file_seek(FILE *file, int64_t offset, int origin)
+{
+    return FSEEKO_FUNC(file, FPOS_TYPE(offset), origin) == 0;
+}
+
 bool data::dds_header(void const *data, size_t data_size, data::dds_header_t *out_header)
 {
     size_t const offset   = sizeof(uint32_t);
@@ -1360,109 +3077,549 @@ size_t data::dds_bytes_per_block(uint32_t format)
     return 0;
 }
 
-size_t data::dds_array_count(data::dds_header_t const *header, data::dds_header_dxt10_t const *header_ex)
+size_t data::dds_array_count(data::dds_header_t const *header, data::dds_header_dxt10_t const *header_ex)
+{
+    if (header && header_ex)
+    {
+        size_t multiplier = 1;
+        if (header->Caps2 & data::DDSCAPS2_CUBEMAP)
+        {   // DX10+ cubemaps must specify all faces.
+            multiplier = 6;
+        }
+        // DX10 extended header is required for surface arrays.
+        return size_t(header_ex->ArraySize) * multiplier;
+    }
+    else if (header)
+    {
+        size_t nfaces = 1;
+        if (header->Caps2 & data::DDSCAPS2_CUBEMAP)
+        {   // non-DX10 cubemaps may specify only some faces.
+            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_POSITIVEX) nfaces++;
+            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_NEGATIVEX) nfaces++;
+            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_POSITIVEY) nfaces++;
+            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_NEGATIVEY) nfaces++;
+            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_POSITIVEZ) nfaces++;
+            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_NEGATIVEZ) nfaces++;
+        }
+        return nfaces;
+    }
+    else return 0;
+}
+
+size_t data::dds_level_count(data::dds_header_t const *header, data::dds_header_dxt10_t const *header_ex)
+{
+    if (data::dds_mipmap(header, header_ex))
+    {   // some writers set DDSD_MIPMAPCOUNT with a level count of zero.
+        return header->Levels > 0 ? header->Levels : 1;
+    }
+    else if (header) return 1;
+    else return 0;
+}
+
+size_t data::dds_describe(
+    void                     const *data,
+    size_t                          data_size,
+    data::dds_header_t       const *header,
+    data::dds_header_dxt10_t const *header_ex,
+    data::dds_level_desc_t         *out_levels,
+    size_t                          max_levels)
+{
+    uint32_t  format = data::DXGI_FORMAT_UNKNOWN;
+    uint8_t const *p = (uint8_t const*) data;
+    size_t offset    = 0;
+    size_t basew     = 0;
+    size_t baseh     = 0;
+    size_t based     = 0;
+    size_t bitspp    = 0;
+    size_t blocksz   = 0;
+    size_t nitems    = data::dds_array_count(header, header_ex);
+    size_t nlevels   = data::dds_level_count(header, header_ex);
+    size_t dst_i     = 0;
+    bool   bcn       = false;
+
+    if (header == NULL)
+    {
+        // the base DDS header is required.
+        return false;
+    }
+
+    // get some basic data about the DDS.
+    format  = data::dds_format(header, header_ex);
+    bitspp  = data::dds_bits_per_pixel(format);
+    blocksz = data::dds_bytes_per_block(format);
+    basew   = (header->Flags & data::DDSD_WIDTH)  ? header->Width  : 0;
+    baseh   = (header->Flags & data::DDSD_HEIGHT) ? header->Height : 0;
+    based   = data::dds_volume(header, header_ex) ? header->Depth  : 1;
+    bcn     = (blocksz > 0);
+
+    // now update the byte offset and data pointer, and write the output.
+    offset += sizeof(uint32_t);
+    offset += sizeof(data::dds_header_t);
+    if (header_ex) offset += sizeof(data::dds_header_dxt10_t);
+    for (size_t i = 0; i < nitems && dst_i < max_levels; ++i)
+    {
+        for (size_t j = 0; j < nlevels && dst_i < max_levels && offset < data_size; ++j)
+        {
+            data::dds_level_desc_t &dst = out_levels[dst_i++];
+            size_t levelw        = level_dimension(basew , j);
+            size_t levelh        = level_dimension(baseh , j);
+            size_t leveld        = level_dimension(based , j);
+            size_t levelp        = data::dds_pitch(format, levelw);
+            size_t blockh        = max2<size_t>(1, (levelh + 3) / 4);
+            dst.Index            = j;
+            dst.Width            = image_dimension(format, levelw);
+            dst.Height           = image_dimension(format, levelh);
+            dst.Slices           = leveld;
+            dst.BytesPerElement  = bcn ? blocksz : (bitspp / 8); // DXGI_FORMAT_R1_UNORM...?
+            dst.BytesPerRow      = levelp;
+            dst.BytesPerSlice    = bcn ? levelp * blockh : levelp * levelh;
+            dst.DataSize         = dst.BytesPerSlice  * leveld;
+            dst.LevelData        = (void*) (p + offset);
+            dst.Format           = format;
+            offset              += dst.DataSize;
+        }
+    }
+    return dst_i;
+}
+
+data::dds_file_t* data::dds_open(char const *path)
+{
+    uintptr_t                fh       = 0;
+    uintptr_t                mh       = 0;
+    size_t                   size     = 0;
+    void                    *addr     = map_file(path, &size, &fh, &mh);
+    data::dds_header_t       header;
+    data::dds_header_dxt10_t header_ex;
+    bool                     has_ex   = false;
+
+    if (addr == NULL)
+    {
+        // the file doesn't exist, is empty, or cannot be mapped.
+        return NULL;
+    }
+    if (!data::dds_header(addr, size, &header))
+    {
+        // the file is not a DDS.
+        unmap_file(addr, size, fh, mh);
+        return NULL;
+    }
+    memset(&header_ex, 0, sizeof(data::dds_header_dxt10_t));
+    has_ex = data::dds_header_dxt10(addr, size, &header_ex);
+
+    data::dds_header_dxt10_t const *ex = has_ex ? &header_ex : NULL;
+    size_t nitems  = data::dds_array_count(&header, ex);
+    size_t nlevels = data::dds_level_count(&header, ex);
+    size_t count   = nitems * nlevels;
+    if (nitems == 0 || nlevels == 0 || nlevels > 32 || count > size)
+    {
+        // the header describes an empty surface, or more subresources
+        // than could possibly be stored in the file.
+        unmap_file(addr, size, fh, mh);
+        return NULL;
+    }
+
+    // the file description and the level table share a single allocation.
+    size_t  nbytes = sizeof(data::dds_file_t) + count * sizeof(data::dds_level_desc_t);
+    uint8_t *block = (uint8_t*) malloc(nbytes);
+    if (block == NULL)
+    {
+        unmap_file(addr, size, fh, mh);
+        return NULL;
+    }
+    data::dds_file_t       *file   = (data::dds_file_t*) block;
+    data::dds_level_desc_t *levels = (data::dds_level_desc_t*) (block + sizeof(data::dds_file_t));
+    if (data::dds_describe(addr, size, &header, ex, levels, count) != count)
+    {
+        // the file is truncated.
+        unmap_file(addr, size, fh, mh);
+        free(block);
+        return NULL;
+    }
+    // dds_describe() only checks that each level starts within the buffer.
+    uint8_t const *end = (uint8_t const*) addr + size;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint8_t const *level = (uint8_t const*) levels[i].LevelData;
+        if (levels[i].DataSize > size_t(end - level))
+        {
+            unmap_file(addr, size, fh, mh);
+            free(block);
+            return NULL;
+        }
+    }
+
+    file->Data             = addr;
+    file->DataSize         = size;
+    file->Header           = header;
+    file->HeaderEx         = header_ex;
+    file->HasHeaderEx      = has_ex;
+    file->Format           = data::dds_format(&header, ex);
+    file->ItemCount        = nitems;
+    file->LevelCount       = nlevels;
+    file->SubresourceCount = count;
+    file->Levels           = levels;
+    file->FileHandle       = fh;
+    file->MapHandle        = mh;
+    return file;
+}
+
+void data::dds_discard(data::dds_file_t *file, data::dds_level_desc_t const *level)
+{
+    if (file != NULL && level != NULL)
+    {
+        discard_pages(level->LevelData, level->DataSize);
+    }
+}
+
+void data::dds_close(data::dds_file_t *file)
+{
+    if (file != NULL)
+    {
+        unmap_file(file->Data, file->DataSize, file->FileHandle, file->MapHandle);
+        free(file);
+    }
+}
+
+uint32_t data::bc_decode_format(uint32_t format)
+{
+    switch (format)
+    {
+        case data::DXGI_FORMAT_BC1_TYPELESS:
+        case data::DXGI_FORMAT_BC1_UNORM:
+        case data::DXGI_FORMAT_BC2_TYPELESS:
+        case data::DXGI_FORMAT_BC2_UNORM:
+        case data::DXGI_FORMAT_BC3_TYPELESS:
+        case data::DXGI_FORMAT_BC3_UNORM:
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+            return data::DXGI_FORMAT_R8G8B8A8_UNORM;
+
+        case data::DXGI_FORMAT_BC1_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC2_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC3_UNORM_SRGB:
+            return data::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+        case data::DXGI_FORMAT_BC4_SNORM:
+        case data::DXGI_FORMAT_BC5_SNORM:
+            return data::DXGI_FORMAT_R8G8B8A8_SNORM;
+
+        default:
+            break;
+    }
+    return data::DXGI_FORMAT_UNKNOWN;
+}
+
+bool data::bc_decode_block(void *dst, size_t dst_pitch, void const *block, uint32_t format)
+{
+    if (data::bc_decode_format(format) == data::DXGI_FORMAT_UNKNOWN)
+    {
+        // the format is not block-compressed, or not supported.
+        return false;
+    }
+    bc_decode((uint8_t*) dst, dst_pitch, (uint8_t const*) block, format);
+    return true;
+}
+
+bool data::bc_decode_rows(
+    void                         *dst,
+    size_t                        dst_pitch,
+    data::dds_level_desc_t const *level,
+    size_t                        slice,
+    size_t                        first_row,
+    size_t                        row_count)
+{
+    uint32_t const format  = level->Format;
+    size_t   const nblocks = level->Width  / 4;
+    size_t   const nrows   = level->Height / 4;
+    if (data::bc_decode_format(format) == data::DXGI_FORMAT_UNKNOWN)
+    {
+        // the format is not block-compressed, or not supported.
+        return false;
+    }
+    if (slice >= level->Slices || first_row > nrows || row_count > nrows - first_row)
+    {
+        // the requested rows are outside of the level.
+        return false;
+    }
+
+    uint8_t const *src = (uint8_t const*) level->LevelData + slice * level->BytesPerSlice;
+    uint8_t       *out = (uint8_t*) dst;
+    for (size_t y = first_row; y < first_row + row_count; ++y, out += 4 * dst_pitch)
+    {
+        uint8_t const *block = src + y * level->BytesPerRow;
+        for (size_t x = 0; x < nblocks; ++x, block += level->BytesPerElement)
+        {
+            bc_decode(out + x * 16, dst_pitch, block, format);
+        }
+    }
+    return true;
+}
+
+size_t data::lz_compress_bound(size_t src_size)
 {
-    if (header && header_ex)
+    // worst case is a single run of literals with its length extension.
+    return src_size + (src_size / 255) + 16;
+}
+
+size_t data::lz_compress(void *dst, size_t dst_size, void const *src, size_t src_size)
+{
+    uint32_t       table[1 << LZ_HASH_BITS];
+    uint8_t const *base   = (uint8_t const*) src;
+    uint8_t const *ip     = base;
+    uint8_t const *anchor = base;
+    uint8_t const *iend   = base + src_size;
+    uint8_t       *op     = (uint8_t*) dst;
+    uint8_t       *oend   = op + dst_size;
+
+    if (src_size > 0xFFFFFFFFU)
     {
-        size_t multiplier = 1;
-        if (header->Caps2 & data::DDSCAPS2_CUBEMAP)
-        {   // DX10+ cubemaps must specify all faces.
-            multiplier = 6;
+        // table entries are 32-bit offsets.
+        return 0;
+    }
+    if (src_size >= LZ_MATCH_LIMIT + 1)
+    {
+        uint8_t const *mflimit    = iend - LZ_MATCH_LIMIT;
+        uint8_t const *matchlimit = iend - LZ_LAST_LITERALS;
+        memset(table, 0, sizeof(table));
+        while (ip < mflimit)
+        {
+            uint32_t       seq = lz_read32(ip);
+            uint32_t       h   = lz_hash(seq);
+            uint8_t const *ref = base + table[h];
+            table[h] = uint32_t(ip - base);
+            if (ref >= ip || size_t(ip - ref) > LZ_MAX_OFFSET || lz_read32(ref) != seq)
+            {   // skip faster through data that does not compress.
+                ip += 1 + (size_t(ip - anchor) >> 6);
+                continue;
+            }
+
+            // extend the match backwards over the pending literals.
+            while (ip > anchor && ref > base && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+            // extend the match forwards, 8 bytes at a time where possible.
+            uint8_t const *mp = ip  + LZ_MIN_MATCH;
+            uint8_t const *rp = ref + LZ_MIN_MATCH;
+            while (mp + 8 <= matchlimit)
+            {
+                uint64_t a, b;
+                memcpy(&a, mp, sizeof(uint64_t));
+                memcpy(&b, rp, sizeof(uint64_t));
+                if (a != b) break;
+                mp += 8;
+                rp += 8;
+            }
+            while (mp < matchlimit && *mp == *rp)
+            {
+                mp++;
+                rp++;
+            }
+
+            op = lz_write_sequence(op, oend, anchor, size_t(ip - anchor), size_t(ip - ref), size_t(mp - ip));
+            if (op == NULL)
+                return 0;
+
+            // prime the table with a position inside the match.
+            if (mp - 2 > ip) table[lz_hash(lz_read32(mp - 2))] = uint32_t(mp - 2 - base);
+            ip     = mp;
+            anchor = mp;
         }
-        // DX10 extended header is required for surface arrays.
-        return size_t(header_ex->ArraySize) * multiplier;
     }
-    else if (header)
+    // the block always ends with a literal-only sequence.
+    op = lz_write_sequence(op, oend, anchor, size_t(iend - anchor), 0, 0);
+    if (op == NULL)
+        return 0;
+    return size_t(op - (uint8_t*) dst);
+}
+
+size_t data::lz_decompress(void *dst, size_t dst_size, void const *src, size_t src_size)
+{
+    uint8_t const *ip    = (uint8_t const*) src;
+    uint8_t const *iend  = ip + src_size;
+    uint8_t       *op    = (uint8_t*) dst;
+    uint8_t       *ostart= op;
+    uint8_t       *oend  = op + dst_size;
+
+    while (ip < iend)
     {
-        size_t nfaces = 1;
-        if (header->Caps2 & data::DDSCAPS2_CUBEMAP)
-        {   // non-DX10 cubemaps may specify only some faces.
-            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_POSITIVEX) nfaces++;
-            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_NEGATIVEX) nfaces++;
-            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_POSITIVEY) nfaces++;
-            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_NEGATIVEY) nfaces++;
-            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_POSITIVEZ) nfaces++;
-            if (header->Caps2 & data::DDSCAPS2_CUBEMAP_NEGATIVEZ) nfaces++;
+        size_t token = *ip++;
+        size_t lit   = token >> 4;
+
+        // most sequences have short literal and match lengths and are far
+        // from the end of both buffers; copy them with fixed-size moves.
+        if (lit < 15 && (token & 15) < 15 && size_t(iend - ip) >= 16 + 2 && size_t(oend - op) >= 16 + 18)
+        {
+            memcpy(op, ip, 16);
+            op += lit;
+            ip += lit;
+            if (ip == iend)
+                break;
+            size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+            size_t mlen   = (token & 15) + LZ_MIN_MATCH;
+            if (offset >= 8 && size_t(op - ostart) >= offset)
+            {   // each 8-byte move reads only bytes that are already written.
+                uint8_t const *match = op - offset;
+                memcpy(op     , match     , 8);
+                memcpy(op +  8, match +  8, 8);
+                memcpy(op + 16, match + 16, 2);
+                op += mlen;
+                ip += 2;
+                continue;
+            }
+            // fall through to the general match copy.
+            ip -= lit;
+            op -= lit;
         }
-        return nfaces;
+
+        if (lit == 15 && !lz_read_length(ip, iend, lit))
+            return 0;
+        if (size_t(iend - ip) < lit || size_t(oend - op) < lit)
+            return 0;
+
+        // short literal runs are copied with two fixed-size moves when
+        // there is slack at the end of both buffers.
+        if (lit <= 16 && size_t(iend - ip) >= 16 && size_t(oend - op) >= 16)
+        {
+            memcpy(op, ip, 16);
+        }
+        else memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend)
+        {   // the final sequence has no match.
+            break;
+        }
+
+        if (size_t(iend - ip) < 2)
+            return 0;
+        size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        size_t mlen   = token & 15;
+        ip += 2;
+        if (mlen == 15 && !lz_read_length(ip, iend, mlen))
+            return 0;
+        mlen += LZ_MIN_MATCH;
+        if (offset == 0 || size_t(op - ostart) < offset || size_t(oend - op) < mlen)
+            return 0;
+
+        uint8_t const *match = op - offset;
+        uint8_t       *mend  = op + mlen;
+        if (offset >= 8 && size_t(oend - mend) >= 8)
+        {   // the source and destination of each 8-byte move never overlap.
+            do
+            {
+                memcpy(op, match, 8);
+                op    += 8;
+                match += 8;
+            } while (op < mend);
+        }
+        else if (size_t(oend - mend) >= 8)
+        {   // overlapping copies replicate a short repeating pattern. once
+            // 8 bytes are written, the pattern repeats at a distance >= 8.
+            for (size_t i = 0; i < 8; ++i) op[i] = match[i];
+            match = op + 8 - offset * ((8 + offset - 1) / offset);
+            op   += 8;
+            while (op < mend)
+            {
+                memcpy(op, match, 8);
+                op    += 8;
+                match += 8;
+            }
+        }
+        else
+        {   // near the end of the output, copy one byte at a time.
+            while (op < mend) *op++ = *match++;
+        }
+        op = mend;
     }
-    else return 0;
+    return size_t(op - ostart);
 }
 
-size_t data::dds_level_count(data::dds_header_t const *header, data::dds_header_dxt10_t const *header_ex)
+bool data::ddsz_header(void const *data, size_t data_size, data::ddsz_header_t *out_header)
 {
-    if (data::dds_mipmap(header, header_ex))
+    if (data_size >= sizeof(data::ddsz_header_t))
     {
-        return header->Levels;
+        data::ddsz_header_t const *header = (data::ddsz_header_t const*) data;
+        if (header->Magic != LLDATAIN_DDSZ_MAGIC_LE)
+            return false;
+        if (header->Version != 1)
+            return false;
+        if (header->Codec != data::DDSZ_CODEC_NONE && header->Codec != data::DDSZ_CODEC_LZ)
+            return false;
+        if (out_header != NULL) *out_header = *header;
+        return true;
     }
-    else if (header) return 1;
-    else return 0;
+    return false;
 }
 
-size_t data::dds_describe(
-    void                     const *data,
-    size_t                          data_size,
-    data::dds_header_t       const *header,
-    data::dds_header_dxt10_t const *header_ex,
-    data::dds_level_desc_t         *out_levels,
-    size_t                          max_levels)
+size_t data::ddsz_describe(void const *data, size_t data_size, data::ddsz_chunk_t *out_chunks, size_t max_chunks)
 {
-    uint32_t  format = data::DXGI_FORMAT_UNKNOWN;
-    uint8_t const *p = (uint8_t const*) data;
-    size_t offset    = 0;
-    size_t basew     = 0;
-    size_t baseh     = 0;
-    size_t based     = 0;
-    size_t bitspp    = 0;
-    size_t blocksz   = 0;
-    size_t nitems    = data::dds_array_count(header, header_ex);
-    size_t nlevels   = data::dds_level_count(header, header_ex);
-    size_t dst_i     = 0;
-    bool   bcn       = false;
+    data::ddsz_header_t header;
+    if (!data::ddsz_header(data, data_size, &header))
+        return 0;
 
-    if (header == NULL)
+    size_t offset = sizeof(data::ddsz_header_t) + header.HeaderSize;
+    size_t count  = min2<size_t>(header.ChunkCount, max_chunks);
+    if (offset + size_t(header.ChunkCount) * sizeof(data::ddsz_chunk_t) > data_size)
+        return 0;
+
+    memcpy(out_chunks, (uint8_t const*) data + offset, count * sizeof(data::ddsz_chunk_t));
+    for (size_t i = 0; i < count; ++i)
     {
-        // the base DDS header is required.
-        return false;
+        if (out_chunks[i].Offset > data_size || out_chunks[i].CompressedSize > data_size - out_chunks[i].Offset)
+            return 0;
     }
+    return count;
+}
 
-    // get some basic data about the DDS.
-    format  = data::dds_format(header, header_ex);
-    bitspp  = data::dds_bits_per_pixel(format);
-    blocksz = data::dds_bytes_per_block(format);
-    basew   = (header->Flags & data::DDSD_WIDTH)  ? header->Width  : 0;
-    baseh   = (header->Flags & data::DDSD_HEIGHT) ? header->Height : 0;
-    based   = data::dds_volume(header, header_ex) ? header->Depth  : 1;
-    bcn     = (blocksz > 0);
+size_t data::ddsz_dds_size(data::ddsz_header_t const *header)
+{
+    return size_t(header->HeaderSize) + size_t(header->DataSize);
+}
 
-    // now update the byte offset and data pointer, and write the output.
-    offset += sizeof(uint32_t);
-    offset += sizeof(data::dds_header_t);
-    if (header_ex) offset += sizeof(data::dds_header_dxt10_t);
-    for (size_t i = 0; i < nitems && dst_i < max_levels; ++i)
+size_t data::ddsz_decompress(void *dst, size_t dst_size, void const *data, size_t data_size)
+{
+    data::ddsz_header_t header;
+    if (!data::ddsz_header(data, data_size, &header))
+        return 0;
+    if (dst_size < data::ddsz_dds_size(&header))
+        return 0;
+    if (sizeof(data::ddsz_header_t) + header.HeaderSize > data_size)
+        return 0;
+
+    uint8_t const *src = (uint8_t const*) data;
+    uint8_t       *out = (uint8_t*) dst;
+    uint8_t       *end = out + data::ddsz_dds_size(&header);
+    memcpy(out, src + sizeof(data::ddsz_header_t), header.HeaderSize);
+    out += header.HeaderSize;
+
+    size_t table = sizeof(data::ddsz_header_t) + header.HeaderSize;
+    if (table + size_t(header.ChunkCount) * sizeof(data::ddsz_chunk_t) > data_size)
+        return 0;
+    for (size_t i = 0; i < header.ChunkCount; ++i)
     {
-        for (size_t j = 0; j < nlevels && dst_i < max_levels && offset < data_size; ++j)
+        data::ddsz_chunk_t chunk;
+        memcpy(&chunk, src + table + i * sizeof(data::ddsz_chunk_t), sizeof(data::ddsz_chunk_t));
+        if (chunk.Offset > data_size || chunk.CompressedSize > data_size - chunk.Offset)
+            return 0;
+        if (chunk.UncompressedSize > size_t(end - out))
+            return 0;
+        if (header.Codec == data::DDSZ_CODEC_NONE || chunk.CompressedSize == chunk.UncompressedSize)
+        {   // the chunk is stored uncompressed.
+            if (chunk.CompressedSize != chunk.UncompressedSize)
+                return 0;
+            memcpy(out, src + chunk.Offset, chunk.UncompressedSize);
+        }
+        else if (data::lz_decompress(out, chunk.UncompressedSize, src + chunk.Offset, chunk.CompressedSize) != chunk.UncompressedSize)
         {
-            data::dds_level_desc_t &dst = out_levels[dst_i++];
-            size_t levelw        = level_dimension(basew , j);
-            size_t levelh        = level_dimension(baseh , j);
-            size_t leveld        = level_dimension(based , j);
-            size_t levelp        = data::dds_pitch(format, levelw);
-            size_t blockh        = max2<size_t>(1, (levelh + 3) / 4);
-            dst.Index            = j;
-            dst.Width            = image_dimension(format, levelw);
-            dst.Height           = image_dimension(format, levelh);
-            dst.Slices           = leveld;
-            dst.BytesPerElement  = bcn ? blocksz : (bitspp / 8); // DXGI_FORMAT_R1_UNORM...?
-            dst.BytesPerRow      = levelp;
-            dst.BytesPerSlice    = bcn ? levelp * blockh : levelp * levelh;
-            dst.DataSize         = dst.BytesPerSlice  * leveld;
-            dst.LevelData        = (void*) (p + offset);
-            dst.Format           = format;
-            offset              += dst.DataSize;
+            return 0;
         }
+        out += chunk.UncompressedSize;
     }
-    return dst_i;
+    return (out == end) ? size_t(out - (uint8_t*) dst) : 0;
 }
 
 size_t data::wav_describe(
@@ -2298,7 +4455,9 @@ bool data::tga_describe(void const *data, size_t data_size, data::tga_desc_t *ou
         goto tga_error;
 
     cmap_offset = sizeof(data::tga_header_t) + header.ImageIdLength;
-    data_offset = cmap_offset + (header.CmapLength * (header.CmapEntrySize / 8));
+    data_offset = cmap_offset + (header.CmapLength * ((header.CmapEntrySize + 7) / 8));
+    if (data_offset > data_size)
+        goto tga_error;
 
     if (out_desc)
     {
@@ -2308,7 +4467,7 @@ bool data::tga_describe(void const *data, size_t data_size, data::tga_desc_t *ou
         out_desc->CmapLength       = header.CmapLength;
         out_desc->CmapEntrySize    = header.CmapEntrySize;
 
-        if (header.ImageYOrigin == 0 || (header.ImageFlags & (1 << 5)) == 0)
+        if ((header.ImageFlags & (1 << 5)) == 0)
             out_desc->OriginBottom = true;
         else
             out_desc->OriginBottom = false;
@@ -2316,8 +4475,10 @@ bool data::tga_describe(void const *data, size_t data_size, data::tga_desc_t *ou
         out_desc->ImageWidth       = header.ImageWidth;
         out_desc->ImageHeight      = header.ImageHeight;
         out_desc->BitsPerPixel     = header.ImageBitDepth;
+        out_desc->AttributeBits    = header.ImageFlags & 0x0F;
         out_desc->PixelDataSize    = 0;
-        out_desc->ColormapDataSize = header.CmapLength *(header.CmapEntrySize / 8);
+        out_desc->EncodedDataSize  = data_size - data_offset;
+        out_desc->ColormapDataSize = header.CmapLength * ((header.CmapEntrySize + 7) / 8);
         out_desc->ColormapData     = (void*) (base_ptr + cmap_offset);
         out_desc->PixelData        = (void*) (base_ptr + data_offset);
 
@@ -2355,7 +4516,9 @@ tga_error:
         out_desc->ImageWidth       = 0;
         out_desc->ImageHeight      = 0;
         out_desc->BitsPerPixel     = 0;
+        out_desc->AttributeBits    = 0;
         out_desc->PixelDataSize    = 0;
+        out_desc->EncodedDataSize  = 0;
         out_desc->ColormapDataSize = 0;
         out_desc->ColormapData     = NULL;
         out_desc->PixelData        = NULL;
@@ -2376,9 +4539,12 @@ bool data::tga_decode_r8(void *dst, size_t dst_size, data::tga_desc_t const *des
     uint8_t       *dstp = (uint8_t*) dst;
     uint8_t       *endp = (uint8_t*) dst + desc->PixelDataSize;
     uint8_t const *srcp = (uint8_t const*) desc->PixelData;
+    uint8_t const *srce = srcp + desc->EncodedDataSize;
 
     if (desc->ImageType == data::TGA_IMAGETYPE_UNCOMPRESSED_GRAY)
     {   // super-easy path, this is just a memcpy.
+        if (desc->PixelDataSize > desc->EncodedDataSize)
+            return false; // truncated pixel data
         memcpy(dstp, srcp, desc->PixelDataSize);
         return true;
     }
@@ -2386,25 +4552,23 @@ bool data::tga_decode_r8(void *dst, size_t dst_size, data::tga_desc_t const *des
     {   // slightly more complex; RLE-encoded data.
         while (dstp < endp)
         {
+            if (srcp >= srce)
+                return false; // truncated packet header
             uint8_t hdr = *srcp++;
-            uint8_t rl  = (hdr & 0x7F) + 1;
+            size_t  rl  = (hdr & 0x7F) + 1;
+            size_t  n   = rl < size_t(endp - dstp) ? rl : size_t(endp - dstp);
+            if (size_t(srce - srcp) < ((hdr & 0x80) ? 1 : rl))
+                return false; // truncated packet data
             if (hdr & 0x80)
             {   // this is an RLE-encoded packet.
-                uint8_t cv = *srcp++;
-                while  (rl > 0)
-                {
-                    *dstp++ = cv;
-                    --rl;
-                }
+                memset(dstp, *srcp++, n);
             }
             else
             {   // standard non-RLE packet.
-                while (rl > 0)
-                {
-                    *dstp++ = *srcp++;
-                    --rl;
-                }
+                memcpy(dstp, srcp, n);
+                srcp += rl;
             }
+            dstp += n;
         }
     }
     return true;
@@ -2412,139 +4576,249 @@ bool data::tga_decode_r8(void *dst, size_t dst_size, data::tga_desc_t const *des
 
 bool data::tga_decode_argb32(void *dst, size_t dst_size, data::tga_desc_t const *desc)
 {
-    if (desc == NULL || desc->PixelDataSize == 0 || desc->PixelData == NULL)
-        return false; // invalid image description
-    if (dst  == NULL || dst_size < desc->PixelDataSize)
-        return false; // invalid destination buffer
+    return tga_decode_32(dst, dst_size, desc, false, false);
+}
 
-    uint8_t       *dstp = (uint8_t*) dst;
-    uint8_t       *endp = (uint8_t*) dst + desc->PixelDataSize;
-    uint8_t const *srcp = (uint8_t const*) desc->PixelData;
-    size_t         srcb = 0;
+bool data::tga_decode_rgba32(void *dst, size_t dst_size, data::tga_desc_t const *desc, uint32_t order)
+{
+    return tga_decode_32(dst, dst_size, desc, order == data::TGA_PIXEL_ORDER_BGRA, true);
+}
+
+size_t data::tga_encode_bound(size_t width, size_t height, size_t bits_per_pixel)
+{
+    // worst case is a raw packet header for every 128 pixels of each row.
+    return sizeof(data::tga_header_t) + height * (width * (bits_per_pixel / 8) + (width + 127) / 128);
+}
+
+size_t data::tga_encode_header(void *dst, size_t dst_size, size_t width, size_t height, size_t bits_per_pixel, bool rle)
+{
+    uint8_t *h = (uint8_t*) dst;
+    if (dst_size < sizeof(data::tga_header_t) || width  < 1 || width  > 0xFFFF ||
+        height < 1 || height > 0xFFFF || (bits_per_pixel != 24 && bits_per_pixel != 32))
+        return 0;
 
-    switch (desc->ImageType)
+    memset(h, 0, sizeof(data::tga_header_t));
+    h[2]  = uint8_t(rle ? data::TGA_IMAGETYPE_RLE_TRUE : data::TGA_IMAGETYPE_UNCOMPRESSED_TRUE);
+    h[12] = uint8_t(width  & 0xFF);
+    h[13] = uint8_t(width  >> 8);
+    h[14] = uint8_t(height & 0xFF);
+    h[15] = uint8_t(height >> 8);
+    h[16] = uint8_t(bits_per_pixel);
+    h[17] = uint8_t((bits_per_pixel == 32 ? 8 : 0) | (1 << 5));
+    return sizeof(data::tga_header_t);
+}
+
+size_t data::tga_encode_rows(void *dst, size_t dst_size, void const *src, size_t src_pitch, size_t width, size_t row_count, uint32_t order, size_t bits_per_pixel, bool rle)
+{
+    uint8_t        *op    = (uint8_t*) dst;
+    uint8_t        *end   = op + dst_size;
+    uint8_t const  *row   = (uint8_t const*) src;
+    size_t   const  bytes = bits_per_pixel / 8;
+    bool     const  bgra  = order == data::TGA_PIXEL_ORDER_BGRA;
+    uint32_t const  simd  = simd_features();
+    if ((bits_per_pixel != 24 && bits_per_pixel != 32) || width == 0 || row_count == 0)
+        return 0;
+    if (!rle && dst_size / bytes / row_count < width)
+        return 0;
+
+    for (size_t y = 0; y < row_count; ++y, row += src_pitch)
     {
-        case data::TGA_IMAGETYPE_UNCOMPRESSED_TRUE:
-            {
-                if (desc->BitsPerPixel == 24)
-                {   // we need to convert RGB8 => ARGB8.
-                    for (size_t row = 0; row < desc->ImageHeight; ++row)
-                    {
-                        for (size_t col = 0; col < desc->ImageWidth; ++col)
-                        {
-                            *dstp++ = srcp[srcb + 2];
-                            *dstp++ = srcp[srcb + 1];
-                            *dstp++ = srcp[srcb + 0];
-                            *dstp++ = 0xFF;
-                            srcb   += 3;
-                        }
-                    }
-                    return true;
-                }
-                if (desc->BitsPerPixel == 32)
-                {   // we need to convert RGBA8 => ARGB8.
-                    for (size_t row = 0; row < desc->ImageHeight; ++row)
-                    {
-                        for (size_t col = 0; col < desc->ImageWidth; ++col)
-                        {
-                            *dstp++ = srcp[srcb + 2];
-                            *dstp++ = srcp[srcb + 1];
-                            *dstp++ = srcp[srcb + 0];
-                            *dstp++ = srcp[srcb + 3];
-                            srcb   += 4;
-                        }
-                    }
-                    return true;
-                }
+        if (rle)
+        {
+            if ((op = tga_encode_rle_row(op, end, row, width, bytes, bgra, simd)) == NULL)
+                return 0;
+            continue;
+        }
+        tga_encode_span(op, row, width, bytes, bgra, simd);
+        op += width * bytes;
+    }
+    return size_t(op - (uint8_t*) dst);
+}
 
-            }
-            break; // 15 & 16bpp currently not supported.
+size_t data::tga_encode(void *dst, size_t dst_size, void const *src, size_t src_pitch, size_t width, size_t height, uint32_t order, size_t bits_per_pixel, bool rle)
+{
+    size_t head = data::tga_encode_header(dst, dst_size, width, height, bits_per_pixel, rle);
+    size_t body = 0;
+    if (head == 0)
+        return 0;
+    if ((body = data::tga_encode_rows((uint8_t*) dst + head, dst_size - head, src, src_pitch, width, height, order, bits_per_pixel, rle)) == 0)
+        return 0;
+    return head + body;
+}
 
-        case data::TGA_IMAGETYPE_RLE_TRUE:
-            {
-                if (desc->BitsPerPixel == 24)
-                {   // we need to decode and convert RGB8 => ARGB8.
-                    while (dstp < endp)
-                    {
-                        uint8_t hdr = *srcp++;
-                        uint8_t rl  = (hdr & 0x7F) + 1;
-                        if (hdr & 0x80)
-                        {   // this is an RLE-encoded packet.
-                            uint8_t cr = *srcp++;
-                            uint8_t cg = *srcp++;
-                            uint8_t cb = *srcp++;
-                            while  (rl > 0)
-                            {
-                                *dstp++ = cb;
-                                *dstp++ = cg;
-                                *dstp++ = cr;
-                                *dstp++ = 0xFF;
-                                --rl;
-                            }
-                        }
-                        else
-                        {   // standard non-RLE packet.
-                            while (rl > 0)
-                            {
-                                uint8_t cr = *srcp++;
-                                uint8_t cg = *srcp++;
-                                uint8_t cb = *srcp++;
-                                *dstp++ = cb;
-                                *dstp++ = cg;
-                                *dstp++ = cr;
-                                *dstp++ = 0xFF;
-                                --rl;
-                            }
-                        }
-                    }
-                    return true;
-                }
-                if (desc->BitsPerPixel == 32)
-                {   // we need to decode and convert RGBA8 => ARGB8.
-                    while (dstp < endp)
-                    {
-                        uint8_t hdr = *srcp++;
-                        uint8_t rl  = (hdr & 0x7F) + 1;
-                        if (hdr & 0x80)
-                        {   // this is an RLE-encoded packet.
-                            uint8_t cr = *srcp++;
-                            uint8_t cg = *srcp++;
-                            uint8_t cb = *srcp++;
-                            uint8_t ca = *srcp++;
-                            while  (rl > 0)
-                            {
-                                *dstp++ = cb;
-                                *dstp++ = cg;
-                                *dstp++ = cr;
-                                *dstp++ = ca;
-                                --rl;
-                            }
-                        }
-                        else
-                        {   // standard non-RLE packet.
-                            while (rl > 0)
-                            {
-                                uint8_t cr = *srcp++;
-                                uint8_t cg = *srcp++;
-                                uint8_t cb = *srcp++;
-                                uint8_t ca = *srcp++;
-                                *dstp++ = cb;
-                                *dstp++ = cg;
-                                *dstp++ = cr;
-                                *dstp++ = ca;
-                                --rl;
-                            }
-                        }
-                    }
-                    return true;
-                }
-            }
-            break;
+size_t data::png_band_bound(size_t width, size_t row_count, size_t channels)
+{
+    // the rows stored in blocks of at most 65535 bytes, with a 5 byte header each.
+    size_t const filtered = row_count * (width * channels + 1);
+    size_t const blocks   = (filtered + DEFLATE_MAX_STORED - 1) / DEFLATE_MAX_STORED;
+    return filtered + (blocks > 0 ? blocks : 1) * 5;
+}
 
-        default:
-            break;
+size_t data::png_encode_band(
+    void               *dst,
+    size_t              dst_size,
+    void const         *src,
+    size_t              src_pitch,
+    size_t              width,
+    size_t              first_row,
+    size_t              row_count,
+    size_t              channels,
+    uint32_t            compression,
+    bool                last,
+    data::png_band_t   *out_band)
+{
+    size_t  const  row_size = width * channels;
+    size_t  const  filtered = row_count * (row_size + 1);
+    size_t  const  bound    = data::png_band_bound(width, row_count, channels);
+    uint8_t const *base     = (uint8_t const*) src + first_row * src_pitch;
+    uint8_t       *op       = (uint8_t*) dst;
+    uint32_t       adler    = 1;
+    size_t         block    = 0;
+    size_t         stream   = filtered;
+
+    if (src == NULL || out_band == NULL || width == 0 || row_count == 0 || channels < 1 || channels > 4)
+        return 0;
+    if (dst_size < bound || filtered > 0xFFFFFFFFU)
+        return 0;
+
+    if (compression == data::PNG_COMPRESSION_STORE)
+    {   // unfiltered rows are copied straight into the stored blocks.
+        uint8_t const none = 0;
+        for (size_t y = 0; y < row_count; ++y)
+        {
+            uint8_t const *row = base + y * src_pitch;
+            op    = deflate_store(op, &none, 1, block, stream, last);
+            op    = deflate_store(op, row, row_size, block, stream, last);
+            adler = adler32(adler32(adler, &none, 1), row, row_size);
+        }
+    }
+    else if (compression == data::PNG_COMPRESSION_FAST)
+    {
+        size_t   const nbytes = (sizeof(uint32_t) << DEFLATE_HASH_BITS) + filtered;
+        uint8_t       *buffer = (uint8_t*) malloc(nbytes);
+        uint8_t       *rows   = buffer + (sizeof(uint32_t) << DEFLATE_HASH_BITS);
+        if (buffer == NULL)
+            return 0;
+
+        for (size_t y = 0; y < row_count; ++y)
+        {
+            uint8_t const *row  = base + y * src_pitch;
+            uint8_t const *prev = first_row + y > 0 ? row - src_pitch : NULL;
+            png_filter_row(rows + y * (row_size + 1), row, prev, row_size, channels);
+        }
+        adler = adler32(adler, rows, filtered);
+
+        // data that does not fit in the stored size is stored instead.
+        deflate_writer_t w = { op, op + bound, 0, 0, false };
+        deflate_fast(w, rows, filtered, (uint32_t*) buffer, last);
+        if (!last)
+        {   // an empty stored block ends the band on a byte boundary.
+            deflate_put(w, 0, 3);
+            deflate_align(w);
+            deflate_put(w, 0xFFFF0000U, 32);
+        }
+        deflate_align(w);
+        op = w.Overflow ? deflate_store(op, rows, filtered, block, stream, last) : w.Out;
+        free(buffer);
     }
+    else return 0;
 
-    // unsupported format (15 or 16bpp, or palettized).
-    return false;
+    out_band->Data         = dst;
+    out_band->Size         = size_t(op - (uint8_t*) dst);
+    out_band->FilteredSize = filtered;
+    out_band->Adler        = adler;
+    return out_band->Size;
+}
+
+size_t data::png_encode_bands(void *dst, size_t dst_size, size_t width, size_t height, size_t channels, data::png_band_t const *bands, size_t band_count)
+{
+    static uint8_t const signature[8]   = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static uint8_t const color_type[5]  = { 0, 0, 4, 2, 6 };
+    size_t               need           = sizeof(signature) + 25 + 12 + 2 + 4;
+    size_t               filtered       = 0;
+    uint32_t             adler          = 1;
+
+    if (width  == 0 || width  > 0x7FFFFFFFU || height == 0 || height > 0x7FFFFFFFU ||
+        channels < 1 || channels > 4 || bands == NULL || band_count == 0)
+        return 0;
+    for (size_t i = 0; i < band_count; ++i)
+    {
+        if (bands[i].Size > 0x7FFFFFFFU - 6)
+            return 0;
+        adler     = i == 0 ? bands[i].Adler : adler32_combine(adler, bands[i].Adler, bands[i].FilteredSize);
+        filtered += bands[i].FilteredSize;
+        need     += 12 + bands[i].Size;
+    }
+    if (filtered != height * (width * channels + 1))
+        return 0;
+    if (dst == NULL)
+        return need;
+    if (dst_size < need)
+        return 0;
+
+    uint8_t *op = (uint8_t*) dst;
+    memcpy(op, signature, sizeof(signature));
+    op += sizeof(signature);
+
+    uint8_t *chunk = op;
+    png_store32(op, 13);
+    memcpy(op + 4, "IHDR", 4);
+    png_store32(op + 8, uint32_t(width));
+    png_store32(op + 12, uint32_t(height));
+    op[16] = 8;
+    op[17] = color_type[channels];
+    op[18] = 0; // deflate
+    op[19] = 0; // adaptive filtering
+    op[20] = 0; // no interlace
+    png_store32(op + 21, png_crc32(0, chunk + 4, 17));
+    op += 25;
+
+    for (size_t i = 0; i < band_count; ++i)
+    {   // one IDAT chunk per band; the zlib header and trailer wrap all bands.
+        bool   first = i == 0;
+        bool   final = i == band_count - 1;
+        size_t size  = bands[i].Size + (first ? 2 : 0) + (final ? 4 : 0);
+        chunk = op;
+        png_store32(op, uint32_t(size));
+        memcpy(op + 4, "IDAT", 4);
+        op += 8;
+        if (first)
+        {   // 32KB window, fastest compression level.
+            *op++ = 0x78;
+            *op++ = 0x01;
+        }
+        memmove(op, bands[i].Data, bands[i].Size);
+        op += bands[i].Size;
+        if (final)
+        {
+            png_store32(op, adler);
+            op += 4;
+        }
+        png_store32(op, png_crc32(0, chunk + 4, size + 4));
+        op += 4;
+    }
+
+    png_store32(op, 0);
+    memcpy(op + 4, "IEND", 4);
+    png_store32(op + 8, png_crc32(0, op + 4, 4));
+    op += 12;
+    return size_t(op - (uint8_t*) dst);
+}
+
+size_t data::png_encode_bound(size_t width, size_t height, size_t channels)
+{
+    // signature, IHDR, IDAT with the zlib header and trailer, and IEND.
+    return 8 + 25 + 12 + 2 + 4 + 12 + data::png_band_bound(width, height, channels);
+}
+
+size_t data::png_encode(void *dst, size_t dst_size, void const *src, size_t src_pitch, size_t width, size_t height, size_t channels, uint32_t compression)
+{
+    // the band is compressed directly into its final position in the IDAT chunk.
+    size_t const     offset = 8 + 25 + 8 + 2;
+    data::png_band_t band;
+    if (dst_size < offset)
+        return 0;
+    if (data::png_encode_band((uint8_t*) dst + offset, dst_size - offset, src, src_pitch, width, 0, height, channels, compression, true, &band) == 0)
+        return 0;
+    return data::png_encode_bands(dst, dst_size, width, height, channels, &band, 1);
 }
@@ -13,9 +13,22 @@
 /*////////////////
 //   Includes   //
 ////////////////*/
+#include <float.h>
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+
+/// @summary Route the scratch memory allocated internally by stb_image_resize
+/// through the scratch pool owned by the conversion job. The alloc_context
+/// supplied to the stbir_resize_*_generic functions is a scratch_pool_t*.
+struct scratch_pool_t;
+static void* scratch_alloc(scratch_pool_t *pool, size_t size);
+static void  scratch_free (scratch_pool_t *pool, void *buffer);
+#define STBIR_MALLOC(size, context)  scratch_alloc((scratch_pool_t*)(context), (size))
+#define STBIR_FREE(ptr, context)     scratch_free ((scratch_pool_t*)(context), (ptr))
+
 #include "stb_dxt.h"
 #include "stb_image.h"
 #include "stb_image_resize.h"
@@ -23,11 +36,41 @@
 
 #ifdef _MSC_VER
 #define stricmp_fn   _stricmp
+#define strnicmp_fn  _strnicmp
 #endif
 
 #ifdef __GNUC__
 #include <strings.h>
 #define stricmp_fn   strcasecmp
+#define strnicmp_fn  strncasecmp
+#endif
+
+/// @summary Abstract platform differences for threads, mutexes and condition variables.
+#if defined(_WIN32) || defined(_WIN64)
+    #define  WIN32_LEAN_AND_MEAN
+    #define  NOMINMAX
+    #include <windows.h>
+    #define  THREAD_FUNC     DWORD WINAPI
+    typedef  HANDLE          thread_id_t;
+    typedef  CRITICAL_SECTION mutex_t;
+    typedef  CONDITION_VARIABLE cond_t;
+#else
+    #include <errno.h>
+    #include <pthread.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define  THREAD_FUNC     void*
+    typedef  pthread_t       thread_id_t;
+    typedef  pthread_mutex_t mutex_t;
+    typedef  pthread_cond_t  cond_t;
+#endif
+
+/// @summary Enable SSE2 code paths where the target guarantees SSE2 support.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define  MAKEDDS_SSE2    1
+#else
+    #define  MAKEDDS_SSE2    0
 #endif
 
 /*/////////////////
@@ -37,6 +80,107 @@
 /// be so large, but volume images can have many slices.
 static size_t   const  MAX_SOURCE_IMAGES = 4096;
 
+/// @summary The size of the buffer holding the name of an embedded input,
+/// such as "SourceData[4095]", including the terminating zero.
+static size_t   const  SOURCE_NAME_SIZE  = 20;
+
+/// @summary Define the maximum number of threads used to process a single job.
+static size_t   const  MAX_WORKER_THREADS  = 64;
+
+/// @summary Define the maximum number of levels in a mipmap chain.
+static size_t   const  MAX_MIP_LEVELS      = 32;
+
+/// @summary Define the maximum number of slices of one volume level that
+/// contribute to a single slice of the next level. Each level halves the depth,
+/// so a window holds two slices, or three where an odd depth is folded in.
+static size_t   const  MAX_VOLUME_WINDOW   = 3;
+
+/// @summary Define the number of rows processed by each work item when slices
+/// are averaged together to produce a slice of the next volume level.
+static size_t   const  VOLUME_BAND_ROWS    = 16;
+
+/// @summary Define the size, in bytes, of the smallest block handed out by a
+/// scratch pool. Smaller requests are rounded up to this size.
+static size_t   const  SCRATCH_MIN_SIZE    = 4096;
+
+/// @summary Define the number of size classes maintained by a scratch pool.
+/// Each power-of-two range is split into four classes, so rounding up wastes
+/// at most 25% of a block. 160 classes covers requests up to 2^52 bytes.
+static size_t   const  SCRATCH_CLASS_COUNT = 160;
+
+/// @summary Define the number of rows of a cubemap face generated by each work
+/// item when projecting an equirectangular image onto the cubemap faces.
+static size_t   const  PROJECTION_BAND_ROWS = 16;
+
+/// @summary Define the number of importance samples taken per texel when
+/// prefiltering cubemap levels with the GGX distribution.
+static size_t   const  GGX_SAMPLE_COUNT     = 128;
+
+/// @summary Define the number of bins in the alpha histogram used to preserve
+/// alpha-test coverage in mipmaps. 8-bit alpha values map to bins exactly.
+static size_t   const  ALPHA_HISTOGRAM_BINS = 256;
+
+/// @summary Define the largest alpha scale factor considered, and the number
+/// of bisection steps used to find the scale that preserves coverage.
+static float    const  ALPHA_SCALE_MAX      = 4.0f;
+static size_t   const  ALPHA_SCALE_ITERATIONS = 16;
+
+/// @summary Define the squared length below which a filtered normal is treated
+/// as degenerate and replaced with +Z during renormalization.
+static float    const  NORMAL_MIN_LENGTH_SQ = 1.0e-8f;
+
+/// @summary The largest support radius, in source pixels at a scale of 1.0, of
+/// any filter used with stb_image_resize. Strip processing reads this many
+/// extra rows of the level above (scaled by the reduction factor) above and
+/// below a strip.
+static double   const  STRIP_FILTER_SUPPORT = 2.0;
+
+/// @summary The 12-byte identifier at the start of every KTX2 file.
+static uint8_t  const  KTX2_IDENTIFIER [12] =
+{
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+/// @summary The default width and height, in pixels, of each page of a texture
+/// atlas, used when no Width or Height is specified.
+static size_t   const  ATLAS_PAGE_SIZE      = 2048;
+
+/// @summary The largest width or height, in pixels, of a texture atlas page.
+/// Rects are stored with 16-bit coordinates.
+static size_t   const  ATLAS_MAX_PAGE_SIZE  = 16384;
+
+/// @summary The default and maximum number of recently emitted blocks searched
+/// by the rate-distortion optimized BC1/BC3 encoder.
+static size_t   const  RDO_DEFAULT_WINDOW   = 64;
+static size_t   const  RDO_MAX_WINDOW       = 1024;
+
+/// @summary The estimated cost, in bits, of 8 bytes of block data that an LZ
+/// compressor stores as literals, as a new match (token and 16-bit offset),
+/// as half literals and a minimum-length match, or as a continuation of the
+/// match that covered the previous block.
+static float    const  RDO_BITS_LITERAL     = 64.0f;
+static float    const  RDO_BITS_MATCH       = 24.0f;
+static float    const  RDO_BITS_PARTIAL     = 60.0f;
+static float    const  RDO_BITS_EXTEND      = 4.0f;
+
+/// @summary The number of texels gathered from the neighboring faces around
+/// each side of a cubemap face when generating seamless mip levels. This
+/// covers the filter support when a level is reduced by half.
+static size_t   const  CUBEMAP_BORDER_TEXELS = 5;
+
+/// @summary The number of rows of a subresource slice examined by each work
+/// item when computing texel statistics for --verify.
+static size_t   const  VERIFY_BAND_ROWS     = 64;
+
+/// @summary The SSIM stabilizing constants (0.01 * 255)^2 and (0.03 * 255)^2
+/// for 8-bit channels, which keep the ratios finite over flat windows.
+static double   const  SSIM_C1              = 6.5025;
+static double   const  SSIM_C2              = 58.5225;
+
+/// @summary The minimum number of rows in each band of an image that is
+/// split across threads when written to a PNG or TGA file.
+static size_t   const  ENCODE_BAND_ROWS     = 64;
+
 /// @summary An array of values corresponding to the ALPHAMODE_STRINGS array.
 static uint32_t const  ALPHAMODE_VALUES   [] =
 {
@@ -299,9 +443,192 @@ static char     const *ALPHAMODE_STRINGS  [] =
     "CUSTOM"
 };
 
+/// @summary An array of strings used to translate the string representation
+/// of a projection_e value into the corresponding enumeration value, which is
+/// the index of the string in the array.
+static char     const *PROJECTION_STRINGS [] =
+{
+    "NONE",
+    "EQUIRECT"
+};
+
+/// @summary An array of strings used to translate the string representation
+/// of an atlas_packer_e value into the corresponding enumeration value, which
+/// is the index of the string in the array.
+static char     const *PACKER_STRINGS     [] =
+{
+    "MAXRECTS",
+    "SKYLINE"
+};
+
+/// @summary An array of strings used to translate the string representation
+/// of a filter_e value into the corresponding enumeration value, which is the
+/// index of the string in the array.
+static char     const *FILTER_STRINGS     [] =
+{
+    "DEFAULT",
+    "BOX",
+    "TRIANGLE",
+    "CUBIC",
+    "CATMULL-ROM",
+    "MITCHELL"
+};
+
+/// @summary An array of strings used to translate the string representation
+/// of a prefilter_e value into the corresponding enumeration value, which is
+/// the index of the string in the array.
+static char     const *PREFILTER_STRINGS  [] =
+{
+    "NONE",
+    "GGX"
+};
+
+/// @summary An array of strings used to translate the string representation
+/// of a colorspace_e value into the corresponding enumeration value, which is
+/// the index of the string in the array.
+static char     const *COLORSPACE_STRINGS [] =
+{
+    "AUTO",
+    "LINEAR",
+    "SRGB"
+};
+
+/// @summary An array of strings used to translate the string representation
+/// of an edge mode into the corresponding stbir_edge value. The stbir_edge
+/// value is one greater than the index of the string in the array.
+static char     const *EDGEMODE_STRINGS   [] =
+{
+    "CLAMP",
+    "REFLECT",
+    "WRAP"
+};
+
+/// @summary The edge-adjacency table of a cubemap, indexed by face (in DDS
+/// face order) and edge (left, right, top, bottom; see cubemap_edge_e), using
+/// the Direct3D face orientations.
+/// Each entry is { Face, Edge, Flip }, where Face and Edge identify the shared
+/// edge of the adjacent face, and Flip is non-zero if texels run in opposite
+/// directions along the shared edge.
+static uint8_t  const  CUBEMAP_ADJACENCY [6][4][3] =
+{
+    { { 4, 1, 0 }, { 5, 0, 0 }, { 2, 1, 1 }, { 3, 1, 0 } },
+    { { 5, 1, 0 }, { 4, 0, 0 }, { 2, 0, 0 }, { 3, 0, 1 } },
+    { { 1, 2, 0 }, { 0, 2, 1 }, { 5, 2, 1 }, { 4, 2, 0 } },
+    { { 1, 3, 1 }, { 0, 3, 0 }, { 4, 3, 0 }, { 5, 3, 1 } },
+    { { 1, 1, 0 }, { 0, 0, 0 }, { 2, 3, 0 }, { 3, 2, 0 } },
+    { { 0, 1, 0 }, { 1, 0, 0 }, { 2, 2, 1 }, { 3, 3, 1 } }
+};
+
 /*//////////////////
 //   Data Types   //
 //////////////////*/
+/// @summary Define the filters used to generate mipmap levels.
+enum filter_e
+{
+    FILTER_DEFAULT      = 0, /// The stb_image_resize default (Catmull-Rom up, Mitchell down).
+    FILTER_BOX          = 1, /// Box filter.
+    FILTER_TRIANGLE     = 2, /// Triangle (tent) filter.
+    FILTER_CUBIC        = 3, /// Cubic B-spline.
+    FILTER_CATMULLROM   = 4, /// Catmull-Rom spline.
+    FILTER_MITCHELL     = 5  /// Mitchell-Netravali filter, B = C = 1/3.
+};
+
+/// @summary Define the prefilters applied to the mipmap levels of cubemaps,
+/// in addition to the resampling filter.
+enum prefilter_e
+{
+    PREFILTER_NONE      = 0, /// Levels are only resampled.
+    PREFILTER_GGX       = 1  /// Prefilter cubemap levels by GGX roughness.
+};
+
+/// @summary Define the edges of a cubemap face, used to index the cubemap
+/// edge-adjacency table.
+enum cubemap_edge_e
+{
+    CUBEMAP_EDGE_LEFT   = 0, /// The edge at x = 0.
+    CUBEMAP_EDGE_RIGHT  = 1, /// The edge at x = width - 1.
+    CUBEMAP_EDGE_TOP    = 2, /// The edge at y = 0.
+    CUBEMAP_EDGE_BOTTOM = 3  /// The edge at y = height - 1.
+};
+
+/// @summary Define the colorspaces in which LDR images may be filtered.
+enum colorspace_e
+{
+    COLORSPACE_AUTO     = 0, /// sRGB for LDR color, linear for HDR and normal maps.
+    COLORSPACE_LINEAR   = 1, /// Filter the stored values directly.
+    COLORSPACE_SRGB     = 2  /// Convert LDR color channels to linear light to filter.
+};
+
+/// @summary Define the supported projections of source images onto cubemaps.
+enum projection_e
+{
+    PROJECTION_NONE     = 0, /// Each face is supplied as a separate source image.
+    PROJECTION_EQUIRECT = 1  /// Each cubemap is projected from one lat-long source image.
+};
+
+/// @summary Define flags describing the numeric interpretation of the samples
+/// of a KTX2 format, used to build its data format descriptor.
+enum ktx2_format_flags_e
+{
+    KTX2_FORMAT_NORMALIZED = (0 << 0), /// Unsigned normalized integer samples.
+    KTX2_FORMAT_SIGNED     = (1 << 0), /// Samples are signed.
+    KTX2_FORMAT_FLOAT      = (1 << 1), /// Samples are floating-point.
+    KTX2_FORMAT_INTEGER    = (1 << 2), /// Samples are non-normalized integers.
+    KTX2_FORMAT_SRGB       = (1 << 3)  /// Color samples use the sRGB transfer function.
+};
+
+/// @summary Define the Khronos data format descriptor color models and channel
+/// IDs used when describing the formats makedds can write to a KTX2 file.
+enum ktx2_dfd_e
+{
+    KTX2_MODEL_RGBSDA      = 1,   /// Uncompressed RGB, stencil, depth and alpha.
+    KTX2_MODEL_BC1A        = 128, /// BC1, with or without 1-bit alpha.
+    KTX2_MODEL_BC2         = 129, /// BC2, explicit 4-bit alpha.
+    KTX2_MODEL_BC3         = 130, /// BC3, interpolated alpha.
+    KTX2_MODEL_BC4         = 131, /// BC4, one channel.
+    KTX2_MODEL_BC5         = 132, /// BC5, two channels.
+    KTX2_MODEL_BC6H        = 133, /// BC6H, HDR color.
+    KTX2_MODEL_BC7         = 134, /// BC7, color and optional alpha.
+    KTX2_CHANNEL_R         = 0,   /// The red channel, or the color channel of BCn formats.
+    KTX2_CHANNEL_G         = 1,   /// The green channel, or the second channel of BC5.
+    KTX2_CHANNEL_BC1A      = 1,   /// The color channel of BC1 formats with 1-bit alpha.
+    KTX2_CHANNEL_B         = 2,   /// The blue channel.
+    KTX2_CHANNEL_D         = 14,  /// The depth channel.
+    KTX2_CHANNEL_A         = 15   /// The alpha channel.
+};
+
+/// @summary Describes how a DXGI format is stored in a KTX2 container. Each
+/// sample is described by its channel ID, bit offset and bit length.
+struct ktx2_format_t
+{
+    uint32_t    DxgiFormat;   /// One of data::dxgi_format_e.
+    uint32_t    VkFormat;     /// The equivalent VkFormat value.
+    uint8_t     ColorModel;   /// One of the KTX2_MODEL_x values of ktx2_dfd_e.
+    uint8_t     BlockBytes;   /// The number of bytes per pixel or compressed block.
+    uint8_t     BlockSize;    /// The width and height of a texel block, 1 or 4.
+    uint8_t     TypeSize;     /// The KTX2 typeSize, used for endian conversion.
+    uint8_t     Flags;        /// A combination of ktx2_format_flags_e.
+    uint8_t     SampleCount;  /// The number of valid entries in Samples.
+    uint8_t     Samples[4][3];/// The channel ID, bit offset and bit length of each sample.
+};
+
+/// @summary Define the algorithms used to pack images into texture atlas pages.
+enum atlas_packer_e
+{
+    PACKER_MAXRECTS     = 0, /// MaxRects with the best-short-side-fit heuristic.
+    PACKER_SKYLINE      = 1  /// Skyline with the bottom-left heuristic.
+};
+
+/// @summary Define the file types written by --extract.
+enum extract_output_e
+{
+    EXTRACT_RAW         = 0, /// The data is copied as stored to .raw files.
+    EXTRACT_PNG         = 1, /// The data is decoded to RGBA8 and written as PNG.
+    EXTRACT_TGA         = 2  /// The data is decoded to RGBA8 and written as RLE TGA.
+};
+
+struct metrics_job_t;
+
 /// @summary Define the set of input parameters to the application.
 struct dds_params_t
 {
@@ -317,24 +644,460 @@ struct dds_params_t
     bool        Cubemap;      /// true if the output is a cubemap or cubemap array. Default = false.
     bool        Volume;       /// true if the output is a volume image. Default = false.
     bool        ForcePow2;    /// true if the output dimensions should be powers of two. Default = false.
+    uint32_t    Projection;   /// One of projection_e. Default = PROJECTION_NONE.
+    uint32_t    Filter;       /// One of filter_e. Default = FILTER_DEFAULT.
+    uint32_t    Prefilter;    /// One of prefilter_e. Default = PREFILTER_NONE.
+    char const *IrradianceSH; /// Path of the JSON file receiving SH coefficients, or NULL.
+    char const *IrradianceCube; /// Path of the DDS file receiving the irradiance cubemap, or NULL.
+    size_t      IrradianceSize; /// The face size of the irradiance cubemap. Default = 32.
+    float       AlphaTestReference; /// Alpha test reference for coverage-preserving mips. Default = 0 (off).
+    bool        NormalMap;    /// true if the source is a tangent-space normal map. Default = false.
+    bool        SeamlessCubemap; /// true to filter cubemap mips across face edges. Default = false.
+    uint32_t    ColorSpace;   /// One of colorspace_e. Default = COLORSPACE_AUTO.
+    uint32_t    EdgeMode;     /// One of stbir_edge. Default = STBIR_EDGE_CLAMP.
+    bool        Atlas;        /// true to pack the source images into atlas pages. Width and Height set the page size. Default = false.
+    uint32_t    AtlasPacker;  /// One of atlas_packer_e. Default = PACKER_MAXRECTS.
+    size_t      AtlasPadding; /// Empty texels between the extruded images on a page. Default = 2.
+    size_t      AtlasExtrude; /// Texels of edge extrusion around each image. Default = 1.
+    char const *AtlasTable;   /// Path of the binary rect table, or NULL to derive it from OutputFile.
+    bool        Ktx2;         /// true to also write the output as a KTX2 file. Default = false.
+    char const *Ktx2File;     /// Path of the KTX2 file, or NULL to derive it from OutputFile.
+    bool        Supercompress; /// true to also write an LZ-supercompressed .ddsz file. Default = false.
+    char const *SupercompressFile; /// Path of the .ddsz file, or NULL to derive it from OutputFile.
+    float       RdoLambda;    /// Rate-distortion tradeoff for BC1/BC3 encoding, or 0 to disable. Default = 0.
+    size_t      RdoWindow;    /// The number of recent blocks searched by RDO encoding. Default = 64.
+    bool        Metrics;      /// true to measure the error of block-compressed output. Default = false.
+    char const *MetricsFile;  /// Path of the JSON metrics file, or NULL to derive it from OutputFile.
+    metrics_job_t *MetricsJob;/// Receives the error measured by the encoders, or NULL.
+    bool        Transcode;    /// true if SourceFiles[0] is a DDS file being re-encoded. Default = false.
+    bool        FormatDefaulted; /// true if Format replaced a DDS source format that cannot be re-encoded.
+    bool        KeepMipmaps;  /// true to re-encode the levels of a DDS source rather than regenerate them.
+    size_t      MemoryLimit;  /// Working memory budget, in bytes, for strip processing. Default = 0 (unlimited).
+    size_t      ThreadCount;  /// The maximum number of worker threads. Default = number of CPUs.
     char       *OutputFile;   /// The path or filename of the output file to generate.
     char       *JsonBuffer;   /// The buffer containing the input JSON data, or NULL.
     size_t      SourceCount;  /// The number of items in SourceFiles.
     size_t      SourceIndex;  /// The index of the item in SourceFiles being processed.
-    char const *SourceFiles[MAX_SOURCE_IMAGES]; /// The filenames of all input files.
+    char const *SourceFiles[MAX_SOURCE_IMAGES]; /// The filenames of all input files, or a name such as "SourceData[3]" for embedded inputs.
+    char const *SourceData [MAX_SOURCE_IMAGES]; /// The base64 text of embedded inputs, or NULL for files.
+    char        SourceNames[MAX_SOURCE_IMAGES][SOURCE_NAME_SIZE]; /// Storage for the names of embedded inputs.
+};
+
+/// @summary The header prepended to every block handed out by a scratch pool.
+/// While the block is free, Next links it into the free list for its class.
+struct scratch_block_t
+{
+    scratch_block_t *Next;    /// The next free block in the same size class.
+    size_t           Class;   /// The zero-based index of the block size class.
+};
+
+/// @summary A size-classed pool of scratch buffers owned by a conversion job.
+/// Released blocks are kept on per-class free lists and handed back out for
+/// later requests of a similar size, so processing a series of same-sized
+/// faces, slices or array elements only allocates while handling the first.
+struct scratch_pool_t
+{
+    mutex_t          Lock;    /// Serializes access from concurrent workers.
+    scratch_block_t *FreeList[SCRATCH_CLASS_COUNT]; /// Free blocks, by size class.
+};
+
+/// @summary Function signature for a unit of work executed by parallel_for().
+/// @param index The zero-based index of the work item to execute.
+/// @param context Opaque data supplied by the caller of parallel_for().
+typedef void (*work_item_fn)(size_t index, void *context);
+
+/// @summary State shared by the threads executing a parallel_for() call.
+struct parallel_for_t
+{
+    work_item_fn  Work;       /// The function to invoke for each work item.
+    void         *Context;    /// Opaque data passed through to Work.
+    long          Count;      /// The total number of work items.
+    long volatile Next;       /// The index of the next work item to claim.
+};
+
+/// @summary The persistent worker threads that execute parallel_for() calls
+/// alongside the calling thread. Only one call is dispatched to the pool at a
+/// time; calls made while a job is running are executed inline.
+struct worker_pool_t
+{
+    mutex_t         Lock;         /// Protects all of the fields below.
+    cond_t          WorkReady;    /// Signalled when a job is posted or the pool shuts down.
+    cond_t          WorkDone;     /// Signalled when the last worker leaves a job.
+    parallel_for_t *Job;          /// The job being executed, or NULL.
+    size_t          Generation;   /// Incremented each time a job is posted.
+    size_t          Slots;        /// The number of workers that may still join Job.
+    size_t          Active;       /// The number of workers executing Job.
+    size_t          ThreadCount;  /// The number of valid items in Threads.
+    bool            Shutdown;     /// true when the workers should exit.
+    thread_id_t     Threads[MAX_WORKER_THREADS]; /// The worker threads.
 };
 
 /// @summary Represents a single image slice loaded into memory by stb_image.
 struct image_info_t
 {
-    void       *Pixels;       /// Pointer to the input buffer of pixels.
-    int         Width;        /// The number of pixels per-row in the input image.
-    int         Height;       /// The number of rows in the input image.
-    int         Channels;     /// The number of channels in the input image.
-    uint32_t    Format;       /// One of data::dxgi_format_e indicating the 'default' format.
-    bool        HDR;          /// true if this is an HDR image and Pixels are float.
+    scratch_pool_t *Pool;     /// The pool that owns Pixels, or NULL if owned by stb_image.
+    void           *Pixels;   /// Pointer to the input buffer of pixels.
+    int             Width;    /// The number of pixels per-row in the input image.
+    int             Height;   /// The number of rows in the input image.
+    int             Channels; /// The number of channels in the input image.
+    uint32_t        Format;   /// One of data::dxgi_format_e indicating the 'default' format.
+    bool            HDR;      /// true if this is an HDR image and Pixels are float.
+};
+
+/// @summary Describes one level of a volume image as it is streamed to disk.
+struct volume_level_t
+{
+    size_t        Width;       /// The number of pixels per-row in each slice.
+    size_t        Height;      /// The number of rows in each slice.
+    size_t        Depth;       /// The number of slices in the level.
+    size_t        SliceSize;   /// The size of a single encoded slice, in bytes.
+    size_t        Offset;      /// The byte offset of the level from the start of the data.
+    size_t        SliceCount;  /// The number of slices written so far.
+    size_t        WindowCount; /// The number of slices held in Window.
+    image_info_t  Window[MAX_VOLUME_WINDOW]; /// Slices awaiting reduction into the next level.
+};
+
+/// @summary State maintained while streaming the slices of a volume image and
+/// its mipmap chain to the output stream.
+struct volume_writer_t
+{
+    FILE           *Errors;     /// The output stream for errors and warnings.
+    FILE           *Output;     /// The DDS output stream.
+    scratch_pool_t *Pool;       /// The pool used for slice buffers.
+    dds_params_t   *Params;     /// Image processing parameters.
+    int64_t         DataStart;  /// The offset of the first byte of level data.
+    size_t          LevelCount; /// The number of levels being written.
+    volume_level_t  Levels[MAX_MIP_LEVELS]; /// Per-level state.
+};
+
+/// @summary Context passed to the work items that reduce a window of volume
+/// slices into a single slice of the next level.
+struct volume_reduce_t
+{
+    volume_writer_t    *Writer;     /// The volume writer.
+    image_info_t const *Inputs;     /// The window slices being reduced.
+    image_info_t       *Reduced;    /// The window slices resampled in X and Y.
+    image_info_t       *Output;     /// The slice being generated.
+    size_t              InputCount; /// The number of slices in the window.
+    size_t              Width;      /// The width of the generated slice.
+    size_t              Height;     /// The height of the generated slice.
+    bool volatile       Failed;     /// Set if any resample failed.
+};
+
+/// @summary Describes the source image, or one level generated from it, as a
+/// mipmap chain is generated in strips and cascaded down the chain.
+struct strip_level_t
+{
+    size_t        Width;      /// The number of pixels per-row.
+    size_t        Height;     /// The number of rows in the level.
+    size_t        Stride;     /// The number of bytes in one row of pixels.
+    size_t        Pitch;      /// The encoded size of one row, or one row of blocks.
+    size_t        Offset;     /// The byte offset of the level from the start of the data.
+    size_t        Halo;       /// Rows of the previous level read beyond each side of a strip.
+    size_t        Deferred;   /// Leading rows generated once the previous level is complete.
+    size_t        HeadRows;   /// Leading rows kept in Head for a wrapping edge of the next level.
+    size_t        Capacity;   /// The number of rows Window can hold.
+    size_t        Next;       /// The first row of the next strip to generate.
+    size_t        First;      /// The row of the level held in the first row of Window.
+    size_t        Count;      /// The number of rows held in Window.
+    bool          Resident;   /// Set if Window is the whole decoded source image.
+    bool          Complete;   /// Set once every row of the level has been generated.
+    float         AlphaScale; /// The scale applied to alpha values before encoding.
+    uint8_t      *Window;     /// The most recent rows, awaiting reduction into the next level.
+    uint8_t      *Head;       /// The first HeadRows rows of the level.
+    uint32_t      Histogram[ALPHA_HISTOGRAM_BINS]; /// Alpha values counted by the measurement pass.
+};
+
+/// @summary State maintained while generating a mipmap chain in strips. Entry
+/// zero of Levels describes the source image, and entry i + 1 describes level i.
+struct strip_chain_t
+{
+    FILE               *Errors;     /// The output stream for errors and warnings.
+    FILE               *Output;     /// The DDS output stream.
+    scratch_pool_t     *Pool;       /// The pool used for strip buffers.
+    dds_params_t const *Params;     /// Image processing parameters.
+    image_info_t const *Source;     /// The decoded source image.
+    int64_t             DataStart;  /// The offset of the first byte of level data.
+    size_t              DataSize;   /// The encoded size of the entire chain.
+    size_t              StripRows;  /// The number of rows generated per strip.
+    size_t              LevelCount; /// The number of entries in Levels, including the source.
+    bool                Measure;    /// Set during the alpha coverage measurement pass.
+    strip_level_t       Levels[MAX_MIP_LEVELS + 1]; /// Per-level state.
+};
+
+/// @summary Describes an axis-aligned rectangle on a texture atlas page.
+struct pack_rect_t
+{
+    size_t              X;          /// The x-coordinate of the upper-left corner.
+    size_t              Y;          /// The y-coordinate of the upper-left corner.
+    size_t              Width;      /// The width of the rectangle.
+    size_t              Height;     /// The height of the rectangle.
+};
+
+/// @summary Describes one segment of the skyline of a page being packed with
+/// the skyline algorithm.
+struct skyline_node_t
+{
+    size_t              X;          /// The x-coordinate of the left end of the segment.
+    size_t              Y;          /// The height of the skyline over the segment.
+    size_t              Width;      /// The width of the segment.
+};
+
+/// @summary State maintained while packing rectangles onto a single page.
+struct atlas_packer_t
+{
+    uint32_t            Method;     /// One of atlas_packer_e.
+    size_t              Width;      /// The width of the packing area.
+    size_t              Height;     /// The height of the packing area.
+    size_t              Count;      /// The number of valid items in Nodes or Free.
+    size_t              Capacity;   /// The number of items allocated for Nodes or Free.
+    skyline_node_t     *Nodes;      /// The skyline, from left to right (PACKER_SKYLINE).
+    pack_rect_t        *Free;       /// The maximal free rectangles (PACKER_MAXRECTS).
+};
+
+/// @summary Describes a single source image placed in a texture atlas.
+struct atlas_sprite_t
+{
+    image_info_t        Image;      /// The source image, once loaded.
+    size_t              Page;       /// The zero-based index of the page containing the image.
+    size_t              X;          /// The x-coordinate of the image on its page, excluding extrusion.
+    size_t              Y;          /// The y-coordinate of the image on its page, excluding extrusion.
+    size_t              Width;      /// The width of the image, in pixels.
+    size_t              Height;     /// The height of the image, in pixels.
+    bool                Loaded;     /// true if Image was loaded successfully.
+    bool                Placed;     /// true if the image has been assigned a page.
+};
+
+/// @summary Context passed to the work items that load the source images of a
+/// texture atlas and copy them onto their pages.
+struct atlas_job_t
+{
+    FILE               *Errors;     /// The output stream for errors and warnings.
+    dds_params_t       *Params;     /// Image processing parameters.
+    atlas_sprite_t     *Sprites;    /// One entry for each source image.
+    image_info_t       *Pages;      /// The page images.
+};
+
+/// @summary Describes one face of a cubemap being processed concurrently with
+/// the other faces of the same cubemap.
+struct cubemap_face_t
+{
+    image_info_t    Image;       /// The face image, once loaded.
+    image_info_t    Levels[MAX_MIP_LEVELS]; /// Prefiltered levels 1+, if generated.
+    FILE           *Stream;      /// The temporary stream receiving the face chain, or NULL.
+    metrics_job_t  *Metrics;     /// Receives the error measured while encoding into Stream, or NULL.
+    bool            Loaded;      /// true if Image was loaded successfully.
+    bool            Written;     /// true if the face chain was written successfully.
 };
 
+/// @summary Context passed to the work items that load and write the faces
+/// of a single cubemap.
+struct cubemap_job_t
+{
+    FILE           *Errors;      /// The output stream for errors and warnings.
+    scratch_pool_t *Pool;        /// The pool used for resampled image buffers.
+    dds_params_t   *Params;      /// Image processing parameters.
+    size_t          FirstSource; /// The index in SourceFiles of the +X face.
+    bool            Prefiltered; /// true if the faces have prefiltered Levels.
+    cubemap_face_t  Faces[6];    /// Per-face state, in DDS face order.
+};
+
+/// @summary Context passed to the work items that project an equirectangular
+/// source image onto the six faces of a cubemap.
+struct equirect_job_t
+{
+    image_info_t const *Source;    /// The equirectangular source image.
+    cubemap_face_t     *Faces;     /// The six faces being generated.
+    size_t              BandCount; /// The number of row bands per face.
+    bool                Srgb;      /// true to blend LDR color channels in linear light.
+};
+
+/// @summary Context passed to the work items that prefilter the levels of a
+/// cubemap with the GGX distribution. The sample arrays are stored as separate
+/// streams so that four samples can be transformed at once.
+struct ggx_job_t
+{
+    cubemap_face_t     *Faces;        /// The faces whose levels are generated.
+    size_t              Level;        /// The level being generated.
+    size_t              BandCount;    /// The number of row bands per face.
+    size_t              SampleCount;  /// The number of valid samples.
+    size_t              PaddedCount;  /// SampleCount rounded up to a multiple of four.
+    size_t              SourceLevels; /// The number of levels in each source chain.
+    float               Lx [GGX_SAMPLE_COUNT + 4]; /// Tangent-space sample direction x.
+    float               Ly [GGX_SAMPLE_COUNT + 4]; /// Tangent-space sample direction y.
+    float               Lz [GGX_SAMPLE_COUNT + 4]; /// Tangent-space sample direction z.
+    float               W  [GGX_SAMPLE_COUNT + 4]; /// Sample weight (N dot L), or 0.
+    float               Lod[GGX_SAMPLE_COUNT + 4]; /// Source level to sample.
+    image_info_t        Sources[6][MAX_MIP_LEVELS]; /// Plain mip chain of each face.
+};
+
+/// @summary Context passed to the work items that generate one level of a
+/// cubemap by filtering each face together with a border gathered from the
+/// previous level of its neighbors.
+struct seamless_job_t
+{
+    cubemap_job_t      *Cube;         /// The cubemap whose levels are generated.
+    size_t              Level;        /// The level being generated.
+    bool volatile       Failed;       /// Set if any face could not be generated.
+};
+
+/// @summary The spherical harmonic projection of part of a cubemap.
+struct sh_partial_t
+{
+    double              Coeff[9][3];  /// Weighted sums for each basis function and channel.
+    double              Weight;       /// The sum of the solid angle weights.
+};
+
+/// @summary Context passed to the work items that project a cubemap onto the
+/// spherical harmonic basis and render the resulting irradiance cubemap.
+struct sh_job_t
+{
+    cubemap_face_t     *Faces;        /// The faces of the source cubemap.
+    size_t              BandCount;    /// The number of row bands per face.
+    sh_partial_t       *Partials;     /// One partial sum per work item.
+    float               Radiance  [9][3]; /// The radiance coefficients.
+    float               Irradiance[9][3]; /// The irradiance coefficients, scaled by 1/pi.
+    image_info_t        Output[6];    /// The faces of the irradiance cubemap.
+};
+
+/// @summary The recently emitted blocks searched by the rate-distortion
+/// optimized BC1/BC3 encoder, stored as a ring buffer.
+struct rdo_window_t
+{
+    uint8_t                *Blocks;   /// Storage for Capacity encoded blocks.
+    size_t                  BlockSize;/// The size of an encoded block, 8 (BC1) or 16 (BC3) bytes.
+    size_t                  Capacity; /// The maximum number of blocks in the window.
+    size_t                  Count;    /// The number of valid blocks in the window.
+    size_t                  Next;     /// The slot that receives the next emitted block.
+    size_t                  Match;    /// The slot repeated by the previous block, or Capacity.
+};
+
+/// @summary Context passed to the work items that supercompress the
+/// subresources of a DDS, one work item per subresource.
+struct ddsz_job_t
+{
+    data::dds_level_desc_t *Levels;   /// The subresources of the DDS, in file order.
+    data::ddsz_chunk_t     *Chunks;   /// The chunk table entry for each subresource.
+    uint8_t               **Buffers;  /// The compressed data, or NULL if stored uncompressed.
+};
+
+/// @summary Encoding error gathered while comparing encoded blocks against the
+/// blocks they were encoded from. Channels are in RGBA order; only the channels
+/// stored by the output format are measured.
+struct metrics_sums_t
+{
+    double                  SquaredError[4]; /// The sum of squared errors of each channel.
+    double                  Ssim;     /// The sum of the SSIM of every 4x4 window and measured channel.
+    uint64_t                Windows;  /// The number of window and channel terms in Ssim.
+    uint64_t                Texels;   /// The number of texels compared.
+};
+
+/// @summary The error gathered by one call to write_pixels(), identified by
+/// the offset in the output file of the first row written by the call.
+struct metrics_sample_t
+{
+    int64_t                 Offset;   /// The file offset of the first row.
+    metrics_sums_t          Sums;     /// The error of the rows.
+};
+
+/// @summary Collects the encoding error reported by concurrent encoders for
+/// --metrics. Samples are attributed to mip-levels once the file is complete.
+struct metrics_job_t
+{
+    mutex_t                 Mutex;    /// Protects the sample list.
+    metrics_sample_t       *Samples;  /// The samples reported so far.
+    size_t                  Count;    /// The number of valid items in Samples.
+    size_t                  Capacity; /// The number of items allocated for Samples.
+};
+
+/// @summary Per-channel statistics gathered over the texels of a subresource.
+/// Channels are always stored in RGBA order, regardless of the storage order
+/// of the format. Channels missing from the format hold their default value.
+struct texel_stats_t
+{
+    float                   Min[4];   /// The smallest finite value of each channel.
+    float                   Max[4];   /// The largest finite value of each channel.
+    double                  Sum[4];   /// The sum of the finite values of each channel.
+    uint64_t                Count;    /// The number of texels accumulated.
+    uint64_t                NonFinite;/// The number of NaN or infinite channel values.
+};
+
+/// @summary Describes a horizontal band of one slice of a subresource, which
+/// is the unit of work when computing texel statistics for --verify.
+struct verify_band_t
+{
+    size_t                  Subresource; /// The index of the subresource in the level table.
+    size_t                  Slice;    /// The zero-based slice within the subresource.
+    size_t                  Row;      /// The first row of the band.
+    size_t                  RowCount; /// The number of rows in the band.
+    bool                    Decoded;  /// true if Stats holds the statistics of the band.
+    texel_stats_t           Stats;    /// The statistics of the texels in the band.
+};
+
+/// @summary Context passed to the work items that compute texel statistics
+/// for --verify, one work item per band.
+struct verify_job_t
+{
+    data::dds_file_t const *File;     /// The DDS being verified.
+    scratch_pool_t         *Pool;     /// The pool used for decoded rows.
+    verify_band_t          *Bands;    /// The bands of the DDS.
+};
+
+/// @summary Describes one band of rows of an image written to a PNG or TGA
+/// file, which is the unit of work of write_encoded_image().
+struct encode_band_t
+{
+    size_t                  FirstRow; /// The first row of the band.
+    size_t                  RowCount; /// The number of rows in the band.
+    uint8_t                *Data;     /// The encoded rows, allocated from the job's pool.
+    size_t                  Size;     /// The number of bytes of encoded rows, or 0 on failure.
+    data::png_band_t        PNG;      /// Describes the compressed rows of a PNG band.
+};
+
+/// @summary Context passed to the work items that encode the bands of an
+/// image, one work item per band.
+struct encode_job_t
+{
+    uint8_t const          *Pixels;   /// The RGBA8 image, with rows of Width * 4 bytes.
+    size_t                  Width;    /// The width of the image, in pixels.
+    size_t                  Height;   /// The height of the image, in pixels.
+    bool                    TGA;      /// true to write RLE TGA, or false to write PNG.
+    uint32_t                Compression; /// One of data::png_compression_e.
+    scratch_pool_t         *Pool;     /// The pool used for the encoded bands.
+    encode_band_t          *Bands;    /// The bands of the image.
+};
+
+/// @summary Describes one slice of a subresource, which is the unit of work
+/// when writing subresources to individual files for --extract.
+struct extract_item_t
+{
+    size_t                  Subresource; /// The index of the subresource in the level table.
+    size_t                  Slice;    /// The zero-based slice within the subresource.
+    bool                    Written;  /// true if the slice was written to its file.
+};
+
+/// @summary Context passed to the work items that write subresources for
+/// --extract, one work item per slice.
+struct extract_job_t
+{
+    data::dds_file_t const *File;     /// The DDS being extracted.
+    scratch_pool_t         *Pool;     /// The pool used for decoded images.
+    FILE                   *Errors;   /// The stream to which errors are written.
+    char const             *Directory;/// The directory receiving the files.
+    char const             *Stem;     /// The file name of the DDS, without extension.
+    uint32_t                Output;   /// One of extract_output_e.
+    uint32_t                Compression; /// One of data::png_compression_e, for PNG output.
+    size_t                  BandThreads; /// The number of threads encoding the bands of each slice.
+    extract_item_t         *Items;    /// The slices of the DDS.
+};
+
+/*///////////////
+//   Globals   //
+///////////////*/
+/// @summary The worker threads shared by every parallel_for() call. Started by
+/// start_worker_pool() and stopped by stop_worker_pool().
+static worker_pool_t Worker_Pool;
+
 /*///////////////////////
 //   Local Functions   //
 ///////////////////////*/
@@ -353,53 +1116,606 @@ static void print_header(FILE *fp)
 static void print_usage(FILE *fp)
 {
     fprintf(fp, "USAGE: makedds inputfile outputfile\n");
+    fprintf(fp, "       makedds --info file.dds [file.dds ...]\n");
+    fprintf(fp, "       makedds --verify file.dds [file.dds ...]\n");
+    fprintf(fp, "       makedds --extract dir file.dds [file.dds ...]\n");
     fprintf(fp, "inputfile:  The path to the image or JSON file to load. Images may be\n");
     fprintf(fp, "            JPEG (non-progressive), PNG (8-bit-per-channel), TGA, GIF,\n");
     fprintf(fp, "            BMP (> 1bpp, non-RLE), PSD (composited view only, no extra\n");
     fprintf(fp, "            channels), HDR or PIC format.\n");
     fprintf(fp, "\n");
+    fprintf(fp, "            The input file can also be a DDS file, which is re-encoded\n");
+    fprintf(fp, "            with the same layout. Its mip-levels are kept unless\n");
+    fprintf(fp, "            --mipmap is given, which regenerates them.\n");
+    fprintf(fp, "\n");
     fprintf(fp, "            The input file can also be a JSON file specifying advanced\n");
     fprintf(fp, "            conversion parameters to generate cubemaps, mipmaps, volume\n");
     fprintf(fp, "            images, and so on.\n");
     fprintf(fp, "\n");
     fprintf(fp, "outputfile: The path to the output .dds file.\n");
     fprintf(fp, "\n");
+    fprintf(fp, "options:    --mipmap           Generate the full mipmap chain.\n");
+    fprintf(fp, "            --pow2             Resize to power-of-two dimensions.\n");
+    fprintf(fp, "            --memory-limit MB  Resample and encode in horizontal strips,\n");
+    fprintf(fp, "                               cascading each mip level from the one\n");
+    fprintf(fp, "                               above, using at most MB megabytes of\n");
+    fprintf(fp, "                               working memory. The limit does not cover\n");
+    fprintf(fp, "                               the decoded source image, which stays\n");
+    fprintf(fp, "                               resident, or the memory used to decode it.\n");
+    fprintf(fp, "            --threads N        Use at most N worker threads. Defaults to\n");
+    fprintf(fp, "                               the number of logical processors.\n");
+    fprintf(fp, "            --ktx2             Also write the output as a .ktx2 file\n");
+    fprintf(fp, "                               next to the .dds file.\n");
+    fprintf(fp, "            --supercompress    Also write a losslessly LZ-compressed\n");
+    fprintf(fp, "                               .ddsz file next to the .dds file.\n");
+    fprintf(fp, "            --rdo LAMBDA       Trade BC1/BC3 quality for compressibility.\n");
+    fprintf(fp, "                               Larger values allow more error.\n");
+    fprintf(fp, "            --format NAME      Override the output DXGI format, for\n");
+    fprintf(fp, "                               example BC3_UNORM.\n");
+    fprintf(fp, "            --metrics          Write the RMSE, PSNR and SSIM4x4 of each\n");
+    fprintf(fp, "                               block-compressed mip-level to a\n");
+    fprintf(fp, "                               .metrics.json file next to the .dds file.\n");
+    fprintf(fp, "                               SSIM4x4 is the mean SSIM of unweighted\n");
+    fprintf(fp, "                               4x4 windows aligned to the BC blocks.\n");
+    fprintf(fp, "\n");
+    fprintf(fp, "--info:     Print the header and subresource layout of each DDS\n");
+    fprintf(fp, "            file, and report any structural problems.\n");
+    fprintf(fp, "--verify:   Check each DDS file for structural problems and print\n");
+    fprintf(fp, "            the min/max/mean of each channel of every subresource.\n");
+    fprintf(fp, "            Exits with a failure status if any file is invalid.\n");
+    fprintf(fp, "--extract:  Write every slice of every subresource of each DDS file\n");
+    fprintf(fp, "            to directory dir, which is created if needed, as\n");
+    fprintf(fp, "            name_iITEM_mLEVEL[_zSLICE].png. Block-compressed data is\n");
+    fprintf(fp, "            decoded. Float data, or all data if --raw is given, is\n");
+    fprintf(fp, "            copied as stored to .raw files instead. --tga writes RLE\n");
+    fprintf(fp, "            .tga files instead of PNG, and --store writes PNG rows\n");
+    fprintf(fp, "            uncompressed, which is faster but much larger.\n");
+    fprintf(fp, "            All three modes accept --threads N.\n");
+    fprintf(fp, "\n");
 }
 
-/// @summary Uses stb_image to load an image file from disk.
-/// @param fp The stream to which any errors or warnings will be written.
-/// @param infile The path of the input image file.
-/// @param image On return, stores information about the loaded image.
-/// @return true if the image was loaded, or false if an error occurred.
-static bool load_image(FILE *fp, char const *infile, image_info_t &image)
+/// @summary Initializes a mutex.
+/// @param mutex The mutex to initialize.
+static void mutex_init(mutex_t *mutex)
 {
-    image.Pixels   = NULL;
-    image.Width    = 0;
-    image.Height   = 0;
-    image.Channels = 0;
-    image.Format   = data::DXGI_FORMAT_UNKNOWN;
-    image.HDR      = false;
+#if defined(_WIN32) || defined(_WIN64)
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+/// @summary Releases the resources associated with a mutex.
+/// @param mutex The mutex to delete. The mutex must not be held.
+static void mutex_delete(mutex_t *mutex)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+/// @summary Acquires a mutex, blocking until it becomes available.
+/// @param mutex The mutex to acquire.
+static inline void mutex_lock(mutex_t *mutex)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+/// @summary Releases a mutex acquired with mutex_lock().
+/// @param mutex The mutex to release.
+static inline void mutex_unlock(mutex_t *mutex)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+/// @summary Initializes a condition variable.
+/// @param cond The condition variable to initialize.
+static void cond_init(cond_t *cond)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+/// @summary Releases the resources associated with a condition variable.
+/// @param cond The condition variable to delete. No thread may be waiting on it.
+static void cond_delete(cond_t *cond)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void) cond; // Windows condition variables need no cleanup.
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+/// @summary Atomically releases a mutex and waits for a condition variable to
+/// be signalled, then re-acquires the mutex. Callers must re-check the
+/// condition they are waiting for, since wakeups may be spurious.
+/// @param cond The condition variable to wait on.
+/// @param mutex The mutex protecting the condition, held by the caller.
+static inline void cond_wait(cond_t *cond, mutex_t *mutex)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+/// @summary Wakes every thread waiting on a condition variable.
+/// @param cond The condition variable to signal.
+static inline void cond_broadcast(cond_t *cond)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+/// @summary Atomically increments a counter shared between threads.
+/// @param counter The counter to increment.
+/// @return The value of the counter before it was incremented.
+static inline long atomic_fetch_inc(long volatile *counter)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return long(InterlockedIncrement((LONG volatile*) counter)) - 1;
+#else
+    return __sync_fetch_and_add(counter, 1L);
+#endif
+}
+
+/// @summary Queries the number of logical processors in the host system.
+/// @return The number of logical processors, clamped to [1, MAX_WORKER_THREADS].
+static size_t cpu_count(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t n = size_t(info.dwNumberOfProcessors);
+#else
+    long   c = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t n = c > 0 ? size_t(c) : 1;
+#endif
+    if (n < 1) n = 1;
+    if (n > MAX_WORKER_THREADS) n = MAX_WORKER_THREADS;
+    return n;
+}
 
-    if (stbi_is_hdr(infile))
+/// @summary The entry point of each thread participating in parallel_for().
+/// Work items are claimed one at a time until none remain.
+/// @param argv Pointer to the parallel_for_t describing the work.
+/// @return Zero.
+static THREAD_FUNC parallel_for_worker(void *argv)
+{
+    parallel_for_t *job = (parallel_for_t*) argv;
+    long            idx = 0;
+    while ((idx = atomic_fetch_inc(&job->Next)) < job->Count)
     {
-        int    w  = 0;
-        int    h  = 0;
-        int    n  = 0;
-        float *px = stbi_loadf(infile, &w, &h, &n, 0);
-        if (px != NULL)
+        job->Work(size_t(idx), job->Context);
+    }
+    return 0;
+}
+
+/// @summary The entry point of each thread in the worker pool. Workers sleep
+/// until a job with a free slot is posted, help execute it, and go back to
+/// sleep, until the pool shuts down.
+/// @param argv Pointer to the worker_pool_t.
+/// @return Zero.
+static THREAD_FUNC worker_pool_thread(void *argv)
+{
+    worker_pool_t *pool = (worker_pool_t*) argv;
+    size_t         seen = 0;
+    mutex_lock(&pool->Lock);
+    for ( ; ; )
+    {
+        while (!pool->Shutdown && (pool->Job == NULL || pool->Generation == seen || pool->Slots == 0))
         {
-            switch (n)
-            {
-                case 1:
-                    image.Format = data::DXGI_FORMAT_R32_FLOAT;
-                    break;
-                case 2:
-                    image.Format = data::DXGI_FORMAT_R32G32_FLOAT;
-                    break;
-                case 3:
-                    image.Format = data::DXGI_FORMAT_R32G32B32_FLOAT;
-                    break;
-                case 4:
+            cond_wait(&pool->WorkReady, &pool->Lock);
+        }
+        if (pool->Shutdown)
+            break;
+
+        parallel_for_t *job = pool->Job;
+        seen = pool->Generation;
+        pool->Slots--;
+        pool->Active++;
+        mutex_unlock(&pool->Lock);
+        parallel_for_worker(job);
+        mutex_lock(&pool->Lock);
+        if (--pool->Active == 0) cond_broadcast(&pool->WorkDone);
+    }
+    mutex_unlock(&pool->Lock);
+    return 0;
+}
+
+/// @summary Initializes the worker pool used by parallel_for(). No threads
+/// are started until a call to parallel_for() needs them; each thread then
+/// persists until stop_worker_pool() is called.
+static void start_worker_pool(void)
+{
+    worker_pool_t *pool = &Worker_Pool;
+    mutex_init(&pool->Lock);
+    cond_init(&pool->WorkReady);
+    cond_init(&pool->WorkDone);
+    pool->Job         = NULL;
+    pool->Generation  = 0;
+    pool->Slots       = 0;
+    pool->Active      = 0;
+    pool->ThreadCount = 0;
+    pool->Shutdown    = false;
+}
+
+/// @summary Stops and joins the threads of the worker pool and releases its
+/// resources. Registered with atexit() by main().
+static void stop_worker_pool(void)
+{
+    worker_pool_t *pool = &Worker_Pool;
+    mutex_lock(&pool->Lock);
+    pool->Shutdown = true;
+    cond_broadcast(&pool->WorkReady);
+    mutex_unlock(&pool->Lock);
+    for (size_t i = 0; i < pool->ThreadCount; ++i)
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        WaitForSingleObject(pool->Threads[i], INFINITE);
+        CloseHandle(pool->Threads[i]);
+#else
+        pthread_join(pool->Threads[i], NULL);
+#endif
+    }
+    pool->ThreadCount = 0;
+    cond_delete(&pool->WorkDone);
+    cond_delete(&pool->WorkReady);
+    mutex_delete(&pool->Lock);
+}
+
+/// @summary Executes a set of independent work items on up to thread_count 
+/// threads, including the calling thread, and waits for all of them to finish.
+/// The other threads come from the worker pool, which is grown as needed.
+/// Calls made from within a work item, or while another call is running, are
+/// executed inline on the calling thread.
+/// @param thread_count The maximum number of threads to use.
+/// @param count The number of work items.
+/// @param work The function to invoke for each work item.
+/// @param context Opaque data passed through to each invocation of work.
+static void parallel_for(size_t thread_count, size_t count, work_item_fn work, void *context)
+{
+    worker_pool_t *pool     = &Worker_Pool;
+    size_t         nthreads = thread_count < count ? thread_count : count;
+    if (nthreads > MAX_WORKER_THREADS) nthreads = MAX_WORKER_THREADS;
+    if (nthreads > 1)
+    {
+        mutex_lock(&pool->Lock);
+        if (pool->Job != NULL)
+        {   // nested calls run inline; the pool is busy with the outer call.
+            nthreads = 1;
+        }
+        while (pool->ThreadCount < nthreads - 1)
+        {   // if a thread cannot be started, the others pick up its share.
+            thread_id_t &thread = pool->Threads[pool->ThreadCount];
+#if defined(_WIN32) || defined(_WIN64)
+            if ((thread = CreateThread(NULL, 0, worker_pool_thread, pool, 0, NULL)) == NULL) break;
+#else
+            if (pthread_create(&thread, NULL, worker_pool_thread, pool) != 0) break;
+#endif
+            pool->ThreadCount++;
+        }
+        if (pool->ThreadCount == 0) nthreads = 1;
+        if (nthreads <= 1) mutex_unlock(&pool->Lock);
+    }
+    if (nthreads <= 1)
+    {   // not worth involving any other threads.
+        for (size_t i = 0; i < count; ++i)
+            work(i, context);
+        return;
+    }
+
+    parallel_for_t job;
+    job.Work    = work;
+    job.Context = context;
+    job.Count   = long(count);
+    job.Next    = 0;
+
+    // post the job, still holding the lock, and help execute it.
+    pool->Job    = &job;
+    pool->Slots  = nthreads - 1;
+    pool->Active = 0;
+    pool->Generation++;
+    cond_broadcast(&pool->WorkReady);
+    mutex_unlock(&pool->Lock);
+    parallel_for_worker(&job);
+
+    // every item has been claimed; wait for the workers still executing one.
+    mutex_lock(&pool->Lock);
+    pool->Slots = 0;
+    while (pool->Active > 0)
+    {
+        cond_wait(&pool->WorkDone, &pool->Lock);
+    }
+    pool->Job = NULL;
+    mutex_unlock(&pool->Lock);
+}
+
+/// @summary Calculates the size of the blocks in a given scratch pool size class.
+/// @param size_class The zero-based index of the size class.
+/// @return The number of usable bytes in a block of the given size class.
+static inline size_t scratch_class_size(size_t size_class)
+{
+    size_t base = SCRATCH_MIN_SIZE << (size_class / 4);
+    return base + (base / 4) * (size_class % 4);
+}
+
+/// @summary Initializes a scratch pool with empty free lists.
+/// @param pool The scratch pool to initialize.
+static void init_scratch_pool(scratch_pool_t *pool)
+{
+    mutex_init(&pool->Lock);
+    for (size_t i = 0; i < SCRATCH_CLASS_COUNT; ++i)
+    {
+        pool->FreeList[i] = NULL;
+    }
+}
+
+/// @summary Returns all memory held on the free lists of a scratch pool to the
+/// system. Any blocks still in use remain valid, but must not be released to
+/// the pool after it has been deleted.
+/// @param pool The scratch pool to drain.
+static void delete_scratch_pool(scratch_pool_t *pool)
+{
+    for (size_t i = 0; i < SCRATCH_CLASS_COUNT; ++i)
+    {
+        scratch_block_t *iter = pool->FreeList[i];
+        while (iter != NULL)
+        {
+            scratch_block_t *next = iter->Next;
+            free(iter);
+            iter = next;
+        }
+        pool->FreeList[i] = NULL;
+    }
+    mutex_delete(&pool->Lock);
+}
+
+/// @summary Finds the smallest scratch pool size class that holds a request.
+/// @param size The number of bytes requested.
+/// @return The zero-based index of the size class, or SCRATCH_CLASS_COUNT if
+/// the request is larger than the largest class.
+static inline size_t scratch_class(size_t size)
+{
+    size_t cls = 0;
+    while (cls < SCRATCH_CLASS_COUNT && scratch_class_size(cls) < size)
+        ++cls;
+    return cls;
+}
+
+/// @summary Calculates the number of bytes a scratch pool keeps for a request,
+/// including the rounding up to its size class.
+/// @param size The number of bytes requested.
+/// @return The size of the block that satisfies the request, or zero.
+static inline size_t scratch_block_size(size_t size)
+{
+    size_t cls = scratch_class(size);
+    return size > 0 && cls < SCRATCH_CLASS_COUNT ? scratch_class_size(cls) : 0;
+}
+
+/// @summary Allocates a scratch buffer, reusing a released block of the same
+/// size class if one is available.
+/// @param pool The scratch pool to allocate from. If NULL, the block is
+/// allocated directly with malloc and must be freed with a NULL pool.
+/// @param size The minimum number of bytes to allocate.
+/// @return A pointer to the buffer, or NULL.
+static void* scratch_alloc(scratch_pool_t *pool, size_t size)
+{
+    size_t cls = scratch_class(size);
+    if (cls == SCRATCH_CLASS_COUNT)
+        return NULL;
+
+    scratch_block_t *block = NULL;
+    if (pool != NULL)
+    {   // reuse a previously released block; no system allocation.
+        mutex_lock(&pool->Lock);
+        if ((block = pool->FreeList[cls]) != NULL)
+            pool->FreeList[cls] = block->Next;
+        mutex_unlock(&pool->Lock);
+    }
+    if (block == NULL)
+    {   // the free list for this class is empty; grow the pool.
+        block = (scratch_block_t*) malloc(sizeof(scratch_block_t) + scratch_class_size(cls));
+        if (block == NULL)
+            return NULL;
+    }
+    block->Next  = NULL;
+    block->Class = cls;
+    return (void*) (block + 1);
+}
+
+/// @summary Releases a buffer returned by scratch_alloc back to its pool.
+/// @param pool The scratch pool the buffer was allocated from, or NULL.
+/// @param buffer The buffer to release. May be NULL.
+static void scratch_free(scratch_pool_t *pool, void *buffer)
+{
+    if (buffer == NULL)
+        return;
+
+    scratch_block_t *block = ((scratch_block_t*) buffer) - 1;
+    if (pool != NULL)
+    {   // keep the block around for the next request of this size class.
+        mutex_lock(&pool->Lock);
+        block->Next = pool->FreeList[block->Class];
+        pool->FreeList[block->Class] = block;
+        mutex_unlock(&pool->Lock);
+    }
+    else free(block);
+}
+
+/// @summary Determines whether a format stores 8-bit channels in B, G, R, A
+/// byte order.
+/// @param format One of data::dxgi_format_e.
+/// @return true if the red and blue channels are swapped relative to RGBA8.
+static bool bgra_format(uint32_t format)
+{
+    switch (format)
+    {
+        case data::DXGI_FORMAT_B8G8R8A8_TYPELESS:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_B8G8R8X8_TYPELESS:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return true;
+        default:
+            break;
+    }
+    return false;
+}
+
+/// @summary Retrieves the name of a DXGI format.
+/// @param format One of data::dxgi_format_e.
+/// @return The name of the format, without the DXGI_FORMAT_ prefix.
+static char const* format_name(uint32_t format)
+{
+    size_t const nvals = sizeof(DXGI_FORMAT_VALUES) / sizeof(DXGI_FORMAT_VALUES[0]);
+    for (size_t i = 0;  i < nvals; ++i)
+    {
+        if (DXGI_FORMAT_VALUES[i] == format)
+            return DXGI_FORMAT_STRINGS[i];
+    }
+    return "UNKNOWN";
+}
+
+/// @summary Uses the lldatain decoder to decode an 8-bit grayscale, true-color
+/// or palettized TGA file held in memory. Color pixels are converted directly
+/// to the byte order of the output format. Files using other features are
+/// left to stb_image, so no errors are reported.
+/// @param file The contents of the TGA file.
+/// @param nb The size of the file, in bytes.
+/// @param format The output DXGI format, or DXGI_FORMAT_UNKNOWN.
+/// @param image On return, stores information about the decoded image.
+/// @return true if the image was decoded.
+static bool decode_tga(void const *file, size_t nb, uint32_t format, image_info_t &image)
+{
+    data::tga_desc_t desc;
+    if (file == NULL || !data::tga_describe(file, nb, &desc) || desc.ImageWidth == 0 || desc.ImageHeight == 0)
+        return false;
+
+    bool     gray  = desc.ImageType == data::TGA_IMAGETYPE_UNCOMPRESSED_GRAY || desc.ImageType == data::TGA_IMAGETYPE_RLE_GRAY;
+    bool     bgra  = bgra_format(format);
+    size_t   nch   = gray ? 1 : 4;
+    size_t   pitch = desc.ImageWidth * nch;
+    uint8_t *px    = (uint8_t*) malloc(pitch * desc.ImageHeight);
+    bool     res   = false;
+    if (px != NULL && gray && desc.BitsPerPixel == 8 && data::tga_decode_r8(px, pitch * desc.ImageHeight, &desc))
+    {   // tga_decode_r8() writes rows in file order; flip them top-down.
+        for (size_t y = 0; desc.OriginBottom && y < desc.ImageHeight / 2; ++y)
+        {
+            uint8_t *a = px + y * pitch;
+            uint8_t *b = px + (desc.ImageHeight - 1 - y) * pitch;
+            for (size_t x = 0; x < pitch; ++x)
+            {
+                uint8_t t = a[x]; a[x] = b[x]; b[x] = t;
+            }
+        }
+        res = true;
+    }
+    else if (px != NULL && !gray)
+    {
+        res = data::tga_decode_rgba32(px, pitch * desc.ImageHeight, &desc, bgra ? data::TGA_PIXEL_ORDER_BGRA : data::TGA_PIXEL_ORDER_RGBA);
+    }
+    if (!res)
+    {
+        free(px);
+        return false;
+    }
+    image.Pool     = NULL;
+    image.Pixels   = px;
+    image.Width    = int(desc.ImageWidth);
+    image.Height   = int(desc.ImageHeight);
+    image.Channels = int(nch);
+    image.Format   = gray ? data::DXGI_FORMAT_R8_UNORM : (bgra ? data::DXGI_FORMAT_B8G8R8A8_UNORM : data::DXGI_FORMAT_R8G8B8A8_UNORM);
+    image.HDR      = false;
+    return true;
+}
+
+/// @summary Uses the lldatain decoder to load a TGA file from disk.
+/// @param infile The path of the input image file.
+/// @param format The output DXGI format, or DXGI_FORMAT_UNKNOWN.
+/// @param image On return, stores information about the loaded image.
+/// @return true if the image was loaded, or false if the file is not a TGA
+/// file that decode_tga() supports.
+static bool load_tga(char const *infile, uint32_t format, image_info_t &image)
+{
+    char const *ext = strrchr(infile, '.');
+    if (ext == NULL || 0 != stricmp_fn(ext, ".tga"))
+        return false;
+
+    size_t nb   = 0;
+    void  *file = data::load_binary(infile, &nb);
+    bool   res  = decode_tga(file, nb, format, image);
+    free(file);
+    return res;
+}
+
+/// @summary Uses stb_image to load an image file from disk or memory. TGA
+/// files on disk are loaded with load_tga() where possible.
+/// @param fp The stream to which any errors or warnings will be written.
+/// @param infile The path of the input image file, or the name used to report
+/// errors for an image held in memory.
+/// @param file The contents of the image file, or NULL to load infile.
+/// @param nb The size of the image file held in memory, in bytes.
+/// @param format The output DXGI format, or DXGI_FORMAT_UNKNOWN. This only
+/// selects the byte order of images decoded by load_tga(), so it must be
+/// DXGI_FORMAT_UNKNOWN when the image is combined with other sources.
+/// @param image On return, stores information about the loaded image.
+/// @return true if the image was loaded, or false if an error occurred.
+static bool load_image(FILE *fp, char const *infile, void const *file, size_t nb, uint32_t format, image_info_t &image)
+{
+    image.Pool     = NULL;
+    image.Pixels   = NULL;
+    image.Width    = 0;
+    image.Height   = 0;
+    image.Channels = 0;
+    image.Format   = data::DXGI_FORMAT_UNKNOWN;
+    image.HDR      = false;
+
+    stbi_uc const *mem  = (stbi_uc const*) file;
+    int     const  size = int(nb);
+    if (file == NULL && load_tga(infile, format, image))
+    {   // no channel-order pass is needed for the output format.
+        return true;
+    }
+    if (file != NULL ? stbi_is_hdr_from_memory(mem, size) : stbi_is_hdr(infile))
+    {
+        int    w  = 0;
+        int    h  = 0;
+        int    n  = 0;
+        float *px = file != NULL ? stbi_loadf_from_memory(mem, size, &w, &h, &n, 0) : stbi_loadf(infile, &w, &h, &n, 0);
+        if (px != NULL)
+        {
+            switch (n)
+            {
+                case 1:
+                    image.Format = data::DXGI_FORMAT_R32_FLOAT;
+                    break;
+                case 2:
+                    image.Format = data::DXGI_FORMAT_R32G32_FLOAT;
+                    break;
+                case 3:
+                    image.Format = data::DXGI_FORMAT_R32G32B32_FLOAT;
+                    break;
+                case 4:
                     image.Format = data::DXGI_FORMAT_R32G32B32A32_FLOAT;
                     break;
                 default:
@@ -425,12 +1741,12 @@ static bool load_image(FILE *fp, char const *infile, image_info_t &image)
         int       w  = 0;
         int       h  = 0;
         int       n  = 0;
-        uint8_t  *px = stbi_load(infile, &w, &h, &n, 0);
+        uint8_t  *px = file != NULL ? stbi_load_from_memory(mem, size, &w, &h, &n, 0) : stbi_load(infile, &w, &h, &n, 0);
         if (n  == 3)
         {
             fprintf(fp, "WARNING: Re-loading 24-bpp file \'%s\' as 32-bpp. Export 32-bpp for best performance.\n", infile);
             stbi_image_free(px);
-            px = stbi_load(infile, &w, &h, &n, 4);
+            px = file != NULL ? stbi_load_from_memory(mem, size, &w, &h, &n, 4) : stbi_load(infile, &w, &h, &n, 4);
             n  = 4; // force the path in the switch below.
         }
         if (px != NULL)
@@ -465,22 +1781,201 @@ static bool load_image(FILE *fp, char const *infile, image_info_t &image)
     }
 }
 
+/// @summary Loads a source image, which is either a file on disk or an image
+/// file embedded in the manifest as base64 text. Embedded text may be given
+/// as a data URI, whose media type selects the lldatain decoder for TGA data.
+/// @param fp The stream to which any errors or warnings will be written.
+/// @param params Image processing parameters.
+/// @param index The zero-based index of the source image to load.
+/// @param format The output DXGI format, or DXGI_FORMAT_UNKNOWN. See load_image().
+/// @param image On return, stores information about the loaded image.
+/// @return true if the image was loaded, or false if an error occurred.
+static bool load_source_image(FILE *fp, dds_params_t const &params, size_t index, uint32_t format, image_info_t &image)
+{
+    char const *text = params.SourceData[index];
+    if (text == NULL)
+    {   // the source image is a file on disk.
+        return load_image(fp, params.SourceFiles[index], NULL, 0, format, image);
+    }
+
+    bool tga = false;
+    if (0 == strncmp(text, "data:", 5))
+    {   // skip the media type of a data URI: data:image/x-tga;base64,...
+        // media types and the base64 token are case-insensitive.
+        char const *comma = strchr(text, ',');
+        if (comma == NULL || comma - text < 12 || 0 != strnicmp_fn(comma - 7, ";base64", 7))
+        {
+            fprintf(fp, "ERROR: %s is not a base64 data URI.\n", params.SourceFiles[index]);
+            return false;
+        }
+        tga  = 0 == strnicmp_fn(text + 5, "image/x-tga;", 12) || 0 == strnicmp_fn(text + 5, "image/tga;", 10) || 0 == strnicmp_fn(text + 5, "image/x-targa;", 14);
+        text = comma + 1;
+    }
+
+    size_t   len  = strlen(text);
+    size_t   cap  = data::binary_size(len, 0) + 3;
+    uint8_t *file = (uint8_t*) malloc(cap);
+    if (file == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate %u bytes to decode %s.\n", unsigned(cap), params.SourceFiles[index]);
+        return false;
+    }
+    size_t nb  = data::base64_decode(file, cap, text, len);
+    bool   res = nb > 0 && ((tga && decode_tga(file, nb, format, image)) || load_image(fp, params.SourceFiles[index], file, nb, format, image));
+    if (nb == 0 && len > 0) fprintf(fp, "ERROR: %s is not valid base64.\n", params.SourceFiles[index]);
+    else if (nb == 0) fprintf(fp, "ERROR: %s is empty.\n", params.SourceFiles[index]);
+    free(file);
+    return res;
+}
+
+/// @summary Renormalizes a single unsigned 8-bit encoded normal vector. Vectors
+/// too short to normalize are replaced with +Z.
+/// @param p Pointer to the x, y and z components of the texel.
+static inline void renormalize_texel(uint8_t *p)
+{
+    float x = float(p[0]) * (2.0f / 255.0f) - 1.0f;
+    float y = float(p[1]) * (2.0f / 255.0f) - 1.0f;
+    float z = float(p[2]) * (2.0f / 255.0f) - 1.0f;
+    float l = x * x + y * y + z * z;
+    if (l < NORMAL_MIN_LENGTH_SQ) { x = 0.0f; y = 0.0f; z = 1.0f; }
+    else { l = 1.0f / sqrtf(l); x *= l; y *= l; z *= l; }
+    p[0] = uint8_t((x * 0.5f + 0.5f) * 255.0f + 0.5f);
+    p[1] = uint8_t((y * 0.5f + 0.5f) * 255.0f + 0.5f);
+    p[2] = uint8_t((z * 0.5f + 0.5f) * 255.0f + 0.5f);
+}
+
+/// @summary Renormalizes every texel of a normal map after filtering. LDR
+/// texels are decoded from [0, 255] to signed vectors and re-encoded; HDR
+/// texels are assumed to hold signed vectors already. Images with fewer than
+/// three channels are left unchanged.
+/// @param image The normal map to renormalize.
+static void renormalize_normals(image_info_t &image)
+{
+    size_t const nch = size_t(image.Channels);
+    size_t const n   = size_t(image.Width) * size_t(image.Height);
+    size_t       i   = 0;
+    if (nch < 3) return;
+
+    if (image.HDR)
+    {
+        float *p = (float*) image.Pixels;
+        for (i = 0; i < n; ++i, p += nch)
+        {
+            float l = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+            if (l < NORMAL_MIN_LENGTH_SQ) { p[0] = 0.0f; p[1] = 0.0f; p[2] = 1.0f; }
+            else { l = 1.0f / sqrtf(l); p[0] *= l; p[1] *= l; p[2] *= l; }
+        }
+        return;
+    }
+
+    uint8_t *p = (uint8_t*) image.Pixels;
+#if MAKEDDS_SSE2
+    // process four texels at a time, with the components in separate vectors.
+    __m128 const scale  = _mm_set1_ps(2.0f / 255.0f);
+    __m128 const one    = _mm_set1_ps(1.0f);
+    __m128 const half   = _mm_set1_ps(0.5f);
+    __m128 const range  = _mm_set1_ps(255.0f);
+    __m128 const minlen = _mm_set1_ps(NORMAL_MIN_LENGTH_SQ);
+    for (; i + 4 <= n; i += 4, p += 4 * nch)
+    {
+        uint8_t *t0 = p, *t1 = p + nch, *t2 = p + 2 * nch, *t3 = p + 3 * nch;
+        __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_setr_ps(t0[0], t1[0], t2[0], t3[0]), scale), one);
+        __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_setr_ps(t0[1], t1[1], t2[1], t3[1]), scale), one);
+        __m128 z = _mm_sub_ps(_mm_mul_ps(_mm_setr_ps(t0[2], t1[2], t2[2], t3[2]), scale), one);
+        __m128 l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        __m128 m = _mm_cmplt_ps(l, minlen);
+        __m128 r = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(l, minlen)));
+        // degenerate vectors become +Z.
+        x = _mm_andnot_ps(m, _mm_mul_ps(x, r));
+        y = _mm_andnot_ps(m, _mm_mul_ps(y, r));
+        z = _mm_or_ps(_mm_andnot_ps(m, _mm_mul_ps(z, r)), _mm_and_ps(m, one));
+        // re-encode to [0, 255] with rounding.
+        __m128i xi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, half), half), range), half));
+        __m128i yi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(y, half), half), range), half));
+        __m128i zi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, half), half), range), half));
+        int32_t xs[4], ys[4], zs[4];
+        _mm_storeu_si128((__m128i*) xs, xi);
+        _mm_storeu_si128((__m128i*) ys, yi);
+        _mm_storeu_si128((__m128i*) zs, zi);
+        uint8_t *t[4] = { t0, t1, t2, t3 };
+        for (size_t j = 0; j < 4; ++j)
+        {
+            t[j][0] = uint8_t(xs[j]);
+            t[j][1] = uint8_t(ys[j]);
+            t[j][2] = uint8_t(zs[j]);
+        }
+    }
+#endif
+    for (; i < n; ++i, p += nch)
+    {
+        renormalize_texel(p);
+    }
+}
+
+/// @summary Determines the stb_image_resize filter kernel selected by the 
+/// Filter parameter. FILTER_DEFAULT selects the stb_image_resize defaults.
+/// @param params Image processing parameters.
+/// @return The filter to pass to stb_image_resize.
+static stbir_filter resize_filter(dds_params_t const &params)
+{
+    switch (params.Filter)
+    {
+        case FILTER_BOX       : return STBIR_FILTER_BOX;
+        case FILTER_TRIANGLE  : return STBIR_FILTER_TRIANGLE;
+        case FILTER_CUBIC     : return STBIR_FILTER_CUBICBSPLINE;
+        case FILTER_CATMULLROM: return STBIR_FILTER_CATMULLROM;
+        case FILTER_MITCHELL  : return STBIR_FILTER_MITCHELL;
+        default               : return STBIR_FILTER_DEFAULT;
+    }
+}
+
+/// @summary Determines whether the color channels of an image are converted
+/// from sRGB to linear light before filtering. HDR images are always linear,
+/// and normal maps are linear unless sRGB is explicitly requested.
+/// @param params Image processing parameters.
+/// @param image Describes the image being filtered.
+/// @return true if the image should be filtered in the sRGB colorspace.
+static bool filter_srgb(dds_params_t const &params, image_info_t const &image)
+{
+    if (image.HDR) return false;
+    if (params.ColorSpace == COLORSPACE_AUTO) return !params.NormalMap;
+    return params.ColorSpace == COLORSPACE_SRGB;
+}
+
+/// @summary Determines the channel stb_image_resize should treat as alpha,
+/// weighting the color channels by it during filtering.
+/// @param params Image processing parameters.
+/// @param image Describes the image being filtered.
+/// @return The alpha channel index, or STBIR_ALPHA_CHANNEL_NONE.
+static int resize_alpha_channel(dds_params_t const &params, image_info_t const &image)
+{
+    if (image.HDR || params.NormalMap || image.Channels != 4)
+        return STBIR_ALPHA_CHANNEL_NONE;
+    return 3;
+}
+
 /// @summary Resizes an image into a new buffer. The format and number of 
-/// channels remain the same as the input image buffer.
+/// channels remain the same as the input image buffer. The filter, edge mode
+/// and colorspace are taken from the image processing parameters. Normal maps
+/// are renormalized after filtering.
 /// @param fp The output stream to which errors and warnings will be written.
+/// @param pool The scratch pool from which the output buffer and any temporary
+/// memory used by stb_image_resize are allocated.
+/// @param params Image processing parameters.
 /// @param output On return, describes the output image.
 /// @param input Describes the input image.
 /// @param new_width The number of columns in the scaled image.
 /// @param new_height The number of rows in the scaled image.
 /// @return true if the output image was generated.
-static bool resize_image(FILE *fp, image_info_t &output, image_info_t const &input, size_t new_width, size_t new_height)
+static bool resize_image(FILE *fp, scratch_pool_t *pool, dds_params_t const &params, image_info_t &output, image_info_t const &input, size_t new_width, size_t new_height)
 {
     size_t bpc    = input.HDR ? sizeof(float) : sizeof(uint8_t);
     size_t nbytes = new_width * new_height * size_t(input.Channels) * bpc;
-    void  *pixels = malloc(nbytes);
+    void  *pixels = scratch_alloc(pool, nbytes);
     if (pixels == NULL)
     {
         fprintf(fp, "ERROR: Unable to allocate %u bytes for resized image.\n", unsigned(nbytes));
+        output.Pool     = NULL;
         output.Pixels   = NULL;
         output.Width    = 0;
         output.Height   = 0;
@@ -490,40 +1985,53 @@ static bool resize_image(FILE *fp, image_info_t &output, image_info_t const &inp
         return false;
     }
 
+    output.Pool     = pool;
     output.Pixels   = pixels;
     output.Width    = int(new_width);
     output.Height   = int(new_height);
     output.Channels = input.Channels;
     output.Format   = input.Format;
     output.HDR      = input.HDR;
+
+    // the unsigned encoding of a normal map is an affine map of the signed
+    // vectors, so filtering it linearly is the same as filtering the vectors.
+    // wrapping edges make the mip levels of a tiling texture tile seamlessly.
+    stbir_edge       edge   = stbir_edge(params.EdgeMode);
+    stbir_filter     filter = resize_filter(params);
+    stbir_colorspace space  = filter_srgb(params, input) ? STBIR_COLORSPACE_SRGB : STBIR_COLORSPACE_LINEAR;
+    int              alpha  = resize_alpha_channel(params, input);
     if (input.HDR)
-    {   // use the default upsample/downsample filters.
-        // edge mode is clamp-to-edge.
-        // colorspace is linear.
-        stbir_resize_float(
+    {
+        stbir_resize_float_generic(
             (float const*)  input.Pixels,  input.Width,  input.Height, 0, 
-            (float      *) output.Pixels, output.Width, output.Height, 0, output.Channels);
+            (float      *) output.Pixels, output.Width, output.Height, 0, output.Channels, 
+            alpha, 0, edge, filter, space, pool);
     }
     else
-    {   // use the default upsample/downsample filters.
-        // edge mode is clamp-to-edge.
-        // colorspace is sRGB.
-        stbir_resize_uint8_srgb(
+    {
+        stbir_resize_uint8_generic(
             (uint8_t const*)  input.Pixels,  input.Width,  input.Height, 0,
             (uint8_t      *) output.Pixels, output.Width, output.Height, 0, output.Channels, 
-            output.Channels == 4 ? 3 : STBIR_ALPHA_CHANNEL_NONE, 0);
+            alpha, 0, edge, filter, space, pool);
+    }
+    if (params.NormalMap)
+    {   // filtering shortens the vectors.
+        renormalize_normals(output);
     }
     return true;
 }
 
-/// @summary Frees an image loaded by stb_image.
+/// @summary Frees an image loaded by stb_image, or returns an image buffer
+/// allocated by resize_image() to the scratch pool that owns it.
 /// @param image The image state to free and re-initialize.
 static void free_image(image_info_t &image)
 {
     if (image.Pixels != NULL)
     {
-        stbi_image_free(image.Pixels);
+        if (image.Pool != NULL) scratch_free(image.Pool, image.Pixels);
+        else stbi_image_free(image.Pixels);
         image.Pixels  = NULL;
+        image.Pool    = NULL;
     }
     image.Width    = 0;
     image.Height   = 0;
@@ -612,73 +2120,351 @@ static void init_params(dds_params_t &params, char *buffer)
     params.Cubemap       = false;
     params.Volume        = false;
     params.ForcePow2     = false;
+    params.MemoryLimit   = 0;
+    params.ThreadCount   = cpu_count();
+    params.Projection    = PROJECTION_NONE;
+    params.Filter        = FILTER_DEFAULT;
+    params.Prefilter     = PREFILTER_NONE;
+    params.IrradianceSH  = NULL;
+    params.IrradianceCube= NULL;
+    params.IrradianceSize= 32;
+    params.AlphaTestReference = 0.0f;
+    params.NormalMap     = false;
+    params.SeamlessCubemap = false;
+    params.ColorSpace    = COLORSPACE_AUTO;
+    params.EdgeMode      = STBIR_EDGE_CLAMP;
+    params.Atlas         = false;
+    params.AtlasPacker   = PACKER_MAXRECTS;
+    params.AtlasPadding  = 2;
+    params.AtlasExtrude  = 1;
+    params.AtlasTable    = NULL;
+    params.Ktx2          = false;
+    params.Ktx2File      = NULL;
+    params.Supercompress = false;
+    params.SupercompressFile = NULL;
+    params.RdoLambda     = 0.0f;
+    params.RdoWindow     = RDO_DEFAULT_WINDOW;
+    params.Metrics       = false;
+    params.MetricsFile   = NULL;
+    params.MetricsJob    = NULL;
+    params.Transcode     = false;
+    params.FormatDefaulted = false;
+    params.KeepMipmaps   = false;
     params.OutputFile    = NULL;
     params.JsonBuffer    = buffer;
     params.SourceCount   = 0;
     params.SourceIndex   = 0;
 }
 
-/// @summary Processes an input node of a JSON document.
-/// @param fp The stream to which errors will be written.
-/// @param node The JSON document node to process.
-/// @param params The DDS output parameters to populate.
-static bool process_json_node(FILE *fp, data::json_item_t *node, dds_params_t &params)
+/// @summary Determines whether a path names a DDS file, based on its extension.
+/// @param path The NULL-terminated path to examine.
+/// @return true if the path has a .dds extension.
+static bool is_dds_path(char const *path)
 {
-    if (node == NULL)
-        return true;
+    size_t      ext_len = 0;
+    char const *ext_str = extpart(path, ext_len);
+    return ext_len > 0 && 0 == stricmp_fn(ext_str, "dds");
+}
 
-    switch (node->ValueType)
+/// @summary Determines whether the subresources of a DDS can be decoded for
+/// transcoding, and the kind of working image they decode to. 8-bit, packed
+/// and 16-bit UNORM data and the UNORM BC formats decode to RGBA8. Float and
+/// SNORM data decode to RGBA32F.
+/// @param format One of data::dxgi_format_e specifying the source format.
+/// @param hdr On return, set to true if the data decodes to RGBA32F.
+/// @return true if the format can be decoded.
+static bool transcode_source_format(uint32_t format, bool &hdr)
+{
+    switch (format)
     {
-        case data::JSON_TYPE_OBJECT:
-            {   // we expect a top-level object, but that's it.
-                data::json_item_t *child = node->FirstChild;
-                while (child != NULL)
-                {   // recursively process the fields that make up the object.
-                    if (!process_json_node(fp, child, params))
-                        return false;
-                    child = child->Next;
-                }
-            }
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM:
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        case data::DXGI_FORMAT_R8G8_UNORM:
+        case data::DXGI_FORMAT_R8_UNORM:
+        case data::DXGI_FORMAT_A8_UNORM:
+        case data::DXGI_FORMAT_R10G10B10A2_UNORM:
+        case data::DXGI_FORMAT_B5G6R5_UNORM:
+        case data::DXGI_FORMAT_B5G5R5A1_UNORM:
+        case data::DXGI_FORMAT_R16G16B16A16_UNORM:
+        case data::DXGI_FORMAT_R16G16_UNORM:
+        case data::DXGI_FORMAT_R16_UNORM:
+        case data::DXGI_FORMAT_BC1_TYPELESS:
+        case data::DXGI_FORMAT_BC1_UNORM:
+        case data::DXGI_FORMAT_BC1_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC2_TYPELESS:
+        case data::DXGI_FORMAT_BC2_UNORM:
+        case data::DXGI_FORMAT_BC2_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC3_TYPELESS:
+        case data::DXGI_FORMAT_BC3_UNORM:
+        case data::DXGI_FORMAT_BC3_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+            hdr = false;
             return true;
 
-        case data::JSON_TYPE_ARRAY:
-            {   // we expect only the SourceFiles element to be an array.
-                if (0 != stricmp_fn(node->Key, "SourceFiles"))
-                {
-                    fprintf(fp, "WARNING: Unexpected array element \'%s\'.", node->Key);
-                    return true;
-                }
-                params.SourceCount         = 0;
-                data::json_item_t *element = node->FirstChild;
-                while (element != NULL)
-                {   // all child elements must be strings.
-                    if (element->ValueType != data::JSON_TYPE_STRING)
-                    {
-                        fprintf(fp, "WARNING: Expect only strings in SourceFiles array; item %u will be ignored.\n", unsigned(params.SourceCount));
-                        element = element->Next;
-                        continue;
-                    }
-                    if (params.SourceCount == MAX_SOURCE_IMAGES)
-                    {
-                        fprintf(fp, "WARNING: A maximum of %u source images are supported.\n", unsigned(MAX_SOURCE_IMAGES));
-                        break;
-                    }
-                    params.SourceFiles[params.SourceCount++] = element->Value.string;
-                    element = element->Next;
-                }
-            }
+        case data::DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case data::DXGI_FORMAT_R32G32B32_FLOAT:
+        case data::DXGI_FORMAT_R32G32_FLOAT:
+        case data::DXGI_FORMAT_R32_FLOAT:
+        case data::DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case data::DXGI_FORMAT_R16G16_FLOAT:
+        case data::DXGI_FORMAT_R16_FLOAT:
+        case data::DXGI_FORMAT_R16G16B16A16_SNORM:
+        case data::DXGI_FORMAT_R8G8B8A8_SNORM:
+        case data::DXGI_FORMAT_R8G8_SNORM:
+        case data::DXGI_FORMAT_R8_SNORM:
+        case data::DXGI_FORMAT_BC4_SNORM:
+        case data::DXGI_FORMAT_BC5_SNORM:
+            hdr = true;
             return true;
 
-        case data::JSON_TYPE_STRING:
-            {   // we expect 'Format' and 'AlphaMode' to be strings.
-                if (0 != stricmp_fn(node->Key, "Format"   ) &&
-                    0 != stricmp_fn(node->Key, "AlphaMode"))
-                {
-                    fprintf(fp, "ERROR: Unexpected string field \'%s\'.\n", node->Key);
-                    return false;
-                }
-
-                if (0 == stricmp_fn(node->Key, "Format"))
+        default:
+            break;
+    }
+    return false;
+}
+
+/// @summary Determines the layout of the float formats that HDR working pixels
+/// can be written to, either as-is or narrowed to fewer or 16-bit channels.
+/// @param format One of data::dxgi_format_e.
+/// @param channels On return, the number of channels stored by the format.
+/// @param bytes On return, the number of bytes per channel, 2 or 4.
+/// @return true if format is one of the R32 or R16 float formats.
+static bool float_format_layout(uint32_t format, size_t &channels, size_t &bytes)
+{
+    switch (format)
+    {
+        case data::DXGI_FORMAT_R32G32B32A32_FLOAT: channels = 4; bytes = 4; return true;
+        case data::DXGI_FORMAT_R32G32B32_FLOAT   : channels = 3; bytes = 4; return true;
+        case data::DXGI_FORMAT_R32G32_FLOAT      : channels = 2; bytes = 4; return true;
+        case data::DXGI_FORMAT_R32_FLOAT         : channels = 1; bytes = 4; return true;
+        case data::DXGI_FORMAT_R16G16B16A16_FLOAT: channels = 4; bytes = 2; return true;
+        case data::DXGI_FORMAT_R16G16_FLOAT      : channels = 2; bytes = 2; return true;
+        case data::DXGI_FORMAT_R16_FLOAT         : channels = 1; bytes = 2; return true;
+        default: break;
+    }
+    channels = 0;
+    bytes    = 0;
+    return false;
+}
+
+/// @summary Determines whether write_pixels() can produce a format from the
+/// working image decoded from a DDS source.
+/// @param format One of data::dxgi_format_e specifying the output format.
+/// @param hdr true if the working image is RGBA32F, or false if it is RGBA8.
+/// @return true if the format can be written.
+static bool transcode_target_format(uint32_t format, bool hdr)
+{
+    if (hdr)
+    {   // float data is written as-is, or narrowed by write_pixels().
+        size_t nch, bpc;
+        return float_format_layout(format, nch, bpc);
+    }
+    switch (format)
+    {
+        case data::DXGI_FORMAT_R8G8B8A8_TYPELESS:
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM:
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_B8G8R8A8_TYPELESS:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_R8G8_TYPELESS:
+        case data::DXGI_FORMAT_R8G8_UNORM:
+        case data::DXGI_FORMAT_R8G8_UINT:
+        case data::DXGI_FORMAT_R8G8_SNORM:
+        case data::DXGI_FORMAT_R8G8_SINT:
+        case data::DXGI_FORMAT_BC1_TYPELESS:
+        case data::DXGI_FORMAT_BC1_UNORM:
+        case data::DXGI_FORMAT_BC1_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC3_TYPELESS:
+        case data::DXGI_FORMAT_BC3_UNORM:
+        case data::DXGI_FORMAT_BC3_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+            return true;
+
+        default:
+            break;
+    }
+    return false;
+}
+
+/// @summary Fills out the image processing parameters for re-encoding an
+/// existing DDS file. The layout (dimensions, array size, cubemap and volume
+/// flags) is taken from the file. Format and AlphaMode default to those of
+/// the file. The existing mip-levels are re-encoded unless Mipmaps was set,
+/// in which case the levels are regenerated from the first level.
+/// @param fp The stream to which error output will be written.
+/// @param path The path of the DDS file.
+/// @param params The image processing parameters to update.
+/// @param image On return, Pixels is NULL; subresources are decoded as written.
+/// @return true if the file is a DDS that can be transcoded.
+static bool params_from_dds(FILE *fp, char const *path, dds_params_t &params, image_info_t &image)
+{
+    image.Pool     = NULL;
+    image.Pixels   = NULL;
+    image.Width    = 0;
+    image.Height   = 0;
+    image.Channels = 0;
+    image.Format   = data::DXGI_FORMAT_UNKNOWN;
+    image.HDR      = false;
+
+    data::dds_file_t *file = data::dds_open(path);
+    if (file == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to load DDS input '%s'.\n", path);
+        return false;
+    }
+
+    bool     hdr    = false;
+    bool     cube   = (file->Header.Caps2 & data::DDSCAPS2_CUBEMAP) != 0;
+    bool     volume = data::dds_volume(&file->Header, file->HasHeaderEx ? &file->HeaderEx : NULL);
+    uint32_t format = file->Format;
+    size_t   width  = file->Header.Width  > 0 ? size_t(file->Header.Width ) : 1;
+    size_t   height = file->Header.Height > 0 ? size_t(file->Header.Height) : 1;
+    size_t   depth  = file->Levels[0].Slices;
+    size_t   items  = file->ItemCount;
+    size_t   levels = file->LevelCount;
+    uint32_t alpha  = file->HasHeaderEx ? (file->HeaderEx.Flags2 & 7) : uint32_t(data::DDS_ALPHA_MODE_UNKNOWN);
+    data::dds_close(file);
+
+    if (!transcode_source_format(format, hdr))
+    {
+        fprintf(fp, "ERROR: Unable to decode DXGI format %u of DDS input '%s'.\n", unsigned(format), path);
+        return false;
+    }
+    if (cube && (items % 6) != 0)
+    {
+        fprintf(fp, "ERROR: The cubemap '%s' does not store all six faces.\n", path);
+        return false;
+    }
+    if (params.Width  == 0) params.Width  = width;
+    if (params.Height == 0) params.Height = height;
+    params.BaseWidth   = width;
+    params.BaseHeight  = height;
+    params.Cubemap     = cube;
+    params.Volume      = volume;
+    params.ArraySize   = cube ? items / 6 : items;
+    params.Transcode   = true;
+    params.SourceCount = volume ? depth : 1;
+    params.SourceIndex = 1;
+    params.SourceFiles[0] = path;
+    params.SourceData [0] = NULL;
+    if (params.Format == data::DXGI_FORMAT_UNKNOWN)
+    {   // keep the format of the file if it can be re-encoded.
+        if (transcode_target_format(format, hdr)) params.Format = format;
+        else
+        {   // the file cannot be re-encoded in its own format. the substitution
+            // is reported when the image is written, unless --format replaces it.
+            params.Format          = hdr ? data::DXGI_FORMAT_R32G32B32A32_FLOAT : data::DXGI_FORMAT_R8G8B8A8_UNORM;
+            params.FormatDefaulted = true;
+        }
+    }
+    if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
+    {
+        params.AlphaMode = alpha;
+    }
+    if (params.Mipmaps == false)
+    {   // re-encode the existing levels, or the first MaxMipLevels of them.
+        if (params.MaxMipLevels == 0 || params.MaxMipLevels > levels)
+            params.MaxMipLevels = levels;
+        params.Mipmaps     = params.MaxMipLevels > 1;
+        params.KeepMipmaps = true;
+    }
+    return true;
+}
+
+/// @summary Processes an input node of a JSON document.
+/// @param fp The stream to which errors will be written.
+/// @param node The JSON document node to process.
+/// @param params The DDS output parameters to populate.
+static bool process_json_node(FILE *fp, data::json_item_t *node, dds_params_t &params)
+{
+    if (node == NULL)
+        return true;
+
+    switch (node->ValueType)
+    {
+        case data::JSON_TYPE_OBJECT:
+            {   // we expect a top-level object, but that's it.
+                data::json_item_t *child = node->FirstChild;
+                while (child != NULL)
+                {   // recursively process the fields that make up the object.
+                    if (!process_json_node(fp, child, params))
+                        return false;
+                    child = child->Next;
+                }
+            }
+            return true;
+
+        case data::JSON_TYPE_ARRAY:
+            {   // we expect only the SourceFiles and SourceData elements to be
+                // arrays. both append to the list of sources in document order.
+                bool embedded = 0 == stricmp_fn(node->Key, "SourceData");
+                if (0 != stricmp_fn(node->Key, "SourceFiles") && !embedded)
+                {
+                    fprintf(fp, "WARNING: Unexpected array element \'%s\'.", node->Key);
+                    return true;
+                }
+                data::json_item_t *element = node->FirstChild;
+                for (size_t item = 0; element != NULL; ++item)
+                {   // all child elements must be strings.
+                    if (element->ValueType != data::JSON_TYPE_STRING)
+                    {
+                        fprintf(fp, "WARNING: Expect only strings in %s array; item %u will be ignored.\n", embedded ? "SourceData" : "SourceFiles", unsigned(params.SourceCount));
+                        element = element->Next;
+                        continue;
+                    }
+                    if (params.SourceCount == MAX_SOURCE_IMAGES)
+                    {
+                        fprintf(fp, "WARNING: A maximum of %u source images are supported.\n", unsigned(MAX_SOURCE_IMAGES));
+                        break;
+                    }
+                    if (embedded)
+                    {   // embedded inputs are named by their position in the array.
+                        char *name = params.SourceNames[params.SourceCount];
+                        snprintf(name, SOURCE_NAME_SIZE, "SourceData[%u]", unsigned(item));
+                        params.SourceFiles[params.SourceCount] = name;
+                    }
+                    else params.SourceFiles[params.SourceCount] = element->Value.string;
+                    params.SourceData [params.SourceCount] = embedded ? element->Value.string : NULL;
+                    params.SourceCount++;
+                    element = element->Next;
+                }
+            }
+            return true;
+
+        case data::JSON_TYPE_STRING:
+            {   // we expect 'Format', 'AlphaMode', 'Projection', 'Filter',
+                // 'Prefilter', 'AtlasPacker' and the output paths to be strings.
+                if (0 != stricmp_fn(node->Key, "Format"        ) &&
+                    0 != stricmp_fn(node->Key, "AlphaMode"     ) &&
+                    0 != stricmp_fn(node->Key, "Projection"    ) &&
+                    0 != stricmp_fn(node->Key, "Filter"        ) &&
+                    0 != stricmp_fn(node->Key, "Prefilter"     ) &&
+                    0 != stricmp_fn(node->Key, "IrradianceSH"  ) &&
+                    0 != stricmp_fn(node->Key, "IrradianceCube") &&
+                    0 != stricmp_fn(node->Key, "ColorSpace"    ) &&
+                    0 != stricmp_fn(node->Key, "EdgeMode"      ) &&
+                    0 != stricmp_fn(node->Key, "AtlasPacker"   ) &&
+                    0 != stricmp_fn(node->Key, "AtlasTable"    ) &&
+                    0 != stricmp_fn(node->Key, "Ktx2File"      ) &&
+                    0 != stricmp_fn(node->Key, "SupercompressFile") &&
+                    0 != stricmp_fn(node->Key, "MetricsFile"   ))
+                {
+                    fprintf(fp, "ERROR: Unexpected string field \'%s\'.\n", node->Key);
+                    return false;
+                }
+
+                if (0 == stricmp_fn(node->Key, "Format"))
                 {
                     bool         match = false;
                     size_t const nvals = sizeof(DXGI_FORMAT_VALUES) / sizeof(DXGI_FORMAT_VALUES[0]);
@@ -716,33 +2502,222 @@ static bool process_json_node(FILE *fp, data::json_item_t *node, dds_params_t &p
                         return false;
                     }
                 }
+                else if (0 == stricmp_fn(node->Key, "Projection"))
+                {
+                    bool         match = false;
+                    size_t const nvals = sizeof(PROJECTION_STRINGS) / sizeof(PROJECTION_STRINGS[0]);
+                    for (size_t i = 0; i < nvals; ++i)
+                    {
+                        if (0 == stricmp_fn(node->Value.string, PROJECTION_STRINGS[i]))
+                        {
+                            params.Projection = uint32_t(i);
+                            match = true;
+                            break;
+                        }
+                    }
+                    if (!match)
+                    {
+                        fprintf(fp, "ERROR: Unknown Projection value \'%s\'.\n", node->Value.string);
+                        return false;
+                    }
+                }
+                else if (0 == stricmp_fn(node->Key, "Filter"))
+                {
+                    bool         match = false;
+                    size_t const nvals = sizeof(FILTER_STRINGS) / sizeof(FILTER_STRINGS[0]);
+                    for (size_t i = 0; i < nvals; ++i)
+                    {
+                        if (0 == stricmp_fn(node->Value.string, FILTER_STRINGS[i]))
+                        {
+                            params.Filter = uint32_t(i);
+                            match = true;
+                            break;
+                        }
+                    }
+                    if (!match && 0 == stricmp_fn(node->Value.string, "GGX"))
+                    {
+                        fprintf(fp, "ERROR: GGX is not a resampling filter; use \"Prefilter\": \"GGX\".\n");
+                        return false;
+                    }
+                    if (!match && 0 == stricmp_fn(node->Value.string, "KAISER"))
+                    {
+                        fprintf(fp, "ERROR: The Kaiser filter is not supported by stb_image_resize.\n");
+                        return false;
+                    }
+                    if (!match)
+                    {
+                        fprintf(fp, "ERROR: Unknown Filter value \'%s\'.\n", node->Value.string);
+                        return false;
+                    }
+                }
+                else if (0 == stricmp_fn(node->Key, "Prefilter"))
+                {
+                    bool         match = false;
+                    size_t const nvals = sizeof(PREFILTER_STRINGS) / sizeof(PREFILTER_STRINGS[0]);
+                    for (size_t i = 0; i < nvals; ++i)
+                    {
+                        if (0 == stricmp_fn(node->Value.string, PREFILTER_STRINGS[i]))
+                        {
+                            params.Prefilter = uint32_t(i);
+                            match = true;
+                            break;
+                        }
+                    }
+                    if (!match)
+                    {
+                        fprintf(fp, "ERROR: Unknown Prefilter value \'%s\'.\n", node->Value.string);
+                        return false;
+                    }
+                }
+                else if (0 == stricmp_fn(node->Key, "ColorSpace"))
+                {
+                    bool         match = false;
+                    size_t const nvals = sizeof(COLORSPACE_STRINGS) / sizeof(COLORSPACE_STRINGS[0]);
+                    for (size_t i = 0; i < nvals; ++i)
+                    {
+                        if (0 == stricmp_fn(node->Value.string, COLORSPACE_STRINGS[i]))
+                        {
+                            params.ColorSpace = uint32_t(i);
+                            match = true;
+                            break;
+                        }
+                    }
+                    if (!match)
+                    {
+                        fprintf(fp, "ERROR: Unknown ColorSpace value \'%s\'.\n", node->Value.string);
+                        return false;
+                    }
+                }
+                else if (0 == stricmp_fn(node->Key, "EdgeMode"))
+                {
+                    bool         match = false;
+                    size_t const nvals = sizeof(EDGEMODE_STRINGS) / sizeof(EDGEMODE_STRINGS[0]);
+                    for (size_t i = 0; i < nvals; ++i)
+                    {
+                        if (0 == stricmp_fn(node->Value.string, EDGEMODE_STRINGS[i]))
+                        {
+                            params.EdgeMode = uint32_t(i + 1);
+                            match = true;
+                            break;
+                        }
+                    }
+                    if (!match)
+                    {
+                        fprintf(fp, "ERROR: Unknown EdgeMode value \'%s\'.\n", node->Value.string);
+                        return false;
+                    }
+                }
+                else if (0 == stricmp_fn(node->Key, "AtlasPacker"))
+                {
+                    bool         match = false;
+                    size_t const nvals = sizeof(PACKER_STRINGS) / sizeof(PACKER_STRINGS[0]);
+                    for (size_t i = 0; i < nvals; ++i)
+                    {
+                        if (0 == stricmp_fn(node->Value.string, PACKER_STRINGS[i]))
+                        {
+                            params.AtlasPacker = uint32_t(i);
+                            match = true;
+                            break;
+                        }
+                    }
+                    if (!match)
+                    {
+                        fprintf(fp, "ERROR: Unknown AtlasPacker value \'%s\'.\n", node->Value.string);
+                        return false;
+                    }
+                }
+                else if (0 == stricmp_fn(node->Key, "IrradianceSH"  )) params.IrradianceSH   = node->Value.string;
+                else if (0 == stricmp_fn(node->Key, "IrradianceCube")) params.IrradianceCube = node->Value.string;
+                else if (0 == stricmp_fn(node->Key, "AtlasTable"    )) params.AtlasTable     = node->Value.string;
+                else if (0 == stricmp_fn(node->Key, "Ktx2File"))
+                {
+                    params.Ktx2File = node->Value.string;
+                    params.Ktx2     = true;
+                }
+                else if (0 == stricmp_fn(node->Key, "SupercompressFile"))
+                {
+                    params.SupercompressFile = node->Value.string;
+                    params.Supercompress     = true;
+                }
+                else if (0 == stricmp_fn(node->Key, "MetricsFile"))
+                {
+                    params.MetricsFile = node->Value.string;
+                    params.Metrics     = true;
+                }
                 else fprintf(fp, "WARNING: Unexpected string field \'%s\'.\n", node->Key);
             }
             return true;
 
         case data::JSON_TYPE_INTEGER:
-            {   // Width, Height, MaxMipLevels, and ArraySize may be integers.
+            {   // Width, Height, MaxMipLevels, ArraySize, IrradianceSize, the atlas spacing
+                // and the RDO parameters may be integers.
                      if (0 == stricmp_fn(node->Key, "Width"       )) params.Width        = size_t(node->Value.integer);
                 else if (0 == stricmp_fn(node->Key, "Height"      )) params.Height       = size_t(node->Value.integer);
                 else if (0 == stricmp_fn(node->Key, "MaxMipLevels")) params.MaxMipLevels = size_t(node->Value.integer);
                 else if (0 == stricmp_fn(node->Key, "ArraySize"   )) params.ArraySize    = size_t(node->Value.integer);
+                else if (0 == stricmp_fn(node->Key, "IrradianceSize")) params.IrradianceSize = size_t(node->Value.integer);
+                else if (0 == stricmp_fn(node->Key, "AtlasPadding"  )) params.AtlasPadding   = size_t(node->Value.integer);
+                else if (0 == stricmp_fn(node->Key, "AtlasExtrude"  )) params.AtlasExtrude   = size_t(node->Value.integer);
+                else if (0 == stricmp_fn(node->Key, "RdoLambda"     ))
+                {
+                    if (node->Value.integer < 0)
+                    {
+                        fprintf(fp, "ERROR: RdoLambda must be non-negative, got %d.\n", int(node->Value.integer));
+                        return false;
+                    }
+                    params.RdoLambda = float(node->Value.integer);
+                }
+                else if (0 == stricmp_fn(node->Key, "RdoWindow"     ))
+                {
+                    if (node->Value.integer < 1 || node->Value.integer > int64_t(RDO_MAX_WINDOW))
+                    {
+                        fprintf(fp, "ERROR: RdoWindow must be between 1 and %u, got %d.\n", unsigned(RDO_MAX_WINDOW), int(node->Value.integer));
+                        return false;
+                    }
+                    params.RdoWindow = size_t(node->Value.integer);
+                }
                 else fprintf(fp, "WARNING: Unexpected Integer field \'%s\'.\n", node->Key);
             }
             return true;
 
         case data::JSON_TYPE_NUMBER:
-            {   // No Number values are expected currently.
-                fprintf(fp, "WARNING: Unexpected Number field \'%s\'.\n", node->Key);
+            {   // AlphaTestReference and RdoLambda may be Numbers.
+                if (0 == stricmp_fn(node->Key, "AlphaTestReference"))
+                {
+                    if (node->Value.number <= 0.0 || node->Value.number >= 1.0)
+                    {
+                        fprintf(fp, "ERROR: AlphaTestReference must be between 0 and 1, got %f.\n", node->Value.number);
+                        return false;
+                    }
+                    params.AlphaTestReference = float(node->Value.number);
+                }
+                else if (0 == stricmp_fn(node->Key, "RdoLambda"))
+                {
+                    if (node->Value.number < 0.0)
+                    {
+                        fprintf(fp, "ERROR: RdoLambda must be non-negative, got %f.\n", node->Value.number);
+                        return false;
+                    }
+                    params.RdoLambda = float(node->Value.number);
+                }
+                else fprintf(fp, "WARNING: Unexpected Number field \'%s\'.\n", node->Key);
             }
             return true;
 
         case data::JSON_TYPE_BOOLEAN:
             {
-                // ForcePow2, Cubemap, Volume and Mipmaps may be booleans.
+                // ForcePow2, Cubemap, Volume, Mipmaps, NormalMap, SeamlessCubemap, Atlas, Ktx2,
+                // Supercompress and Metrics may be booleans.
                      if (0 == stricmp_fn(node->Key, "Cubemap"  )) params.Cubemap   = node->Value.boolean;
                 else if (0 == stricmp_fn(node->Key, "Mipmaps"  )) params.Mipmaps   = node->Value.boolean;
                 else if (0 == stricmp_fn(node->Key, "Volume"   )) params.Volume    = node->Value.boolean;
                 else if (0 == stricmp_fn(node->Key, "ForcePow2")) params.ForcePow2 = node->Value.boolean;
+                else if (0 == stricmp_fn(node->Key, "NormalMap")) params.NormalMap = node->Value.boolean;
+                else if (0 == stricmp_fn(node->Key, "SeamlessCubemap")) params.SeamlessCubemap = node->Value.boolean;
+                else if (0 == stricmp_fn(node->Key, "Atlas"    )) params.Atlas     = node->Value.boolean;
+                else if (0 == stricmp_fn(node->Key, "Ktx2"     )) params.Ktx2      = node->Value.boolean;
+                else if (0 == stricmp_fn(node->Key, "Supercompress")) params.Supercompress = node->Value.boolean;
+                else if (0 == stricmp_fn(node->Key, "Metrics"  )) params.Metrics   = node->Value.boolean;
                 else fprintf(fp, "WARNING: Unexpected Boolean field \'%s\'.\n" , node->Key);
             }
             return true;
@@ -753,15 +2728,40 @@ static bool process_json_node(FILE *fp, data::json_item_t *node, dds_params_t &p
                 else if (0 == stricmp_fn(node->Key, "Mipmaps"     )) params.Mipmaps      = false;
                 else if (0 == stricmp_fn(node->Key, "Volume"      )) params.Volume       = false;
                 else if (0 == stricmp_fn(node->Key, "ForcePow2"   )) params.ForcePow2    = false;
+                else if (0 == stricmp_fn(node->Key, "NormalMap"   )) params.NormalMap    = false;
+                else if (0 == stricmp_fn(node->Key, "SeamlessCubemap")) params.SeamlessCubemap = false;
+                else if (0 == stricmp_fn(node->Key, "ColorSpace"  )) params.ColorSpace   = COLORSPACE_AUTO;
+                else if (0 == stricmp_fn(node->Key, "EdgeMode"    )) params.EdgeMode     = STBIR_EDGE_CLAMP;
                 else if (0 == stricmp_fn(node->Key, "Width"       )) params.Width        = 0;
                 else if (0 == stricmp_fn(node->Key, "Height"      )) params.Height       = 0;
                 else if (0 == stricmp_fn(node->Key, "Format"      )) params.Format       = data::DXGI_FORMAT_B8G8R8A8_UNORM;
                 else if (0 == stricmp_fn(node->Key, "AlphaMode"   )) params.AlphaMode    = data::DDS_ALPHA_MODE_PREMULTIPLIED;
                 else if (0 == stricmp_fn(node->Key, "MaxMipLevels")) params.MaxMipLevels = 1;
                 else if (0 == stricmp_fn(node->Key, "ArraySize"   )) params.ArraySize    = 1;
-                else if (0 == stricmp_fn(node->Key, "SourceFiles" ))
+                else if (0 == stricmp_fn(node->Key, "Projection"  )) params.Projection   = PROJECTION_NONE;
+                else if (0 == stricmp_fn(node->Key, "Filter"      )) params.Filter       = FILTER_DEFAULT;
+                else if (0 == stricmp_fn(node->Key, "Prefilter"   )) params.Prefilter    = PREFILTER_NONE;
+                else if (0 == stricmp_fn(node->Key, "IrradianceSH"  )) params.IrradianceSH   = NULL;
+                else if (0 == stricmp_fn(node->Key, "IrradianceCube")) params.IrradianceCube = NULL;
+                else if (0 == stricmp_fn(node->Key, "IrradianceSize")) params.IrradianceSize = 32;
+                else if (0 == stricmp_fn(node->Key, "AlphaTestReference")) params.AlphaTestReference = 0.0f;
+                else if (0 == stricmp_fn(node->Key, "RdoLambda"     )) params.RdoLambda      = 0.0f;
+                else if (0 == stricmp_fn(node->Key, "RdoWindow"     )) params.RdoWindow      = RDO_DEFAULT_WINDOW;
+                else if (0 == stricmp_fn(node->Key, "Atlas"         )) params.Atlas          = false;
+                else if (0 == stricmp_fn(node->Key, "AtlasPacker"   )) params.AtlasPacker    = PACKER_MAXRECTS;
+                else if (0 == stricmp_fn(node->Key, "AtlasPadding"  )) params.AtlasPadding   = 2;
+                else if (0 == stricmp_fn(node->Key, "AtlasExtrude"  )) params.AtlasExtrude   = 1;
+                else if (0 == stricmp_fn(node->Key, "AtlasTable"    )) params.AtlasTable     = NULL;
+                else if (0 == stricmp_fn(node->Key, "Ktx2"          )) params.Ktx2           = false;
+                else if (0 == stricmp_fn(node->Key, "Ktx2File"      )) params.Ktx2File       = NULL;
+                else if (0 == stricmp_fn(node->Key, "Supercompress" )) params.Supercompress  = false;
+                else if (0 == stricmp_fn(node->Key, "SupercompressFile")) params.SupercompressFile = NULL;
+                else if (0 == stricmp_fn(node->Key, "Metrics"       )) params.Metrics        = false;
+                else if (0 == stricmp_fn(node->Key, "MetricsFile"   )) params.MetricsFile    = NULL;
+                else if (0 == stricmp_fn(node->Key, "SourceFiles" ) ||
+                         0 == stricmp_fn(node->Key, "SourceData"  ))
                 {
-                    fprintf(fp, "ERROR: SourceFiles cannot be null.\n");
+                    fprintf(fp, "ERROR: %s cannot be null.\n", node->Key);
                     return false;
                 }
                 else fprintf(fp, "WARNING: Unexpected null field \'%s\'.\n", node->Key);
@@ -820,14 +2820,59 @@ static bool params_from_json(FILE *fp, char *json, size_t json_size, bool free_b
     data::json_free(root, NULL);
 
     // perform some additional parameter validation.
-    if (params.Cubemap && (params.SourceCount % 6) != 0)
+    if (params.Projection != PROJECTION_NONE)
+    {   // each source image is projected onto the six faces of a cubemap.
+        if (params.Volume)
+        {
+            fprintf(fp, "ERROR: Projection cannot be used with volume images.\n");
+            return false;
+        }
+        params.Cubemap = true;
+    }
+    if (params.Atlas)
+    {   // the pages of an atlas are a plain 2D image or image array.
+        if (params.Cubemap || params.Volume)
+        {
+            fprintf(fp, "ERROR: Atlas cannot be used with cubemap or volume images.\n");
+            return false;
+        }
+        if (params.Width  == 0) params.Width  = ATLAS_PAGE_SIZE;
+        if (params.Height == 0) params.Height = ATLAS_PAGE_SIZE;
+        if (params.Width > ATLAS_MAX_PAGE_SIZE || params.Height > ATLAS_MAX_PAGE_SIZE)
+        {
+            fprintf(fp, "ERROR: Atlas pages may be at most %ux%u pixels.\n", unsigned(ATLAS_MAX_PAGE_SIZE), unsigned(ATLAS_MAX_PAGE_SIZE));
+            return false;
+        }
+    }
+    if (params.Prefilter == PREFILTER_GGX && !params.Cubemap)
+    {
+        fprintf(fp, "WARNING: The GGX prefilter applies only to cubemaps and will be ignored.\n");
+        params.Prefilter = PREFILTER_NONE;
+    }
+    if (params.SeamlessCubemap && !params.Cubemap)
+    {
+        fprintf(fp, "WARNING: SeamlessCubemap applies only to cubemaps and will be ignored.\n");
+        params.SeamlessCubemap = false;
+    }
+    if ((params.IrradianceSH != NULL || params.IrradianceCube != NULL) && !params.Cubemap)
+    {
+        fprintf(fp, "WARNING: Irradiance output applies only to cubemaps and will not be generated.\n");
+        params.IrradianceSH   = NULL;
+        params.IrradianceCube = NULL;
+    }
+    if (params.IrradianceSize == 0)
+    {
+        params.IrradianceSize = 1;
+    }
+    size_t cube_sources = params.Projection == PROJECTION_NONE ? 6 : 1;
+    if (params.Cubemap && (params.SourceCount % cube_sources) != 0)
     {
         fprintf(fp, "ERROR: The number of SourceFiles specified for a cubemap must be a multiple of six, got %u.\n", unsigned(params.SourceCount));
         return false;
     }
-    if (params.Cubemap &&  params.SourceCount > 6)
+    if (params.Cubemap &&  params.SourceCount > cube_sources)
     {   // this is an array of cubemap images.
-        params.ArraySize = params.SourceCount / 6;
+        params.ArraySize = params.SourceCount / cube_sources;
     }
     if (params.Volume)
     {   // the array size must be set to 1. volume arrays are not supported.
@@ -837,17 +2882,20 @@ static bool params_from_json(FILE *fp, char *json, size_t json_size, bool free_b
     {   // default to the number of source files specified.
         params.ArraySize = params.SourceCount;
     }
-    if (params.Volume && params.Mipmaps)
-    {
-        fprintf(fp, "WARNING: Mipmaps are not currently supported for volume images and will not be output.\n");
-        params.Mipmaps  = false;
-        params.MaxMipLevels = 1;
-    }
 
-    if (params.SourceCount == 1 && !params.Volume)
-    {   // if there's only one source file, load it now.
-        if (load_image(fp, params.SourceFiles[0], image) == false)
-        {   // additional information is printed out by load_image().
+    if (params.SourceCount == 1 && is_dds_path(params.SourceFiles[0]))
+    {   // an existing DDS is re-encoded; its layout replaces Cubemap, Volume and ArraySize.
+        if (params.Atlas || params.Projection != PROJECTION_NONE)
+        {
+            fprintf(fp, "ERROR: Atlas and Projection cannot be used with a DDS source.\n");
+            return false;
+        }
+        return params_from_dds(fp, params.SourceFiles[0], params, image);
+    }
+    if (params.SourceCount == 1 && !params.Volume && !params.Atlas && params.Projection == PROJECTION_NONE)
+    {   // if there's only one source file, load it now.
+        if (load_source_image(fp, params, 0, params.Format, image) == false)
+        {   // additional information is printed out by load_image().
             return false;
         }
 
@@ -869,6 +2917,7 @@ static bool params_from_json(FILE *fp, char *json, size_t json_size, bool free_b
     else
     {   // more than one image, so defer loading until we generate the DDS.
         params.SourceIndex = 1;
+        image.Pool         = NULL;
         image.Pixels       = NULL;
         image.Width        = 0;
         image.Height       = 0;
@@ -916,7 +2965,7 @@ static bool params_from_path(FILE *fp, char const *inpath, dds_params_t &params,
     {   // raw image files can describe only simple images.
         // LDR images are always R8[G8B8A8]_UNORM. HDR images are always R32[G32B32A32]_FLOAT.
         // if you need something other than this, use a JSON file and specify the format.
-        if (load_image(fp, inpath, image) == false)
+        if (load_image(fp, inpath, NULL, 0, data::DXGI_FORMAT_UNKNOWN, image) == false)
         {   // load_image() outputs error information.
             return false;
         }
@@ -935,14 +2984,51 @@ static bool params_from_path(FILE *fp, char const *inpath, dds_params_t &params,
         params.Cubemap        = false;
         params.Volume         = false;
         params.ForcePow2      = false;
+        params.MemoryLimit    = 0;
+        params.ThreadCount    = cpu_count();
+        params.Projection     = PROJECTION_NONE;
+        params.Filter         = FILTER_DEFAULT;
+        params.Prefilter      = PREFILTER_NONE;
+        params.IrradianceSH   = NULL;
+        params.IrradianceCube = NULL;
+        params.IrradianceSize = 32;
+        params.AlphaTestReference = 0.0f;
+        params.NormalMap      = false;
+        params.SeamlessCubemap= false;
+        params.ColorSpace     = COLORSPACE_AUTO;
+        params.EdgeMode       = STBIR_EDGE_CLAMP;
+        params.Atlas          = false;
+        params.AtlasPacker    = PACKER_MAXRECTS;
+        params.AtlasPadding   = 2;
+        params.AtlasExtrude   = 1;
+        params.AtlasTable     = NULL;
+        params.Ktx2           = false;
+        params.Ktx2File       = NULL;
+        params.Supercompress  = false;
+        params.SupercompressFile = NULL;
+        params.RdoLambda      = 0.0f;
+        params.RdoWindow      = RDO_DEFAULT_WINDOW;
+        params.Metrics        = false;
+        params.MetricsFile    = NULL;
+        params.MetricsJob     = NULL;
+        params.Transcode      = false;
+        params.FormatDefaulted = false;
+        params.KeepMipmaps    = false;
         params.OutputFile     = NULL;
         params.JsonBuffer     = NULL;
         params.SourceCount    = 1;
         params.SourceIndex    = 1;
         params.SourceFiles[0] = inpath;
+        params.SourceData [0] = NULL;
         return true;
     }
 
+    if (0 == stricmp_fn(ext_str, "dds"))
+    {   // an existing DDS is re-encoded with the same layout and format.
+        init_params(params, NULL);
+        return params_from_dds(fp, inpath, params, image);
+    }
+
     fprintf(fp, "ERROR: Unrecognized file extension \'%s\' on \'%s\'.\n", ext_str, inpath);
     return false;
 }
@@ -964,16 +3050,19 @@ static inline size_t pow2_ge(size_t value, size_t min)
 /// @param argc The number of command-line arguments.
 /// @param argv An array of NULL-terminated strings specifying command-line arguments.
 /// @param params The image processing parameters to update.
-static void modify_params(int argc, char **argv, dds_params_t &params)
+/// @return true if the arguments are valid, or false if an argument was rejected.
+static bool modify_params(int argc, char **argv, dds_params_t &params)
 {
-    // look for the --mipmap and --pow2 command line arguments and 
-    // modify the params structure.
+    // look for the --mipmap, --pow2, --memory-limit, --threads, --ktx2,
+    // --supercompress, --rdo, --metrics and --format command line arguments
+    // and modify the params structure.
     for (int i = 0; i < argc; ++i)
     {
         if (0 == stricmp_fn(argv[i], "--mipmap"))
         {
             params.Mipmaps      = true;
             params.MaxMipLevels = 0;
+            params.KeepMipmaps  = false;
             continue;
         }
         if (0 == stricmp_fn(argv[i], "--pow2"))
@@ -981,6 +3070,71 @@ static void modify_params(int argc, char **argv, dds_params_t &params)
             params.ForcePow2 = true;
             continue;
         }
+        if (0 == stricmp_fn(argv[i], "--ktx2"))
+        {
+            params.Ktx2 = true;
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--supercompress"))
+        {
+            params.Supercompress = true;
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--metrics"))
+        {
+            params.Metrics = true;
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--format") && i + 1 < argc)
+        {
+            bool         match = false;
+            size_t const nvals = sizeof(DXGI_FORMAT_VALUES) / sizeof(DXGI_FORMAT_VALUES[0]);
+            for (size_t j = 0; j < nvals && !match; ++j)
+            {
+                if (0 == stricmp_fn(argv[i + 1], DXGI_FORMAT_STRINGS[j]))
+                {
+                    params.Format          = DXGI_FORMAT_VALUES[j];
+                    params.FormatDefaulted = false;
+                    match = true;
+                }
+            }
+            if (!match) fprintf(stdout, "WARNING: Unknown DXGI_FORMAT_ value \'%s\' ignored.\n", argv[i + 1]);
+            ++i;
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--rdo") && i + 1 < argc)
+        {
+            float lambda = float(atof(argv[++i]));
+            if (lambda < 0.0f)
+            {
+                fprintf(stdout, "ERROR: --rdo must be non-negative, got %s.\n", argv[i]);
+                return false;
+            }
+            params.RdoLambda = lambda;
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--memory-limit") && i + 1 < argc)
+        {
+            // the limit is given in megabytes. strtoul() accepts a sign and
+            // saturates on overflow, so both are rejected here.
+            char const   *arg = argv[++i];
+            char         *end = NULL;
+            unsigned long mb  = strtoul(arg, &end, 10);
+            if (arg[0] < '0' || arg[0] > '9' || *end != '\0' || mb == ULONG_MAX || mb > (size_t(-1) / (1024 * 1024)))
+            {
+                fprintf(stdout, "WARNING: Invalid --memory-limit value '%s' ignored.\n", arg);
+                continue;
+            }
+            params.MemoryLimit = size_t(mb) * 1024 * 1024;
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--threads") && i + 1 < argc)
+        {
+            params.ThreadCount = size_t(strtoul(argv[++i], NULL, 10));
+            if (params.ThreadCount < 1) params.ThreadCount = 1;
+            if (params.ThreadCount > MAX_WORKER_THREADS) params.ThreadCount = MAX_WORKER_THREADS;
+            continue;
+        }
     }
     if (params.ForcePow2 && params.Width != 0 && params.Height != 0)
     {   // set Width and Height to the nearest power of 2.
@@ -988,18 +3142,21 @@ static void modify_params(int argc, char **argv, dds_params_t &params)
         params.Height = pow2_ge(params.Height, 1);
     }
     if (params.Mipmaps && params.MaxMipLevels == 0 && params.Width > 0 && params.Height > 0)
-    {   // compute all the way down to 1x1.
+    {   // compute all the way down to 1x1 (1x1x1 for volumes.)
         size_t lw = params.Width;
         size_t lh = params.Height;
-        while (lw > 1 || lh > 1)
+        size_t ld = params.Volume ? params.SourceCount : 1;
+        while (lw > 1 || lh > 1 || ld > 1)
         {
             params.MaxMipLevels++;
             lw >>= 1; if (lw == 0) lw = 1;
             lh >>= 1; if (lh == 0) lh = 1;
+            ld >>= 1; if (ld == 0) ld = 1;
         }
         // include the base level in the count.
         params.MaxMipLevels++;
     }
+    return true;
 }
 
 /// @summary Initializes the fields of a DDS_HEADER_DXT10 structure based on 
@@ -1261,6 +3418,7 @@ static void init_dds_header(data::dds_header_t *head, dds_params_t const &params
     uint32_t caps    = data::DDSCAPS_TEXTURE;
     if (params.Mipmaps) caps |= data::DDSCAPS_COMPLEX | data::DDSCAPS_MIPMAP;
     if (params.Cubemap) caps |= data::DDSCAPS_COMPLEX;
+    if (params.Volume)  caps |= data::DDSCAPS_COMPLEX;
 
     uint32_t caps2   = data::DDSCAPS2_NONE;
     if (params.Cubemap)caps2 |= data::DDS_CUBEMAP_ALLFACES;
@@ -1270,7 +3428,11 @@ static void init_dds_header(data::dds_header_t *head, dds_params_t const &params
     head->Flags     = flags;
     head->Height    = uint32_t(params.Height);
     head->Width     = uint32_t(params.Width);
-    head->Pitch     = data::dds_pitch(params.Format, params.Width);
+    head->Pitch     = uint32_t(data::dds_pitch(params.Format, params.Width));
+    if (data::dds_block_compressed(params.Format))
+    {   // the linear size is the number of bytes in the top level.
+        head->Pitch *= uint32_t(params.Height > 4 ? (params.Height + 3) / 4 : 1);
+    }
     head->Depth     = uint32_t(params.SourceCount);
     head->Levels    = uint32_t(params.MaxMipLevels);
     head->Caps      = caps;
@@ -1281,7 +3443,7 @@ static void init_dds_header(data::dds_header_t *head, dds_params_t const &params
     init_dds_pixelformat(&head->Format, params);
 }
 
-/// @summary Loads a specific source image from disk.
+/// @summary Loads a specific source image from disk or the manifest.
 /// @param fp The output stream to which errors and warnings will be written.
 /// @param params Image processing parameters.
 /// @param index The zero-based index of the source image to load.
@@ -1289,8 +3451,7 @@ static void init_dds_header(data::dds_header_t *head, dds_params_t const &params
 /// @return true if the image was loaded.
 static bool load_source(FILE *fp, dds_params_t &params, size_t index, image_info_t &image)
 {
-    char const *infile  = params.SourceFiles[index];
-    return load_image(fp, infile, image);
+    return load_source_image(fp, params, index, data::DXGI_FORMAT_UNKNOWN, image);
 }
 
 /// @summary Loads the next source image in the SourceFiles list.
@@ -1307,265 +3468,5911 @@ static bool load_next_source(FILE *fp, dds_params_t &params, image_info_t &image
     return load_source(fp, params, params.SourceIndex++, image);
 }
 
-/// @summary Generates and writes to disk the mipmap chain for an image. This 
-/// function writes the base image first, followed by all sub-levels.
-/// @param fp The output stream to which errors and warnings will be written.
-/// @param dds The output stream to which the image data will be written.
-/// @param params Image processing parameters.
-/// @param base_level A description of the highest-resolution image. If resizing
-/// is requested, or the image needs to be forced to power-of-two dimensions, 
-/// on return base_level will describe the resized image, and the original image
-/// described by base_level is freed.
-/// @return true if the entire mipchain was written to stream dds.
-static bool write_image_chain(FILE *fp, FILE *dds, dds_params_t const &params, image_info_t &base_level)
+/// @summary Determines whether makedds can block-compress data to a format.
+/// @param format One of data::dxgi_format_e.
+/// @return true if format is a BC1 or BC3 variant, which stb_dxt can encode,
+/// or an unsigned BC4 or BC5 variant, encoded with the stb_dxt alpha encoder.
+static bool bc_encoder_available(uint32_t format)
 {
-    if (base_level.Pixels == NULL)
-    {   // unable to load one of the source images.
-        return false;
-    }
+    switch (format)
+    {
+        case data::DXGI_FORMAT_BC1_TYPELESS:
+        case data::DXGI_FORMAT_BC1_UNORM:
+        case data::DXGI_FORMAT_BC1_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC3_TYPELESS:
+        case data::DXGI_FORMAT_BC3_UNORM:
+        case data::DXGI_FORMAT_BC3_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+            return true;
 
-    if (params.Width != params.BaseWidth || params.Height != params.BaseHeight)
-    {   // explicit resample requested, or we need to force power-of-two.
-        image_info_t out;
-        if (resize_image(fp, out, base_level, params.Width, params.Height) == false)
-        {   // resize_image() outputs error messages.
-            return false;
-        }
-        free_image(base_level);
-        base_level = out;
+        default:
+            break;
     }
+    return false;
+}
 
-    // write the highest-resolution image.
-    size_t pitch = data::dds_pitch(params.Format, params.Width);
-    size_t nb    = pitch  * params.Height;
-    fwrite(base_level.Pixels, nb, 1, dds);
+/// @summary Forces stb_dxt to build its lookup tables. stb_dxt initializes
+/// lazily on first use, which is not safe if the first blocks are encoded on
+/// several threads at once, so this is called before any work is started.
+static void init_bc_encoder(void)
+{
+    uint8_t block[64];
+    uint8_t dest [16];
+    memset(block, 0, sizeof(block));
+    stb_compress_dxt_block(dest, block, 1, STB_DXT_NORMAL);
+}
 
-    // write any additional levels in the mipmap chain.
-    if (params.Mipmaps && params.MaxMipLevels > 1)
-    {   // always generate the miplevel from the high-resolution source.
-        for (size_t i = 1; i < params.MaxMipLevels; ++i)
+/// @summary Gathers a 4x4 block of RGBA8 pixels from an LDR image, replicating
+/// the last column and row for blocks that extend past the image edges.
+/// @param block The 64-byte destination buffer.
+/// @param image The source image. Must have 1, 2 or 4 8-bit channels.
+/// @param bx The x-coordinate of the upper-left pixel of the block.
+/// @param by The y-coordinate of the upper-left pixel of the block.
+static void gather_block_rgba8(uint8_t block[64], image_info_t const &image, size_t bx, size_t by)
+{
+    uint8_t const *src = (uint8_t const*) image.Pixels;
+    size_t const   nch = size_t(image.Channels);
+    size_t const   w   = size_t(image.Width);
+    size_t const   h   = size_t(image.Height);
+    for (size_t y = 0; y < 4; ++y)
+    {
+        size_t sy = by + y < h ? by + y : h - 1;
+        for (size_t x = 0; x < 4; ++x)
         {
-            size_t lw = params.Width  >> i;
-            size_t lh = params.Height >> i;
-            if (lw < 1) lw = 1;
-            if (lh < 1) lh = 1;
-
-            image_info_t mip;
-            if (resize_image(fp, mip, base_level, lw, lh))
-            {   // write the mip-level to the output stream and delete it.
-                pitch = data::dds_pitch(params.Format, lw);
-                nb    = pitch * lh;
-                fwrite(mip.Pixels , nb, 1, dds);
-                free_image(mip);
+            size_t         sx = bx + x < w ? bx + x : w - 1;
+            uint8_t const *px = src + (sy * w + sx) * nch;
+            uint8_t       *dp = block + (y * 4 + x) * 4;
+            switch (nch)
+            {
+                case 1:
+                    dp[0] = px[0]; dp[1] = px[0]; dp[2] = px[0]; dp[3] = 0xFF;
+                    break;
+                case 2:
+                    dp[0] = px[0]; dp[1] = px[0]; dp[2] = px[0]; dp[3] = px[1];
+                    break;
+                default:
+                    dp[0] = px[0]; dp[1] = px[1]; dp[2] = px[2]; dp[3] = px[3];
+                    break;
             }
-            else return false;
         }
     }
-    return true;
 }
 
-/// @summary Loads six source files specified in the image processing parameters
-/// and writes them to the DDS output stream as a cubemap image. If requested, 
-/// mipmaps are generated and written to the output stream as well.
-/// @param fp The output stream to which errors and warnings will be written.
-/// @param dds The output stream to which the image data will be written.
-/// @param params Image processing parameters. These parameters may be updated
-/// with defaults based on the first cubemap face loaded.
-/// @return true if the entire cubemap image chain was written to the DDS output stream.
-static bool write_cubemap_image(FILE *fp, FILE *dds, dds_params_t &params)
+/// @summary Gathers one channel of a 4x4 block of pixels from an LDR image into
+/// the alpha bytes of an RGBA8 block, as expected by the stb_dxt alpha encoder.
+/// The last column and row are replicated for blocks past the image edges.
+/// @param block The 64-byte destination buffer.
+/// @param image The source image.
+/// @param bx The x-coordinate of the upper-left pixel of the block.
+/// @param by The y-coordinate of the upper-left pixel of the block.
+/// @param channel The zero-based index of the channel to gather.
+static void gather_block_channel(uint8_t block[64], image_info_t const &image, size_t bx, size_t by, size_t channel)
 {
-    for (size_t i = 0; i < 6; ++i)
-    {   // note that params.SourceIndex is used to keep track of state in this
-        // case, because it's possible to have arrays of cubemaps with mipmaps.
-        image_info_t face;
-        bool   first_face  = params.SourceIndex == 0;
-        if (load_next_source(fp, params, face))
+    uint8_t const *src = (uint8_t const*) image.Pixels;
+    size_t const   nch = size_t(image.Channels);
+    size_t const   w   = size_t(image.Width);
+    size_t const   h   = size_t(image.Height);
+    for (size_t y = 0; y < 4; ++y)
+    {
+        size_t sy = by + y < h ? by + y : h - 1;
+        for (size_t x = 0; x < 4; ++x)
         {
-            if (first_face)
-            {   // set any 'default to source' parameters.
-                if (params.Width  == 0) params.Width  = size_t(face.Width);
-                if (params.Height == 0) params.Height = size_t(face.Height);
-                params.BaseWidth   = size_t(face.Width);
-                params.BaseHeight  = size_t(face.Height);
+            size_t sx = bx + x < w ? bx + x : w - 1;
+            block[(y * 4 + x) * 4 + 3] = src[(sy * w + sx) * nch + channel];
+        }
+    }
+}
 
-                if (params.Format == data::DXGI_FORMAT_UNKNOWN)
-                {   // set the format to that of the first face.
-                    params.Format  = face.Format;
-                }
-                if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
-                {
-                    if (face.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
-                    else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
-                }
-                if (params.Mipmaps && params.MaxMipLevels == 0)
-                {   // compute all the way down to 1x1.
-                    size_t lw = params.Width;
-                    size_t lh = params.Height;
-                    while (lw > 1 || lh > 1)
-                    {
-                        params.MaxMipLevels++;
-                        lw >>= 1; if (lw == 0) lw = 1;
-                        lh >>= 1; if (lh == 0) lh = 1;
-                    }
-                    // include the base level in the count.
-                    params.MaxMipLevels++;
-                }
-            }
+/// @summary Expands a 5:6:5 color to 8 bits per channel.
+/// @param c The packed 16-bit color.
+/// @param out On return, stores the red, green and blue values.
+static inline void rgb565_to_rgb888(uint32_t c, int out[3])
+{
+    int r  = int((c >> 11) & 31);
+    int g  = int((c >>  5) & 63);
+    int b  = int( c        & 31);
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
 
-            if (!write_image_chain(fp, dds, params, face))
-            {
-                fprintf(fp, "ERROR: Unable to write face %u/6 (\'%s\').\n", unsigned(i), params.SourceFiles[params.SourceIndex-1]);
-                return false;
-            }
-            else free_image(face);
+/// @summary Decodes the palette of a BC1-style color block.
+/// @param color The 8-byte color block.
+/// @param four_color true to always decode in four-color mode, as BC3 does.
+/// @param pal On return, stores the palette colors.
+/// @return The number of usable palette entries. In BC1 three-color mode the
+/// fourth entry is transparent black, which is never used for opaque texels.
+static size_t bc1_palette(uint8_t const *color, bool four_color, int pal[4][3])
+{
+    uint32_t c0 = uint32_t(color[0]) | (uint32_t(color[1]) << 8);
+    uint32_t c1 = uint32_t(color[2]) | (uint32_t(color[3]) << 8);
+    rgb565_to_rgb888(c0, pal[0]);
+    rgb565_to_rgb888(c1, pal[1]);
+    if (four_color || c0 > c1)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            pal[2][k] = (2 * pal[0][k] + pal[1][k]) / 3;
+            pal[3][k] = (pal[0][k] + 2 * pal[1][k]) / 3;
         }
+        return 4;
     }
-    return true;
+    for (size_t k = 0; k < 3; ++k)
+    {
+        pal[2][k] = (pal[0][k] + pal[1][k]) / 2;
+        pal[3][k] = 0;
+    }
+    return 3;
 }
 
-/// @summary Loads the source files specified in the image processing parameters
-/// and writes them to the DDS output stream as an image array. If requested, 
-/// mipmaps are generated and written to the output stream as well.
-/// @param fp The output stream to which errors and warnings will be written.
-/// @param dds The output stream to which the image data will be written.
-/// @param params Image processing parameters. These parameters may be updated
-/// with defaults based on the first image loaded.
-/// @return true if the entire image array chain was written to the DDS output stream.
-static bool write_array_image(FILE *fp, FILE *dds, dds_params_t &params)
+/// @summary Computes the squared RGB error of a BC1-style color block.
+/// @param color The 8-byte color block.
+/// @param block The 4x4 block of RGBA8 source pixels.
+/// @param four_color true to always decode in four-color mode, as BC3 does.
+/// @return The sum of squared errors, or 0xFFFFFFFF if the block selects
+/// transparent black.
+static uint32_t bc1_color_error(uint8_t const *color, uint8_t const block[64], bool four_color)
 {
-    params.SourceIndex = 0;
-    if (params.Cubemap)
+    int      pal[4][3];
+    size_t   n   = bc1_palette(color, four_color, pal);
+    uint32_t sel = uint32_t(color[4]) | (uint32_t(color[5]) << 8) | (uint32_t(color[6]) << 16) | (uint32_t(color[7]) << 24);
+    uint32_t err = 0;
+    for (size_t i = 0; i < 16; ++i, sel >>= 2)
     {
-        for (size_t  i = 0, n = params.ArraySize; i < n; ++i)
+        size_t idx = sel & 3;
+        if (idx >= n)
+            return 0xFFFFFFFFU;
+        for (size_t k = 0; k < 3; ++k)
         {
-            if (!write_cubemap_image(fp, dds, params))
-            {
-                fprintf(fp, "ERROR: Unable to write element %u/%u.\n", unsigned(i), unsigned(n));
-                return false;
-            }
+            int d = int(block[i * 4 + k]) - pal[idx][k];
+            err  += uint32_t(d * d);
         }
     }
-    else
+    return err;
+}
+
+/// @summary Chooses the closest palette entry for each texel of a BC1-style
+/// color block, keeping its endpoints.
+/// @param color The 8-byte color block. The selectors are overwritten.
+/// @param block The 4x4 block of RGBA8 source pixels.
+/// @param four_color true to always decode in four-color mode, as BC3 does.
+/// @return The sum of squared errors of the block.
+static uint32_t bc1_select(uint8_t *color, uint8_t const block[64], bool four_color)
+{
+    int      pal[4][3];
+    size_t   n   = bc1_palette(color, four_color, pal);
+    uint32_t sel = 0;
+    uint32_t err = 0;
+    for (size_t i = 0; i < 16; ++i)
     {
-        for (size_t  i = 0, n = params.ArraySize; i < n; ++i)
+        uint32_t best = 0xFFFFFFFFU;
+        uint32_t bi   = 0;
+        for (size_t j = 0; j < n; ++j)
         {
-            image_info_t image;
-            if (load_next_source(fp, params, image))
+            uint32_t e = 0;
+            for (size_t k = 0; k < 3; ++k)
             {
-                if (i == 0)
-                {   // set any 'default to source' parameters. note that all 
-                    // images in the array have the same dimension and format.
-                    if (params.Width  == 0) params.Width  = size_t(image.Width);
-                    if (params.Height == 0) params.Height = size_t(image.Height);
-                    params.BaseWidth   = size_t(image.Width);
-                    params.BaseHeight  = size_t(image.Height);
-
-                    if (params.Format == data::DXGI_FORMAT_UNKNOWN)
-                    {   // set the format to that of the first image.
-                        params.Format  = image.Format;
-                    }
-                    if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
-                    {
-                        if (image.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
-                        else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
-                    }
-                    if (params.Mipmaps && params.MaxMipLevels == 0)
-                    {   // compute all the way down to 1x1.
-                        size_t lw = params.Width;
-                        size_t lh = params.Height;
-                        while (lw > 1 || lh > 1)
-                        {
-                            params.MaxMipLevels++;
-                            lw >>= 1; if (lw == 0) lw = 1;
-                            lh >>= 1; if (lh == 0) lh = 1;
-                        }
-                        // include the base level in the count.
-                        params.MaxMipLevels++;
-                    }
-                }
-                if (!write_image_chain(fp, dds, params, image))
-                {
-                    free_image(image);
-                    fprintf(fp, "ERROR: Unable to write element %u/%u.\n", unsigned(i), unsigned(n));
-                    return false;
-                }
-                else free_image(image);
+                int d = int(block[i * 4 + k]) - pal[j][k];
+                e    += uint32_t(d * d);
             }
-            else
+            if (e < best)
             {
-                fprintf(fp, "ERROR: Unable to load element %u/%u (\'%s\').\n", unsigned(i), unsigned(n), params.SourceFiles[i]);
-                return false;
+                best = e;
+                bi   = uint32_t(j);
             }
         }
+        sel |= bi << (i * 2);
+        err += best;
     }
-    return true;
+    color[4] = uint8_t(sel);
+    color[5] = uint8_t(sel >>  8);
+    color[6] = uint8_t(sel >> 16);
+    color[7] = uint8_t(sel >> 24);
+    return err;
 }
 
-/// @summary Loads the series of source files specified in the image processing
-/// parameters, and writes them to the DDS output stream as a volume image.
-/// @param fp The output stream to which errors and warnings will be written.
-/// @param dds The output stream to which the image data will be written.
-/// @param params Image processing parameters. These parameters may be updated
-/// with defaults based on the first slice loaded.
-/// @return true if the entire volume image was written to the DDS output stream.
-static bool write_volume_image(FILE *fp, FILE *dds, dds_params_t &params)
+/// @summary Computes the squared alpha error of a BC3 alpha block.
+/// @param alpha The 8-byte alpha block.
+/// @param block The 4x4 block of RGBA8 source pixels.
+/// @return The sum of squared errors.
+static uint32_t bc3_alpha_error(uint8_t const *alpha, uint8_t const block[64])
 {
-    params.SourceIndex = 0;
-    for (size_t i = 0, n = params.SourceCount; i < n; ++i)
+    int      pal[8];
+    uint64_t bits = 0;
+    pal[0] = alpha[0];
+    pal[1] = alpha[1];
+    if (pal[0] > pal[1])
     {
-        image_info_t slice;
-        if (load_next_source(fp, params, slice))
-        {
-            if (i == 0)
-            {   // set any 'default to source' parameters.
-                // note that volume images don't currently support mipmaps.
-                if (params.Width  == 0) params.Width  = size_t(slice.Width);
-                if (params.Height == 0) params.Height = size_t(slice.Height);
-                params.BaseWidth   = size_t(slice.Width);
-                params.BaseHeight  = size_t(slice.Height);
-                
-                if (params.Format == data::DXGI_FORMAT_UNKNOWN)
-                {   // set the format to that of the base slice.
-                    params.Format  = slice.Format;
-                }
-                if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
-                {   // set the alpha mode based on the number of source channels.
-                    if (slice.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
-                    else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
-                }
-                if (params.ForcePow2)
-                {   // set Width and Height to the nearest power of 2.
-                    params.Width   = pow2_ge(params.Width , 1);
-                    params.Height  = pow2_ge(params.Height, 1);
-                }
-            }
+        for (int i = 2; i < 8; ++i) pal[i] = ((8 - i) * pal[0] + (i - 1) * pal[1]) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; ++i) pal[i] = ((6 - i) * pal[0] + (i - 1) * pal[1]) / 5;
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+    for (size_t i = 0; i < 6; ++i)
+    {
+        bits |= uint64_t(alpha[2 + i]) << (i * 8);
+    }
+    uint32_t err = 0;
+    for (size_t i = 0; i < 16; ++i, bits >>= 3)
+    {
+        int d = int(block[i * 4 + 3]) - pal[bits & 7];
+        err  += uint32_t(d * d);
+    }
+    return err;
+}
 
-            if (params.Width != params.BaseWidth || params.Height != params.BaseHeight)
-            {   // explicit resample requested, or we need to force a power-of-two.
-                image_info_t out;
-                if (resize_image(fp, out, slice, params.Width, params.Height) == false)
-                {   // resize_image() outputs error messages.
-                    return false;
-                }
-                free_image(slice);
-                slice = out;
-            }
+/// @summary Replaces an encoded BC1 or BC3 block with a variant that repeats
+/// data from recently emitted blocks, when the error it adds is outweighed by
+/// the estimated bits an LZ compressor saves. Candidates repeat a whole block,
+/// reuse the endpoints of a color block with new selectors, or reuse its
+/// selectors with the current endpoints. Repeating the block that follows the
+/// one repeated by the previous block extends that match, and is cheapest.
+/// A candidate is chosen only if it lowers error + lambda * bits, so the
+/// squared error added to a block is at most lambda * RDO_BITS_LITERAL for
+/// each 8-byte half.
+/// @param window The recently emitted blocks. The final block is appended.
+/// @param dst The encoded block, updated in place.
+/// @param block The 4x4 block of RGBA8 source pixels.
+/// @param lambda The weight of the estimated bit cost relative to squared error.
+static void rdo_block(rdo_window_t *window, uint8_t *dst, uint8_t const block[64], float lambda)
+{
+    bool     bc3        = window->BlockSize == 16;
+    size_t   bsize      = window->BlockSize;
+    size_t   halves     = bc3 ? 2 : 1;
+    uint8_t *color      = dst + (bc3 ? 8 : 0);
+    uint32_t color_err  = bc1_color_error(color, block, bc3);
+    uint32_t alpha_err  = bc3 ? bc3_alpha_error(dst, block) : 0;
+    size_t   extend     = window->Match < window->Capacity ? (window->Match + 1) % window->Capacity : window->Capacity;
+    uint8_t  best_color[8];
+    uint8_t  best_alpha[8];
+    float    color_cost = float(color_err) + lambda * RDO_BITS_LITERAL;
+    float    alpha_cost = float(alpha_err) + lambda * RDO_BITS_LITERAL;
+    float    whole_cost = color_cost + (bc3 ? alpha_cost : 0.0f);
+    size_t   whole      = window->Capacity;
+    memcpy(best_color, color, 8);
+    memcpy(best_alpha, dst  , 8);
+    if (extend == window->Next) extend = window->Capacity;
+    for (size_t i = 0; i < window->Count; ++i)
+    {
+        uint8_t const *prev = window->Blocks + i * bsize;
+        uint8_t const *pcol = prev + (bc3 ? 8 : 0);
+        uint32_t       perr = bc1_color_error(pcol, block, bc3);
+        uint32_t       aerr = bc3 ? bc3_alpha_error(prev, block) : 0;
+        uint8_t        cand[8];
+        float          bits = (i == extend) ? RDO_BITS_EXTEND : RDO_BITS_MATCH;
+        float          cost;
 
-            // write the slice data out to the DDS file.
-            size_t pitch = data::dds_pitch(params.Format, params.Width);
-            size_t nb    = pitch  * params.Height;
-            fwrite(slice.Pixels, nb, 1, dds);
-            free_image(slice);
+        // repeat the entire block.
+        cost = float(perr) + float(aerr) + lambda * bits * float(halves);
+        if (cost < whole_cost)
+        {
+            whole_cost = cost;
+            whole      = i;
         }
-        else
+        // repeat only the color block.
+        cost = float(perr) + lambda * RDO_BITS_MATCH;
+        if (cost < color_cost)
         {
-            fprintf(fp, "ERROR: Unable to load slice %u/%u (\'%s\').\n", unsigned(i), unsigned(n), params.SourceFiles[i]);
-            return false;
+            color_cost = cost;
+            memcpy(best_color, pcol, 8);
         }
-    }
+        // reuse the endpoints and choose new selectors.
+        memcpy(cand, pcol, 4);
+        cost = float(bc1_select(cand, block, bc3)) + lambda * RDO_BITS_PARTIAL;
+        if (cost < color_cost)
+        {
+            color_cost = cost;
+            memcpy(best_color, cand, 8);
+        }
+        // reuse the selectors with the current endpoints.
+        memcpy(cand    , color   , 4);
+        memcpy(cand + 4, pcol + 4, 4);
+        cost = float(bc1_color_error(cand, block, bc3)) + lambda * RDO_BITS_PARTIAL;
+        if (cost < color_cost)
+        {
+            color_cost = cost;
+            memcpy(best_color, cand, 8);
+        }
+        if (bc3)
+        {   // repeat only the alpha block.
+            cost = float(aerr) + lambda * RDO_BITS_MATCH;
+            if (cost < alpha_cost)
+            {
+                alpha_cost = cost;
+                memcpy(best_alpha, prev, 8);
+            }
+        }
+    }
+    if (whole < window->Capacity && whole_cost <= color_cost + (bc3 ? alpha_cost : 0.0f))
+    {   // repeating a whole block is at least as good as the best halves.
+        memcpy(dst, window->Blocks + whole * bsize, bsize);
+        window->Match = whole;
+    }
+    else
+    {
+        memcpy(color, best_color, 8);
+        if (bc3) memcpy(dst, best_alpha, 8);
+        window->Match = window->Capacity;
+    }
+
+    memcpy(window->Blocks + window->Next * bsize, dst, bsize);
+    window->Next = (window->Next + 1) % window->Capacity;
+    if (window->Count < window->Capacity) window->Count++;
+}
+
+/// @summary Determines how many channels of an encoded block are measured for
+/// --metrics. BC1 alpha is not measured, as makedds always encodes it opaque.
+/// @param format One of data::dxgi_format_e specifying a block-compressed format.
+/// @return The number of leading RGBA channels stored by the format.
+static size_t metrics_channel_count(uint32_t format)
+{
+    switch (format)
+    {
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+            return 1;
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+            return 2;
+        default:
+            break;
+    }
+    return data::dds_bytes_per_block(format) == 16 ? 4 : 3;
+}
+
+#if MAKEDDS_SSE2
+/// @summary Multiplies the 16-bit channels of two texels and widens the
+/// products, adding the two texels together.
+/// @param a Two RGBA texels, zero-extended to 16 bits per channel.
+/// @param b Two RGBA texels, zero-extended to 16 bits per channel.
+/// @return The sum of the products of each channel, as four 32-bit values.
+static inline __m128i texel_products(__m128i a, __m128i b)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const p    = _mm_mullo_epi16(a, b); // at most 255 * 255, exact when unsigned.
+    return _mm_add_epi32(_mm_unpacklo_epi16(p, zero), _mm_unpackhi_epi16(p, zero));
+}
+#endif
+
+/// @summary Computes the first and second moments of each channel of a pair
+/// of 4x4 blocks of RGBA8 texels.
+/// @param x The first block.
+/// @param y The second block.
+/// @param moments On return, stores the per-channel sums of x, y, x*x, y*y
+/// and x*y, in that order.
+static void block_moments(uint8_t const x[64], uint8_t const y[64], uint32_t moments[5][4])
+{
+#if MAKEDDS_SSE2
+    __m128i const zero = _mm_setzero_si128();
+    __m128i sx  = zero, sy  = zero;
+    __m128i sxx = zero, syy = zero, sxy = zero;
+    for (size_t i = 0; i < 64; i += 16)
+    {
+        __m128i xv = _mm_loadu_si128((__m128i const*) (x + i));
+        __m128i yv = _mm_loadu_si128((__m128i const*) (y + i));
+        __m128i xl = _mm_unpacklo_epi8(xv, zero);
+        __m128i xh = _mm_unpackhi_epi8(xv, zero);
+        __m128i yl = _mm_unpacklo_epi8(yv, zero);
+        __m128i yh = _mm_unpackhi_epi8(yv, zero);
+        // the 16-bit sums reach at most 8 * 255, so they cannot overflow.
+        sx  = _mm_add_epi16(sx, _mm_add_epi16(xl, xh));
+        sy  = _mm_add_epi16(sy, _mm_add_epi16(yl, yh));
+        sxx = _mm_add_epi32(sxx, _mm_add_epi32(texel_products(xl, xl), texel_products(xh, xh)));
+        syy = _mm_add_epi32(syy, _mm_add_epi32(texel_products(yl, yl), texel_products(yh, yh)));
+        sxy = _mm_add_epi32(sxy, _mm_add_epi32(texel_products(xl, yl), texel_products(xh, yh)));
+    }
+    sx = _mm_add_epi32(_mm_unpacklo_epi16(sx, zero), _mm_unpackhi_epi16(sx, zero));
+    sy = _mm_add_epi32(_mm_unpacklo_epi16(sy, zero), _mm_unpackhi_epi16(sy, zero));
+    _mm_storeu_si128((__m128i*) moments[0], sx);
+    _mm_storeu_si128((__m128i*) moments[1], sy);
+    _mm_storeu_si128((__m128i*) moments[2], sxx);
+    _mm_storeu_si128((__m128i*) moments[3], syy);
+    _mm_storeu_si128((__m128i*) moments[4], sxy);
+#else
+    memset(moments, 0, 5 * 4 * sizeof(uint32_t));
+    for (size_t i = 0; i < 64; ++i)
+    {
+        uint32_t a = x[i];
+        uint32_t b = y[i];
+        moments[0][i & 3] += a;
+        moments[1][i & 3] += b;
+        moments[2][i & 3] += a * a;
+        moments[3][i & 3] += b * b;
+        moments[4][i & 3] += a * b;
+    }
+#endif
+}
+
+/// @summary Decodes an encoded block and adds its error relative to the
+/// block it was encoded from to a set of metrics sums. Each block is one SSIM
+/// window, so windows never straddle the rows written by separate calls. The
+/// windows are unweighted and do not overlap, unlike the 11x11 Gaussian window
+/// of standard SSIM, so the result is reported as SSIM4x4 and is not directly
+/// comparable with SSIM figures from other tools.
+/// @param sums The sums to update.
+/// @param ref The 4x4 block of RGBA8 texels that was encoded.
+/// @param encoded The encoded block.
+/// @param format One of data::dxgi_format_e specifying the encoded format.
+/// @param channels The number of leading RGBA channels stored by the format.
+/// @param cols The number of columns of the block within the image.
+/// @param rows The number of rows of the block within the image.
+static void measure_block(metrics_sums_t *sums, uint8_t const ref[64], uint8_t const *encoded, uint32_t format, size_t channels, size_t cols, size_t rows)
+{
+    uint8_t  src[64];
+    uint8_t  dec[64];
+    uint32_t m[5][4];
+    data::bc_decode_block(dec, 16, encoded, format);
+    memcpy(src, ref, sizeof(src));
+    if (cols < 4 || rows < 4)
+    {   // texels replicated past the image edges are excluded.
+        for (size_t y = 0; y < 4; ++y)
+        {
+            for (size_t x = 0; x < 4; ++x)
+            {
+                if (x < cols && y < rows) continue;
+                memset(&src[(y * 4 + x) * 4], 0, 4);
+                memset(&dec[(y * 4 + x) * 4], 0, 4);
+            }
+        }
+    }
+    if (cols > 4) cols = 4;
+    if (rows > 4) rows = 4;
+
+    block_moments(src, dec, m);
+    double n = double(cols * rows);
+    for (size_t c = 0; c < channels; ++c)
+    {
+        double mx  = m[0][c] / n;
+        double my  = m[1][c] / n;
+        double vx  = m[2][c] / n - mx * mx;
+        double vy  = m[3][c] / n - my * my;
+        double cxy = m[4][c] / n - mx * my;
+        sums->SquaredError[c] += double(m[2][c]) + double(m[3][c]) - 2.0 * double(m[4][c]);
+        sums->Ssim += ((2.0 * mx * my + SSIM_C1) * (2.0 * cxy + SSIM_C2)) / ((mx * mx + my * my + SSIM_C1) * (vx + vy + SSIM_C2));
+    }
+    sums->Windows += channels;
+    sums->Texels  += cols * rows;
+}
+
+/// @summary Adds the error measured over a run of rows to a metrics job.
+/// @param job The metrics job. May be accessed concurrently.
+/// @param offset The file offset of the first row.
+/// @param sums The error measured over the rows.
+/// @return true if the sample was recorded.
+static bool push_metrics(metrics_job_t *job, int64_t offset, metrics_sums_t const &sums)
+{
+    bool res = true;
+    mutex_lock(&job->Mutex);
+    if (job->Count == job->Capacity)
+    {
+        size_t            newcap = job->Capacity < 16 ? 16 : job->Capacity * 2;
+        metrics_sample_t *newbuf = (metrics_sample_t*) realloc(job->Samples, newcap * sizeof(metrics_sample_t));
+        if (newbuf != NULL)
+        {
+            job->Samples  = newbuf;
+            job->Capacity = newcap;
+        }
+        else res = false;
+    }
+    if (res)
+    {
+        job->Samples[job->Count].Offset = offset;
+        job->Samples[job->Count].Sums   = sums;
+        job->Count++;
+    }
+    mutex_unlock(&job->Mutex);
+    return res;
+}
+
+/// @summary Determines whether a format stores two 8-bit channels, which is
+/// how two-channel normal maps (X and Y, without Z) are output uncompressed.
+/// @param format One of data::dxgi_format_e.
+/// @return true if format is an R8G8 variant.
+static bool two_channel_format(uint32_t format)
+{
+    return format >= data::DXGI_FORMAT_R8G8_TYPELESS && format <= data::DXGI_FORMAT_R8G8_SINT;
+}
+
+/// @summary Converts a single-precision value to IEEE 754 half precision,
+/// rounding to nearest even. Values too large for a half become infinity.
+/// @param f The single-precision value.
+/// @return The equivalent half-precision value.
+static inline uint16_t float_to_half(float f)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &f, sizeof(float));
+    uint32_t sign = (bits >> 16) & 0x8000U;
+    uint32_t expo = (bits >> 23) & 0xFFU;
+    uint32_t mant =  bits & 0x7FFFFFU;
+    if (expo == 0xFF)
+    {   // infinity, or NaN with the top mantissa bits kept and one forced set.
+        return uint16_t(sign | 0x7C00U | (mant != 0 ? 0x200U | (mant >> 13) : 0));
+    }
+    int32_t e = int32_t(expo) - 127 + 15;
+    if (e >= 31)
+    {   // overflow.
+        return uint16_t(sign | 0x7C00U);
+    }
+    if (e <= 0)
+    {   // subnormal or zero; shift the implicit bit into the mantissa.
+        if (e < -10) return uint16_t(sign);
+        mant |= 0x800000U;
+        uint32_t shift = uint32_t(14 - e);
+        uint32_t half  = mant >> shift;
+        uint32_t rest  = mant & ((1U << shift) - 1);
+        uint32_t mid   = 1U << (shift - 1);
+        if (rest > mid || (rest == mid && (half & 1))) half++;
+        return uint16_t(sign | half);
+    }
+    uint32_t half = sign | (uint32_t(e) << 10) | (mant >> 13);
+    uint32_t rest = mant & 0x1FFFU;
+    if (rest > 0x1000U || (rest == 0x1000U && (half & 1))) half++; // may carry into the exponent.
+    return uint16_t(half);
+}
+
+/// @summary Converts a run of rows of working pixels into the output format
+/// and writes them to the DDS output stream. Block-compressed formats are
+/// encoded one row of 4x4 blocks at a time, so the row count must be a
+/// multiple of four except for the final rows of a level.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for the encoded block row.
+/// @param params Image processing parameters.
+/// @param image Describes the rows to write. Height is the number of rows.
+/// @return true if the rows were written to stream dds.
+static bool write_pixels(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t const &params, image_info_t const &image)
+{
+    size_t width = size_t(image.Width);
+    size_t rows  = size_t(image.Height);
+    size_t pitch = data::dds_pitch(params.Format, width);
+
+    if (two_channel_format(params.Format) && !image.HDR && (image.Channels > 2 || params.Format == data::DXGI_FORMAT_R8G8_SNORM))
+    {   // keep the first two channels, converting to signed if necessary.
+        uint8_t *row = (uint8_t*) scratch_alloc(pool, pitch);
+        if (row == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for row conversion.\n", unsigned(pitch));
+            return false;
+        }
+        bool           snorm = params.Format == data::DXGI_FORMAT_R8G8_SNORM;
+        size_t const   nch   = size_t(image.Channels);
+        uint8_t const *src   = (uint8_t const*) image.Pixels;
+        bool           res   = true;
+        for (size_t y = 0; y < rows && res; ++y)
+        {
+            for (size_t x = 0; x < width * 2; ++x)
+            {
+                uint8_t v = src[(y * width + x / 2) * nch + (nch > 1 ? x & 1 : 0)];
+                row[x]    = snorm ? uint8_t(int8_t(floorf((float(v) * (2.0f / 255.0f) - 1.0f) * 127.0f + 0.5f))) : v;
+            }
+            res = fwrite(row, pitch, 1, dds) == 1;
+        }
+        scratch_free(pool, row);
+        if (!res) fprintf(fp, "ERROR: Unable to write %u bytes of pixel data.\n", unsigned(pitch));
+        return res;
+    }
+    if (!image.HDR && image.Channels == 4 && bgra_format(params.Format) != bgra_format(image.Format))
+    {   // swap the red and blue channels of RGBA8 pixels written to BGRA8 formats.
+        uint8_t *row = (uint8_t*) scratch_alloc(pool, pitch);
+        if (row == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for row conversion.\n", unsigned(pitch));
+            return false;
+        }
+        uint8_t const *src = (uint8_t const*) image.Pixels;
+        bool           res = true;
+        for (size_t y = 0; y < rows && res; ++y, src += width * 4)
+        {
+            for (size_t x = 0; x < width * 4; x += 4)
+            {
+                row[x + 0] = src[x + 2];
+                row[x + 1] = src[x + 1];
+                row[x + 2] = src[x + 0];
+                row[x + 3] = src[x + 3];
+            }
+            res = fwrite(row, pitch, 1, dds) == 1;
+        }
+        scratch_free(pool, row);
+        if (!res) fprintf(fp, "ERROR: Unable to write %u bytes of pixel data.\n", unsigned(pitch));
+        return res;
+    }
+    size_t fch = 0, fbytes = 0;
+    if (image.HDR && float_format_layout(params.Format, fch, fbytes) && (fch != size_t(image.Channels) || fbytes != sizeof(float)))
+    {   // keep the first channels of float pixels, converting to half if necessary.
+        // channels missing from the working image are written as zero.
+        uint8_t *row = (uint8_t*) scratch_alloc(pool, pitch);
+        if (row == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for row conversion.\n", unsigned(pitch));
+            return false;
+        }
+        size_t const nch = size_t(image.Channels);
+        float  const*src = (float const*) image.Pixels;
+        bool         res = true;
+        for (size_t y = 0; y < rows && res; ++y, src += width * nch)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                for (size_t c = 0; c < fch; ++c)
+                {
+                    float v = c < nch ? src[x * nch + c] : 0.0f;
+                    if (fbytes == 2)
+                    {
+                        uint16_t h = float_to_half(v);
+                        memcpy(&row[(x * fch + c) * 2], &h, 2);
+                    }
+                    else memcpy(&row[(x * fch + c) * 4], &v, 4);
+                }
+            }
+            res = fwrite(row, pitch, 1, dds) == 1;
+        }
+        scratch_free(pool, row);
+        if (!res) fprintf(fp, "ERROR: Unable to write %u bytes of pixel data.\n", unsigned(pitch));
+        return res;
+    }
+    if (data::dds_block_compressed(params.Format) == false)
+    {   // uncompressed formats are written as-is.
+        if (rows > 0 && fwrite(image.Pixels, pitch * rows, 1, dds) != 1)
+        {
+            fprintf(fp, "ERROR: Unable to write %u bytes of pixel data.\n", unsigned(pitch * rows));
+            return false;
+        }
+        return true;
+    }
+    bool   bc4   = params.Format == data::DXGI_FORMAT_BC4_TYPELESS || params.Format == data::DXGI_FORMAT_BC4_UNORM;
+    bool   bc5   = params.Format == data::DXGI_FORMAT_BC5_TYPELESS || params.Format == data::DXGI_FORMAT_BC5_UNORM;
+    if (bc_encoder_available(params.Format) == false || image.HDR || (image.Channels == 3 && !bc4 && !bc5))
+    {
+        fprintf(fp, "ERROR: Unable to encode %s data to DXGI format %u.\n", image.HDR ? "HDR" : "LDR", unsigned(params.Format));
+        return false;
+    }
+
+    uint8_t *blocks = (uint8_t*) scratch_alloc(pool, pitch);
+    if (blocks == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate %u bytes for encoded blocks.\n", unsigned(pitch));
+        return false;
+    }
+
+    size_t bsize = data::dds_bytes_per_block(params.Format);
+    int    alpha = bsize == 16 ? 1 : 0;
+
+    // the RDO window spans the blocks written by this call, which is one
+    // level, or one strip of a level when memory is limited.
+    rdo_window_t window;
+    bool         rdo = params.RdoLambda > 0.0f && !bc4 && !bc5;
+    memset(&window, 0, sizeof(window));
+    if (rdo)
+    {
+        window.BlockSize = bsize;
+        window.Capacity  = params.RdoWindow;
+        window.Count     = 0;
+        window.Next      = 0;
+        window.Match     = window.Capacity;
+        window.Blocks    = (uint8_t*) scratch_alloc(pool, window.Capacity * bsize);
+        if (window.Blocks == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for the RDO window.\n", unsigned(window.Capacity * bsize));
+            scratch_free(pool, blocks);
+            return false;
+        }
+    }
+
+    // each encoded block is decoded and compared against its source block.
+    // the measured channels are those stored by the output format.
+    metrics_job_t *metrics = params.MetricsJob;
+    metrics_sums_t sums;
+    size_t         mch     = metrics_channel_count(params.Format);
+    int64_t        offset  = metrics != NULL ? data::file_tell(dds) : 0;
+    bool           res     = true;
+    memset(&sums, 0, sizeof(sums));
+
+    for (size_t by = 0; by < rows && res; by += 4)
+    {
+        for (size_t bx = 0, i = 0; bx < width; bx += 4, ++i)
+        {
+            uint8_t block[64];
+            uint8_t ref  [64];
+            if (bc4 || bc5)
+            {   // BC4 holds the first channel, BC5 the first two.
+                if (metrics != NULL) memset(ref, 0, sizeof(ref));
+                gather_block_channel(block, image, bx, by, 0);
+                stb__CompressAlphaBlock(&blocks[i * bsize], block, STB_DXT_NORMAL);
+                for (size_t t = 0; t < 16 && metrics != NULL; ++t) ref[t * 4 + 0] = block[t * 4 + 3];
+                if (bc5)
+                {
+                    gather_block_channel(block, image, bx, by, image.Channels > 1 ? 1 : 0);
+                    stb__CompressAlphaBlock(&blocks[i * bsize + 8], block, STB_DXT_NORMAL);
+                    for (size_t t = 0; t < 16 && metrics != NULL; ++t) ref[t * 4 + 1] = block[t * 4 + 3];
+                }
+            }
+            else
+            {
+                gather_block_rgba8(block, image, bx, by);
+                stb_compress_dxt_block(&blocks[i * bsize], block, alpha, STB_DXT_NORMAL);
+                if (rdo) rdo_block(&window, &blocks[i * bsize], block, params.RdoLambda);
+            }
+            if (metrics != NULL) measure_block(&sums, bc4 || bc5 ? ref : block, &blocks[i * bsize], params.Format, mch, width - bx, rows - by);
+        }
+        res = fwrite(blocks, pitch, 1, dds) == 1;
+    }
+    if (rdo) scratch_free(pool, window.Blocks);
+    scratch_free(pool, blocks);
+    if (!res)
+    {
+        fprintf(fp, "ERROR: Unable to write %u bytes of encoded blocks.\n", unsigned(pitch));
+        return false;
+    }
+    if (metrics != NULL && !push_metrics(metrics, offset, sums))
+    {
+        fprintf(fp, "ERROR: Unable to record encoding metrics.\n");
+        return false;
+    }
+    return true;
+}
+
+/// @summary Determines which channel of an image holds alpha.
+/// @param image The image to examine.
+/// @return The zero-based channel index, or -1 if the image has no alpha.
+static int alpha_channel(image_info_t const &image)
+{
+    if (image.Channels == 2) return 1;
+    if (image.Channels == 4) return 3;
+    return -1;
+}
+
+/// @summary Accumulates a histogram of the alpha values of an image. HDR alpha
+/// values are clamped to [0, 1] and quantized to the same 256 bins.
+/// @param image The image to examine. Must have an alpha channel.
+/// @param hist The histogram to which counts are added.
+static void alpha_histogram(image_info_t const &image, uint32_t hist[ALPHA_HISTOGRAM_BINS])
+{
+    size_t const nch = size_t(image.Channels);
+    size_t const n   = size_t(image.Width) * size_t(image.Height);
+    size_t const a   = size_t(alpha_channel(image));
+    if (image.HDR)
+    {
+        float const *p = (float const*) image.Pixels + a;
+        for (size_t i = 0; i < n; ++i, p += nch)
+        {
+            float v = *p * float(ALPHA_HISTOGRAM_BINS - 1) + 0.5f;
+            hist[v <= 0.0f ? 0 : (v >= float(ALPHA_HISTOGRAM_BINS - 1) ? ALPHA_HISTOGRAM_BINS - 1 : size_t(v))]++;
+        }
+    }
+    else
+    {
+        uint8_t const *p = (uint8_t const*) image.Pixels + a;
+        for (size_t i = 0; i < n; ++i, p += nch)
+        {
+            hist[*p]++;
+        }
+    }
+}
+
+/// @summary Computes the fraction of texels that pass an alpha test after
+/// their alpha values are multiplied by a scale factor.
+/// @param hist The alpha histogram of the level.
+/// @param reference The alpha test reference value, in (0, 1).
+/// @param scale The scale applied to alpha values.
+/// @return The fraction of texels whose scaled alpha exceeds reference.
+static float alpha_coverage(uint32_t const hist[ALPHA_HISTOGRAM_BINS], float reference, float scale)
+{
+    uint64_t pass  = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < ALPHA_HISTOGRAM_BINS; ++i)
+    {
+        float v = float(i) * scale;
+        if (v > float(ALPHA_HISTOGRAM_BINS - 1)) v = float(ALPHA_HISTOGRAM_BINS - 1);
+        if (v > reference * float(ALPHA_HISTOGRAM_BINS - 1)) pass += hist[i];
+        total += hist[i];
+    }
+    return total > 0 ? float(double(pass) / double(total)) : 0.0f;
+}
+
+/// @summary Searches for the alpha scale factor at which a level passes the
+/// alpha test over the same fraction of its area as the base level. Coverage
+/// never decreases as the scale increases, so a bisection over the histogram
+/// converges without touching the level pixels again.
+/// @param hist The alpha histogram of the level.
+/// @param reference The alpha test reference value, in (0, 1).
+/// @param coverage The coverage fraction of the base level.
+/// @return The alpha scale factor for the level.
+static float find_alpha_scale(uint32_t const hist[ALPHA_HISTOGRAM_BINS], float reference, float coverage)
+{
+    float lo = 0.0f;
+    float hi = ALPHA_SCALE_MAX;
+    for (size_t i = 0; i < ALPHA_SCALE_ITERATIONS; ++i)
+    {
+        float mid = 0.5f * (lo + hi);
+        if (alpha_coverage(hist, reference, mid) < coverage) lo = mid;
+        else hi = mid;
+    }
+    // coverage is a step function, so pick whichever bound lands closer.
+    float c_lo = alpha_coverage(hist, reference, lo);
+    float c_hi = alpha_coverage(hist, reference, hi);
+    return (coverage - c_lo) < (c_hi - coverage) ? lo : hi;
+}
+
+/// @summary Multiplies the alpha values of an image by a scale factor,
+/// clamping the result to the representable range.
+/// @param image The image to modify. Must have an alpha channel.
+/// @param scale The scale factor.
+static void scale_alpha(image_info_t &image, float scale)
+{
+    size_t const nch = size_t(image.Channels);
+    size_t const n   = size_t(image.Width) * size_t(image.Height);
+    size_t const a   = size_t(alpha_channel(image));
+    if (image.HDR)
+    {
+        float *p = (float*) image.Pixels + a;
+        for (size_t i = 0; i < n; ++i, p += nch)
+        {
+            float v = *p * scale;
+            *p = v > 1.0f ? 1.0f : v;
+        }
+    }
+    else
+    {
+        uint8_t *p = (uint8_t*) image.Pixels + a;
+        for (size_t i = 0; i < n; ++i, p += nch)
+        {
+            float v = float(*p) * scale + 0.5f;
+            *p = v >= 255.0f ? 255 : uint8_t(v);
+        }
+    }
+}
+
+/// @summary Determines whether alpha-coverage preservation applies to an image.
+/// @param params Image processing parameters.
+/// @param image The image being processed.
+/// @return true if an alpha test reference is set and the image has alpha.
+static bool preserve_coverage(dds_params_t const &params, image_info_t const &image)
+{
+    return params.AlphaTestReference > 0.0f && alpha_channel(image) >= 0;
+}
+
+/// @summary Computes the fraction of an image's texels that pass the alpha test.
+/// @param params Image processing parameters specifying the reference value.
+/// @param image The image to examine. Must have an alpha channel.
+/// @return The coverage fraction, in [0, 1].
+static float image_coverage(dds_params_t const &params, image_info_t const &image)
+{
+    uint32_t hist[ALPHA_HISTOGRAM_BINS];
+    memset(hist, 0, sizeof(hist));
+    alpha_histogram(image, hist);
+    return alpha_coverage(hist, params.AlphaTestReference, 1.0f);
+}
+
+/// @summary Scales the alpha values of a mip level so that it passes the alpha
+/// test over the given fraction of its area.
+/// @param params Image processing parameters specifying the reference value.
+/// @param image The mip level to modify. Must have an alpha channel.
+/// @param coverage The coverage fraction to preserve.
+static void apply_coverage(dds_params_t const &params, image_info_t &image, float coverage)
+{
+    uint32_t hist[ALPHA_HISTOGRAM_BINS];
+    memset(hist, 0, sizeof(hist));
+    alpha_histogram(image, hist);
+    scale_alpha(image, find_alpha_scale(hist, params.AlphaTestReference, coverage));
+}
+
+/// @summary Calculates the width, height or depth of a mipmap level.
+/// @param dimension The dimension of the highest-resolution level.
+/// @param level The zero-based index of the mipmap level.
+/// @return The dimension of the level, which is always at least one.
+static inline size_t level_dimension(size_t dimension, size_t level)
+{
+    size_t d = dimension >> level;
+    return d > 0 ? d : 1;
+}
+
+/// @summary Calculates the working memory stb_image_resize allocates for one
+/// resample, using the same setup as stbir_resize_subpixel().
+/// @param params Image processing parameters specifying the filter.
+/// @param channels The number of channels per pixel.
+/// @param input_w The number of pixels per-row of the input.
+/// @param input_h The number of input rows.
+/// @param output_w The number of pixels per-row of the output.
+/// @param output_h The number of output rows.
+/// @param sx The horizontal scale factor.
+/// @param sy The vertical scale factor.
+/// @return The number of bytes allocated by the resample.
+static size_t resize_scratch_size(dds_params_t const &params, int channels, size_t input_w, size_t input_h, size_t output_w, size_t output_h, float sx, float sy)
+{
+    stbir__info  info;
+    stbir_filter filter = resize_filter(params);
+    float        transform[4] = { sx, sy, 0.0f, 0.0f };
+    stbir__setup(&info, int(input_w), int(input_h), int(output_w), int(output_h), channels);
+    stbir__calculate_transform(&info, 0.0f, 0.0f, 1.0f, 1.0f, transform);
+    stbir__choose_filter(&info, filter, filter);
+    return size_t(stbir__calculate_memory(&info));
+}
+
+/// @summary Calculates the number of rows of the previous level read to
+/// generate a strip of a level, including the halo on either side.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels. Must be at least 1.
+/// @param nrows The number of rows in the strip.
+/// @return The number of rows of the previous level read.
+static size_t strip_span(strip_chain_t const *chain, size_t level, size_t nrows)
+{
+    strip_level_t const &in = chain->Levels[level - 1];
+    strip_level_t const &lv = chain->Levels[level];
+    size_t span = size_t(ceil(double(nrows) * double(in.Height) / double(lv.Height))) + 2 * lv.Halo + 2;
+    size_t most = in.Height + 2 * lv.Halo;
+    return span < most ? span : most;
+}
+
+/// @summary Calculates the number of rows the window of a level must hold: the
+/// rows read by one strip of the next level, plus the strip being generated.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels.
+/// @param nrows The number of rows per strip.
+/// @return The number of rows, or zero if the level needs no window.
+static size_t strip_window_rows(strip_chain_t const *chain, size_t level, size_t nrows)
+{
+    strip_level_t const &lv = chain->Levels[level];
+    if (lv.Resident || level + 1 >= chain->LevelCount)
+        return 0;
+
+    size_t next = chain->Levels[level + 1].Height;
+    size_t rows = strip_span(chain, level + 1, nrows < next ? nrows : next) + (nrows < lv.Height ? nrows : lv.Height);
+    return rows < lv.Height ? rows : lv.Height;
+}
+
+/// @summary Calculates the working memory used to generate a chain in strips:
+/// the window and head rows of each level, and the gather buffer, resampler
+/// memory and encoder buffers of each level, which the scratch pool keeps once
+/// they have been used. The decoded source image is not included.
+/// @param chain The chain being generated.
+/// @param nrows The number of rows per strip.
+/// @return The working memory, in bytes.
+static size_t strip_chain_size(strip_chain_t const *chain, size_t nrows)
+{
+    dds_params_t const &params   = *chain->Params;
+    image_info_t const &source   = *chain->Source;
+    bool                coverage = preserve_coverage(params, source);
+    size_t              total    = 0;
+    for (size_t i = 1; i < chain->LevelCount; ++i)
+    {
+        strip_level_t const &in = chain->Levels[i - 1];
+        strip_level_t const &lv = chain->Levels[i];
+        size_t n = nrows < lv.Height ? nrows : lv.Height;
+        size_t m = n > lv.Deferred ? n : lv.Deferred;
+        total   += scratch_block_size(strip_window_rows(chain, i, nrows) * lv.Stride);
+        total   += scratch_block_size(lv.HeadRows * lv.Stride);
+        if (!lv.Resident)
+        {   // the largest strip is gathered, resampled, and for the last level
+            // or the deferred rows, generated into a buffer of its own.
+            size_t span = strip_span(chain, i, m);
+            float  sx   = float(double(lv.Width ) / double(in.Width ));
+            float  sy   = float(double(lv.Height) / double(in.Height));
+            total += scratch_block_size(span * in.Stride);
+            total += scratch_block_size(resize_scratch_size(params, source.Channels, in.Width, span, lv.Width, m, sx, sy));
+            total += scratch_block_size(m * lv.Stride);
+        }
+        if (coverage) total += scratch_block_size(n * lv.Stride);
+        if (params.RdoLambda > 0.0f) total += scratch_block_size(params.RdoWindow * 16);
+        total += 2 * scratch_block_size(lv.Pitch);
+    }
+    return total;
+}
+
+/// @summary Calculates the number of rows to generate per strip so that the
+/// working memory of the whole chain fits within the memory limit.
+/// @param chain The chain being generated.
+/// @return The number of rows per strip, always a multiple of four.
+static size_t strip_rows(strip_chain_t const *chain)
+{
+    size_t const limit = chain->Params->MemoryLimit;
+    size_t lo = 4;
+    size_t hi = (chain->Levels[1].Height + 3) & ~size_t(3);
+    if (strip_chain_size(chain, hi) <= limit)
+        return hi;
+    while (hi - lo > 4)
+    {   // the working memory grows with the strip height.
+        size_t mid = ((lo + hi) / 2) & ~size_t(3);
+        if (strip_chain_size(chain, mid) <= limit) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/// @summary Computes the dimensions, halo and output offset of every level of
+/// a chain generated in strips. With a wrapping edge, the first rows of a level
+/// read the last rows of the previous level, so they are deferred until that
+/// level is complete, and the first rows of the previous level are kept for
+/// the strips at the bottom edge and the deferred rows.
+/// @param chain The chain to initialize.
+/// @param params Image processing parameters.
+/// @param source The decoded source image.
+static void init_strip_levels(strip_chain_t *chain, dds_params_t const &params, image_info_t const &source)
+{
+    size_t nlevels = params.Mipmaps && params.MaxMipLevels > 1 ? params.MaxMipLevels : 1;
+    size_t bpc     = source.HDR ? sizeof(float) : sizeof(uint8_t);
+    size_t offset  = 0;
+    bool   bcn     = data::dds_block_compressed(params.Format);
+    bool   wrap    = params.EdgeMode == STBIR_EDGE_WRAP;
+    if (nlevels > MAX_MIP_LEVELS) nlevels = MAX_MIP_LEVELS;
+
+    memset(chain->Levels, 0, sizeof(chain->Levels));
+    chain->LevelCount = nlevels + 1;
+    for (size_t i = 0; i < chain->LevelCount; ++i)
+    {
+        strip_level_t &lv = chain->Levels[i];
+        lv.Width      = i == 0 ? size_t(source.Width ) : level_dimension(params.Width , i - 1);
+        lv.Height     = i == 0 ? size_t(source.Height) : level_dimension(params.Height, i - 1);
+        lv.Stride     = lv.Width * size_t(source.Channels) * bpc;
+        lv.Pitch      = data::dds_pitch(params.Format, lv.Width);
+        lv.AlphaScale = 1.0f;
+        if (i == 0 || (i == 1 && lv.Width == size_t(source.Width) && lv.Height == size_t(source.Height)))
+        {   // the source, and a base level that is not resized, are not generated.
+            lv.Resident = true;
+            lv.Window   = (uint8_t*) source.Pixels;
+            lv.Capacity = lv.Height;
+        }
+        if (i == 0) continue;
+
+        strip_level_t &in = chain->Levels[i - 1];
+        double const   sy = double(lv.Height) / double(in.Height);
+        lv.Offset = offset;
+        lv.Halo   = size_t(ceil(STRIP_FILTER_SUPPORT / (sy < 1.0 ? sy : 1.0))) + 1;
+        offset   += lv.Pitch * (bcn ? (lv.Height + 3) / 4 : lv.Height);
+        if (wrap && !in.Resident)
+        {   // regular strips start below the rows that wrap to the top edge.
+            size_t y = 0;
+            while (y < lv.Height && floor(double(y) / sy) - double(lv.Halo) < double(in.Deferred))
+                y += 4;
+            lv.Deferred = y < lv.Height ? y : lv.Height;
+            in.HeadRows = size_t(ceil(double(lv.Deferred) / sy)) + lv.Halo + 2;
+            if (in.HeadRows > in.Height) in.HeadRows = in.Height;
+        }
+    }
+    chain->DataSize = offset;
+}
+
+/// @summary Locates a row of a level among the rows still held for it.
+/// @param lv The level.
+/// @param row The zero-based index of the row.
+/// @return A pointer to the row, or NULL if it is no longer held.
+static uint8_t const* strip_level_row(strip_level_t const &lv, size_t row)
+{
+    if (row >= lv.First && row < lv.First + lv.Count)
+        return lv.Window + (row - lv.First) * lv.Stride;
+    if (row < lv.HeadRows)
+        return lv.Head + row * lv.Stride;
+    return NULL;
+}
+
+/// @summary Builds an image description for rows of a level.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels.
+/// @param rows The first row of pixels.
+/// @param nrows The number of rows.
+/// @return The image description. The image does not own its pixels.
+static image_info_t strip_image(strip_chain_t const *chain, size_t level, uint8_t *rows, size_t nrows)
+{
+    image_info_t strip;
+    strip.Pool     = NULL;
+    strip.Pixels   = rows;
+    strip.Width    = int(chain->Levels[level].Width);
+    strip.Height   = int(nrows);
+    strip.Channels = chain->Source->Channels;
+    strip.Format   = chain->Source->Format;
+    strip.HDR      = chain->Source->HDR;
+    return strip;
+}
+
+/// @summary Makes room at the end of the window of a level for a new strip, 
+/// discarding the rows that the next level no longer reads. The rows that a
+/// wrapping edge of the next level reads last are always kept.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels.
+/// @param nrows The number of rows in the new strip.
+/// @return A pointer to the first row of the new strip, or NULL.
+static uint8_t* reserve_strip_rows(strip_chain_t *chain, size_t level, size_t nrows)
+{
+    strip_level_t       &lv   = chain->Levels[level];
+    strip_level_t const &next = chain->Levels[level + 1];
+    if (lv.Count + nrows > lv.Capacity)
+    {
+        double sy   = double(next.Height) / double(lv.Height);
+        double keep = floor(double(next.Next) / sy) - double(next.Halo);
+        double tail = double(lv.Height) - double(next.Halo) - 1.0;
+        if (keep > tail) keep = tail;
+        if (keep > double(lv.First))
+        {
+            size_t drop = size_t(keep) - lv.First;
+            if (drop > lv.Count) drop = lv.Count;
+            memmove(lv.Window, lv.Window + drop * lv.Stride, (lv.Count - drop) * lv.Stride);
+            lv.First += drop;
+            lv.Count -= drop;
+        }
+    }
+    if (lv.Count + nrows > lv.Capacity)
+    {
+        fprintf(chain->Errors, "ERROR: The strip window of level %u is full.\n", unsigned(level - 1));
+        return NULL;
+    }
+    return lv.Window + lv.Count * lv.Stride;
+}
+
+/// @summary Resamples one strip of a level from only the rows of the previous
+/// level it depends on, plus a halo of rows covering the filter support.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels. Must be at least 1.
+/// @param y0 The first row of the strip.
+/// @param y1 The row following the last row of the strip.
+/// @param dst The buffer that receives the strip.
+/// @return true if the strip was generated.
+static bool generate_strip(strip_chain_t *chain, size_t level, size_t y0, size_t y1, uint8_t *dst)
+{
+    dds_params_t  const &params = *chain->Params;
+    image_info_t  const &source = *chain->Source;
+    strip_level_t const &in     = chain->Levels[level - 1];
+    strip_level_t const &lv     = chain->Levels[level];
+    double        const  sx     = double(lv.Width ) / double(in.Width );
+    double        const  sy     = double(lv.Height) / double(in.Height);
+    ptrdiff_t     const  h      = ptrdiff_t(in.Height);
+    stbir_edge       const edge   = stbir_edge(params.EdgeMode);
+    stbir_filter     const filter = resize_filter(params);
+    stbir_colorspace const space  = filter_srgb(params, source) ? STBIR_COLORSPACE_SRGB : STBIR_COLORSPACE_LINEAR;
+
+    // determine the rows of the previous level, including halo, that contribute to the strip.
+    ptrdiff_t r0 = ptrdiff_t(floor(double(y0) / sy)) - ptrdiff_t(lv.Halo);
+    ptrdiff_t r1 = ptrdiff_t( ceil(double(y1) / sy)) + ptrdiff_t(lv.Halo);
+    if (edge == STBIR_EDGE_CLAMP)
+    {   // stb_image_resize clamps to the first and last rows itself.
+        if (r0 < 0) r0 = 0;
+        if (r1 > h) r1 = h;
+    }
+
+    uint8_t const *rows = NULL;
+    uint8_t       *temp = NULL;
+    if (r0 >= ptrdiff_t(in.First) && r1 <= ptrdiff_t(in.First + in.Count))
+    {   // the rows are held, in order, in the window of the previous level.
+        rows = in.Window + size_t(r0 - ptrdiff_t(in.First)) * in.Stride;
+    }
+    else
+    {   // the halo extends past the image, or the rows are split between the
+        // head and window; gather the wrapped or reflected rows so that the
+        // strip is filtered exactly as if the whole level were resized at once.
+        size_t nbytes = size_t(r1 - r0) * in.Stride;
+        if ((temp = (uint8_t*) scratch_alloc(chain->Pool, nbytes)) == NULL)
+        {
+            fprintf(chain->Errors, "ERROR: Unable to allocate %u bytes for strip halo.\n", unsigned(nbytes));
+            return false;
+        }
+        for (ptrdiff_t r = r0; r < r1; ++r)
+        {   // a halo taller than the level reflects past the far edge; clamp it.
+            int            src = stbir__edge_wrap(edge, int(r), int(h));
+            uint8_t const *row = strip_level_row(in, size_t(src < int(h) ? src : int(h) - 1));
+            if (row == NULL)
+            {
+                fprintf(chain->Errors, "ERROR: Row %d of the input to level %u is no longer available.\n", int(r), unsigned(level - 1));
+                scratch_free(chain->Pool, temp);
+                return false;
+            }
+            memcpy(temp + size_t(r - r0) * in.Stride, row, in.Stride);
+        }
+        rows = temp;
+    }
+
+    // the vertical shift maps strip row 0 onto level row y0 relative to input row r0.
+    int res = stbir_resize_subpixel(
+        rows, int(in.Width), int(r1 - r0), int(in.Stride),
+        dst, int(lv.Width), int(y1 - y0), 0,
+        source.HDR ? STBIR_TYPE_FLOAT : STBIR_TYPE_UINT8, source.Channels,
+        resize_alpha_channel(params, source), 0,
+        edge, temp != NULL ? STBIR_EDGE_CLAMP : edge, filter, filter, space, chain->Pool,
+        float(sx), float(sy), 0.0f, float(double(y0) - double(r0) * sy));
+    scratch_free(chain->Pool, temp);
+    if (!res)
+    {
+        fprintf(chain->Errors, "ERROR: Unable to resample rows %u-%u of level %u.\n", unsigned(y0), unsigned(y1 - 1), unsigned(level - 1));
+        return false;
+    }
+    if (params.NormalMap)
+    {   // filtering shortens the vectors.
+        image_info_t strip = strip_image(chain, level, dst, y1 - y0);
+        renormalize_normals(strip);
+    }
+    return true;
+}
+
+/// @summary Writes a strip of a level to its final position in the output
+/// stream, or during the measurement pass, adds its alpha values to the level
+/// histogram. Rows that fall within the head of the level are also kept.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels. Must be at least 1.
+/// @param y0 The first row of the strip.
+/// @param y1 The row following the last row of the strip.
+/// @param rows The rows of the strip. Alpha values are left unscaled.
+/// @return true if the strip was written.
+static bool push_strip(strip_chain_t *chain, size_t level, size_t y0, size_t y1, uint8_t *rows)
+{
+    strip_level_t &lv    = chain->Levels[level];
+    image_info_t   strip = strip_image(chain, level, rows, y1 - y0);
+    if (y0 < lv.HeadRows)
+    {   // keep the first rows for a wrapping edge of the next level.
+        size_t end = y1 < lv.HeadRows ? y1 : lv.HeadRows;
+        memcpy(lv.Head + y0 * lv.Stride, rows, (end - y0) * lv.Stride);
+    }
+    if (chain->Measure)
+    {   // this is a measurement pass; nothing is written.
+        alpha_histogram(strip, lv.Histogram);
+        return true;
+    }
+
+    size_t  nbytes = (y1 - y0) * lv.Stride;
+    bool    bcn    = data::dds_block_compressed(chain->Params->Format);
+    int64_t pos    = chain->DataStart + int64_t(lv.Offset + (bcn ? y0 / 4 : y0) * lv.Pitch);
+    if (lv.AlphaScale != 1.0f)
+    {   // the unscaled rows are cascaded into the next level.
+        if ((strip.Pixels = scratch_alloc(chain->Pool, nbytes)) == NULL)
+        {
+            fprintf(chain->Errors, "ERROR: Unable to allocate %u bytes for image strip.\n", unsigned(nbytes));
+            return false;
+        }
+        memcpy(strip.Pixels, rows, nbytes);
+        scale_alpha(strip, lv.AlphaScale);
+    }
+    bool res = data::file_seek(chain->Output, pos, SEEK_SET) && write_pixels(chain->Errors, chain->Output, chain->Pool, *chain->Params, strip);
+    if (strip.Pixels != rows) scratch_free(chain->Pool, strip.Pixels);
+    if (!res) fprintf(chain->Errors, "ERROR: Unable to write rows %u-%u of level %u.\n", unsigned(y0), unsigned(y1 - 1), unsigned(level - 1));
+    return res;
+}
+
+/// @summary Generates as many strips of a level as the rows generated so far
+/// for the previous level allow, writing each one and cascading it into the
+/// next level. Deferred leading rows are generated once the previous level is
+/// complete, which completes the level.
+/// @param chain The chain being generated.
+/// @param level The index of the level in chain->Levels. Must be at least 1.
+/// @return true if every strip generated was written.
+static bool advance_strip_level(strip_chain_t *chain, size_t level)
+{
+    strip_level_t       &lv   = chain->Levels[level];
+    strip_level_t const &in   = chain->Levels[level - 1];
+    double        const  sy   = double(lv.Height) / double(in.Height);
+    bool          const  last = level + 1 >= chain->LevelCount;
+    while (lv.Next < lv.Height)
+    {
+        size_t y0 = lv.Next;
+        size_t y1 = y0 + chain->StripRows < lv.Height ? y0 + chain->StripRows : lv.Height;
+        if (!in.Complete && ceil(double(y1) / sy) + double(lv.Halo) > double(in.First + in.Count))
+        {   // wait for more rows of the previous level.
+            return true;
+        }
+
+        size_t   nbytes = (y1 - y0) * lv.Stride;
+        uint8_t *rows   = last ? (uint8_t*) scratch_alloc(chain->Pool, nbytes) : reserve_strip_rows(chain, level, y1 - y0);
+        if (rows == NULL)
+        {
+            if (last) fprintf(chain->Errors, "ERROR: Unable to allocate %u bytes for image strip.\n", unsigned(nbytes));
+            return false;
+        }
+        bool res = generate_strip(chain, level, y0, y1, rows);
+        if (res && !last) lv.Count += y1 - y0;
+        lv.Next  = y1;
+        res = res && push_strip(chain, level, y0, y1, rows);
+        if (last) scratch_free(chain->Pool, rows);
+        if (!res || (!last && !advance_strip_level(chain, level + 1)))
+            return false;
+    }
+    if (lv.Complete || (lv.Deferred > 0 && !in.Complete))
+    {   // nothing more can be generated yet.
+        return true;
+    }
+    if (lv.Deferred > 0)
+    {   // the rows above the first regular strip wrap to the bottom of the previous level.
+        size_t   nbytes = lv.Deferred * lv.Stride;
+        uint8_t *rows   = (uint8_t*) scratch_alloc(chain->Pool, nbytes);
+        if (rows == NULL)
+        {
+            fprintf(chain->Errors, "ERROR: Unable to allocate %u bytes for image strip.\n", unsigned(nbytes));
+            return false;
+        }
+        bool res = generate_strip(chain, level, 0, lv.Deferred, rows) && push_strip(chain, level, 0, lv.Deferred, rows);
+        scratch_free(chain->Pool, rows);
+        if (!res) return false;
+    }
+    lv.Complete = true;
+    return last || advance_strip_level(chain, level + 1);
+}
+
+/// @summary Generates every level of a chain in strips and writes them to the
+/// output stream, or during the measurement pass, counts their alpha values.
+/// @param chain The chain to generate.
+/// @return true if the entire chain was generated.
+static bool run_strip_chain(strip_chain_t *chain)
+{
+    for (size_t i = 0; i < chain->LevelCount; ++i)
+    {
+        strip_level_t &lv = chain->Levels[i];
+        lv.Complete = lv.Resident;
+        lv.Next     = lv.Resident ? lv.Height : lv.Deferred;
+        lv.First    = lv.Resident ? 0 : lv.Deferred;
+        lv.Count    = lv.Resident ? lv.Height : 0;
+    }
+
+    strip_level_t &base = chain->Levels[1];
+    if (base.Resident)
+    {   // the base level is the source image, which is written as-is.
+        for (size_t y0 = 0; y0 < base.Height; y0 += chain->StripRows)
+        {
+            size_t y1 = y0 + chain->StripRows < base.Height ? y0 + chain->StripRows : base.Height;
+            if (!push_strip(chain, 1, y0, y1, base.Window + y0 * base.Stride))
+                return false;
+        }
+        if (chain->LevelCount > 2 && !advance_strip_level(chain, 2))
+            return false;
+    }
+    else if (!advance_strip_level(chain, 1))
+    {   // advance_strip_level() outputs error messages.
+        return false;
+    }
+    return chain->Levels[chain->LevelCount - 1].Complete;
+}
+
+/// @summary Generates the mipmap chain for an image in horizontal strips, and
+/// writes each strip to its final position in the DDS output stream as soon
+/// as it is complete. The base level is resampled from the source image, and
+/// each further level from a rolling window of rows of the level above it, so
+/// the working memory is bounded by the strip size rather than the level size.
+/// Preserving alpha coverage takes one additional measurement pass.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for strip buffers.
+/// @param params Image processing parameters.
+/// @param source The decoded source image.
+/// @return true if the entire mipchain was written to stream dds.
+static bool write_strip_chain(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t const &params, image_info_t const &source)
+{
+    strip_chain_t chain;
+    chain.Errors    = fp;
+    chain.Output    = dds;
+    chain.Pool      = pool;
+    chain.Params    = &params;
+    chain.Source    = &source;
+    chain.DataStart = data::file_tell(dds);
+    chain.Measure   = false;
+    init_strip_levels(&chain, params, source);
+    chain.StripRows = strip_rows(&chain);
+    if (strip_chain_size(&chain, chain.StripRows) > params.MemoryLimit)
+    {   // even the smallest strips do not fit; carry on regardless.
+        fprintf(fp, "WARNING: Generating the image in strips needs %u KB of working memory, more than the memory limit.\n", unsigned(strip_chain_size(&chain, chain.StripRows) / 1024));
+    }
+
+    bool res = true;
+    for (size_t i = 1; i < chain.LevelCount && res; ++i)
+    {
+        strip_level_t &lv = chain.Levels[i];
+        size_t window = strip_window_rows(&chain, i, chain.StripRows);
+        if (window > 0 && (lv.Window = (uint8_t*) scratch_alloc(pool, window * lv.Stride)) == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for strip window.\n", unsigned(window * lv.Stride));
+            res = false;
+        }
+        else if (lv.HeadRows > 0 && (lv.Head = (uint8_t*) scratch_alloc(pool, lv.HeadRows * lv.Stride)) == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for strip head.\n", unsigned(lv.HeadRows * lv.Stride));
+            res = false;
+        }
+        if (!lv.Resident) lv.Capacity = window;
+    }
+
+    if (res && preserve_coverage(params, source))
+    {   // the alpha scale of each level depends on the alpha values of the 
+        // whole level, so the chain is generated once without writing.
+        chain.Measure = true;
+        if ((res = run_strip_chain(&chain)) == true)
+        {
+            float target = alpha_coverage(chain.Levels[1].Histogram, params.AlphaTestReference, 1.0f);
+            for (size_t i = 2; i < chain.LevelCount; ++i)
+            {
+                chain.Levels[i].AlphaScale = find_alpha_scale(chain.Levels[i].Histogram, params.AlphaTestReference, target);
+            }
+        }
+        chain.Measure = false;
+    }
+
+    // leave the stream positioned after the chain.
+    res = res && run_strip_chain(&chain);
+    res = res && data::file_seek(dds, chain.DataStart + int64_t(chain.DataSize), SEEK_SET);
+    for (size_t i = 1; i < chain.LevelCount; ++i)
+    {
+        if (!chain.Levels[i].Resident) scratch_free(pool, chain.Levels[i].Window);
+        scratch_free(pool, chain.Levels[i].Head);
+    }
+    return res;
+}
+
+/// @summary Generates and writes to disk the mipmap chain for an image. This 
+/// function writes the base image first, followed by all sub-levels.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for resampled image buffers.
+/// @param params Image processing parameters.
+/// @param base_level A description of the highest-resolution image. If resizing
+/// is requested, or the image needs to be forced to power-of-two dimensions, 
+/// on return base_level will describe the resized image, and the original image
+/// described by base_level is freed.
+/// @return true if the entire mipchain was written to stream dds.
+static bool write_image_chain(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t const &params, image_info_t &base_level)
+{
+    if (base_level.Pixels == NULL)
+    {   // unable to load one of the source images.
+        return false;
+    }
+
+    if (params.MemoryLimit > 0)
+    {   // every level, including the base level, is generated strip-by-strip;
+        // no full-size level buffer is ever allocated.
+        return write_strip_chain(fp, dds, pool, params, base_level);
+    }
+
+    if (params.Width != params.BaseWidth || params.Height != params.BaseHeight)
+    {   // explicit resample requested, or we need to force power-of-two.
+        image_info_t out;
+        if (resize_image(fp, pool, params, out, base_level, params.Width, params.Height) == false)
+        {   // resize_image() outputs error messages.
+            return false;
+        }
+        free_image(base_level);
+        base_level = out;
+    }
+
+    // write the highest-resolution image.
+    if (!write_pixels(fp, dds, pool, params, base_level))
+        return false;
+
+    // the alpha-test coverage of the base level is preserved in each mip.
+    bool  coverage = preserve_coverage(params, base_level);
+    float target   = coverage ? image_coverage(params, base_level) : 0.0f;
+
+    // write any additional levels in the mipmap chain.
+    if (params.Mipmaps && params.MaxMipLevels > 1)
+    {   // always generate the miplevel from the high-resolution source.
+        for (size_t i = 1; i < params.MaxMipLevels; ++i)
+        {
+            size_t lw = params.Width  >> i;
+            size_t lh = params.Height >> i;
+            if (lw < 1) lw = 1;
+            if (lh < 1) lh = 1;
+
+            image_info_t mip;
+            if (resize_image(fp, pool, params, mip, base_level, lw, lh))
+            {   // write the mip-level to the output stream and delete it.
+                if (coverage) apply_coverage(params, mip, target);
+                bool res = write_pixels(fp, dds, pool, params, mip);
+                free_image(mip);
+                if (!res) return false;
+            }
+            else return false;
+        }
+    }
+    return true;
+}
+
+/// @summary Work item that loads one face of a cubemap.
+/// @param index The zero-based index of the face, in DDS face order.
+/// @param context Pointer to the cubemap_job_t.
+static void cubemap_load_work(size_t index, void *context)
+{
+    cubemap_job_t  *job  = (cubemap_job_t*) context;
+    cubemap_face_t &face = job->Faces[index];
+    face.Loaded = load_source(job->Errors, *job->Params, job->FirstSource + index, face.Image);
+}
+
+/// @summary Writes the mipmap chain of one face of a cubemap to a stream. The
+/// chain is either generated from the face image, or taken from the levels
+/// already generated by prefiltering.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the face chain will be written.
+/// @param pool The scratch pool used for resampled image buffers.
+/// @param params Image processing parameters.
+/// @param job The cubemap being written.
+/// @param face The face to write.
+/// @return true if the entire face chain was written to stream dds.
+static bool write_face_chain(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t const &params, cubemap_job_t const &job, cubemap_face_t &face)
+{
+    if (job.Prefiltered)
+    {   // the base face and its levels have already been generated.
+        size_t nlevels = params.MaxMipLevels < MAX_MIP_LEVELS ? params.MaxMipLevels : MAX_MIP_LEVELS;
+        bool   res     = write_pixels(fp, dds, pool, params, face.Image);
+        for (size_t i = 1; i < nlevels && res; ++i)
+        {
+            res = write_pixels(fp, dds, pool, params, face.Levels[i]);
+        }
+        return res;
+    }
+    return write_image_chain(fp, dds, pool, params, face.Image);
+}
+
+/// @summary Work item that generates the mipmap chain for one face of a
+/// cubemap and encodes it into the face's temporary stream, so that faces can
+/// be encoded concurrently. Encoding error is recorded in the face's metrics
+/// job, keyed by offsets within the temporary stream.
+/// @param index The zero-based index of the face, in DDS face order.
+/// @param context Pointer to the cubemap_job_t.
+static void cubemap_write_work(size_t index, void *context)
+{
+    cubemap_job_t      *job    = (cubemap_job_t*) context;
+    cubemap_face_t     &face   = job->Faces[index];
+    dds_params_t const *params = job->Params;
+    dds_params_t       *local  = NULL;
+    if (face.Metrics != NULL)
+    {   // the face reports its error to its own metrics job.
+        if ((local = (dds_params_t*) malloc(sizeof(dds_params_t))) == NULL)
+        {
+            fprintf(job->Errors, "ERROR: Unable to allocate parameters for face %u.\n", unsigned(index));
+            return;
+        }
+        *local = *job->Params;
+        local->MetricsJob = face.Metrics;
+        params = local;
+    }
+    face.Written = write_face_chain(job->Errors, face.Stream, job->Pool, *params, *job, face);
+    free(local);
+}
+
+/// @summary Appends the entire contents of a stream to another stream.
+/// @param dst The stream to write.
+/// @param src The stream to read, which is read from the beginning.
+/// @param pool The scratch pool used for the copy buffer.
+/// @return true if every byte of src was written to dst.
+static bool append_stream(FILE *dst, FILE *src, scratch_pool_t *pool)
+{
+    size_t const nbytes = 64 * 1024;
+    uint8_t     *buffer = (uint8_t*) scratch_alloc(pool, nbytes);
+    int64_t      size   = data::file_tell(src);
+    int64_t      copied = 0;
+    bool         res    = buffer != NULL && size >= 0 && data::file_seek(src, 0, SEEK_SET);
+    while (res && copied < size)
+    {
+        size_t n = fread(buffer, 1, nbytes, src);
+        if (n == 0 || fwrite(buffer, 1, n, dst) != n)
+            res = false;
+        copied += int64_t(n);
+    }
+    scratch_free(pool, buffer);
+    return res && copied == size;
+}
+
+/// @summary Writes the mipmap chains of the six faces of a cubemap to the
+/// output stream, in DDS face order. When worker threads are available, each
+/// face is encoded concurrently into a temporary stream, and the streams are
+/// then appended to the output in order, so the output stream is only ever
+/// written sequentially. Otherwise, or if a temporary stream cannot be created,
+/// the faces are encoded directly into the output stream one after another.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param job The cubemap being written. The Written field of each face is set.
+static void write_cubemap_faces(FILE *fp, FILE *dds, cubemap_job_t &job)
+{
+    dds_params_t const &params = *job.Params;
+    metrics_job_t       metrics[6];
+    bool                streams = params.ThreadCount > 1;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        metrics[i].Samples  = NULL;
+        metrics[i].Count    = 0;
+        metrics[i].Capacity = 0;
+        mutex_init(&metrics[i].Mutex);
+        job.Faces[i].Metrics = params.MetricsJob != NULL ? &metrics[i] : NULL;
+        job.Faces[i].Stream  = streams ? tmpfile() : NULL;
+        job.Faces[i].Written = false;
+        if (job.Faces[i].Stream == NULL) streams = false;
+    }
+    if (streams)
+    {   // encode concurrently, then append the face chains in order. the error
+        // of each face is re-keyed by the offset of the face in the output.
+        parallel_for(params.ThreadCount, 6, cubemap_write_work, &job);
+        for (size_t i = 0; i < 6; ++i)
+        {
+            cubemap_face_t &face = job.Faces[i];
+            int64_t         base = data::file_tell(dds);
+            if (face.Written && !append_stream(dds, face.Stream, job.Pool))
+                face.Written = false;
+            for (size_t j = 0; face.Written && face.Metrics != NULL && j < face.Metrics->Count; ++j)
+            {
+                metrics_sample_t const &sample = face.Metrics->Samples[j];
+                face.Written = push_metrics(params.MetricsJob, base + sample.Offset, sample.Sums);
+            }
+            if (!face.Written)
+            {   // later faces would be written at the wrong offset.
+                break;
+            }
+        }
+    }
+    else
+    {   // encode each face directly into the output stream.
+        for (size_t i = 0; i < 6; ++i)
+        {
+            cubemap_face_t &face = job.Faces[i];
+            face.Metrics = NULL;
+            if ((face.Written = write_face_chain(fp, dds, job.Pool, params, job, face)) == false)
+                break;
+        }
+    }
+    for (size_t i = 0; i < 6; ++i)
+    {
+        if (job.Faces[i].Stream != NULL) fclose(job.Faces[i].Stream);
+        job.Faces[i].Stream  = NULL;
+        job.Faces[i].Metrics = NULL;
+        free(metrics[i].Samples);
+        mutex_delete(&metrics[i].Mutex);
+    }
+}
+
+/// @summary Computes the unnormalized direction through a point on a face of
+/// a cubemap, using the Direct3D face orientations.
+/// @param face The zero-based index of the face, in DDS face order (+X, -X,
+/// +Y, -Y, +Z, -Z).
+/// @param u The horizontal face coordinate, in [-1, 1], increasing rightward.
+/// @param v The vertical face coordinate, in [-1, 1], increasing downward.
+/// @param dir On return, stores the x, y and z components of the direction.
+static void cubemap_direction(size_t face, float u, float v, float dir[3])
+{
+    switch (face)
+    {
+        case 0: dir[0] =  1.0f; dir[1] =   -v; dir[2] =   -u; break;
+        case 1: dir[0] = -1.0f; dir[1] =   -v; dir[2] =    u; break;
+        case 2: dir[0] =     u; dir[1] = 1.0f; dir[2] =    v; break;
+        case 3: dir[0] =     u; dir[1] =-1.0f; dir[2] =   -v; break;
+        case 4: dir[0] =     u; dir[1] =   -v; dir[2] = 1.0f; break;
+        default:dir[0] =    -u; dir[1] =   -v; dir[2] =-1.0f; break;
+    }
+}
+
+#if MAKEDDS_SSE2
+/// @summary Loads a single texel of an image into the low lanes of a vector.
+/// Lanes beyond the channel count of the image are zero.
+/// @param image The source image.
+/// @param x The x-coordinate of the texel.
+/// @param y The y-coordinate of the texel.
+/// @return The texel value. LDR values are in [0, 255].
+static inline __m128 load_texel_ps(image_info_t const &image, size_t x, size_t y)
+{
+    size_t const nch = size_t(image.Channels);
+    size_t const ofs = (y * size_t(image.Width) + x) * nch;
+    if (image.HDR)
+    {
+        float const *p = (float const*) image.Pixels + ofs;
+        switch (nch)
+        {
+            case 1 : return _mm_load_ss(p);
+            case 2 : return _mm_castpd_ps(_mm_load_sd((double const*) p));
+            case 3 : return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((double const*) p)), _mm_load_ss(p + 2));
+            default: return _mm_loadu_ps(p);
+        }
+    }
+    else
+    {
+        uint8_t const *p    = (uint8_t const*) image.Pixels + ofs;
+        uint32_t       bits = 0;
+        memcpy(&bits, p, nch);
+        __m128i        z    = _mm_setzero_si128();
+        __m128i        v    = _mm_cvtsi32_si128(int(bits));
+        v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, z), z);
+        return _mm_cvtepi32_ps(v);
+    }
+}
+#else
+/// @summary Loads a single texel of an image. Channels beyond the channel
+/// count of the image are zero.
+/// @param image The source image.
+/// @param x The x-coordinate of the texel.
+/// @param y The y-coordinate of the texel.
+/// @param out On return, stores the texel value. LDR values are in [0, 255].
+static inline void load_texel(image_info_t const &image, size_t x, size_t y, float out[4])
+{
+    size_t const nch = size_t(image.Channels);
+    size_t const ofs = (y * size_t(image.Width) + x) * nch;
+    for (size_t c = 0; c < 4; ++c)
+    {
+        if (c >= nch) out[c] = 0.0f;
+        else if (image.HDR) out[c] = ((float const*) image.Pixels)[ofs + c];
+        else out[c] = float(((uint8_t const*) image.Pixels)[ofs + c]);
+    }
+}
+#endif
+
+/// @summary Stores a single texel of an image, converting from the working
+/// representation returned by load_texel_ps() and sample_bilinear().
+/// @param image The destination image.
+/// @param x The x-coordinate of the texel.
+/// @param y The y-coordinate of the texel.
+/// @param value The texel value. LDR values are in [0, 255].
+/// @param scale A factor applied to each channel of value.
+static inline void store_texel(image_info_t &image, size_t x, size_t y, float const value[4], float scale)
+{
+    size_t const nch = size_t(image.Channels);
+    size_t const ofs = (y * size_t(image.Width) + x) * nch;
+    if (image.HDR)
+    {
+        float *p = (float*) image.Pixels + ofs;
+        for (size_t c = 0; c < nch; ++c) p[c] = value[c] * scale;
+    }
+    else
+    {
+        uint8_t *p = (uint8_t*) image.Pixels + ofs;
+        for (size_t c = 0; c < nch; ++c)
+        {
+            float val = value[c] * scale + 0.5f;
+            p[c] = val <= 0.0f ? 0 : (val >= 255.0f ? 255 : uint8_t(val));
+        }
+    }
+}
+
+/// @summary Bilinearly samples an image, clamping vertically and either
+/// wrapping or clamping horizontally. Wrapping is appropriate for the longitude
+/// axis of an equirectangular (latitude-longitude) map.
+/// @param image The source image.
+/// @param s The horizontal texture coordinate, in [0, 1].
+/// @param t The vertical texture coordinate, in [0, 1].
+/// @param wrap Specify true to wrap horizontally, or false to clamp.
+/// @param srgb Specify true to blend the color channels of LDR texels in linear
+/// light. The alpha channel of a four-channel image is always blended as-is.
+/// @param out On return, stores the filtered value. LDR values are in [0, 255].
+static void sample_bilinear(image_info_t const &image, float s, float t, bool wrap, bool srgb, float out[4])
+{
+    int   const w  = image.Width;
+    int   const h  = image.Height;
+    float const fx = s * float(w) - 0.5f;
+    float const fy = t * float(h) - 0.5f;
+    float const x0f= floorf(fx);
+    float const y0f= floorf(fy);
+    float const ax = fx - x0f;
+    float const ay = fy - y0f;
+    int         x0 = int(x0f);
+    int         x1 = x0 + 1;
+    if (wrap)
+    {
+        x0 = x0 % w; if (x0 < 0) x0 += w;
+        x1 = x0 + 1 < w ? x0 + 1 : 0;
+    }
+    else
+    {
+        x0 = x0 < 0 ? 0 : (x0 > w - 1 ? w - 1 : x0);
+        x1 = x1 < 0 ? 0 : (x1 > w - 1 ? w - 1 : x1);
+    }
+    int         y0 = int(y0f);
+    int         y1 = y0 + 1;
+    y0 = y0 < 0 ? 0 : (y0 > h - 1 ? h - 1 : y0);
+    y1 = y1 < 0 ? 0 : (y1 > h - 1 ? h - 1 : y1);
+    if (srgb && !image.HDR)
+    {   // convert the color channels of each tap to linear light, blend, and
+        // convert the result back, so sRGB texels are not darkened by the blend.
+        size_t const ncolor = image.Channels < 3 ? size_t(image.Channels) : 3;
+        int    const tx[4]  = { x0, x1, x0, x1 };
+        int    const ty[4]  = { y0, y0, y1, y1 };
+        float        tap[4][4];
+        for (size_t i = 0; i < 4; ++i)
+        {
+#if MAKEDDS_SSE2
+            _mm_storeu_ps(tap[i], load_texel_ps(image, size_t(tx[i]), size_t(ty[i])));
+#else
+            load_texel(image, size_t(tx[i]), size_t(ty[i]), tap[i]);
+#endif
+            for (size_t c = 0; c < ncolor; ++c)
+                tap[i][c] = stbir__srgb_uchar_to_linear_float[uint8_t(tap[i][c])];
+        }
+        for (size_t c = 0; c < 4; ++c)
+        {
+            float top = tap[0][c] + ax * (tap[1][c] - tap[0][c]);
+            float bot = tap[2][c] + ax * (tap[3][c] - tap[2][c]);
+            float val = top + ay * (bot - top);
+            out[c]    = c < ncolor ? float(stbir__linear_to_srgb_uchar(val)) : val;
+        }
+        return;
+    }
+#if MAKEDDS_SSE2
+    __m128 t00 = load_texel_ps(image, size_t(x0), size_t(y0));
+    __m128 t10 = load_texel_ps(image, size_t(x1), size_t(y0));
+    __m128 t01 = load_texel_ps(image, size_t(x0), size_t(y1));
+    __m128 t11 = load_texel_ps(image, size_t(x1), size_t(y1));
+    __m128 wx  = _mm_set1_ps(ax);
+    __m128 wy  = _mm_set1_ps(ay);
+    __m128 top = _mm_add_ps(t00, _mm_mul_ps(wx, _mm_sub_ps(t10, t00)));
+    __m128 bot = _mm_add_ps(t01, _mm_mul_ps(wx, _mm_sub_ps(t11, t01)));
+    _mm_storeu_ps(out, _mm_add_ps(top, _mm_mul_ps(wy, _mm_sub_ps(bot, top))));
+#else
+    float t00[4], t10[4], t01[4], t11[4];
+    load_texel(image, size_t(x0), size_t(y0), t00);
+    load_texel(image, size_t(x1), size_t(y0), t10);
+    load_texel(image, size_t(x0), size_t(y1), t01);
+    load_texel(image, size_t(x1), size_t(y1), t11);
+    for (size_t c = 0; c < 4; ++c)
+    {
+        float top = t00[c] + ax * (t10[c] - t00[c]);
+        float bot = t01[c] + ax * (t11[c] - t01[c]);
+        out[c]    = top + ay * (bot - top);
+    }
+#endif
+}
+
+/// @summary Work item that resamples a band of rows of one cubemap face from
+/// an equirectangular source image. The +Z face is centered on the middle of
+/// the source, and the top row of the source maps to +Y.
+/// @param index The work item index; face = index / bands, band = index % bands.
+/// @param context Pointer to the equirect_job_t.
+static void equirect_work(size_t index, void *context)
+{
+    equirect_job_t     *ctx  = (equirect_job_t*) context;
+    image_info_t const &src  = *ctx->Source;
+    size_t const        face = index / ctx->BandCount;
+    image_info_t       &dst  = ctx->Faces[face].Image;
+    size_t const        w    = size_t(dst.Width);
+    size_t const        h    = size_t(dst.Height);
+    size_t const        row0 = (index % ctx->BandCount) * PROJECTION_BAND_ROWS;
+    size_t const        row1 = row0 + PROJECTION_BAND_ROWS < h ? row0 + PROJECTION_BAND_ROWS : h;
+    float  const        pi   = 3.14159265358979323846f;
+
+    for (size_t y = row0; y < row1; ++y)
+    {
+        float v = 2.0f * (float(y) + 0.5f) / float(h) - 1.0f;
+        for (size_t x = 0; x < w; ++x)
+        {
+            float u = 2.0f * (float(x) + 0.5f) / float(w) - 1.0f;
+            float d[3], texel[4];
+            cubemap_direction(face, u, v, d);
+            float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            float s   = 0.5f + atan2f(d[0], d[2]) / (2.0f * pi);
+            float t   = acosf(d[1] / len) / pi;
+            sample_bilinear(src, s, t, true, ctx->Srgb, texel);
+            store_texel(dst, x, y, texel, 1.0f);
+        }
+    }
+}
+
+/// @summary Loads an equirectangular source image and projects it onto the six
+/// faces of a cubemap. If the parameters do not specify a face size, faces are
+/// one quarter of the source width.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param job The cubemap job. On return, the face images are set.
+/// @return true if all six faces were generated.
+static bool project_equirect(FILE *fp, cubemap_job_t &job)
+{
+    dds_params_t &params = *job.Params;
+    image_info_t  src;
+    if (!load_source(fp, params, job.FirstSource, src))
+    {
+        fprintf(fp, "ERROR: Unable to load equirectangular source \'%s\'.\n", params.SourceFiles[job.FirstSource]);
+        return false;
+    }
+    if (src.Width != 2 * src.Height)
+    {
+        fprintf(fp, "WARNING: Equirectangular source \'%s\' is %dx%d; expected a 2:1 aspect ratio.\n", params.SourceFiles[job.FirstSource], src.Width, src.Height);
+    }
+    if (params.Width == 0 && params.Height == 0)
+    {   // default to a face size that roughly preserves the source resolution.
+        params.Width  = src.Width / 4 > 0 ? size_t(src.Width / 4) : 1;
+    }
+    if (params.Width  == 0) params.Width  = params.Height;
+    if (params.Height == 0) params.Height = params.Width;
+
+    size_t bpc    = src.HDR ? sizeof(float) : sizeof(uint8_t);
+    size_t nbytes = params.Width * params.Height * size_t(src.Channels) * bpc;
+    bool   res    = true;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        image_info_t &face = job.Faces[i].Image;
+        face.Pool     = job.Pool;
+        face.Pixels   = scratch_alloc(job.Pool, nbytes);
+        face.Width    = int(params.Width);
+        face.Height   = int(params.Height);
+        face.Channels = src.Channels;
+        face.Format   = src.Format;
+        face.HDR      = src.HDR;
+        if (face.Pixels == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for cubemap face %u.\n", unsigned(nbytes), unsigned(i));
+            res = false;
+        }
+    }
+    if (res)
+    {
+        equirect_job_t ctx;
+        ctx.Source    = &src;
+        ctx.Faces     = job.Faces;
+        ctx.BandCount = (params.Height + PROJECTION_BAND_ROWS - 1) / PROJECTION_BAND_ROWS;
+        ctx.Srgb      = filter_srgb(params, src);
+        parallel_for(params.ThreadCount, 6 * ctx.BandCount, equirect_work, &ctx);
+        for (size_t i = 0; i < 6; ++i)
+        {
+            job.Faces[i].Loaded = true;
+        }
+    }
+    free_image(src);
+    return res;
+}
+
+/// @summary Determines the cubemap face and face coordinates that a direction
+/// passes through. This is the inverse of cubemap_direction().
+/// @param dir The x, y and z components of the direction. Need not be normalized.
+/// @param u On return, the horizontal face coordinate, in [-1, 1].
+/// @param v On return, the vertical face coordinate, in [-1, 1].
+/// @return The zero-based index of the face, in DDS face order.
+static size_t cubemap_face_uv(float const dir[3], float &u, float &v)
+{
+    float ax = fabsf(dir[0]);
+    float ay = fabsf(dir[1]);
+    float az = fabsf(dir[2]);
+    if (ax >= ay && ax >= az)
+    {
+        u = (dir[0] > 0.0f ? -dir[2] : dir[2]) / ax;
+        v = -dir[1] / ax;
+        return dir[0] > 0.0f ? 0 : 1;
+    }
+    if (ay >= az)
+    {
+        u = dir[0] / ay;
+        v = (dir[1] > 0.0f ? dir[2] : -dir[2]) / ay;
+        return dir[1] > 0.0f ? 2 : 3;
+    }
+    u = (dir[2] > 0.0f ? dir[0] : -dir[0]) / az;
+    v = -dir[1] / az;
+    return dir[2] > 0.0f ? 4 : 5;
+}
+
+/// @summary Locates the texel that a texel outside the bounds of a cubemap
+/// face maps to on an adjacent face, using the edge-adjacency table. Texels
+/// beyond a corner are taken from the edge they are furthest past.
+/// @param face The zero-based index of the face, in DDS face order.
+/// @param size The width and height of the face, in texels.
+/// @param x The x-coordinate of the texel, which may be outside the face.
+/// @param y The y-coordinate of the texel, which may be outside the face.
+/// @param out_x On return, the x-coordinate of the texel on the returned face.
+/// @param out_y On return, the y-coordinate of the texel on the returned face.
+/// @return The zero-based index of the face containing the texel.
+static size_t cubemap_border_texel(size_t face, ptrdiff_t size, ptrdiff_t x, ptrdiff_t y, ptrdiff_t &out_x, ptrdiff_t &out_y)
+{
+    ptrdiff_t dx = x < 0 ? -x : (x >= size ? x - size + 1 : 0);
+    ptrdiff_t dy = y < 0 ? -y : (y >= size ? y - size + 1 : 0);
+    if (dx == 0 && dy == 0)
+    {   // the texel is inside the face.
+        out_x = x;
+        out_y = y;
+        return face;
+    }
+
+    size_t    edge;
+    ptrdiff_t depth;  // the zero-based distance past the edge.
+    ptrdiff_t along;  // the position along the edge.
+    if (dx >= dy)
+    {
+        edge  = x < 0 ? CUBEMAP_EDGE_LEFT : CUBEMAP_EDGE_RIGHT;
+        depth = dx - 1;
+        along = y;
+    }
+    else
+    {
+        edge  = y < 0 ? CUBEMAP_EDGE_TOP : CUBEMAP_EDGE_BOTTOM;
+        depth = dy - 1;
+        along = x;
+    }
+    if (along < 0) along = 0;
+    if (along > size - 1) along = size - 1;
+    if (depth > size - 1) depth = size - 1;
+
+    uint8_t const *adj = CUBEMAP_ADJACENCY[face][edge];
+    if (adj[2]) along  = size - 1 - along;
+    switch (adj[1])
+    {
+        case CUBEMAP_EDGE_LEFT  : out_x = depth;            out_y = along;            break;
+        case CUBEMAP_EDGE_RIGHT : out_x = size - 1 - depth; out_y = along;            break;
+        case CUBEMAP_EDGE_TOP   : out_x = along;            out_y = depth;            break;
+        default                 : out_x = along;            out_y = size - 1 - depth; break;
+    }
+    return size_t(adj[0]);
+}
+
+/// @summary Computes the van der Corput radical inverse of an integer in base
+/// 2, used to generate the Hammersley point set.
+/// @param bits The integer value.
+/// @return The radical inverse, in [0, 1).
+static float radical_inverse(uint32_t bits)
+{
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+    bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+    bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+    bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+    return float(bits) * 2.3283064365386963e-10f;
+}
+
+/// @summary Generates the importance samples used to prefilter one level of a
+/// cubemap with the GGX distribution. The view and normal directions are
+/// assumed equal, so the light directions in tangent space, their weights and
+/// their source mip levels are the same for every texel of the level.
+/// @param job The prefilter job. The sample arrays are populated.
+/// @param roughness The perceptual roughness of the level, in [0, 1].
+/// @param source_width The width of the base level of the source faces.
+static void init_ggx_samples(ggx_job_t *job, float roughness, size_t source_width)
+{
+    float const pi    = 3.14159265358979323846f;
+    float const a     = roughness * roughness;
+    float const a2    = a * a;
+    float const texel = 4.0f * pi / (6.0f * float(source_width) * float(source_width));
+    size_t      n     = 0;
+
+    for (size_t i = 0; i < GGX_SAMPLE_COUNT; ++i)
+    {
+        float xi0  = float(i) / float(GGX_SAMPLE_COUNT);
+        float xi1  = radical_inverse(uint32_t(i));
+        float phi  = 2.0f * pi * xi0;
+        float cos_t= sqrtf((1.0f - xi1) / (1.0f + (a2 - 1.0f) * xi1));
+        float sin_t= sqrtf(1.0f - cos_t * cos_t);
+        float hx   = sin_t * cosf(phi);
+        float hy   = sin_t * sinf(phi);
+        float hz   = cos_t;
+        // reflect the view direction (0, 0, 1) about the half vector.
+        float lx   = 2.0f * hz * hx;
+        float ly   = 2.0f * hz * hy;
+        float lz   = 2.0f * hz * hz - 1.0f;
+        if (lz <= 0.0f) continue;
+
+        // choose the source level whose texels subtend the sample's solid angle.
+        float d    = (hz * hz) * (a2 - 1.0f) + 1.0f;
+        float pdf  = a2 / (pi * d * d) * 0.25f;
+        float omega= 1.0f / (float(GGX_SAMPLE_COUNT) * pdf + 1.0e-6f);
+        float lod  = a > 0.0f ? 0.5f * log2f(omega / texel) + 1.0f : 0.0f;
+        job->Lx [n] = lx;
+        job->Ly [n] = ly;
+        job->Lz [n] = lz;
+        job->W  [n] = lz;
+        job->Lod[n] = lod < 0.0f ? 0.0f : lod;
+        n++;
+    }
+    job->SampleCount = n;
+    while (n & 3)
+    {   // pad to a multiple of four with zero-weight samples.
+        job->Lx[n] = 0.0f; job->Ly[n] = 0.0f; job->Lz[n] = 1.0f;
+        job->W [n] = 0.0f; job->Lod[n]= 0.0f;
+        n++;
+    }
+    job->PaddedCount = n;
+}
+
+/// @summary Bilinearly samples one level of the source cubemap chain at a
+/// point on a face. Taps beyond the edges of a square face are read from the
+/// adjacent faces, so the result is continuous across face edges.
+/// @param job The prefilter job providing the source chain.
+/// @param face The zero-based index of the face, in DDS face order.
+/// @param level The zero-based index of the source level.
+/// @param s The horizontal texture coordinate on the face, in [0, 1].
+/// @param t The vertical texture coordinate on the face, in [0, 1].
+/// @param out On return, stores the filtered value.
+static void sample_cubemap_bilinear(ggx_job_t const *job, size_t face, size_t level, float s, float t, float out[4])
+{
+    image_info_t const &image = job->Sources[face][level];
+    ptrdiff_t    const  n     = ptrdiff_t(image.Width);
+    float        const  fx    = s * float(n) - 0.5f;
+    float        const  fy    = t * float(n) - 0.5f;
+    ptrdiff_t    const  x0    = ptrdiff_t(floorf(fx));
+    ptrdiff_t    const  y0    = ptrdiff_t(floorf(fy));
+    if (image.Width != image.Height || (x0 >= 0 && y0 >= 0 && x0 + 1 < n && y0 + 1 < n))
+    {   // all four taps are inside the face.
+        sample_bilinear(image, s, t, false, false, out);
+        return;
+    }
+
+    float tap[4][4];
+    for (size_t i = 0; i < 4; ++i)
+    {
+        ptrdiff_t sx, sy;
+        size_t    f = cubemap_border_texel(face, n, x0 + ptrdiff_t(i & 1), y0 + ptrdiff_t(i >> 1), sx, sy);
+#if MAKEDDS_SSE2
+        _mm_storeu_ps(tap[i], load_texel_ps(job->Sources[f][level], size_t(sx), size_t(sy)));
+#else
+        load_texel(job->Sources[f][level], size_t(sx), size_t(sy), tap[i]);
+#endif
+    }
+    float ax = fx - float(x0);
+    float ay = fy - float(y0);
+    for (size_t c = 0; c < 4; ++c)
+    {
+        float top = tap[0][c] + ax * (tap[1][c] - tap[0][c]);
+        float bot = tap[2][c] + ax * (tap[3][c] - tap[2][c]);
+        out[c]    = top + ay * (bot - top);
+    }
+}
+
+/// @summary Trilinearly samples the source cubemap chain in a given direction.
+/// Samples near a face edge are filtered across the edge, so the prefiltered
+/// levels do not show seams where the source levels are only a few texels wide.
+/// @param job The prefilter job providing the source chain.
+/// @param dir The x, y and z components of the sample direction.
+/// @param lod The source mip level to sample.
+/// @param out On return, stores the filtered value.
+static void sample_cubemap_lod(ggx_job_t const *job, float const dir[3], float lod, float out[4])
+{
+    float  u, v, a[4], b[4];
+    size_t face = cubemap_face_uv(dir, u, v);
+    float  maxl = float(job->SourceLevels - 1);
+    if (lod > maxl) lod = maxl;
+    size_t l0   = size_t(lod);
+    size_t l1   = l0 + 1 < job->SourceLevels ? l0 + 1 : l0;
+    float  f    = lod - float(l0);
+    float  s    = 0.5f * (u + 1.0f);
+    float  t    = 0.5f * (v + 1.0f);
+    sample_cubemap_bilinear(job, face, l0, s, t, a);
+    if (f <= 0.0f || l1 == l0)
+    {
+        out[0] = a[0]; out[1] = a[1]; out[2] = a[2]; out[3] = a[3];
+        return;
+    }
+    sample_cubemap_bilinear(job, face, l1, s, t, b);
+    for (size_t c = 0; c < 4; ++c)
+    {
+        out[c] = a[c] + f * (b[c] - a[c]);
+    }
+}
+
+/// @summary Work item that prefilters a band of rows of one face of a cubemap
+/// level by convolving the source chain with the GGX distribution.
+/// @param index The work item index; face = index / bands, band = index % bands.
+/// @param context Pointer to the ggx_job_t.
+static void ggx_work(size_t index, void *context)
+{
+    ggx_job_t    *ctx  = (ggx_job_t*) context;
+    size_t const  face = index / ctx->BandCount;
+    image_info_t &dst  = ctx->Faces[face].Levels[ctx->Level];
+    size_t const  w    = size_t(dst.Width);
+    size_t const  h    = size_t(dst.Height);
+    size_t const  row0 = (index % ctx->BandCount) * PROJECTION_BAND_ROWS;
+    size_t const  row1 = row0 + PROJECTION_BAND_ROWS < h ? row0 + PROJECTION_BAND_ROWS : h;
+
+    for (size_t y = row0; y < row1; ++y)
+    {
+        float v = 2.0f * (float(y) + 0.5f) / float(h) - 1.0f;
+        for (size_t x = 0; x < w; ++x)
+        {
+            float u = 2.0f * (float(x) + 0.5f) / float(w) - 1.0f;
+            float n[3], t[3], b[3];
+            cubemap_direction(face, u, v, n);
+            float len = 1.0f / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            n[0] *= len; n[1] *= len; n[2] *= len;
+
+            // build an orthonormal basis around the normal.
+            float up[3] = { 0.0f, 0.0f, 1.0f };
+            if (fabsf(n[2]) > 0.999f) { up[0] = 1.0f; up[2] = 0.0f; }
+            t[0] = up[1] * n[2] - up[2] * n[1];
+            t[1] = up[2] * n[0] - up[0] * n[2];
+            t[2] = up[0] * n[1] - up[1] * n[0];
+            len  = 1.0f / sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+            t[0]*= len; t[1] *= len; t[2] *= len;
+            b[0] = n[1] * t[2] - n[2] * t[1];
+            b[1] = n[2] * t[0] - n[0] * t[2];
+            b[2] = n[0] * t[1] - n[1] * t[0];
+
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float wsum   = 0.0f;
+            for (size_t k = 0; k < ctx->PaddedCount; k += 4)
+            {   // rotate four tangent-space sample directions into world space.
+                float dx[4], dy[4], dz[4];
+#if MAKEDDS_SSE2
+                __m128 lx = _mm_loadu_ps(&ctx->Lx[k]);
+                __m128 ly = _mm_loadu_ps(&ctx->Ly[k]);
+                __m128 lz = _mm_loadu_ps(&ctx->Lz[k]);
+                _mm_storeu_ps(dx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, _mm_set1_ps(t[0])), _mm_mul_ps(ly, _mm_set1_ps(b[0]))), _mm_mul_ps(lz, _mm_set1_ps(n[0]))));
+                _mm_storeu_ps(dy, _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, _mm_set1_ps(t[1])), _mm_mul_ps(ly, _mm_set1_ps(b[1]))), _mm_mul_ps(lz, _mm_set1_ps(n[1]))));
+                _mm_storeu_ps(dz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, _mm_set1_ps(t[2])), _mm_mul_ps(ly, _mm_set1_ps(b[2]))), _mm_mul_ps(lz, _mm_set1_ps(n[2]))));
+#else
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    dx[j] = ctx->Lx[k+j] * t[0] + ctx->Ly[k+j] * b[0] + ctx->Lz[k+j] * n[0];
+                    dy[j] = ctx->Lx[k+j] * t[1] + ctx->Ly[k+j] * b[1] + ctx->Lz[k+j] * n[1];
+                    dz[j] = ctx->Lx[k+j] * t[2] + ctx->Ly[k+j] * b[2] + ctx->Lz[k+j] * n[2];
+                }
+#endif
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    float wt = ctx->W[k+j];
+                    if (wt <= 0.0f) continue;
+                    float d[3] = { dx[j], dy[j], dz[j] }, texel[4];
+                    sample_cubemap_lod(ctx, d, ctx->Lod[k+j], texel);
+                    sum[0] += texel[0] * wt; sum[1] += texel[1] * wt;
+                    sum[2] += texel[2] * wt; sum[3] += texel[3] * wt;
+                    wsum   += wt;
+                }
+            }
+            float scale = wsum > 0.0f ? 1.0f / wsum : 0.0f;
+            store_texel(dst, x, y, sum, scale);
+        }
+    }
+}
+
+/// @summary Replaces the mipmap chain of a cubemap with levels prefiltered by
+/// the GGX distribution, at a roughness increasing linearly from 0 at the base
+/// level to 1 at the last level. The base faces are resampled to the output
+/// dimensions, and a plain mip chain of the faces is used as the source so
+/// that wide lobes can be integrated with few samples.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param job The cubemap job. On return, the face levels are set.
+/// @return true if every level of every face was generated.
+static bool prefilter_ggx(FILE *fp, cubemap_job_t &job)
+{
+    dds_params_t const &params  = *job.Params;
+    size_t              nlevels = params.MaxMipLevels < MAX_MIP_LEVELS ? params.MaxMipLevels : MAX_MIP_LEVELS;
+    ggx_job_t          *ctx     = (ggx_job_t*) malloc(sizeof(ggx_job_t));
+    bool                res     = true;
+    if (ctx == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate GGX prefilter state.\n");
+        return false;
+    }
+
+    // resample the base faces to the output dimensions, and build the source chain.
+    ctx->Faces        = job.Faces;
+    ctx->SourceLevels = 1;
+    for (size_t f = 0; f < 6; ++f)
+    {
+        for (size_t m = 0; m < MAX_MIP_LEVELS; ++m)
+        {
+            ctx->Sources[f][m].Pool   = NULL;
+            ctx->Sources[f][m].Pixels = NULL;
+        }
+    }
+    for (size_t f = 0; f < 6 && res; ++f)
+    {
+        image_info_t &face = job.Faces[f].Image;
+        if (size_t(face.Width) != params.Width || size_t(face.Height) != params.Height)
+        {
+            image_info_t out;
+            if (!resize_image(fp, job.Pool, params, out, face, params.Width, params.Height)) { res = false; break; }
+            free_image(face);
+            face = out;
+        }
+        ctx->Sources[f][0] = face;
+        for (size_t m = 1; m < MAX_MIP_LEVELS; ++m)
+        {
+            size_t lw = params.Width  >> m;
+            size_t lh = params.Height >> m;
+            if (lw == 0 && lh == 0) break;
+            if (lw < 1) lw = 1;
+            if (lh < 1) lh = 1;
+            if (!resize_image(fp, job.Pool, params, ctx->Sources[f][m], ctx->Sources[f][m-1], lw, lh)) { res = false; break; }
+            if (f == 0) ctx->SourceLevels = m + 1;
+        }
+    }
+
+    // allocate and generate each prefiltered level; level 0 is the base face.
+    for (size_t i = 1; i < nlevels && res; ++i)
+    {
+        size_t lw = params.Width  >> i; if (lw < 1) lw = 1;
+        size_t lh = params.Height >> i; if (lh < 1) lh = 1;
+        for (size_t f = 0; f < 6; ++f)
+        {
+            image_info_t const &base  = job.Faces[f].Image;
+            image_info_t       &level = job.Faces[f].Levels[i];
+            size_t              bpc   = base.HDR ? sizeof(float) : sizeof(uint8_t);
+            size_t              nbytes= lw * lh * size_t(base.Channels) * bpc;
+            level.Pool     = job.Pool;
+            level.Pixels   = scratch_alloc(job.Pool, nbytes);
+            level.Width    = int(lw);
+            level.Height   = int(lh);
+            level.Channels = base.Channels;
+            level.Format   = base.Format;
+            level.HDR      = base.HDR;
+            if (level.Pixels == NULL)
+            {
+                fprintf(fp, "ERROR: Unable to allocate %u bytes for prefiltered level %u.\n", unsigned(nbytes), unsigned(i));
+                res = false;
+            }
+        }
+        if (!res) break;
+
+        init_ggx_samples(ctx, float(i) / float(nlevels - 1), params.Width);
+        ctx->Level     = i;
+        ctx->BandCount = (lh + PROJECTION_BAND_ROWS - 1) / PROJECTION_BAND_ROWS;
+        parallel_for(params.ThreadCount, 6 * ctx->BandCount, ggx_work, ctx);
+    }
+
+    // release the source chain; level 0 is the face image itself.
+    for (size_t f = 0; f < 6; ++f)
+    {
+        for (size_t m = 1; m < MAX_MIP_LEVELS; ++m)
+        {
+            free_image(ctx->Sources[f][m]);
+        }
+    }
+    free(ctx);
+    job.Prefiltered = res;
+    return res;
+}
+
+/// @summary Retrieves a level of one face of a cubemap.
+/// @param job The cubemap job.
+/// @param face The zero-based index of the face, in DDS face order.
+/// @param level The zero-based index of the level. Level 0 is the face image.
+/// @return The face level.
+static inline image_info_t const& cubemap_level(cubemap_job_t const *job, size_t face, size_t level)
+{
+    return level == 0 ? job->Faces[face].Image : job->Faces[face].Levels[level];
+}
+
+/// @summary Work item that generates one level of one face of a cubemap. The
+/// previous level of the face is surrounded by a border of texels gathered
+/// from the previous level of the adjacent faces, and the bordered image is
+/// reduced so that the filter reads across the face edges. The previous level
+/// of every face is only read, so all faces are generated concurrently.
+/// @param index The zero-based index of the face, in DDS face order.
+/// @param context Pointer to the seamless_job_t.
+static void seamless_work(size_t index, void *context)
+{
+    seamless_job_t     *ctx    = (seamless_job_t*) context;
+    cubemap_job_t      *job    = ctx->Cube;
+    dds_params_t const &params = *job->Params;
+    image_info_t const &src    = cubemap_level(job, index, ctx->Level - 1);
+    image_info_t       &dst    = job->Faces[index].Levels[ctx->Level];
+    ptrdiff_t    const  n      = ptrdiff_t(src.Width);
+    ptrdiff_t    const  b      = ptrdiff_t(CUBEMAP_BORDER_TEXELS);
+    ptrdiff_t    const  bw     = n + 2 * b;
+    size_t       const  texel  = size_t(src.Channels) * (src.HDR ? sizeof(float) : sizeof(uint8_t));
+    size_t       const  nbytes = size_t(bw * bw) * texel;
+    uint8_t            *buffer = (uint8_t*) scratch_alloc(job->Pool, nbytes);
+    if (buffer == NULL)
+    {
+        fprintf(job->Errors, "ERROR: Unable to allocate %u bytes for bordered face %u.\n", unsigned(nbytes), unsigned(index));
+        ctx->Failed = true;
+        return;
+    }
+
+    for (ptrdiff_t y = -b; y < n + b; ++y)
+    {
+        uint8_t *row = buffer + size_t((y + b) * bw) * texel;
+        if (y >= 0 && y < n)
+        {   // copy the interior of the row, then gather the left and right borders.
+            memcpy(row + size_t(b) * texel, (uint8_t const*) src.Pixels + size_t(y * n) * texel, size_t(n) * texel);
+            for (ptrdiff_t x = -b; x < 0; ++x)
+            {
+                ptrdiff_t sx, sy;
+                image_info_t const &adj = cubemap_level(job, cubemap_border_texel(index, n, x, y, sx, sy), ctx->Level - 1);
+                memcpy(row + size_t(x + b) * texel, (uint8_t const*) adj.Pixels + size_t(sy * n + sx) * texel, texel);
+            }
+            for (ptrdiff_t x = n; x < n + b; ++x)
+            {
+                ptrdiff_t sx, sy;
+                image_info_t const &adj = cubemap_level(job, cubemap_border_texel(index, n, x, y, sx, sy), ctx->Level - 1);
+                memcpy(row + size_t(x + b) * texel, (uint8_t const*) adj.Pixels + size_t(sy * n + sx) * texel, texel);
+            }
+        }
+        else
+        {   // the entire row is in the top or bottom border.
+            for (ptrdiff_t x = -b; x < n + b; ++x)
+            {
+                ptrdiff_t sx, sy;
+                image_info_t const &adj = cubemap_level(job, cubemap_border_texel(index, n, x, y, sx, sy), ctx->Level - 1);
+                memcpy(row + size_t(x + b) * texel, (uint8_t const*) adj.Pixels + size_t(sy * n + sx) * texel, texel);
+            }
+        }
+    }
+
+    // the shift maps output texel 0 onto face texel 0, which is bordered texel b.
+    float sx = float(dst.Width ) / float(n);
+    float sy = float(dst.Height) / float(n);
+    stbir_filter     filter = resize_filter(params);
+    stbir_colorspace space  = filter_srgb(params, src) ? STBIR_COLORSPACE_SRGB : STBIR_COLORSPACE_LINEAR;
+    if (!stbir_resize_subpixel(
+            buffer, int(bw), int(bw), int(size_t(bw) * texel),
+            dst.Pixels, dst.Width, dst.Height, 0,
+            src.HDR ? STBIR_TYPE_FLOAT : STBIR_TYPE_UINT8, src.Channels,
+            resize_alpha_channel(params, src), 0,
+            STBIR_EDGE_CLAMP, STBIR_EDGE_CLAMP, filter, filter, space, job->Pool,
+            sx, sy, float(b) * sx, float(b) * sy))
+    {
+        fprintf(job->Errors, "ERROR: Unable to resample level %u of face %u.\n", unsigned(ctx->Level), unsigned(index));
+        ctx->Failed = true;
+    }
+    else if (params.NormalMap) renormalize_normals(dst);
+    scratch_free(job->Pool, buffer);
+}
+
+/// @summary Replaces the mipmap chain of a cubemap with levels filtered across
+/// the face edges, so that no seams appear between faces in the lower levels.
+/// Each level is reduced from the previous level, so that only a narrow border
+/// of the adjacent faces is needed. The base faces are resampled to the output
+/// dimensions, which must be square.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param job The cubemap job. On return, the face levels are set.
+/// @return true if every level of every face was generated.
+static bool filter_cubemap_seamless(FILE *fp, cubemap_job_t &job)
+{
+    dds_params_t const &params  = *job.Params;
+    size_t              nlevels = params.MaxMipLevels < MAX_MIP_LEVELS ? params.MaxMipLevels : MAX_MIP_LEVELS;
+    float               target[6];
+    bool                coverage= false;
+
+    for (size_t f = 0; f < 6; ++f)
+    {
+        image_info_t &face = job.Faces[f].Image;
+        if (size_t(face.Width) != params.Width || size_t(face.Height) != params.Height)
+        {
+            image_info_t out;
+            if (!resize_image(fp, job.Pool, params, out, face, params.Width, params.Height))
+                return false;
+            free_image(face);
+            face = out;
+        }
+        // the alpha-test coverage of each base face is preserved in its mips.
+        coverage  = preserve_coverage(params, face);
+        target[f] = coverage ? image_coverage(params, face) : 0.0f;
+    }
+
+    seamless_job_t ctx;
+    ctx.Cube   = &job;
+    ctx.Failed = false;
+    for (size_t i = 1; i < nlevels && !ctx.Failed; ++i)
+    {
+        size_t lw = params.Width  >> i; if (lw < 1) lw = 1;
+        size_t lh = params.Height >> i; if (lh < 1) lh = 1;
+        for (size_t f = 0; f < 6; ++f)
+        {
+            image_info_t const &base  = job.Faces[f].Image;
+            image_info_t       &level = job.Faces[f].Levels[i];
+            size_t              bpc   = base.HDR ? sizeof(float) : sizeof(uint8_t);
+            size_t              nbytes= lw * lh * size_t(base.Channels) * bpc;
+            level.Pool     = job.Pool;
+            level.Pixels   = scratch_alloc(job.Pool, nbytes);
+            level.Width    = int(lw);
+            level.Height   = int(lh);
+            level.Channels = base.Channels;
+            level.Format   = base.Format;
+            level.HDR      = base.HDR;
+            if (level.Pixels == NULL)
+            {
+                fprintf(fp, "ERROR: Unable to allocate %u bytes for cubemap level %u.\n", unsigned(nbytes), unsigned(i));
+                ctx.Failed = true;
+            }
+        }
+        if (ctx.Failed) break;
+
+        ctx.Level = i;
+        parallel_for(params.ThreadCount, 6, seamless_work, &ctx);
+    }
+
+    // coverage is applied once every level has been reduced from unscaled data.
+    for (size_t i = 1; i < nlevels && coverage && !ctx.Failed; ++i)
+    {
+        for (size_t f = 0; f < 6; ++f)
+        {
+            apply_coverage(params, job.Faces[f].Levels[i], target[f]);
+        }
+    }
+    job.Prefiltered = !ctx.Failed;
+    return !ctx.Failed;
+}
+
+/// @summary Evaluates the nine real spherical harmonic basis functions of
+/// bands 0 through 2 for a unit direction.
+/// @param d The x, y and z components of the unit direction.
+/// @param y On return, stores the values of the nine basis functions.
+static void sh9_basis(float const d[3], float y[9])
+{
+    y[0] = 0.282095f;
+    y[1] = 0.488603f * d[1];
+    y[2] = 0.488603f * d[2];
+    y[3] = 0.488603f * d[0];
+    y[4] = 1.092548f * d[0] * d[1];
+    y[5] = 1.092548f * d[1] * d[2];
+    y[6] = 0.315392f *(3.0f * d[2] * d[2] - 1.0f);
+    y[7] = 1.092548f * d[0] * d[2];
+    y[8] = 0.546274f *(d[0] * d[0] - d[1] * d[1]);
+}
+
+/// @summary Work item that projects a band of rows of one cubemap face onto
+/// the spherical harmonic basis. Each work item accumulates into its own
+/// partial sum, so no synchronization is needed and the result does not
+/// depend on the number of threads.
+/// @param index The work item index; face = index / bands, band = index % bands.
+/// @param context Pointer to the sh_job_t.
+static void sh_project_work(size_t index, void *context)
+{
+    sh_job_t           *ctx  = (sh_job_t*) context;
+    size_t const        face = index / ctx->BandCount;
+    image_info_t const &src  = ctx->Faces[face].Image;
+    sh_partial_t       &sum  = ctx->Partials[index];
+    size_t const        nch  = src.Channels >= 3 ? 3 : 1;
+    size_t const        w    = size_t(src.Width);
+    size_t const        h    = size_t(src.Height);
+    size_t const        row0 = (index % ctx->BandCount) * PROJECTION_BAND_ROWS;
+    size_t const        row1 = row0 + PROJECTION_BAND_ROWS < h ? row0 + PROJECTION_BAND_ROWS : h;
+
+    memset(&sum, 0, sizeof(sh_partial_t));
+    for (size_t y = row0; y < row1; ++y)
+    {
+        float v = 2.0f * (float(y) + 0.5f) / float(h) - 1.0f;
+        for (size_t x = 0; x < w; ++x)
+        {
+            float  u = 2.0f * (float(x) + 0.5f) / float(w) - 1.0f;
+            float  d[3], basis[9], texel[4];
+            cubemap_direction(face, u, v, d);
+            // the solid angle subtended by a texel is proportional to 1/r^3.
+            float  r2  = 1.0f + u * u + v * v;
+            float  rcp = 1.0f / sqrtf(r2);
+            float  wt  = rcp / r2;
+            d[0] *= rcp; d[1] *= rcp; d[2] *= rcp;
+            sh9_basis(d, basis);
+#if MAKEDDS_SSE2
+            _mm_storeu_ps(texel, load_texel_ps(src, x, y));
+#else
+            load_texel(src, x, y, texel);
+#endif
+            for (size_t k = 0; k < 9; ++k)
+            {
+                for (size_t c = 0; c < nch; ++c)
+                    sum.Coeff[k][c] += double(texel[c] * basis[k] * wt);
+            }
+            sum.Weight += double(wt);
+        }
+    }
+}
+
+/// @summary Work item that renders a band of rows of one face of the
+/// irradiance cubemap from the spherical harmonic coefficients.
+/// @param index The work item index; face = index / bands, band = index % bands.
+/// @param context Pointer to the sh_job_t.
+static void sh_render_work(size_t index, void *context)
+{
+    sh_job_t     *ctx  = (sh_job_t*) context;
+    size_t const  face = index / ctx->BandCount;
+    image_info_t &dst  = ctx->Output[face];
+    size_t const  w    = size_t(dst.Width);
+    size_t const  h    = size_t(dst.Height);
+    size_t const  row0 = (index % ctx->BandCount) * PROJECTION_BAND_ROWS;
+    size_t const  row1 = row0 + PROJECTION_BAND_ROWS < h ? row0 + PROJECTION_BAND_ROWS : h;
+
+    for (size_t y = row0; y < row1; ++y)
+    {
+        float v = 2.0f * (float(y) + 0.5f) / float(h) - 1.0f;
+        for (size_t x = 0; x < w; ++x)
+        {
+            float u = 2.0f * (float(x) + 0.5f) / float(w) - 1.0f;
+            float d[3], basis[9];
+            float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            cubemap_direction(face, u, v, d);
+            float rcp = 1.0f / sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            d[0] *= rcp; d[1] *= rcp; d[2] *= rcp;
+            sh9_basis(d, basis);
+            for (size_t k = 0; k < 9; ++k)
+            {
+                for (size_t c = 0; c < 3; ++c)
+                    value[c] += ctx->Irradiance[k][c] * basis[k];
+            }
+            for (size_t c = 0; c < 3; ++c)
+            {
+                if (value[c] < 0.0f) value[c] = 0.0f;
+            }
+            if (dst.Channels < 3) value[1] = value[3]; // luminance + alpha.
+            store_texel(dst, x, y, value, 1.0f);
+        }
+    }
+}
+
+/// @summary Writes the spherical harmonic coefficients of a cubemap to a JSON
+/// file, as arrays of nine [r, g, b] triples in the order L00, L1-1, L10, L11,
+/// L2-2, L2-1, L20, L21, L22. The irradiance coefficients are scaled by 1/pi.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param path The path of the file to write.
+/// @param job The spherical harmonic job providing the coefficients.
+/// @return true if the file was written.
+static bool write_sh_coefficients(FILE *fp, char const *path, sh_job_t const *job)
+{
+    FILE *out = fopen(path, "wt");
+    if (out == NULL)
+    {
+        fprintf(fp, "ERROR: Cannot open SH output file \'%s\'.\n", path);
+        return false;
+    }
+    fprintf(out, "{\n    \"Radiance\": [\n");
+    for (size_t k = 0; k < 9; ++k)
+    {
+        fprintf(out, "        [%.9g, %.9g, %.9g]%s\n", job->Radiance[k][0], job->Radiance[k][1], job->Radiance[k][2], k < 8 ? "," : "");
+    }
+    fprintf(out, "    ],\n    \"Irradiance\": [\n");
+    for (size_t k = 0; k < 9; ++k)
+    {
+        fprintf(out, "        [%.9g, %.9g, %.9g]%s\n", job->Irradiance[k][0], job->Irradiance[k][1], job->Irradiance[k][2], k < 8 ? "," : "");
+    }
+    fprintf(out, "    ]\n}\n");
+    return fclose(out) == 0;
+}
+
+/// @summary Renders the irradiance cubemap described by a set of spherical
+/// harmonic coefficients and writes it to a separate DDS file.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param pool The scratch pool used for the face buffers.
+/// @param params Image processing parameters for the source cubemap.
+/// @param job The spherical harmonic job providing the coefficients.
+/// @return true if the irradiance cubemap was written.
+static bool write_irradiance_cube(FILE *fp, scratch_pool_t *pool, dds_params_t const &params, sh_job_t *job)
+{
+    image_info_t const &base = job->Faces[0].Image;
+    dds_params_t        irr  = params;
+    size_t              size = params.IrradianceSize;
+    size_t              bpc  = sizeof(float);
+    size_t              nbytes = size * size * size_t(base.Channels) * bpc;
+    bool                res  = true;
+    irr.Width        = size;
+    irr.Height       = size;
+    irr.BaseWidth    = size;
+    irr.BaseHeight   = size;
+    irr.MaxMipLevels = 1;
+    irr.Mipmaps      = false;
+    irr.ArraySize    = 1;
+    irr.Format       = base.Format;
+    irr.AlphaMode    = data::DDS_ALPHA_MODE_OPAQUE;
+    irr.MemoryLimit  = 0;
+    irr.MetricsJob   = NULL;
+
+    for (size_t i = 0; i < 6; ++i)
+    {
+        image_info_t &face = job->Output[i];
+        face.Pool     = pool;
+        face.Pixels   = scratch_alloc(pool, nbytes);
+        face.Width    = int(size);
+        face.Height   = int(size);
+        face.Channels = base.Channels;
+        face.Format   = base.Format;
+        face.HDR      = true;
+        if (face.Pixels == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for irradiance face %u.\n", unsigned(nbytes), unsigned(i));
+            res = false;
+        }
+    }
+    if (res)
+    {
+        job->BandCount = (size + PROJECTION_BAND_ROWS - 1) / PROJECTION_BAND_ROWS;
+        parallel_for(params.ThreadCount, 6 * job->BandCount, sh_render_work, job);
+
+        FILE *dds = fopen(params.IrradianceCube, "wb");
+        if (dds != NULL)
+        {
+            uint32_t                 magic = data::fourcc_le('D','D','S',' ');
+            data::dds_header_t       head;
+            data::dds_header_dxt10_t dx10;
+            memset(&head, 0, sizeof(head));
+            memset(&dx10, 0, sizeof(dx10));
+            init_dds_header(&head, irr);
+            init_dds_header_dxt10(&dx10, irr);
+            fwrite(&magic, sizeof(uint32_t), 1, dds);
+            fwrite(&head , sizeof(data::dds_header_t), 1, dds);
+            fwrite(&dx10 , sizeof(data::dds_header_dxt10_t), 1, dds);
+            for (size_t i = 0; i < 6 && res; ++i)
+            {
+                res = write_pixels(fp, dds, pool, irr, job->Output[i]);
+            }
+            if (fclose(dds) != 0) res = false;
+        }
+        else
+        {
+            fprintf(fp, "ERROR: Cannot open irradiance output file \'%s\'.\n", params.IrradianceCube);
+            res = false;
+        }
+    }
+    for (size_t i = 0; i < 6; ++i)
+    {
+        free_image(job->Output[i]);
+    }
+    return res;
+}
+
+/// @summary Projects the faces of an HDR cubemap onto the first three bands of
+/// spherical harmonics in a single parallel pass, weighting each texel by its
+/// solid angle. The radiance and irradiance coefficients are optionally written
+/// to a JSON file, and a low-resolution irradiance cubemap to a second DDS. The
+/// irradiance cube stores E/pi, the radiance leaving a white diffuse surface.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param job The cubemap job providing the loaded faces.
+/// @return true if the requested outputs were written.
+static bool write_irradiance(FILE *fp, cubemap_job_t &job)
+{
+    dds_params_t const &params = *job.Params;
+    if (!job.Faces[0].Image.HDR)
+    {
+        fprintf(fp, "WARNING: Irradiance output requires an HDR cubemap and will not be generated.\n");
+        return true;
+    }
+
+    sh_job_t ctx;
+    ctx.Faces     = job.Faces;
+    ctx.BandCount = (size_t(job.Faces[0].Image.Height) + PROJECTION_BAND_ROWS - 1) / PROJECTION_BAND_ROWS;
+    ctx.Partials  = (sh_partial_t*) malloc(6 * ctx.BandCount * sizeof(sh_partial_t));
+    if (ctx.Partials == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate spherical harmonic partial sums.\n");
+        return false;
+    }
+    parallel_for(params.ThreadCount, 6 * ctx.BandCount, sh_project_work, &ctx);
+
+    // reduce the partial sums, and normalize so the weights total 4*pi.
+    double coeff[9][3];
+    double total = 0.0;
+    memset(coeff, 0, sizeof(coeff));
+    for (size_t i = 0, n = 6 * ctx.BandCount; i < n; ++i)
+    {
+        for (size_t k = 0; k < 9; ++k)
+        {
+            for (size_t c = 0; c < 3; ++c)
+                coeff[k][c] += ctx.Partials[i].Coeff[k][c];
+        }
+        total += ctx.Partials[i].Weight;
+    }
+    free(ctx.Partials);
+
+    double const pi    = 3.14159265358979323846;
+    double const norm  = 4.0 * pi / total;
+    double const band[9] = { 1.0, 2.0/3.0, 2.0/3.0, 2.0/3.0, 0.25, 0.25, 0.25, 0.25, 0.25 };
+    for (size_t k = 0; k < 9; ++k)
+    {   // irradiance is radiance convolved with the clamped cosine lobe.
+        for (size_t c = 0; c < 3; ++c)
+        {
+            ctx.Radiance  [k][c] = float(coeff[k][c] * norm);
+            ctx.Irradiance[k][c] = float(coeff[k][c] * norm * band[k]);
+        }
+    }
+
+    bool res = true;
+    if (params.IrradianceSH != NULL)
+    {   // write_sh_coefficients() outputs error messages.
+        res = write_sh_coefficients(fp, params.IrradianceSH, &ctx);
+    }
+    if (params.IrradianceCube != NULL && res)
+    {   // write_irradiance_cube() outputs error messages.
+        res = write_irradiance_cube(fp, job.Pool, params, &ctx);
+    }
+    return res;
+}
+
+/// @summary Loads six source files specified in the image processing parameters,
+/// or projects a single source file if a projection is specified, and writes
+/// them to the DDS output stream as a cubemap image. If requested, mipmaps are
+/// generated and written to the output stream as well. The faces are loaded,
+/// resampled and encoded concurrently, and the encoded faces are written to
+/// the output stream in DDS face order.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for resampled image buffers.
+/// @param params Image processing parameters. These parameters may be updated
+/// with defaults based on the first cubemap face loaded.
+/// @return true if the entire cubemap image chain was written to the DDS output stream.
+static bool write_cubemap_image(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t &params)
+{   // note that params.SourceIndex is used to keep track of state in this
+    // case, because it's possible to have arrays of cubemaps with mipmaps.
+    size_t nsources = params.Projection == PROJECTION_NONE ? 6 : 1;
+    if (params.SourceIndex + nsources > params.SourceCount)
+    {
+        fprintf(fp, "ERROR: %u source images are required for each cubemap (have %u).\n", unsigned(nsources), unsigned(params.SourceCount - params.SourceIndex));
+        return false;
+    }
+
+    cubemap_job_t job;
+    job.Errors      = fp;
+    job.Pool        = pool;
+    job.Params      = &params;
+    job.FirstSource = params.SourceIndex;
+    job.Prefiltered = false;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        for (size_t j = 0; j < MAX_MIP_LEVELS; ++j)
+        {
+            job.Faces[i].Levels[j].Pool   = NULL;
+            job.Faces[i].Levels[j].Pixels = NULL;
+        }
+        job.Faces[i].Image.Pool   = NULL;
+        job.Faces[i].Image.Pixels = NULL;
+        job.Faces[i].Stream       = NULL;
+        job.Faces[i].Metrics      = NULL;
+        job.Faces[i].Loaded       = false;
+        job.Faces[i].Written      = false;
+    }
+    bool first_cube    = params.SourceIndex == 0;
+    bool res           = true;
+    params.SourceIndex+= nsources;
+    if (params.Projection == PROJECTION_EQUIRECT)
+    {   // project_equirect() outputs error messages.
+        res = project_equirect(fp, job);
+    }
+    else
+    {   // load each face from its own source file.
+        parallel_for(params.ThreadCount, 6, cubemap_load_work, &job);
+        for (size_t i = 0; i < 6; ++i)
+        {
+            if (job.Faces[i].Loaded == false)
+            {
+                fprintf(fp, "ERROR: Unable to load face %u/6 (\'%s\').\n", unsigned(i), params.SourceFiles[job.FirstSource + i]);
+                res = false;
+            }
+        }
+    }
+
+    if (res && first_cube)
+    {   // set any 'default to source' parameters.
+        image_info_t const &face = job.Faces[0].Image;
+        if (params.Width  == 0) params.Width  = size_t(face.Width);
+        if (params.Height == 0) params.Height = size_t(face.Height);
+        params.BaseWidth   = size_t(face.Width);
+        params.BaseHeight  = size_t(face.Height);
+
+        if (params.Format == data::DXGI_FORMAT_UNKNOWN)
+        {   // set the format to that of the first face.
+            params.Format  = face.Format;
+        }
+        if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
+        {
+            if (face.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
+            else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
+        }
+        if (params.Mipmaps && params.MaxMipLevels == 0)
+        {   // compute all the way down to 1x1.
+            size_t lw = params.Width;
+            size_t lh = params.Height;
+            while (lw > 1 || lh > 1)
+            {
+                params.MaxMipLevels++;
+                lw >>= 1; if (lw == 0) lw = 1;
+                lh >>= 1; if (lh == 0) lh = 1;
+            }
+            // include the base level in the count.
+            params.MaxMipLevels++;
+        }
+    }
+
+    if (res && first_cube && (params.IrradianceSH != NULL || params.IrradianceCube != NULL))
+    {   // irradiance is computed from the first cubemap of an array only.
+        // write_irradiance() outputs error messages.
+        res = write_irradiance(fp, job);
+    }
+
+    if (res && params.Prefilter == PREFILTER_GGX && params.Mipmaps && params.MaxMipLevels > 1)
+    {   // prefilter_ggx() outputs error messages.
+        res = prefilter_ggx(fp, job);
+    }
+    else if (res && params.SeamlessCubemap && params.Mipmaps && params.MaxMipLevels > 1)
+    {
+        if (params.Width != params.Height)
+        {
+            fprintf(fp, "WARNING: SeamlessCubemap requires square faces; faces will be filtered independently.\n");
+        }
+        else
+        {   // filter_cubemap_seamless() outputs error messages.
+            res = filter_cubemap_seamless(fp, job);
+        }
+    }
+
+    if (res)
+    {   // write_cubemap_faces() sets the Written field of each face.
+        write_cubemap_faces(fp, dds, job);
+        for (size_t i = 0; i < 6 && res; ++i)
+        {
+            if (job.Faces[i].Written == false)
+            {
+                fprintf(fp, "ERROR: Unable to write face %u/6 (\'%s\').\n", unsigned(i), params.SourceFiles[job.FirstSource + (nsources > 1 ? i : 0)]);
+                res = false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < 6; ++i)
+    {
+        for (size_t j = 0; j < MAX_MIP_LEVELS; ++j)
+        {
+            free_image(job.Faces[i].Levels[j]);
+        }
+        free_image(job.Faces[i].Image);
+    }
+    return res;
+}
+
+/// @summary Loads the source files specified in the image processing parameters
+/// and writes them to the DDS output stream as an image array. If requested, 
+/// mipmaps are generated and written to the output stream as well.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for resampled image buffers.
+/// @param params Image processing parameters. These parameters may be updated
+/// with defaults based on the first image loaded.
+/// @return true if the entire image array chain was written to the DDS output stream.
+static bool write_array_image(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t &params)
+{
+    params.SourceIndex = 0;
+    if (params.Cubemap)
+    {
+        for (size_t  i = 0, n = params.ArraySize; i < n; ++i)
+        {
+            if (!write_cubemap_image(fp, dds, pool, params))
+            {
+                fprintf(fp, "ERROR: Unable to write element %u/%u.\n", unsigned(i), unsigned(n));
+                return false;
+            }
+        }
+    }
+    else
+    {
+        for (size_t  i = 0, n = params.ArraySize; i < n; ++i)
+        {
+            image_info_t image;
+            if (load_next_source(fp, params, image))
+            {
+                if (i == 0)
+                {   // set any 'default to source' parameters. note that all 
+                    // images in the array have the same dimension and format.
+                    if (params.Width  == 0) params.Width  = size_t(image.Width);
+                    if (params.Height == 0) params.Height = size_t(image.Height);
+                    params.BaseWidth   = size_t(image.Width);
+                    params.BaseHeight  = size_t(image.Height);
+
+                    if (params.Format == data::DXGI_FORMAT_UNKNOWN)
+                    {   // set the format to that of the first image.
+                        params.Format  = image.Format;
+                    }
+                    if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
+                    {
+                        if (image.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
+                        else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
+                    }
+                    if (params.Mipmaps && params.MaxMipLevels == 0)
+                    {   // compute all the way down to 1x1.
+                        size_t lw = params.Width;
+                        size_t lh = params.Height;
+                        while (lw > 1 || lh > 1)
+                        {
+                            params.MaxMipLevels++;
+                            lw >>= 1; if (lw == 0) lw = 1;
+                            lh >>= 1; if (lh == 0) lh = 1;
+                        }
+                        // include the base level in the count.
+                        params.MaxMipLevels++;
+                    }
+                }
+                if (!write_image_chain(fp, dds, pool, params, image))
+                {
+                    free_image(image);
+                    fprintf(fp, "ERROR: Unable to write element %u/%u.\n", unsigned(i), unsigned(n));
+                    return false;
+                }
+                else free_image(image);
+            }
+            else
+            {
+                fprintf(fp, "ERROR: Unable to load element %u/%u (\'%s\').\n", unsigned(i), unsigned(n), params.SourceFiles[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// @summary Builds a path by replacing the extension of an existing path.
+/// @param dst The buffer receiving the new path.
+/// @param dst_size The size of the dst buffer, in bytes.
+/// @param path The existing path. If it has no extension, ext is appended.
+/// @param ext The new extension, including the leading period.
+/// @return true if the new path fits in the dst buffer.
+static bool replace_extension(char *dst, size_t dst_size, char const *path, char const *ext)
+{
+    char const *slash  = strrchr(path, '/');
+    char const *bslash = strrchr(path, '\\');
+    char const *dot    = strrchr(path, '.');
+    if (bslash > slash) slash = bslash;
+    size_t      len    = (dot != NULL && dot > slash) ? size_t(dot - path) : strlen(path);
+    size_t      extlen = strlen(ext);
+    if (len + extlen + 1 > dst_size)
+        return false;
+    memcpy(dst, path, len);
+    memcpy(dst + len, ext, extlen + 1);
+    return true;
+}
+
+/// @summary Work item that loads one source image of a texture atlas.
+/// @param index The zero-based index of the source image.
+/// @param context Pointer to the atlas_job_t.
+static void atlas_load_work(size_t index, void *context)
+{
+    atlas_job_t    *job    = (atlas_job_t*) context;
+    atlas_sprite_t &sprite = job->Sprites[index];
+    sprite.Loaded = load_source(job->Errors, *job->Params, index, sprite.Image);
+    sprite.Width  = size_t(sprite.Image.Width);
+    sprite.Height = size_t(sprite.Image.Height);
+}
+
+/// @summary Appends a rectangle to a growable array of rectangles.
+/// @param list The array of rectangles, which may be reallocated.
+/// @param count The number of valid items in the array.
+/// @param capacity The number of items allocated for the array.
+/// @param rect The rectangle to append.
+/// @return true if the rectangle was appended.
+static bool push_rect(pack_rect_t **list, size_t *count, size_t *capacity, pack_rect_t const &rect)
+{
+    if (*count == *capacity)
+    {
+        size_t       newcap = *capacity < 16 ? 16 : *capacity * 2;
+        pack_rect_t *newbuf = (pack_rect_t*) realloc(*list, newcap * sizeof(pack_rect_t));
+        if (newbuf == NULL) return false;
+        *list     = newbuf;
+        *capacity = newcap;
+    }
+    (*list)[(*count)++] = rect;
+    return true;
+}
+
+/// @summary Initializes a packer for a single empty page.
+/// @param packer The packer to initialize.
+/// @param method One of atlas_packer_e.
+/// @param width The width of the packing area.
+/// @param height The height of the packing area.
+/// @param max_items The maximum number of rectangles that will be inserted.
+/// @return true if the packer was initialized.
+static bool init_packer(atlas_packer_t *packer, uint32_t method, size_t width, size_t height, size_t max_items)
+{
+    pack_rect_t page = { 0, 0, width, height };
+    packer->Method   = method;
+    packer->Width    = width;
+    packer->Height   = height;
+    packer->Count    = 0;
+    packer->Capacity = 0;
+    packer->Nodes    = NULL;
+    packer->Free     = NULL;
+    if (method == PACKER_SKYLINE)
+    {   // each insertion adds at most one segment to the skyline.
+        packer->Nodes = (skyline_node_t*) malloc((max_items + 1) * sizeof(skyline_node_t));
+        if (packer->Nodes == NULL) return false;
+        packer->Nodes[0].X     = 0;
+        packer->Nodes[0].Y     = 0;
+        packer->Nodes[0].Width = width;
+        packer->Count    = 1;
+        packer->Capacity = max_items + 1;
+        return true;
+    }
+    return push_rect(&packer->Free, &packer->Count, &packer->Capacity, page);
+}
+
+/// @summary Frees the memory associated with a packer.
+/// @param packer The packer to delete.
+static void delete_packer(atlas_packer_t *packer)
+{
+    free(packer->Nodes);
+    free(packer->Free);
+    packer->Nodes    = NULL;
+    packer->Free     = NULL;
+    packer->Count    = 0;
+    packer->Capacity = 0;
+}
+
+/// @summary Determines whether a rectangle fits on the skyline with its left
+/// edge at the start of a given skyline segment.
+/// @param packer The skyline packer.
+/// @param index The zero-based index of the skyline segment.
+/// @param width The width of the rectangle.
+/// @param height The height of the rectangle.
+/// @param y On return, the lowest y-coordinate at which the rectangle rests.
+/// @return true if the rectangle fits within the packing area.
+static bool skyline_fit(atlas_packer_t const *packer, size_t index, size_t width, size_t height, size_t &y)
+{
+    size_t x = packer->Nodes[index].X;
+    if (x + width > packer->Width)
+        return false;
+
+    size_t covered = 0;
+    y = 0;
+    for (size_t i = index; covered < width && i < packer->Count; ++i)
+    {
+        if (packer->Nodes[i].Y > y) y = packer->Nodes[i].Y;
+        covered += packer->Nodes[i].Width;
+    }
+    return y + height <= packer->Height;
+}
+
+/// @summary Places a rectangle using the skyline bottom-left heuristic, which
+/// minimizes the top edge of the placed rectangle, then the wasted width.
+/// @param packer The skyline packer.
+/// @param width The width of the rectangle.
+/// @param height The height of the rectangle.
+/// @param rect On return, the placed rectangle.
+/// @return true if the rectangle was placed.
+static bool skyline_insert(atlas_packer_t *packer, size_t width, size_t height, pack_rect_t &rect)
+{
+    size_t best = packer->Count;
+    size_t best_top = 0, best_width = 0, best_y = 0;
+    for (size_t i = 0; i < packer->Count; ++i)
+    {
+        size_t y;
+        if (!skyline_fit(packer, i, width, height, y))
+            continue;
+        if (best == packer->Count || y + height < best_top || (y + height == best_top && packer->Nodes[i].Width < best_width))
+        {
+            best       = i;
+            best_top   = y + height;
+            best_width = packer->Nodes[i].Width;
+            best_y     = y;
+        }
+    }
+    if (best == packer->Count || packer->Count == packer->Capacity)
+        return false;
+
+    rect.X      = packer->Nodes[best].X;
+    rect.Y      = best_y;
+    rect.Width  = width;
+    rect.Height = height;
+
+    // insert the new segment, then trim the segments it covers.
+    memmove(&packer->Nodes[best + 1], &packer->Nodes[best], (packer->Count - best) * sizeof(skyline_node_t));
+    packer->Nodes[best].X     = rect.X;
+    packer->Nodes[best].Y     = rect.Y + height;
+    packer->Nodes[best].Width = width;
+    packer->Count++;
+    for (size_t i = best + 1; i < packer->Count; )
+    {
+        skyline_node_t const &prev = packer->Nodes[i - 1];
+        skyline_node_t       &node = packer->Nodes[i];
+        if (node.X >= prev.X + prev.Width)
+            break;
+        size_t shrink = prev.X + prev.Width - node.X;
+        if (node.Width > shrink)
+        {
+            node.X     += shrink;
+            node.Width -= shrink;
+            break;
+        }
+        memmove(&packer->Nodes[i], &packer->Nodes[i + 1], (packer->Count - i - 1) * sizeof(skyline_node_t));
+        packer->Count--;
+    }
+    // merge adjacent segments at the same height.
+    for (size_t i = 0; i + 1 < packer->Count; )
+    {
+        if (packer->Nodes[i].Y == packer->Nodes[i + 1].Y)
+        {
+            packer->Nodes[i].Width += packer->Nodes[i + 1].Width;
+            memmove(&packer->Nodes[i + 1], &packer->Nodes[i + 2], (packer->Count - i - 2) * sizeof(skyline_node_t));
+            packer->Count--;
+        }
+        else ++i;
+    }
+    return true;
+}
+
+/// @summary Determines whether one rectangle contains another.
+/// @param outer The containing rectangle.
+/// @param inner The contained rectangle.
+/// @return true if inner lies entirely within outer.
+static inline bool rect_contains(pack_rect_t const &outer, pack_rect_t const &inner)
+{
+    return inner.X >= outer.X && inner.X + inner.Width  <= outer.X + outer.Width &&
+           inner.Y >= outer.Y && inner.Y + inner.Height <= outer.Y + outer.Height;
+}
+
+/// @summary Places a rectangle using the MaxRects best-short-side-fit
+/// heuristic, then splits every free rectangle it overlaps into the maximal
+/// free rectangles around it and discards free rectangles contained in others.
+/// @param packer The MaxRects packer.
+/// @param width The width of the rectangle.
+/// @param height The height of the rectangle.
+/// @param rect On return, the placed rectangle.
+/// @return true if the rectangle was placed.
+static bool maxrects_insert(atlas_packer_t *packer, size_t width, size_t height, pack_rect_t &rect)
+{
+    size_t best = packer->Count;
+    size_t best_short = 0, best_long = 0;
+    for (size_t i = 0; i < packer->Count; ++i)
+    {
+        pack_rect_t const &f = packer->Free[i];
+        if (f.Width < width || f.Height < height)
+            continue;
+        size_t dw = f.Width  - width;
+        size_t dh = f.Height - height;
+        size_t ss = dw < dh ? dw : dh;
+        size_t ls = dw < dh ? dh : dw;
+        if (best == packer->Count || ss < best_short || (ss == best_short && ls < best_long))
+        {
+            best       = i;
+            best_short = ss;
+            best_long  = ls;
+        }
+    }
+    if (best == packer->Count)
+        return false;
+
+    rect.X      = packer->Free[best].X;
+    rect.Y      = packer->Free[best].Y;
+    rect.Width  = width;
+    rect.Height = height;
+
+    // build the new free list from the pieces of each free rectangle left
+    // uncovered by the placed rectangle.
+    pack_rect_t *list = NULL;
+    size_t       count = 0, capacity = 0;
+    bool         ok    = true;
+    size_t const rx1   = rect.X + width;
+    size_t const ry1   = rect.Y + height;
+    for (size_t i = 0; i < packer->Count && ok; ++i)
+    {
+        pack_rect_t const &f   = packer->Free[i];
+        size_t      const  fx1 = f.X + f.Width;
+        size_t      const  fy1 = f.Y + f.Height;
+        if (rect.X >= fx1 || rx1 <= f.X || rect.Y >= fy1 || ry1 <= f.Y)
+        {   // no overlap; keep the free rectangle as-is.
+            ok = push_rect(&list, &count, &capacity, f);
+            continue;
+        }
+        if (ok && rect.X > f.X)
+        {
+            pack_rect_t r = { f.X, f.Y, rect.X - f.X, f.Height };
+            ok = push_rect(&list, &count, &capacity, r);
+        }
+        if (ok && rx1 < fx1)
+        {
+            pack_rect_t r = { rx1, f.Y, fx1 - rx1, f.Height };
+            ok = push_rect(&list, &count, &capacity, r);
+        }
+        if (ok && rect.Y > f.Y)
+        {
+            pack_rect_t r = { f.X, f.Y, f.Width, rect.Y - f.Y };
+            ok = push_rect(&list, &count, &capacity, r);
+        }
+        if (ok && ry1 < fy1)
+        {
+            pack_rect_t r = { f.X, ry1, f.Width, fy1 - ry1 };
+            ok = push_rect(&list, &count, &capacity, r);
+        }
+    }
+    if (!ok)
+    {
+        free(list);
+        return false;
+    }
+
+    // discard free rectangles contained within another; they are marked by
+    // setting their width to zero, then the list is compacted.
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (list[i].Width == 0) continue;
+        for (size_t j = i + 1; j < count; ++j)
+        {
+            if (list[j].Width == 0) continue;
+            if (rect_contains(list[j], list[i])) { list[i].Width = 0; break; }
+            if (rect_contains(list[i], list[j])) { list[j].Width = 0; }
+        }
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (list[i].Width != 0) list[n++] = list[i];
+    }
+    free(packer->Free);
+    packer->Free     = list;
+    packer->Count    = n;
+    packer->Capacity = capacity;
+    return true;
+}
+
+/// @summary Places a rectangle on the page being packed.
+/// @param packer The packer.
+/// @param width The width of the rectangle.
+/// @param height The height of the rectangle.
+/// @param rect On return, the placed rectangle.
+/// @return true if the rectangle was placed.
+static bool pack_insert(atlas_packer_t *packer, size_t width, size_t height, pack_rect_t &rect)
+{
+    if (packer->Method == PACKER_SKYLINE)
+        return skyline_insert(packer, width, height, rect);
+    else
+        return maxrects_insert(packer, width, height, rect);
+}
+
+/// @summary Expands a texel with one to four channels to four channels. Gray
+/// is replicated to RGB, and a missing alpha channel is opaque.
+/// @param dst The four-channel destination texel.
+/// @param src The source texel.
+/// @param channels The number of channels in the source texel.
+/// @param hdr true if the channels are floats, or false if they are bytes.
+static inline void expand_texel_rgba(uint8_t *dst, uint8_t const *src, size_t channels, bool hdr)
+{
+    size_t const bpc = hdr ? sizeof(float) : sizeof(uint8_t);
+    uint8_t      one[sizeof(float)];
+    if (hdr) { float f = 1.0f; memcpy(one, &f, sizeof(float)); }
+    else one[0] = 0xFF;
+    for (size_t c = 0; c < 3; ++c)
+    {
+        memcpy(dst + c * bpc, src + (channels < 3 ? 0 : c) * bpc, bpc);
+    }
+    if (channels == 2 || channels == 4) memcpy(dst + 3 * bpc, src + (channels - 1) * bpc, bpc);
+    else memcpy(dst + 3 * bpc, one, bpc);
+}
+
+/// @summary Work item that copies one source image onto its atlas page and
+/// extrudes its edge texels outward, so that filtering near the edges of the
+/// image does not sample the padding. Images with fewer channels than the
+/// page are expanded to RGBA as they are copied.
+/// @param index The zero-based index of the source image.
+/// @param context Pointer to the atlas_job_t.
+static void atlas_blit_work(size_t index, void *context)
+{
+    atlas_job_t          *job    = (atlas_job_t*) context;
+    atlas_sprite_t const &sprite = job->Sprites[index];
+    image_info_t   const &src    = sprite.Image;
+    image_info_t         &page   = job->Pages[sprite.Page];
+    ptrdiff_t      const  e      = ptrdiff_t(job->Params->AtlasExtrude);
+    ptrdiff_t      const  w      = ptrdiff_t(src.Width);
+    ptrdiff_t      const  h      = ptrdiff_t(src.Height);
+    size_t         const  bpc    = src.HDR ? sizeof(float) : sizeof(uint8_t);
+    size_t         const  texel  = size_t(src.Channels) * bpc;
+    size_t         const  pitch  = size_t(page.Width) * size_t(page.Channels) * bpc;
+
+    if (src.Channels != page.Channels)
+    {   // expand each texel, clamping the coordinates for the extruded border.
+        size_t const wide = size_t(page.Channels) * bpc;
+        for (ptrdiff_t y = -e; y < h + e; ++y)
+        {
+            ptrdiff_t      sy  = y < 0 ? 0 : (y >= h ? h - 1 : y);
+            uint8_t const *row = (uint8_t const*) src.Pixels + size_t(sy * w) * texel;
+            uint8_t       *dst = (uint8_t*) page.Pixels + size_t(ptrdiff_t(sprite.Y) + y) * pitch + sprite.X * wide;
+            for (ptrdiff_t x = -e; x < w + e; ++x)
+            {
+                ptrdiff_t sx = x < 0 ? 0 : (x >= w ? w - 1 : x);
+                expand_texel_rgba(dst + x * ptrdiff_t(wide), row + size_t(sx) * texel, size_t(src.Channels), src.HDR);
+            }
+        }
+        return;
+    }
+    for (ptrdiff_t y = -e; y < h + e; ++y)
+    {
+        ptrdiff_t      sy  = y < 0 ? 0 : (y >= h ? h - 1 : y);
+        uint8_t const *row = (uint8_t const*) src.Pixels + size_t(sy * w) * texel;
+        uint8_t       *dst = (uint8_t*) page.Pixels + size_t(ptrdiff_t(sprite.Y) + y) * pitch + sprite.X * texel;
+        for (ptrdiff_t x = -e; x < 0; ++x)
+        {
+            memcpy(dst + x * ptrdiff_t(texel), row, texel);
+        }
+        memcpy(dst, row, size_t(w) * texel);
+        for (ptrdiff_t x = w; x < w + e; ++x)
+        {
+            memcpy(dst + x * ptrdiff_t(texel), row + size_t(w - 1) * texel, texel);
+        }
+    }
+}
+
+/// @summary Writes the binary rect table describing the location of each
+/// source image within a texture atlas. The table is a data::atlas_header_t
+/// followed by one data::atlas_rect_t per source image, in source order.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param params Image processing parameters.
+/// @param sprites The placed source images.
+/// @param page_count The number of pages in the atlas.
+/// @return true if the table was written.
+static bool write_atlas_table(FILE *fp, dds_params_t const &params, atlas_sprite_t const *sprites, size_t page_count)
+{
+    char        path[4096];
+    char const *table = params.AtlasTable;
+    if (page_count > 0xFFFF || params.Width > 0xFFFF || params.Height > 0xFFFF)
+    {   // the table stores page indices and coordinates as 16-bit values. every
+        // rect lies within a page, so checking the page bounds covers them too.
+        fprintf(fp, "ERROR: The atlas table cannot describe %u pages of %ux%u; the limit is 65535.\n", unsigned(page_count), unsigned(params.Width), unsigned(params.Height));
+        return false;
+    }
+    if (table == NULL)
+    {   // replace the extension of the output file with '.atlas'.
+        if (!replace_extension(path, sizeof(path), params.OutputFile, ".atlas"))
+        {
+            fprintf(fp, "ERROR: The output path is too long to derive the atlas table path.\n");
+            return false;
+        }
+        table = path;
+    }
+
+    FILE *out = fopen(table, "wb");
+    if (out == NULL)
+    {
+        fprintf(fp, "ERROR: Cannot open atlas table \'%s\'.\n", table);
+        return false;
+    }
+
+    data::atlas_header_t header;
+    header.Magic      = LLDATAIN_ATLAS_MAGIC_LE;
+    header.Version    = 1;
+    header.PageCount  = uint16_t(page_count);
+    header.PageWidth  = uint16_t(params.Width);
+    header.PageHeight = uint16_t(params.Height);
+    header.RectCount  = uint32_t(params.SourceCount);
+    bool res = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (size_t i = 0; i < params.SourceCount && res; ++i)
+    {
+        data::atlas_rect_t rect;
+        rect.Page   = uint16_t(sprites[i].Page);
+        rect.X      = uint16_t(sprites[i].X);
+        rect.Y      = uint16_t(sprites[i].Y);
+        rect.Width  = uint16_t(sprites[i].Width);
+        rect.Height = uint16_t(sprites[i].Height);
+        res = fwrite(&rect, sizeof(rect), 1, out) == 1;
+    }
+    if (fclose(out) != 0) res = false;
+    if (!res) fprintf(fp, "ERROR: Unable to write atlas table \'%s\'.\n", table);
+    return res;
+}
+
+/// @summary Loads the source files specified in the image processing parameters,
+/// packs them onto one or more pages of the size given by params.Width and 
+/// params.Height, and writes the pages to the DDS output stream as a single
+/// image or an image array. Each image is surrounded by AtlasExtrude texels
+/// copied from its edges and separated from its neighbors by AtlasPadding 
+/// empty texels. A binary rect table is written alongside the DDS.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for page and resampled image buffers.
+/// @param params Image processing parameters. These parameters may be updated
+/// with defaults based on the first image loaded.
+/// @return true if every page was written to the DDS output stream.
+static bool write_atlas_image(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t &params)
+{
+    size_t const    count   = params.SourceCount;
+    size_t const    border  = 2 * params.AtlasExtrude + params.AtlasPadding;
+    atlas_sprite_t *sprites = (atlas_sprite_t*) malloc(count * sizeof(atlas_sprite_t));
+    size_t         *order   = (size_t*) malloc(count * sizeof(size_t));
+    image_info_t   *pages   = NULL;
+    size_t          npages  = 0;
+    bool            res     = true;
+    if (sprites == NULL || order == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate atlas state for %u images.\n", unsigned(count));
+        free(order); free(sprites);
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        sprites[i].Image.Pool   = NULL;
+        sprites[i].Image.Pixels = NULL;
+        sprites[i].Page         = 0;
+        sprites[i].X            = 0;
+        sprites[i].Y            = 0;
+        sprites[i].Width        = 0;
+        sprites[i].Height       = 0;
+        sprites[i].Loaded       = false;
+        sprites[i].Placed       = false;
+    }
+
+    // decode every source image concurrently.
+    atlas_job_t job;
+    job.Errors  = fp;
+    job.Params  = &params;
+    job.Sprites = sprites;
+    job.Pages   = NULL;
+    parallel_for(params.ThreadCount, count, atlas_load_work, &job);
+    for (size_t i = 0; i < count; ++i)
+    {
+        image_info_t const &first = sprites[0].Image;
+        image_info_t const &image = sprites[i].Image;
+        if (!sprites[i].Loaded)
+        {
+            fprintf(fp, "ERROR: Unable to load atlas image %u/%u (\'%s\').\n", unsigned(i), unsigned(count), params.SourceFiles[i]);
+            res = false;
+        }
+        else if (sprites[0].Loaded && image.HDR != first.HDR)
+        {
+            fprintf(fp, "ERROR: Atlas image \'%s\' is %s, but \'%s\' is %s.\n", params.SourceFiles[i], image.HDR ? "HDR" : "LDR", params.SourceFiles[0], first.HDR ? "HDR" : "LDR");
+            res = false;
+        }
+        else if (size_t(image.Width) + border > params.Width + params.AtlasPadding || size_t(image.Height) + border > params.Height + params.AtlasPadding)
+        {
+            fprintf(fp, "ERROR: Atlas image \'%s\' (%dx%d) does not fit on a %ux%u page.\n", params.SourceFiles[i], image.Width, image.Height, unsigned(params.Width), unsigned(params.Height));
+            res = false;
+        }
+    }
+
+    if (res)
+    {   // place the largest images first; ties keep source order.
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t key_i = size_t(sprites[i].Image.Width > sprites[i].Image.Height ? sprites[i].Image.Width : sprites[i].Image.Height);
+            size_t j     = i;
+            for ( ; j > 0; --j)
+            {
+                image_info_t const &prev = sprites[order[j - 1]].Image;
+                size_t key_j = size_t(prev.Width > prev.Height ? prev.Width : prev.Height);
+                if (key_j >= key_i) break;
+                order[j] = order[j - 1];
+            }
+            order[j] = i;
+        }
+
+        // fill one page at a time. the packing area includes the padding to
+        // the right of and below the images touching the edges of the page.
+        size_t placed = 0;
+        while (placed < count && res)
+        {
+            atlas_packer_t packer;
+            size_t         before = placed;
+            if (!init_packer(&packer, params.AtlasPacker, params.Width + params.AtlasPadding, params.Height + params.AtlasPadding, count))
+            {
+                fprintf(fp, "ERROR: Unable to allocate atlas packer state.\n");
+                res = false;
+                break;
+            }
+            for (size_t k = 0; k < count; ++k)
+            {
+                atlas_sprite_t &sprite = sprites[order[k]];
+                pack_rect_t     rect;
+                if (sprite.Placed)
+                    continue;
+                if (pack_insert(&packer, size_t(sprite.Image.Width) + border, size_t(sprite.Image.Height) + border, rect))
+                {
+                    sprite.Page   = npages;
+                    sprite.X      = rect.X + params.AtlasExtrude;
+                    sprite.Y      = rect.Y + params.AtlasExtrude;
+                    sprite.Placed = true;
+                    placed++;
+                }
+            }
+            delete_packer(&packer);
+            if (placed == before)
+            {
+                fprintf(fp, "ERROR: Unable to pack atlas page %u.\n", unsigned(npages));
+                res = false;
+            }
+            else npages++;
+        }
+    }
+
+    if (res)
+    {   // allocate and clear the pages, then copy the images onto them. if
+        // the images have different channel counts, the pages are RGBA.
+        image_info_t const &first    = sprites[0].Image;
+        int                 channels = first.Channels;
+        uint32_t            format   = first.Format;
+        for (size_t i = 1; i < count; ++i)
+        {
+            if (sprites[i].Image.Channels != first.Channels)
+            {
+                channels = 4;
+                format   = first.HDR ? data::DXGI_FORMAT_R32G32B32A32_FLOAT : data::DXGI_FORMAT_R8G8B8A8_UNORM;
+                break;
+            }
+        }
+        size_t bpc    = first.HDR ? sizeof(float) : sizeof(uint8_t);
+        size_t nbytes = params.Width * params.Height * size_t(channels) * bpc;
+        pages = (image_info_t*) malloc(npages * sizeof(image_info_t));
+        for (size_t i = 0; i < npages && pages != NULL; ++i)
+        {
+            pages[i].Pool     = pool;
+            pages[i].Pixels   = scratch_alloc(pool, nbytes);
+            pages[i].Width    = int(params.Width);
+            pages[i].Height   = int(params.Height);
+            pages[i].Channels = channels;
+            pages[i].Format   = format;
+            pages[i].HDR      = first.HDR;
+            if (pages[i].Pixels != NULL) memset(pages[i].Pixels, 0, nbytes);
+            else res = false;
+        }
+        if (pages == NULL || !res)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for each of %u atlas pages.\n", unsigned(nbytes), unsigned(npages));
+            res = false;
+        }
+        else
+        {
+            job.Pages = pages;
+            parallel_for(params.ThreadCount, count, atlas_blit_work, &job);
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {   // the source images are no longer needed.
+        free_image(sprites[i].Image);
+    }
+
+    if (res)
+    {   // set any 'default to source' parameters. the page size was set
+        // when the parameters were validated.
+        image_info_t const &page = pages[0];
+        params.BaseWidth = params.Width;
+        params.BaseHeight= params.Height;
+        params.ArraySize = npages;
+        if (params.Format == data::DXGI_FORMAT_UNKNOWN)
+        {   // set the format to that of the first image.
+            params.Format  = page.Format;
+        }
+        if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
+        {
+            if (page.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
+            else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
+        }
+        if (params.Mipmaps && params.MaxMipLevels == 0)
+        {   // compute all the way down to 1x1.
+            size_t lw = params.Width;
+            size_t lh = params.Height;
+            while (lw > 1 || lh > 1)
+            {
+                params.MaxMipLevels++;
+                lw >>= 1; if (lw == 0) lw = 1;
+                lh >>= 1; if (lh == 0) lh = 1;
+            }
+            // include the base level in the count.
+            params.MaxMipLevels++;
+        }
+        for (size_t i = 0; i < npages && res; ++i)
+        {
+            if (!write_image_chain(fp, dds, pool, params, pages[i]))
+            {
+                fprintf(fp, "ERROR: Unable to write atlas page %u/%u.\n", unsigned(i), unsigned(npages));
+                res = false;
+            }
+        }
+        if (res) res = write_atlas_table(fp, params, sprites, npages);
+    }
+
+    for (size_t i = 0; i < npages && pages != NULL; ++i)
+    {
+        free_image(pages[i]);
+    }
+    free(pages);
+    free(order);
+    free(sprites);
+    return res;
+}
+
+/// @summary Computes the dimensions, slice sizes and output offsets of every
+/// level of a volume image once the base level dimensions are known.
+/// @param writer The volume writer to initialize.
+/// @param params Image processing parameters.
+static void init_volume_levels(volume_writer_t *writer, dds_params_t const &params)
+{
+    size_t nlevels = params.Mipmaps && params.MaxMipLevels > 1 ? params.MaxMipLevels : 1;
+    size_t offset  = 0;
+    bool   bcn     = data::dds_block_compressed(params.Format);
+    if (nlevels > MAX_MIP_LEVELS) nlevels = MAX_MIP_LEVELS;
+
+    for (size_t i = 0; i < nlevels; ++i)
+    {
+        volume_level_t &lv = writer->Levels[i];
+        lv.Width       = params.Width       >> i; if (lv.Width  == 0) lv.Width  = 1;
+        lv.Height      = params.Height      >> i; if (lv.Height == 0) lv.Height = 1;
+        lv.Depth       = params.SourceCount >> i; if (lv.Depth  == 0) lv.Depth  = 1;
+        lv.SliceSize   = data::dds_pitch(params.Format, lv.Width) * (bcn ? (lv.Height + 3) / 4 : lv.Height);
+        lv.Offset      = offset;
+        lv.SliceCount  = 0;
+        lv.WindowCount = 0;
+        offset        += lv.SliceSize * lv.Depth;
+    }
+    writer->LevelCount = nlevels;
+}
+
+/// @summary Frees any slices still held in the windows of a volume writer.
+/// @param writer The volume writer.
+static void free_volume_windows(volume_writer_t *writer)
+{
+    for (size_t i = 0; i < writer->LevelCount; ++i)
+    {
+        volume_level_t &lv = writer->Levels[i];
+        for (size_t j = 0; j < lv.WindowCount; ++j)
+        {
+            free_image(lv.Window[j]);
+        }
+        lv.WindowCount = 0;
+    }
+}
+
+/// @summary Work item that resamples one slice of a volume window to the
+/// width and height of the next level.
+/// @param index The zero-based index of the slice within the window.
+/// @param context Pointer to the volume_reduce_t.
+static void volume_resize_work(size_t index, void *context)
+{
+    volume_reduce_t    *ctx = (volume_reduce_t*) context;
+    image_info_t const &src = ctx->Inputs [index];
+    image_info_t       &dst = ctx->Reduced[index];
+    if (size_t(src.Width) == ctx->Width && size_t(src.Height) == ctx->Height)
+    {   // reduction in Z only; use the input slice directly.
+        dst = src;
+        return;
+    }
+    if (!resize_image(ctx->Writer->Errors, ctx->Writer->Pool, *ctx->Writer->Params, dst, src, ctx->Width, ctx->Height))
+        ctx->Failed = true;
+}
+
+/// @summary Work item that averages a band of rows across the resampled
+/// window slices to produce the corresponding rows of the next level. LDR
+/// color channels are averaged in linear light when the level is filtered in
+/// the sRGB colorspace, as stb_image_resize does; otherwise the encoded
+/// values are averaged directly.
+/// @param index The zero-based index of the band of VOLUME_BAND_ROWS rows.
+/// @param context Pointer to the volume_reduce_t.
+static void volume_average_work(size_t index, void *context)
+{
+    volume_reduce_t *ctx   = (volume_reduce_t*) context;
+    image_info_t    &out   = *ctx->Output;
+    size_t const     nch   = size_t(out.Channels);
+    size_t const     row0  = index * VOLUME_BAND_ROWS;
+    size_t const     row1  = row0 + VOLUME_BAND_ROWS < ctx->Height ? row0 + VOLUME_BAND_ROWS : ctx->Height;
+    size_t const     first = row0 * ctx->Width * nch;
+    size_t const     last  = row1 * ctx->Width * nch;
+    float  const     scale = 1.0f / float(ctx->InputCount);
+    bool   const  srgb_rgb = filter_srgb(*ctx->Writer->Params, out);
+
+    if (out.HDR)
+    {
+        float *dst = (float*) out.Pixels;
+        for (size_t e = first; e < last; ++e)
+        {
+            float sum = 0.0f;
+            for (size_t i = 0; i < ctx->InputCount; ++i)
+                sum += ((float const*) ctx->Reduced[i].Pixels)[e];
+            dst[e] = sum * scale;
+        }
+    }
+    else
+    {
+        uint8_t *dst = (uint8_t*) out.Pixels;
+        for (size_t e = first; e < last; ++e)
+        {
+            bool  srgb = srgb_rgb && !(nch == 4 && (e % nch) == 3);
+            float sum  = 0.0f;
+            for (size_t i = 0; i < ctx->InputCount; ++i)
+            {
+                uint8_t v = ((uint8_t const*) ctx->Reduced[i].Pixels)[e];
+                sum += srgb ? stbir__srgb_uchar_to_linear_float[v] : float(v) / 255.0f;
+            }
+            sum   *= scale;
+            dst[e] = srgb ? stbir__linear_to_srgb_uchar(sum) : uint8_t(sum * 255.0f + 0.5f);
+        }
+    }
+}
+
+/// @summary Reduces the window of slices held by a level into a single slice
+/// of the next level. The window slices are resampled in X and Y concurrently,
+/// then averaged in Z with the rows split across the worker threads.
+/// @param writer The volume writer.
+/// @param level The zero-based index of the level whose window is reduced.
+/// @param out On return, describes the new slice of level + 1.
+/// @return true if the slice was generated.
+static bool reduce_volume_window(volume_writer_t *writer, size_t level, image_info_t &out)
+{
+    volume_level_t const &lv   = writer->Levels[level];
+    volume_level_t const &next = writer->Levels[level + 1];
+    image_info_t const   &src  = lv.Window[0];
+    image_info_t          reduced[MAX_VOLUME_WINDOW];
+    volume_reduce_t       ctx;
+
+    for (size_t i = 0; i < MAX_VOLUME_WINDOW; ++i)
+    {
+        reduced[i].Pool   = NULL;
+        reduced[i].Pixels = NULL;
+    }
+    ctx.Writer     = writer;
+    ctx.Inputs     = lv.Window;
+    ctx.Reduced    = reduced;
+    ctx.Output     = &out;
+    ctx.InputCount = lv.WindowCount;
+    ctx.Width      = next.Width;
+    ctx.Height     = next.Height;
+    ctx.Failed     = false;
+    parallel_for(writer->Params->ThreadCount, lv.WindowCount, volume_resize_work, &ctx);
+
+    size_t bpc     = src.HDR ? sizeof(float) : sizeof(uint8_t);
+    size_t nbytes  = next.Width * next.Height * size_t(src.Channels) * bpc;
+    out.Pool       = writer->Pool;
+    out.Pixels     = ctx.Failed ? NULL : scratch_alloc(writer->Pool, nbytes);
+    out.Width      = int(next.Width);
+    out.Height     = int(next.Height);
+    out.Channels   = src.Channels;
+    out.Format     = src.Format;
+    out.HDR        = src.HDR;
+    if (out.Pixels != NULL)
+    {
+        size_t nbands = (next.Height + VOLUME_BAND_ROWS - 1) / VOLUME_BAND_ROWS;
+        parallel_for(writer->Params->ThreadCount, nbands, volume_average_work, &ctx);
+        if (writer->Params->NormalMap) renormalize_normals(out);
+        if (preserve_coverage(*writer->Params, out))
+        {   // levels are built from the previous level, which already has the
+            // coverage of the base, so match the mean coverage of the window.
+            float target = 0.0f;
+            for (size_t i = 0; i < lv.WindowCount; ++i)
+            {
+                target += image_coverage(*writer->Params, lv.Window[i]);
+            }
+            apply_coverage(*writer->Params, out, target / float(lv.WindowCount));
+        }
+    }
+    else if (!ctx.Failed)
+    {
+        fprintf(writer->Errors, "ERROR: Unable to allocate %u bytes for volume slice.\n", unsigned(nbytes));
+    }
+
+    for (size_t i = 0; i < lv.WindowCount; ++i)
+    {   // release resampled slices, but not inputs used directly.
+        if (reduced[i].Pixels != lv.Window[i].Pixels)
+            free_image(reduced[i]);
+    }
+    return out.Pixels != NULL;
+}
+
+/// @summary Writes a slice of a volume level to its final position in the
+/// output stream, and reduces it into the next level once the window of slices
+/// contributing to the next slice of that level is complete.
+/// @param writer The volume writer.
+/// @param level The zero-based index of the level the slice belongs to.
+/// @param slice The slice data. Ownership passes to the volume writer.
+/// @return true if the slice, and any slices it completed, were written.
+static bool push_volume_slice(volume_writer_t *writer, size_t level, image_info_t &slice)
+{
+    volume_level_t &lv  = writer->Levels[level];
+    int64_t         pos = writer->DataStart + int64_t(lv.Offset + lv.SliceCount * lv.SliceSize);
+    if (!data::file_seek(writer->Output, pos, SEEK_SET) || !write_pixels(writer->Errors, writer->Output, writer->Pool, *writer->Params, slice))
+    {
+        fprintf(writer->Errors, "ERROR: Unable to write slice %u of level %u.\n", unsigned(lv.SliceCount), unsigned(level));
+        free_image(slice);
+        return false;
+    }
+    lv.SliceCount++;
+
+    if (level + 1 >= writer->LevelCount)
+    {   // this is the last level in the chain.
+        free_image(slice);
+        return true;
+    }
+    lv.Window[lv.WindowCount++] = slice;
+
+    // slice j of the next level covers slices [j*D/Dn, (j+1)*D/Dn) of this one.
+    volume_level_t &next = writer->Levels[level + 1];
+    size_t          end  = ((next.SliceCount + 1) * lv.Depth) / next.Depth;
+    if (lv.SliceCount < end)
+    {   // wait for the remaining slices in the window.
+        return true;
+    }
+
+    image_info_t out;
+    bool res = reduce_volume_window(writer, level, out);
+    for (size_t i = 0; i < lv.WindowCount; ++i)
+    {
+        free_image(lv.Window[i]);
+    }
+    lv.WindowCount = 0;
+    if (!res) return false;
+    return push_volume_slice(writer, level + 1, out);
+}
+
+/// @summary Loads the series of source files specified in the image processing
+/// parameters, and writes them to the DDS output stream as a volume image. If
+/// requested, the mipmap chain is generated by streaming the slices through a
+/// small window per level, reducing in X, Y and Z, so the whole volume is never
+/// resident at once.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for resampled image buffers.
+/// @param params Image processing parameters. These parameters may be updated
+/// with defaults based on the first slice loaded.
+/// @return true if the entire volume image was written to the DDS output stream.
+static bool write_volume_image(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t &params)
+{
+    volume_writer_t writer;
+    writer.Errors      = fp;
+    writer.Output      = dds;
+    writer.Pool        = pool;
+    writer.Params      = &params;
+    writer.DataStart   = data::file_tell(dds);
+    writer.LevelCount  = 0;
+    params.SourceIndex = 0;
+    for (size_t i = 0, n = params.SourceCount; i < n; ++i)
+    {
+        image_info_t slice;
+        if (load_next_source(fp, params, slice))
+        {
+            if (i == 0)
+            {   // set any 'default to source' parameters.
+                if (params.Width  == 0) params.Width  = size_t(slice.Width);
+                if (params.Height == 0) params.Height = size_t(slice.Height);
+                params.BaseWidth   = size_t(slice.Width);
+                params.BaseHeight  = size_t(slice.Height);
+
+                if (params.Format == data::DXGI_FORMAT_UNKNOWN)
+                {   // set the format to that of the base slice.
+                    params.Format  = slice.Format;
+                }
+                if (params.AlphaMode == data::DDS_ALPHA_MODE_UNKNOWN)
+                {   // set the alpha mode based on the number of source channels.
+                    if (slice.Channels == 4) params.AlphaMode = data::DDS_ALPHA_MODE_PREMULTIPLIED;
+                    else params.AlphaMode = data::DDS_ALPHA_MODE_OPAQUE;
+                }
+                if (params.ForcePow2)
+                {   // set Width and Height to the nearest power of 2.
+                    params.Width   = pow2_ge(params.Width , 1);
+                    params.Height  = pow2_ge(params.Height, 1);
+                }
+                if (params.Mipmaps && params.MaxMipLevels == 0)
+                {   // compute all the way down to 1x1x1.
+                    size_t lw = params.Width;
+                    size_t lh = params.Height;
+                    size_t ld = params.SourceCount;
+                    while (lw > 1 || lh > 1 || ld > 1)
+                    {
+                        params.MaxMipLevels++;
+                        lw >>= 1; if (lw == 0) lw = 1;
+                        lh >>= 1; if (lh == 0) lh = 1;
+                        ld >>= 1; if (ld == 0) ld = 1;
+                    }
+                    // include the base level in the count.
+                    params.MaxMipLevels++;
+                }
+                init_volume_levels(&writer, params);
+            }
+
+            if (params.Width != params.BaseWidth || params.Height != params.BaseHeight)
+            {   // explicit resample requested, or we need to force a power-of-two.
+                image_info_t out;
+                if (resize_image(fp, pool, params, out, slice, params.Width, params.Height) == false)
+                {   // resize_image() outputs error messages.
+                    free_image(slice);
+                    free_volume_windows(&writer);
+                    return false;
+                }
+                free_image(slice);
+                slice = out;
+            }
+
+            // write the slice, and any lower-resolution slices it completes.
+            if (!push_volume_slice(&writer, 0, slice))
+            {   // push_volume_slice() outputs error messages.
+                free_volume_windows(&writer);
+                return false;
+            }
+        }
+        else
+        {
+            fprintf(fp, "ERROR: Unable to load slice %u/%u (\'%s\').\n", unsigned(i), unsigned(n), params.SourceFiles[i]);
+            free_volume_windows(&writer);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @summary Retrieves the KTX2 description of a DXGI format.
+/// @param format One of data::dxgi_format_e.
+/// @param out_format On return, stores the KTX2 format description.
+/// @return true if the format can be stored in a KTX2 file.
+static bool ktx2_format(uint32_t format, ktx2_format_t *out_format)
+{
+    static ktx2_format_t const KTX2_FORMATS[] =
+    {
+        // uncompressed formats, one sample per channel in memory order.
+        { data::DXGI_FORMAT_R32G32B32A32_FLOAT , 109, KTX2_MODEL_RGBSDA, 16, 1, 4, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 4, {{0, 0,32}, {1,32,32}, {2,64,32}, {15,96,32}} },
+        { data::DXGI_FORMAT_R32G32B32A32_UINT  , 107, KTX2_MODEL_RGBSDA, 16, 1, 4, KTX2_FORMAT_INTEGER, 4, {{0, 0,32}, {1,32,32}, {2,64,32}, {15,96,32}} },
+        { data::DXGI_FORMAT_R32G32B32A32_SINT  , 108, KTX2_MODEL_RGBSDA, 16, 1, 4, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 4, {{0, 0,32}, {1,32,32}, {2,64,32}, {15,96,32}} },
+        { data::DXGI_FORMAT_R32G32B32_FLOAT    , 106, KTX2_MODEL_RGBSDA, 12, 1, 4, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 3, {{0, 0,32}, {1,32,32}, {2,64,32}} },
+        { data::DXGI_FORMAT_R32G32B32_UINT     , 104, KTX2_MODEL_RGBSDA, 12, 1, 4, KTX2_FORMAT_INTEGER, 3, {{0, 0,32}, {1,32,32}, {2,64,32}} },
+        { data::DXGI_FORMAT_R32G32B32_SINT     , 105, KTX2_MODEL_RGBSDA, 12, 1, 4, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 3, {{0, 0,32}, {1,32,32}, {2,64,32}} },
+        { data::DXGI_FORMAT_R16G16B16A16_FLOAT ,  97, KTX2_MODEL_RGBSDA,  8, 1, 2, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 4, {{0, 0,16}, {1,16,16}, {2,32,16}, {15,48,16}} },
+        { data::DXGI_FORMAT_R16G16B16A16_UNORM ,  91, KTX2_MODEL_RGBSDA,  8, 1, 2, KTX2_FORMAT_NORMALIZED, 4, {{0, 0,16}, {1,16,16}, {2,32,16}, {15,48,16}} },
+        { data::DXGI_FORMAT_R16G16B16A16_UINT  ,  95, KTX2_MODEL_RGBSDA,  8, 1, 2, KTX2_FORMAT_INTEGER, 4, {{0, 0,16}, {1,16,16}, {2,32,16}, {15,48,16}} },
+        { data::DXGI_FORMAT_R16G16B16A16_SNORM ,  92, KTX2_MODEL_RGBSDA,  8, 1, 2, KTX2_FORMAT_SIGNED, 4, {{0, 0,16}, {1,16,16}, {2,32,16}, {15,48,16}} },
+        { data::DXGI_FORMAT_R16G16B16A16_SINT  ,  96, KTX2_MODEL_RGBSDA,  8, 1, 2, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 4, {{0, 0,16}, {1,16,16}, {2,32,16}, {15,48,16}} },
+        { data::DXGI_FORMAT_R32G32_FLOAT       , 103, KTX2_MODEL_RGBSDA,  8, 1, 4, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 2, {{0, 0,32}, {1,32,32}} },
+        { data::DXGI_FORMAT_R32G32_UINT        , 101, KTX2_MODEL_RGBSDA,  8, 1, 4, KTX2_FORMAT_INTEGER, 2, {{0, 0,32}, {1,32,32}} },
+        { data::DXGI_FORMAT_R32G32_SINT        , 102, KTX2_MODEL_RGBSDA,  8, 1, 4, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 2, {{0, 0,32}, {1,32,32}} },
+        { data::DXGI_FORMAT_R10G10B10A2_UNORM  ,  64, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_NORMALIZED, 4, {{0, 0,10}, {1,10,10}, {2,20,10}, {15,30, 2}} },
+        { data::DXGI_FORMAT_R10G10B10A2_UINT   ,  68, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_INTEGER, 4, {{0, 0,10}, {1,10,10}, {2,20,10}, {15,30, 2}} },
+        { data::DXGI_FORMAT_R11G11B10_FLOAT    , 122, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_FLOAT, 3, {{0, 0,11}, {1,11,11}, {2,22,10}} },
+        { data::DXGI_FORMAT_R8G8B8A8_UNORM     ,  37, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_NORMALIZED, 4, {{0, 0, 8}, {1, 8, 8}, {2,16, 8}, {15,24, 8}} },
+        { data::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  43, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_SRGB, 4, {{0, 0, 8}, {1, 8, 8}, {2,16, 8}, {15,24, 8}} },
+        { data::DXGI_FORMAT_R8G8B8A8_UINT      ,  41, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_INTEGER, 4, {{0, 0, 8}, {1, 8, 8}, {2,16, 8}, {15,24, 8}} },
+        { data::DXGI_FORMAT_R8G8B8A8_SNORM     ,  38, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_SIGNED, 4, {{0, 0, 8}, {1, 8, 8}, {2,16, 8}, {15,24, 8}} },
+        { data::DXGI_FORMAT_R8G8B8A8_SINT      ,  42, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 4, {{0, 0, 8}, {1, 8, 8}, {2,16, 8}, {15,24, 8}} },
+        { data::DXGI_FORMAT_R16G16_FLOAT       ,  83, KTX2_MODEL_RGBSDA,  4, 1, 2, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 2, {{0, 0,16}, {1,16,16}} },
+        { data::DXGI_FORMAT_R16G16_UNORM       ,  77, KTX2_MODEL_RGBSDA,  4, 1, 2, KTX2_FORMAT_NORMALIZED, 2, {{0, 0,16}, {1,16,16}} },
+        { data::DXGI_FORMAT_R16G16_UINT        ,  81, KTX2_MODEL_RGBSDA,  4, 1, 2, KTX2_FORMAT_INTEGER, 2, {{0, 0,16}, {1,16,16}} },
+        { data::DXGI_FORMAT_R16G16_SNORM       ,  78, KTX2_MODEL_RGBSDA,  4, 1, 2, KTX2_FORMAT_SIGNED, 2, {{0, 0,16}, {1,16,16}} },
+        { data::DXGI_FORMAT_R16G16_SINT        ,  82, KTX2_MODEL_RGBSDA,  4, 1, 2, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 2, {{0, 0,16}, {1,16,16}} },
+        { data::DXGI_FORMAT_D32_FLOAT          , 126, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_FLOAT, 1, {{14, 0,32}} },
+        { data::DXGI_FORMAT_R32_FLOAT          , 100, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 1, {{0, 0,32}} },
+        { data::DXGI_FORMAT_R32_UINT           ,  98, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_INTEGER, 1, {{0, 0,32}} },
+        { data::DXGI_FORMAT_R32_SINT           ,  99, KTX2_MODEL_RGBSDA,  4, 1, 4, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 1, {{0, 0,32}} },
+        { data::DXGI_FORMAT_R8G8_UNORM         ,  16, KTX2_MODEL_RGBSDA,  2, 1, 1, KTX2_FORMAT_NORMALIZED, 2, {{0, 0, 8}, {1, 8, 8}} },
+        { data::DXGI_FORMAT_R8G8_UINT          ,  20, KTX2_MODEL_RGBSDA,  2, 1, 1, KTX2_FORMAT_INTEGER, 2, {{0, 0, 8}, {1, 8, 8}} },
+        { data::DXGI_FORMAT_R8G8_SNORM         ,  17, KTX2_MODEL_RGBSDA,  2, 1, 1, KTX2_FORMAT_SIGNED, 2, {{0, 0, 8}, {1, 8, 8}} },
+        { data::DXGI_FORMAT_R8G8_SINT          ,  21, KTX2_MODEL_RGBSDA,  2, 1, 1, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 2, {{0, 0, 8}, {1, 8, 8}} },
+        { data::DXGI_FORMAT_R16_FLOAT          ,  76, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 1, {{0, 0,16}} },
+        { data::DXGI_FORMAT_D16_UNORM          , 124, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_NORMALIZED, 1, {{14, 0,16}} },
+        { data::DXGI_FORMAT_R16_UNORM          ,  70, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_NORMALIZED, 1, {{0, 0,16}} },
+        { data::DXGI_FORMAT_R16_UINT           ,  74, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_INTEGER, 1, {{0, 0,16}} },
+        { data::DXGI_FORMAT_R16_SNORM          ,  71, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_SIGNED, 1, {{0, 0,16}} },
+        { data::DXGI_FORMAT_R16_SINT           ,  75, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 1, {{0, 0,16}} },
+        { data::DXGI_FORMAT_R8_UNORM           ,   9, KTX2_MODEL_RGBSDA,  1, 1, 1, KTX2_FORMAT_NORMALIZED, 1, {{0, 0, 8}} },
+        { data::DXGI_FORMAT_R8_UINT            ,  13, KTX2_MODEL_RGBSDA,  1, 1, 1, KTX2_FORMAT_INTEGER, 1, {{0, 0, 8}} },
+        { data::DXGI_FORMAT_R8_SNORM           ,  10, KTX2_MODEL_RGBSDA,  1, 1, 1, KTX2_FORMAT_SIGNED, 1, {{0, 0, 8}} },
+        { data::DXGI_FORMAT_R8_SINT            ,  14, KTX2_MODEL_RGBSDA,  1, 1, 1, KTX2_FORMAT_INTEGER| KTX2_FORMAT_SIGNED, 1, {{0, 0, 8}} },
+        { data::DXGI_FORMAT_B5G6R5_UNORM       ,   4, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_NORMALIZED, 3, {{2, 0, 5}, {1, 5, 6}, {0,11, 5}} },
+        { data::DXGI_FORMAT_B5G5R5A1_UNORM     ,   8, KTX2_MODEL_RGBSDA,  2, 1, 2, KTX2_FORMAT_NORMALIZED, 4, {{2, 0, 5}, {1, 5, 5}, {0,10, 5}, {15,15, 1}} },
+        { data::DXGI_FORMAT_B8G8R8A8_UNORM     ,  44, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_NORMALIZED, 4, {{2, 0, 8}, {1, 8, 8}, {0,16, 8}, {15,24, 8}} },
+        { data::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  50, KTX2_MODEL_RGBSDA,  4, 1, 1, KTX2_FORMAT_SRGB, 4, {{2, 0, 8}, {1, 8, 8}, {0,16, 8}, {15,24, 8}} },
+        // block-compressed formats; samples describe the channels of a 4x4 block.
+        // DXGI BC1 may use 1-bit alpha, so it maps to the BC1_RGBA VkFormats,
+        // whose sample must use KTX2_CHANNEL_BC1A.
+        { data::DXGI_FORMAT_BC1_UNORM          , 133, KTX2_MODEL_BC1A,    8, 4, 1, KTX2_FORMAT_NORMALIZED, 1, {{1, 0,64}} },
+        { data::DXGI_FORMAT_BC1_UNORM_SRGB     , 134, KTX2_MODEL_BC1A,    8, 4, 1, KTX2_FORMAT_SRGB, 1, {{1, 0,64}} },
+        { data::DXGI_FORMAT_BC2_UNORM          , 135, KTX2_MODEL_BC2,    16, 4, 1, KTX2_FORMAT_NORMALIZED, 2, {{15, 0,64}, {0,64,64}} },
+        { data::DXGI_FORMAT_BC2_UNORM_SRGB     , 136, KTX2_MODEL_BC2,    16, 4, 1, KTX2_FORMAT_SRGB, 2, {{15, 0,64}, {0,64,64}} },
+        { data::DXGI_FORMAT_BC3_UNORM          , 137, KTX2_MODEL_BC3,    16, 4, 1, KTX2_FORMAT_NORMALIZED, 2, {{15, 0,64}, {0,64,64}} },
+        { data::DXGI_FORMAT_BC3_UNORM_SRGB     , 138, KTX2_MODEL_BC3,    16, 4, 1, KTX2_FORMAT_SRGB, 2, {{15, 0,64}, {0,64,64}} },
+        { data::DXGI_FORMAT_BC4_UNORM          , 139, KTX2_MODEL_BC4,     8, 4, 1, KTX2_FORMAT_NORMALIZED, 1, {{0, 0,64}} },
+        { data::DXGI_FORMAT_BC4_SNORM          , 140, KTX2_MODEL_BC4,     8, 4, 1, KTX2_FORMAT_SIGNED, 1, {{0, 0,64}} },
+        { data::DXGI_FORMAT_BC5_UNORM          , 141, KTX2_MODEL_BC5,    16, 4, 1, KTX2_FORMAT_NORMALIZED, 2, {{0, 0,64}, {1,64,64}} },
+        { data::DXGI_FORMAT_BC5_SNORM          , 142, KTX2_MODEL_BC5,    16, 4, 1, KTX2_FORMAT_SIGNED, 2, {{0, 0,64}, {1,64,64}} },
+        { data::DXGI_FORMAT_BC6H_UF16          , 143, KTX2_MODEL_BC6H,   16, 4, 1, KTX2_FORMAT_FLOAT, 1, {{0, 0,128}} },
+        { data::DXGI_FORMAT_BC6H_SF16          , 144, KTX2_MODEL_BC6H,   16, 4, 1, KTX2_FORMAT_FLOAT  | KTX2_FORMAT_SIGNED, 1, {{0, 0,128}} },
+        { data::DXGI_FORMAT_BC7_UNORM          , 145, KTX2_MODEL_BC7,    16, 4, 1, KTX2_FORMAT_NORMALIZED, 1, {{0, 0,128}} },
+        { data::DXGI_FORMAT_BC7_UNORM_SRGB     , 146, KTX2_MODEL_BC7,    16, 4, 1, KTX2_FORMAT_SRGB, 1, {{0, 0,128}} }
+    };
+    for (size_t i = 0, n = sizeof(KTX2_FORMATS) / sizeof(KTX2_FORMATS[0]); i < n; ++i)
+    {
+        if (KTX2_FORMATS[i].DxgiFormat == format)
+        {
+            *out_format = KTX2_FORMATS[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @summary Computes the lower and upper bounds of a sample in a KTX2 data
+/// format descriptor, which give the values that map to 0.0 and 1.0.
+/// @param format The KTX2 format description.
+/// @param bits The number of bits in the sample.
+/// @param out_lower On return, stores the value representing 0.0 (or -1.0 if signed).
+/// @param out_upper On return, stores the value representing 1.0.
+static void ktx2_sample_bounds(ktx2_format_t const &format, size_t bits, uint32_t *out_lower, uint32_t *out_upper)
+{
+    bool signed_ = (format.Flags & KTX2_FORMAT_SIGNED) != 0;
+    if (format.Flags & KTX2_FORMAT_FLOAT)
+    {   // -1.0f (or 0.0f) and 1.0f.
+        *out_lower = signed_ ? 0xBF800000U : 0;
+        *out_upper = 0x3F800000U;
+    }
+    else if (format.Flags & KTX2_FORMAT_INTEGER)
+    {
+        *out_lower = signed_ ? 0xFFFFFFFFU : 0;
+        *out_upper = 1;
+    }
+    else if (signed_)
+    {
+        if (bits >= 32)
+        {
+            *out_lower = 0x80000000U;
+            *out_upper = 0x7FFFFFFFU;
+        }
+        else
+        {
+            *out_upper = (1U << (bits - 1)) - 1;
+            *out_lower = uint32_t(-int32_t(*out_upper));
+        }
+    }
+    else
+    {
+        *out_lower = 0;
+        *out_upper = bits >= 32 ? 0xFFFFFFFFU : (1U << bits) - 1;
+    }
+}
+
+/// @summary Builds the data format descriptor for a KTX2 file, consisting of
+/// the total size followed by a single basic descriptor block.
+/// @param dst The buffer to write. Must be at least 92 bytes.
+/// @param format The KTX2 format description.
+/// @param alpha_mode One of data::dds_alpha_mode_e.
+/// @return The number of bytes written to dst.
+static size_t ktx2_dfd(uint8_t *dst, ktx2_format_t const &format, uint32_t alpha_mode)
+{
+    size_t   block = 24 + 16 * size_t(format.SampleCount);
+    uint32_t total = uint32_t(sizeof(uint32_t) + block);
+    uint32_t words[2] =
+    {
+        0,                              // vendorId = Khronos, descriptorType = basic.
+        2U | (uint32_t(block) << 16)    // versionNumber = 2, descriptorBlockSize.
+    };
+    uint8_t  *p = dst;
+    memcpy(p, &total, sizeof(uint32_t)); p += sizeof(uint32_t);
+    memcpy(p,  words, sizeof(words));    p += sizeof(words);
+    *p++ = format.ColorModel;
+    *p++ = 1;                                                   // BT.709 primaries.
+    *p++ = (format.Flags & KTX2_FORMAT_SRGB) ? 2 : 1;           // sRGB or linear transfer.
+    *p++ = (alpha_mode == data::DDS_ALPHA_MODE_PREMULTIPLIED) ? 1 : 0;
+    *p++ = uint8_t(format.BlockSize - 1);
+    *p++ = uint8_t(format.BlockSize - 1);
+    *p++ = 0;
+    *p++ = 0;
+    memset(p, 0, 8);
+    *p   = format.BlockBytes;                                   // bytesPlane0.
+    p   += 8;
+    for (size_t i = 0; i < format.SampleCount; ++i)
+    {
+        uint8_t  channel = format.Samples[i][0];
+        uint16_t offset  = format.Samples[i][1];
+        uint8_t  length  = uint8_t(format.Samples[i][2] - 1);
+        uint32_t lower   = 0;
+        uint32_t upper   = 0;
+        if (format.Flags & KTX2_FORMAT_FLOAT ) channel |= 0x80;
+        if (format.Flags & KTX2_FORMAT_SIGNED) channel |= 0x40;
+        if (channel == KTX2_CHANNEL_A && (format.Flags & KTX2_FORMAT_SRGB))
+        {   // alpha is always linear, even in sRGB formats.
+            channel |= 0x10;
+        }
+        ktx2_sample_bounds(format, format.Samples[i][2], &lower, &upper);
+        memcpy(p, &offset, sizeof(uint16_t)); p += sizeof(uint16_t);
+        *p++ = length;
+        *p++ = channel;
+        memset(p, 0, 4);                      p += 4; // sample position.
+        memcpy(p, &lower, sizeof(uint32_t));  p += sizeof(uint32_t);
+        memcpy(p, &upper, sizeof(uint32_t));  p += sizeof(uint32_t);
+    }
+    return size_t(p - dst);
+}
+
+/// @summary Writes zero bytes to a file to pad it to a given alignment.
+/// @param fp The output stream.
+/// @param offset The current offset within the output stream.
+/// @param alignment The required alignment, in bytes.
+/// @return The aligned offset.
+static size_t write_padding(FILE *fp, size_t offset, size_t alignment)
+{
+    static uint8_t const zeroes[16] = { 0 };
+    size_t aligned = ((offset + alignment - 1) / alignment) * alignment;
+    size_t count   = aligned - offset;
+    while (count > 0)
+    {
+        size_t n = count < sizeof(zeroes) ? count : sizeof(zeroes);
+        fwrite(zeroes, 1, n, fp);
+        count -= n;
+    }
+    return aligned;
+}
+
+/// @summary Writes the encoded output as a KTX2 file. The DDS has already
+/// been written, so its level table is used to copy each encoded subresource
+/// into the KTX2 container; no image data is re-processed.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param params Image processing parameters. OutputFile specifies the DDS.
+/// @return true if the KTX2 file was written.
+static bool write_ktx2(FILE *fp, dds_params_t const &params)
+{
+    char        path[4096];
+    char const *target = params.Ktx2File;
+    if (target == NULL)
+    {   // replace the extension of the output file with '.ktx2'.
+        if (!replace_extension(path, sizeof(path), params.OutputFile, ".ktx2"))
+        {
+            fprintf(fp, "ERROR: The output path is too long to derive the KTX2 path.\n");
+            return false;
+        }
+        target = path;
+    }
+
+    data::dds_file_t *dds_file = data::dds_open(params.OutputFile);
+    if (dds_file == NULL || !dds_file->HasHeaderEx)
+    {
+        fprintf(fp, "ERROR: Unable to reload \'%s\' to write the KTX2 file.\n", params.OutputFile);
+        data::dds_close(dds_file);
+        return false;
+    }
+    data::dds_header_t       const &dds    = dds_file->Header;
+    data::dds_header_dxt10_t const &dx10   = dds_file->HeaderEx;
+    data::dds_level_desc_t   const *levels = dds_file->Levels;
+
+    ktx2_format_t format;
+    if (!ktx2_format(dx10.Format, &format))
+    {
+        fprintf(fp, "ERROR: DXGI format %u cannot be written to a KTX2 file.\n", unsigned(dx10.Format));
+        data::dds_close(dds_file);
+        return false;
+    }
+
+    size_t item_count  = dds_file->ItemCount;
+    size_t level_count = dds_file->LevelCount;
+    data::ktx2_level_index_t *index = (data::ktx2_level_index_t*) malloc(level_count * sizeof(data::ktx2_level_index_t));
+    if (index == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate the KTX2 level index.\n");
+        data::dds_close(dds_file);
+        return false;
+    }
+
+    // the level index is followed by the DFD and key/value data. the level
+    // data is stored smallest level first, each aligned to lcm(block, 4).
+    static char const  kvd_pair[] = "KTXwriter\0makedds";
+    uint8_t            dfd[4 + 24 + 16 * 4];
+    size_t             dfd_size   = ktx2_dfd(dfd, format, dx10.Flags2);
+    uint32_t           kvd_length = uint32_t(sizeof(kvd_pair));
+    size_t             kvd_end    = sizeof(uint32_t) + sizeof(kvd_pair);
+    size_t             kvd_size   = (kvd_end + 3) & ~size_t(3); // includes valuePadding.
+    size_t             dfd_offset = sizeof(data::ktx2_header_t) + level_count * sizeof(data::ktx2_level_index_t);
+    size_t             kvd_offset = dfd_offset + dfd_size;
+    size_t             alignment  = format.BlockBytes;
+    while (alignment % 4 != 0) alignment += format.BlockBytes;
+    size_t             offset     = kvd_offset + kvd_size;
+    for (size_t i = level_count; i > 0; --i)
+    {
+        size_t level = i - 1;
+        size_t bytes = 0;
+        for (size_t j = 0; j < item_count; ++j)
+        {
+            bytes += levels[j * level_count + level].DataSize;
+        }
+        offset  = ((offset + alignment - 1) / alignment) * alignment;
+        index[level].ByteOffset             = offset;
+        index[level].ByteLength             = bytes;
+        index[level].UncompressedByteLength = bytes;
+        offset += bytes;
+    }
+
+    data::ktx2_header_t head;
+    bool cubemap = data::dds_cubemap(&dds, &dx10);
+    memcpy(head.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    head.VkFormat               = format.VkFormat;
+    head.TypeSize               = format.TypeSize;
+    head.PixelWidth             = dds.Width;
+    head.PixelHeight            = dds.Height;
+    head.PixelDepth             = data::dds_volume(&dds, &dx10) ? dds.Depth : 0;
+    head.LayerCount             = dx10.ArraySize > 1 ? dx10.ArraySize : 0;
+    head.FaceCount              = cubemap ? 6 : 1;
+    head.LevelCount             = uint32_t(level_count);
+    head.SupercompressionScheme = 0;
+    head.DfdByteOffset          = uint32_t(dfd_offset);
+    head.DfdByteLength          = uint32_t(dfd_size);
+    head.KvdByteOffset          = uint32_t(kvd_offset);
+    head.KvdByteLength          = uint32_t(kvd_size);
+    head.SgdByteOffset          = 0;
+    head.SgdByteLength          = 0;
+
+    FILE *ktx = fopen(target, "wb");
+    if (ktx == NULL)
+    {
+        fprintf(fp, "ERROR: Cannot open KTX2 output file \'%s\'.\n", target);
+        free(index); data::dds_close(dds_file);
+        return false;
+    }
+    fwrite(&head, sizeof(data::ktx2_header_t), 1, ktx);
+    fwrite(index, sizeof(data::ktx2_level_index_t), level_count, ktx);
+    fwrite(dfd, 1, dfd_size, ktx);
+    fwrite(&kvd_length, sizeof(uint32_t), 1, ktx);
+    fwrite(kvd_pair, 1, sizeof(kvd_pair), ktx);
+    offset = write_padding(ktx, kvd_offset + kvd_end, 4);
+    for (size_t i = level_count; i > 0; --i)
+    {   // within a level, data is ordered by layer, then face, then slice,
+        // which matches the item order of the DDS.
+        size_t level = i - 1;
+        offset = write_padding(ktx, offset, alignment);
+        for (size_t j = 0; j < item_count; ++j)
+        {
+            data::dds_level_desc_t const &desc = levels[j * level_count + level];
+            fwrite(desc.LevelData, 1, desc.DataSize, ktx);
+            offset += desc.DataSize;
+        }
+    }
+    bool res = (ferror(ktx) == 0);
+    res = fclose(ktx) == 0 && res;
+    free(index); data::dds_close(dds_file);
+    if (!res)
+    {
+        fprintf(fp, "ERROR: Unable to write KTX2 output file \'%s\'.\n", target);
+    }
+    return res;
+}
+
+/// @summary Work item that compresses one subresource of a DDS. Subresources
+/// that do not shrink are left uncompressed.
+/// @param index The zero-based index of the subresource.
+/// @param context Pointer to the ddsz_job_t.
+static void ddsz_compress_work(size_t index, void *context)
+{
+    ddsz_job_t                   *job   = (ddsz_job_t*) context;
+    data::dds_level_desc_t const &level = job->Levels[index];
+    size_t                        bound = data::lz_compress_bound(level.DataSize);
+    uint8_t                      *buf   = (uint8_t*) malloc(bound);
+    size_t                        size  = 0;
+    if (buf != NULL)
+    {
+        size = data::lz_compress(buf, bound, level.LevelData, level.DataSize);
+    }
+    if (size == 0 || size >= level.DataSize)
+    {   // store the subresource uncompressed.
+        free(buf);
+        buf  = NULL;
+        size = level.DataSize;
+    }
+    job->Buffers[index] = buf;
+    job->Chunks [index].Offset           = 0;
+    job->Chunks [index].CompressedSize   = uint32_t(size);
+    job->Chunks [index].UncompressedSize = uint32_t(level.DataSize);
+}
+
+/// @summary Writes a supercompressed copy of the output DDS. Each subresource
+/// is compressed independently, so they can be decoded in parallel.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param params Image processing parameters. OutputFile specifies the DDS.
+/// @return true if the .ddsz file was written.
+static bool write_ddsz(FILE *fp, dds_params_t const &params)
+{
+    char        path[4096];
+    char const *target = params.SupercompressFile;
+    if (target == NULL)
+    {   // replace the extension of the output file with '.ddsz'.
+        if (!replace_extension(path, sizeof(path), params.OutputFile, ".ddsz"))
+        {
+            fprintf(fp, "ERROR: The output path is too long to derive the .ddsz path.\n");
+            return false;
+        }
+        target = path;
+    }
+
+    data::dds_file_t *dds_file = data::dds_open(params.OutputFile);
+    if (dds_file == NULL || !dds_file->HasHeaderEx)
+    {
+        fprintf(fp, "ERROR: Unable to reload \'%s\' to write the .ddsz file.\n", params.OutputFile);
+        data::dds_close(dds_file);
+        return false;
+    }
+
+    size_t      count   = dds_file->SubresourceCount;
+    size_t      hsize   = sizeof(uint32_t) + sizeof(data::dds_header_t) + sizeof(data::dds_header_dxt10_t);
+    ddsz_job_t  job;
+    job.Levels  = dds_file->Levels;
+    job.Chunks  = (data::ddsz_chunk_t    *) malloc(count * sizeof(data::ddsz_chunk_t));
+    job.Buffers = (uint8_t              **) calloc(count , sizeof(uint8_t*));
+    if (job.Chunks == NULL || job.Buffers == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate the .ddsz chunk table.\n");
+        free(job.Buffers); free(job.Chunks); data::dds_close(dds_file);
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (job.Levels[i].DataSize > 0xFFFFFFFFU)
+        {
+            fprintf(fp, "ERROR: Subresource %u is too large to supercompress.\n", unsigned(i));
+            free(job.Buffers); free(job.Chunks); data::dds_close(dds_file);
+            return false;
+        }
+    }
+    parallel_for(params.ThreadCount, count, ddsz_compress_work, &job);
+
+    // the chunk data follows the headers and chunk table.
+    data::ddsz_header_t head;
+    uint64_t            offset = sizeof(data::ddsz_header_t) + hsize + count * sizeof(data::ddsz_chunk_t);
+    uint64_t            total  = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        job.Chunks[i].Offset = offset;
+        offset += job.Chunks[i].CompressedSize;
+        total  += job.Chunks[i].UncompressedSize;
+    }
+    head.Magic      = LLDATAIN_DDSZ_MAGIC_LE;
+    head.Version    = 1;
+    head.Codec      = data::DDSZ_CODEC_LZ;
+    head.ChunkCount = uint32_t(count);
+    head.HeaderSize = uint32_t(hsize);
+    head.DataSize   = total;
+
+    bool  res = false;
+    FILE *out = fopen(target, "wb");
+    if (out != NULL)
+    {
+        fwrite(&head, sizeof(data::ddsz_header_t), 1, out);
+        fwrite(dds_file->Data, 1, hsize, out);
+        fwrite(job.Chunks, sizeof(data::ddsz_chunk_t), count, out);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (job.Buffers[i] != NULL) fwrite(job.Buffers[i], 1, job.Chunks[i].CompressedSize, out);
+            else fwrite(job.Levels[i].LevelData, 1, job.Chunks[i].CompressedSize, out);
+        }
+        res = (ferror(out) == 0);
+        res = fclose(out) == 0 && res;
+        if (!res) fprintf(fp, "ERROR: Unable to write .ddsz output file \'%s\'.\n", target);
+    }
+    else fprintf(fp, "ERROR: Cannot open .ddsz output file \'%s\'.\n", target);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        free(job.Buffers[i]);
+    }
+    free(job.Buffers); free(job.Chunks); data::dds_close(dds_file);
+    return res;
+}
+
+/// @summary Determines which channels of a format are examined by --verify.
+/// @param format One of data::dxgi_format_e.
+/// @return A string naming the channels present in the format, in RGBA order,
+/// or NULL if texel statistics cannot be computed for the format.
+static char const* format_channels(uint32_t format)
+{
+    switch (format)
+    {
+        case data::DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case data::DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case data::DXGI_FORMAT_R16G16B16A16_UNORM:
+        case data::DXGI_FORMAT_R16G16B16A16_SNORM:
+        case data::DXGI_FORMAT_R10G10B10A2_UNORM:
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM:
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_R8G8B8A8_SNORM:
+        case data::DXGI_FORMAT_B5G5R5A1_UNORM:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC1_TYPELESS:
+        case data::DXGI_FORMAT_BC1_UNORM:
+        case data::DXGI_FORMAT_BC1_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC2_TYPELESS:
+        case data::DXGI_FORMAT_BC2_UNORM:
+        case data::DXGI_FORMAT_BC2_UNORM_SRGB:
+        case data::DXGI_FORMAT_BC3_TYPELESS:
+        case data::DXGI_FORMAT_BC3_UNORM:
+        case data::DXGI_FORMAT_BC3_UNORM_SRGB:
+            return "RGBA";
+        case data::DXGI_FORMAT_R32G32B32_FLOAT:
+        case data::DXGI_FORMAT_B5G6R5_UNORM:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return "RGB";
+        case data::DXGI_FORMAT_R32G32_FLOAT:
+        case data::DXGI_FORMAT_R16G16_FLOAT:
+        case data::DXGI_FORMAT_R16G16_UNORM:
+        case data::DXGI_FORMAT_R8G8_UNORM:
+        case data::DXGI_FORMAT_R8G8_SNORM:
+        case data::DXGI_FORMAT_BC5_TYPELESS:
+        case data::DXGI_FORMAT_BC5_UNORM:
+        case data::DXGI_FORMAT_BC5_SNORM:
+            return "RG";
+        case data::DXGI_FORMAT_R32_FLOAT:
+        case data::DXGI_FORMAT_R16_FLOAT:
+        case data::DXGI_FORMAT_R16_UNORM:
+        case data::DXGI_FORMAT_R8_UNORM:
+        case data::DXGI_FORMAT_R8_SNORM:
+        case data::DXGI_FORMAT_BC4_TYPELESS:
+        case data::DXGI_FORMAT_BC4_UNORM:
+        case data::DXGI_FORMAT_BC4_SNORM:
+            return "R";
+        case data::DXGI_FORMAT_A8_UNORM:
+            return "A";
+        default:
+            break;
+    }
+    return NULL;
+}
+
+/// @summary Converts an IEEE 754 half-precision value to single precision.
+/// @param h The half-precision value.
+/// @return The equivalent single-precision value.
+static inline float half_to_float(uint16_t h)
+{
+    uint32_t sign = uint32_t(h & 0x8000U) << 16;
+    uint32_t expo = (h >> 10) & 0x1FU;
+    uint32_t mant =  h & 0x3FFU;
+    uint32_t bits = 0;
+    float    f    = 0.0f;
+    if (expo == 0)
+    {   // zero or subnormal; the value is mant * 2^-24.
+        f = float(mant) * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    if (expo == 0x1F) bits = sign | 0x7F800000U | (mant << 13);
+    else bits = sign | ((expo + 112) << 23) | (mant << 13);
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+/// @summary Converts the bits of an IEEE 754 single-precision value to float.
+static inline float f32_to_float(uint32_t v)
+{
+    float f;
+    memcpy(&f, &v, sizeof(float));
+    return f;
+}
+
+/// @summary Converts 8-bit and 16-bit normalized integer values to float.
+static inline float unorm16_to_float(uint16_t v)
+{
+    return float(v) * (1.0f / 65535.0f);
+}
+static inline float snorm16_to_float(uint16_t v)
+{
+    float f = float(int16_t(v)) * (1.0f / 32767.0f);
+    return f < -1.0f ? -1.0f : f;
+}
+static inline float snorm8_to_float(uint8_t v)
+{
+    float f = float(int8_t(v)) * (1.0f / 127.0f);
+    return f < -1.0f ? -1.0f : f;
+}
+
+/// @summary Converts a row of texels made up of n components of the same type
+/// to RGBA32F. Missing color channels are set to 0, and missing alpha to 1.
+/// @param dst The destination buffer, with room for width RGBA32F texels.
+/// @param src The first texel of the row.
+/// @param width The number of texels in the row.
+/// @param n The number of components in each texel, in [1, 4].
+template <typename T, float (*convert)(T)>
+static void decode_components(float *dst, uint8_t const *src, size_t width, size_t n)
+{
+    for (size_t i = 0; i < width; ++i, dst += 4)
+    {
+        dst[0] = 0.0f; dst[1] = 0.0f; dst[2] = 0.0f; dst[3] = 1.0f;
+        for (size_t c = 0; c < n; ++c, src += sizeof(T))
+        {
+            T v;
+            memcpy(&v, src, sizeof(T));
+            dst[c] = convert(v);
+        }
+    }
+}
+
+/// @summary Converts a row of 8-bit UNORM texels to RGBA8. Rows that are
+/// already RGBA8 are returned in-place without being copied.
+/// @param format One of data::dxgi_format_e.
+/// @param src The first texel of the row.
+/// @param width The number of texels in the row.
+/// @param dst The destination buffer, with room for width RGBA8 texels.
+/// @return A pointer to the RGBA8 texels of the row, or NULL if format is not
+/// an 8-bit UNORM format.
+static uint8_t const* decode_row_rgba8(uint32_t format, uint8_t const *src, size_t width, uint8_t *dst)
+{
+    uint8_t *out = dst;
+    switch (format)
+    {
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM:
+        case data::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            return src;
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM:
+        case data::DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            for (size_t i = 0; i < width; ++i, src += 4, out += 4)
+            {
+                out[0] = src[2]; out[1] = src[1]; out[2] = src[0]; out[3] = src[3];
+            }
+            return dst;
+        case data::DXGI_FORMAT_R8G8_UNORM:
+            for (size_t i = 0; i < width; ++i, src += 2, out += 4)
+            {
+                out[0] = src[0]; out[1] = src[1]; out[2] = 0; out[3] = 255;
+            }
+            return dst;
+        case data::DXGI_FORMAT_R8_UNORM:
+            for (size_t i = 0; i < width; ++i, src += 1, out += 4)
+            {
+                out[0] = src[0]; out[1] = 0; out[2] = 0; out[3] = 255;
+            }
+            return dst;
+        case data::DXGI_FORMAT_A8_UNORM:
+            for (size_t i = 0; i < width; ++i, src += 1, out += 4)
+            {
+                out[0] = 0; out[1] = 0; out[2] = 0; out[3] = src[0];
+            }
+            return dst;
+        default:
+            break;
+    }
+    return NULL;
+}
+
+/// @summary Converts a row of texels in any format listed by format_channels()
+/// that is not handled by decode_row_rgba8() to RGBA32F.
+/// @param format One of data::dxgi_format_e.
+/// @param src The first texel of the row.
+/// @param width The number of texels in the row.
+/// @param dst The destination buffer, with room for width RGBA32F texels.
+/// @return true if the row was converted.
+static bool decode_row_float(uint32_t format, uint8_t const *src, size_t width, float *dst)
+{
+    switch (format)
+    {
+        case data::DXGI_FORMAT_R32G32B32A32_FLOAT:
+            decode_components<uint32_t, f32_to_float>(dst, src, width, 4);
+            return true;
+        case data::DXGI_FORMAT_R32G32B32_FLOAT:
+            decode_components<uint32_t, f32_to_float>(dst, src, width, 3);
+            return true;
+        case data::DXGI_FORMAT_R32G32_FLOAT:
+            decode_components<uint32_t, f32_to_float>(dst, src, width, 2);
+            return true;
+        case data::DXGI_FORMAT_R32_FLOAT:
+            decode_components<uint32_t, f32_to_float>(dst, src, width, 1);
+            return true;
+        case data::DXGI_FORMAT_R16G16B16A16_FLOAT:
+            decode_components<uint16_t, half_to_float>(dst, src, width, 4);
+            return true;
+        case data::DXGI_FORMAT_R16G16_FLOAT:
+            decode_components<uint16_t, half_to_float>(dst, src, width, 2);
+            return true;
+        case data::DXGI_FORMAT_R16_FLOAT:
+            decode_components<uint16_t, half_to_float>(dst, src, width, 1);
+            return true;
+        case data::DXGI_FORMAT_R16G16B16A16_UNORM:
+            decode_components<uint16_t, unorm16_to_float>(dst, src, width, 4);
+            return true;
+        case data::DXGI_FORMAT_R16G16_UNORM:
+            decode_components<uint16_t, unorm16_to_float>(dst, src, width, 2);
+            return true;
+        case data::DXGI_FORMAT_R16_UNORM:
+            decode_components<uint16_t, unorm16_to_float>(dst, src, width, 1);
+            return true;
+        case data::DXGI_FORMAT_R16G16B16A16_SNORM:
+            decode_components<uint16_t, snorm16_to_float>(dst, src, width, 4);
+            return true;
+        case data::DXGI_FORMAT_R8G8B8A8_SNORM:
+            decode_components<uint8_t, snorm8_to_float>(dst, src, width, 4);
+            return true;
+        case data::DXGI_FORMAT_R8G8_SNORM:
+            decode_components<uint8_t, snorm8_to_float>(dst, src, width, 2);
+            return true;
+        case data::DXGI_FORMAT_R8_SNORM:
+            decode_components<uint8_t, snorm8_to_float>(dst, src, width, 1);
+            return true;
+        default:
+            break;
+    }
+    for (size_t i = 0; i < width; ++i, dst += 4)
+    {
+        uint32_t v = 0;
+        switch (format)
+        {
+            case data::DXGI_FORMAT_R10G10B10A2_UNORM:
+                memcpy(&v, src, 4); src += 4;
+                dst[0] = float((v      ) & 0x3FF) * (1.0f / 1023.0f);
+                dst[1] = float((v >> 10) & 0x3FF) * (1.0f / 1023.0f);
+                dst[2] = float((v >> 20) & 0x3FF) * (1.0f / 1023.0f);
+                dst[3] = float((v >> 30)        ) * (1.0f / 3.0f);
+                break;
+            case data::DXGI_FORMAT_B5G6R5_UNORM:
+                v = uint32_t(src[0]) | (uint32_t(src[1]) << 8); src += 2;
+                dst[0] = float((v >> 11) & 0x1F) * (1.0f / 31.0f);
+                dst[1] = float((v >>  5) & 0x3F) * (1.0f / 63.0f);
+                dst[2] = float((v      ) & 0x1F) * (1.0f / 31.0f);
+                dst[3] = 1.0f;
+                break;
+            case data::DXGI_FORMAT_B5G5R5A1_UNORM:
+                v = uint32_t(src[0]) | (uint32_t(src[1]) << 8); src += 2;
+                dst[0] = float((v >> 10) & 0x1F) * (1.0f / 31.0f);
+                dst[1] = float((v >>  5) & 0x1F) * (1.0f / 31.0f);
+                dst[2] = float((v      ) & 0x1F) * (1.0f / 31.0f);
+                dst[3] = float((v >> 15)        );
+                break;
+            default:
+                return false;
+        }
+    }
     return true;
 }
 
+/// @summary Resets a set of texel statistics.
+/// @param stats The statistics to reset.
+static void init_stats(texel_stats_t *stats)
+{
+    for (size_t c = 0; c < 4; ++c)
+    {
+        stats->Min[c] =  FLT_MAX;
+        stats->Max[c] = -FLT_MAX;
+        stats->Sum[c] =  0.0;
+    }
+    stats->Count     = 0;
+    stats->NonFinite = 0;
+}
+
+/// @summary Accumulates statistics for a run of RGBA8 texels. The values are
+/// reduced as integers and normalized to [0, 1] once per call.
+/// @param stats The statistics to update.
+/// @param rgba The RGBA8 texels.
+/// @param count The number of texels. Must be greater than zero.
+static void accumulate_rgba8(texel_stats_t *stats, uint8_t const *rgba, size_t count)
+{
+    uint32_t lo [4] = { 255, 255, 255, 255 };
+    uint32_t hi [4] = { 0, 0, 0, 0 };
+    uint64_t sum[4] = { 0, 0, 0, 0 };
+    size_t   i      = 0;
+#if MAKEDDS_SSE2
+    if (count >= 4)
+    {   // reduce four texels per step. the 16-bit sums are widened after
+        // at most 128 steps, before they can overflow.
+        __m128i const zero = _mm_setzero_si128();
+        __m128i       vlo  = _mm_set1_epi8(char(0xFF));
+        __m128i       vhi  = zero;
+        uint32_t      s32[4];
+        uint8_t       blo[16];
+        uint8_t       bhi[16];
+        while (i + 4 <= count)
+        {
+            __m128i acc = zero;
+            for (size_t n = 0; n < 128 && i + 4 <= count; ++n, i += 4, rgba += 16)
+            {
+                __m128i v = _mm_loadu_si128((__m128i const*) rgba);
+                vlo = _mm_min_epu8(vlo, v);
+                vhi = _mm_max_epu8(vhi, v);
+                acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+            }
+            // lanes 0-3 and 4-7 of acc hold the RGBA sums of alternate texels.
+            acc = _mm_add_epi32(_mm_unpacklo_epi16(acc, zero), _mm_unpackhi_epi16(acc, zero));
+            _mm_storeu_si128((__m128i*) s32, acc);
+            for (size_t c = 0; c < 4; ++c) sum[c] += s32[c];
+        }
+        _mm_storeu_si128((__m128i*) blo, vlo);
+        _mm_storeu_si128((__m128i*) bhi, vhi);
+        for (size_t k = 0; k < 16; ++k)
+        {
+            lo[k & 3] = blo[k] < lo[k & 3] ? blo[k] : lo[k & 3];
+            hi[k & 3] = bhi[k] > hi[k & 3] ? bhi[k] : hi[k & 3];
+        }
+    }
+#endif
+    for ( ; i < count; ++i, rgba += 4)
+    {
+        for (size_t c = 0; c < 4; ++c)
+        {
+            uint32_t v = rgba[c];
+            lo [c]     = v < lo[c] ? v : lo[c];
+            hi [c]     = v > hi[c] ? v : hi[c];
+            sum[c]    += v;
+        }
+    }
+    for (size_t c = 0; c < 4; ++c)
+    {
+        float vmin    = float(lo[c]) * (1.0f / 255.0f);
+        float vmax    = float(hi[c]) * (1.0f / 255.0f);
+        stats->Min[c] = vmin < stats->Min[c] ? vmin : stats->Min[c];
+        stats->Max[c] = vmax > stats->Max[c] ? vmax : stats->Max[c];
+        stats->Sum[c]+= double(sum[c]) / 255.0;
+    }
+    stats->Count += count;
+}
+
+/// @summary Accumulates statistics for a run of RGBA32F texels. NaN and
+/// infinite values are counted, but excluded from the min/max/sum.
+/// @param stats The statistics to update.
+/// @param rgba The RGBA32F texels.
+/// @param count The number of texels.
+static void accumulate_float(texel_stats_t *stats, float const *rgba, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, rgba += 4)
+    {
+        for (size_t c = 0; c < 4; ++c)
+        {
+            float v = rgba[c];
+            if (!(v - v == 0.0f))
+            {   // NaN or infinity.
+                stats->NonFinite++;
+                continue;
+            }
+            stats->Min[c] = v < stats->Min[c] ? v : stats->Min[c];
+            stats->Max[c] = v > stats->Max[c] ? v : stats->Max[c];
+            stats->Sum[c]+= v;
+        }
+    }
+    stats->Count += count;
+}
+
+/// @summary Combines two sets of texel statistics.
+/// @param dst The statistics to update.
+/// @param src The statistics to merge into dst.
+static void merge_stats(texel_stats_t *dst, texel_stats_t const *src)
+{
+    for (size_t c = 0; c < 4; ++c)
+    {
+        dst->Min[c] = src->Min[c] < dst->Min[c] ? src->Min[c] : dst->Min[c];
+        dst->Max[c] = src->Max[c] > dst->Max[c] ? src->Max[c] : dst->Max[c];
+        dst->Sum[c]+= src->Sum[c];
+    }
+    dst->Count     += src->Count;
+    dst->NonFinite += src->NonFinite;
+}
+
+/// @summary Computes the texel statistics for one band of a subresource.
+/// Block-compressed data is decoded one row of blocks at a time, and the
+/// padding texels beyond the edges of the level are excluded.
+/// @param index The zero-based index of the band.
+/// @param context Pointer to the verify_job_t.
+static void verify_band_work(size_t index, void *context)
+{
+    verify_job_t                 *job     = (verify_job_t*) context;
+    verify_band_t                &band    = job->Bands[index];
+    data::dds_level_desc_t const &desc    = job->File->Levels[band.Subresource];
+    uint8_t const                *base    = (uint8_t const*) desc.LevelData + band.Slice * desc.BytesPerSlice;
+    uint32_t                      decoded = data::bc_decode_format(desc.Format);
+    size_t                        width   = level_dimension(job->File->Header.Width , desc.Index);
+    size_t                        height  = level_dimension(job->File->Header.Height, desc.Index);
+    size_t                        pitch   = desc.Width * 4;
+    uint8_t                      *texels  = (uint8_t*) scratch_alloc(job->Pool, pitch * 4 + desc.Width * 4 * sizeof(float));
+    float                        *values  = (float  *) (texels + pitch * 4);
+
+    init_stats(&band.Stats);
+    band.Decoded = false;
+    if (texels == NULL)
+    {   // the caller reports the failure.
+        return;
+    }
+    if (decoded != data::DXGI_FORMAT_UNKNOWN)
+    {
+        for (size_t y = band.Row; y < band.Row + band.RowCount; y += 4)
+        {
+            if (!data::bc_decode_rows(texels, pitch, &desc, band.Slice, y / 4, 1))
+            {   // the caller reports the failure.
+                scratch_free(job->Pool, texels);
+                return;
+            }
+            for (size_t r = 0; r < 4 && y + r < height; ++r)
+            {
+                uint8_t const *src = texels + r * pitch;
+                if (decoded == data::DXGI_FORMAT_R8G8B8A8_SNORM)
+                {
+                    decode_row_float(decoded, src, width, values);
+                    accumulate_float(&band.Stats, values, width);
+                }
+                else accumulate_rgba8(&band.Stats, src, width);
+            }
+        }
+        scratch_free(job->Pool, texels);
+        band.Decoded = true;
+        return;
+    }
+    for (size_t y = band.Row; y < band.Row + band.RowCount; ++y)
+    {
+        uint8_t const *src  = base + y * desc.BytesPerRow;
+        uint8_t const *rgba = decode_row_rgba8(desc.Format, src, width, texels);
+        if (rgba != NULL)
+        {
+            accumulate_rgba8(&band.Stats, rgba, width);
+        }
+        else if (decode_row_float(desc.Format, src, width, values))
+        {
+            accumulate_float(&band.Stats, values, width);
+        }
+        else
+        {
+            scratch_free(job->Pool, texels);
+            return;
+        }
+    }
+    scratch_free(job->Pool, texels);
+    band.Decoded = true;
+}
+
+/// @summary Checks the headers of a mapped DDS for internal consistency and
+/// checks that the payload size matches the size described by the headers.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param path The path of the DDS, used in messages.
+/// @param file The DDS returned by data::dds_open().
+/// @return The number of errors found.
+static size_t check_dds(FILE *fp, char const *path, data::dds_file_t const *file)
+{
+    data::dds_header_t       const &dds = file->Header;
+    data::dds_header_dxt10_t const *ex  = file->HasHeaderEx ? &file->HeaderEx : NULL;
+    data::dds_level_desc_t   const &top = file->Levels[0];
+    data::dds_level_desc_t   const &end = file->Levels[file->SubresourceCount - 1];
+    size_t                   errors     = 0;
+
+    if (data::dds_bits_per_pixel(file->Format) == 0)
+    {
+        fprintf(fp, "ERROR: %s: Unknown or unsupported DXGI format %u.\n", path, unsigned(file->Format));
+        errors++;
+    }
+    if ((dds.Flags & data::DDSD_WIDTH) == 0 || (dds.Flags & data::DDSD_HEIGHT) == 0 || dds.Width == 0 || dds.Height == 0)
+    {
+        fprintf(fp, "ERROR: %s: The header does not specify a width and height.\n", path);
+        errors++;
+    }
+
+    size_t depth   = data::dds_volume(&dds, ex) ? size_t(dds.Depth) : 1;
+    size_t largest = size_t(dds.Width > dds.Height ? dds.Width : dds.Height);
+    size_t nlevels = 1;
+    if (depth > largest) largest = depth;
+    while (largest > 1)
+    {
+        largest >>= 1;
+        nlevels++;
+    }
+    if (file->LevelCount > nlevels)
+    {
+        fprintf(fp, "ERROR: %s: The header specifies %u levels, but a %ux%ux%u surface has at most %u.\n", path,
+            unsigned(file->LevelCount), unsigned(dds.Width), unsigned(dds.Height), unsigned(depth), unsigned(nlevels));
+        errors++;
+    }
+    if (data::dds_cubemap(&dds, ex) && dds.Width != dds.Height)
+    {
+        fprintf(fp, "ERROR: %s: The faces of the cubemap are not square (%ux%u).\n", path, unsigned(dds.Width), unsigned(dds.Height));
+        errors++;
+    }
+
+    // for block-compressed formats the field holds the size of the top level.
+    if (dds.Flags & (data::DDSD_PITCH | data::DDSD_LINEARSIZE))
+    {
+        bool        linear   = data::dds_block_compressed(file->Format);
+        size_t      expected = linear ? top.BytesPerSlice : top.BytesPerRow;
+        char const *field    = linear ? "linear size" : "pitch";
+        if (dds.Pitch == 0)
+        {
+            fprintf(fp, "WARNING: %s: The header specifies a %s of zero.\n", path, field);
+        }
+        else if (size_t(dds.Pitch) != expected)
+        {
+            fprintf(fp, "ERROR: %s: The header %s is %u bytes, but should be %u bytes.\n", path, field, unsigned(dds.Pitch), unsigned(expected));
+            errors++;
+        }
+    }
+
+    // data::dds_open() guarantees that every subresource is within the file.
+    size_t payload_end = size_t((uint8_t const*) end.LevelData - (uint8_t const*) file->Data) + end.DataSize;
+    if (payload_end != file->DataSize)
+    {
+        fprintf(fp, "ERROR: %s: The file is %llu bytes, but the header describes %llu bytes.\n", path,
+            (unsigned long long) file->DataSize, (unsigned long long) payload_end);
+        errors++;
+    }
+    return errors;
+}
+
+/// @summary Explains why a file could not be opened with data::dds_open().
+/// The file is read into memory, since this only happens for invalid files.
+/// @param fp The output stream to which errors will be written.
+/// @param path The path of the file.
+static void diagnose_dds(FILE *fp, char const *path)
+{
+    size_t                   size = 0;
+    void                    *data = data::load_binary(path, &size);
+    data::dds_header_t       dds;
+    data::dds_header_dxt10_t dx10;
+    if (data == NULL || size == 0)
+    {
+        fprintf(fp, "ERROR: %s: The file cannot be read, or is empty.\n", path);
+        free(data);
+        return;
+    }
+    if (!data::dds_header(data, size, &dds))
+    {
+        fprintf(fp, "ERROR: %s: The file does not start with a valid DDS header.\n", path);
+        free(data);
+        return;
+    }
+
+    data::dds_header_dxt10_t const *ex = data::dds_header_dxt10(data, size, &dx10) ? &dx10 : NULL;
+    size_t nitems  = data::dds_array_count(&dds, ex);
+    size_t nlevels = data::dds_level_count(&dds, ex);
+    size_t count   = nitems * nlevels;
+    if (count == 0)
+    {
+        fprintf(fp, "ERROR: %s: The header describes an empty surface.\n", path);
+    }
+    else if (nlevels > 32 || count > size)
+    {
+        fprintf(fp, "ERROR: %s: The header describes %u levels of %u items, more than the file can hold.\n", path, unsigned(nlevels), unsigned(nitems));
+    }
+    else
+    {   // lay out the subresources as if the file were large enough.
+        data::dds_level_desc_t *levels = (data::dds_level_desc_t*) malloc(count * sizeof(data::dds_level_desc_t));
+        if (levels != NULL && data::dds_describe(data, size_t(-1), &dds, ex, levels, count) == count)
+        {
+            data::dds_level_desc_t const &end = levels[count - 1];
+            size_t payload_end = size_t((uint8_t const*) end.LevelData - (uint8_t const*) data) + end.DataSize;
+            if (payload_end > size)
+            {
+                fprintf(fp, "ERROR: %s: The file is truncated. It is %llu bytes, but the header describes %llu bytes.\n", path,
+                    (unsigned long long) size, (unsigned long long) payload_end);
+            }
+            else fprintf(fp, "ERROR: %s: The file cannot be mapped into memory.\n", path);
+        }
+        else fprintf(fp, "ERROR: %s: Unable to allocate the subresource table.\n", path);
+        free(levels);
+    }
+    free(data);
+}
+
+/// @summary Prints the header fields and the subresource layout of a DDS,
+/// and checks the file for structural problems.
+/// @param fp The output stream.
+/// @param path The path of the DDS.
+/// @return true if the file is valid.
+static bool print_dds_info(FILE *fp, char const *path)
+{
+    data::dds_file_t *file = data::dds_open(path);
+    if (file == NULL)
+    {   // diagnose_dds() outputs error messages.
+        diagnose_dds(fp, path);
+        return false;
+    }
+
+    data::dds_header_t       const &dds = file->Header;
+    data::dds_header_dxt10_t const *ex  = file->HasHeaderEx ? &file->HeaderEx : NULL;
+    char const *type  = "2D";
+    char const *alpha = "-";
+    if (data::dds_volume(&dds, ex)) type = "volume";
+    else if (data::dds_cubemap(&dds, ex)) type = file->ItemCount > 6 ? "cubemap array" : "cubemap";
+    else if (ex && ex->Dimension == data::D3D11_RESOURCE_DIMENSION_TEXTURE1D) type = file->ItemCount > 1 ? "1D array" : "1D";
+    else if (file->ItemCount > 1) type = "2D array";
+    if (ex)
+    {
+        size_t const nvals = sizeof(ALPHAMODE_VALUES) / sizeof(ALPHAMODE_VALUES[0]);
+        alpha = "UNKNOWN";
+        for (size_t i = 0; i < nvals; ++i)
+        {
+            if (ALPHAMODE_VALUES[i] == ex->Flags2)
+                alpha = ALPHAMODE_STRINGS[i];
+        }
+    }
+
+    fprintf(fp, "%s:\n", path);
+    fprintf(fp, "    Format:     %s (%u)\n", format_name(file->Format), unsigned(file->Format));
+    fprintf(fp, "    Type:       %s, %ux%ux%u, %u item(s), %u level(s)\n", type, unsigned(dds.Width), unsigned(dds.Height),
+        unsigned(data::dds_volume(&dds, ex) ? dds.Depth : 1), unsigned(file->ItemCount), unsigned(file->LevelCount));
+    fprintf(fp, "    Header:     %s, flags 0x%08X, pitch %u, caps 0x%08X, caps2 0x%08X\n", ex ? "DX10" : "legacy",
+        unsigned(dds.Flags), unsigned(dds.Pitch), unsigned(dds.Caps), unsigned(dds.Caps2));
+    fprintf(fp, "    Alpha mode: %s\n", alpha);
+    fprintf(fp, "    File size:  %llu bytes\n", (unsigned long long) file->DataSize);
+    fprintf(fp, "    item level    width   height   depth   row pitch  slice pitch         size       offset\n");
+    for (size_t i = 0; i < file->SubresourceCount; ++i)
+    {
+        data::dds_level_desc_t const &desc = file->Levels[i];
+        fprintf(fp, "    %4u %5u %8u %8u %7u %11u %12u %12llu %12llu\n",
+            unsigned(i / file->LevelCount), unsigned(desc.Index),
+            unsigned(level_dimension(dds.Width , desc.Index)),
+            unsigned(level_dimension(dds.Height, desc.Index)),
+            unsigned(desc.Slices), unsigned(desc.BytesPerRow), unsigned(desc.BytesPerSlice),
+            (unsigned long long) desc.DataSize,
+            (unsigned long long) ((uint8_t const*) desc.LevelData - (uint8_t const*) file->Data));
+    }
+
+    size_t errors = check_dds(fp, path, file);
+    data::dds_close(file);
+    return errors == 0;
+}
+
+/// @summary Checks a DDS for structural problems, decodes every subresource
+/// and prints the min/max/mean of each channel. Subresources are split into
+/// bands of rows, which are processed in parallel.
+/// @param fp The output stream.
+/// @param pool The scratch pool used for decoded rows.
+/// @param thread_count The maximum number of worker threads.
+/// @param path The path of the DDS.
+/// @return true if the file is valid.
+static bool verify_dds(FILE *fp, scratch_pool_t *pool, size_t thread_count, char const *path)
+{
+    data::dds_file_t *file = data::dds_open(path);
+    if (file == NULL)
+    {   // diagnose_dds() outputs error messages.
+        diagnose_dds(fp, path);
+        fprintf(fp, "%s: FAILED\n", path);
+        return false;
+    }
+
+    fprintf(fp, "%s:\n", path);
+    size_t      errors   = check_dds(fp, path, file);
+    char const *channels = format_channels(file->Format);
+    if (channels == NULL)
+    {
+        fprintf(fp, "    Texel statistics are not available for %s.\n", format_name(file->Format));
+    }
+    else
+    {
+        size_t nbands = 0;
+        for (size_t i = 0; i < file->SubresourceCount; ++i)
+        {
+            data::dds_level_desc_t const &desc = file->Levels[i];
+            nbands += desc.Slices * ((desc.Height + VERIFY_BAND_ROWS - 1) / VERIFY_BAND_ROWS);
+        }
+        verify_band_t *bands = (verify_band_t*) malloc(nbands * sizeof(verify_band_t));
+        if (bands == NULL)
+        {
+            fprintf(fp, "ERROR: %s: Unable to allocate %u work items.\n", path, unsigned(nbands));
+            fprintf(fp, "%s: FAILED\n", path);
+            data::dds_close(file);
+            return false;
+        }
+        for (size_t i = 0, n = 0; i < file->SubresourceCount; ++i)
+        {
+            data::dds_level_desc_t const &desc = file->Levels[i];
+            for (size_t z = 0; z < desc.Slices; ++z)
+            {
+                for (size_t y = 0; y < desc.Height; y += VERIFY_BAND_ROWS, ++n)
+                {
+                    bands[n].Subresource = i;
+                    bands[n].Slice       = z;
+                    bands[n].Row         = y;
+                    bands[n].RowCount    = desc.Height - y < VERIFY_BAND_ROWS ? desc.Height - y : VERIFY_BAND_ROWS;
+                }
+            }
+        }
+
+        verify_job_t job;
+        job.File  = file;
+        job.Pool  = pool;
+        job.Bands = bands;
+        parallel_for(thread_count, nbands, verify_band_work, &job);
+
+        // bands are merged in order, so the results do not depend on timing.
+        size_t nchannels = strlen(channels);
+        for (size_t i = 0, n = 0; i < file->SubresourceCount; ++i)
+        {
+            data::dds_level_desc_t const &desc = file->Levels[i];
+            texel_stats_t stats;
+            bool          decoded = true;
+            init_stats(&stats);
+            for ( ; n < nbands && bands[n].Subresource == i; ++n)
+            {
+                decoded = decoded && bands[n].Decoded;
+                merge_stats(&stats, &bands[n].Stats);
+            }
+            if (!decoded)
+            {
+                fprintf(fp, "ERROR: %s: Unable to decode item %u level %u.\n", path, unsigned(i / file->LevelCount), unsigned(desc.Index));
+                errors++;
+                continue;
+            }
+            fprintf(fp, "    item %u level %u (%ux%ux%u):", unsigned(i / file->LevelCount), unsigned(desc.Index),
+                unsigned(level_dimension(file->Header.Width , desc.Index)),
+                unsigned(level_dimension(file->Header.Height, desc.Index)), unsigned(desc.Slices));
+            for (size_t c = 0; c < nchannels; ++c)
+            {
+                size_t ch = size_t(strchr("RGBA", channels[c]) - "RGBA");
+                double mean = stats.Count > 0 ? stats.Sum[ch] / double(stats.Count) : 0.0;
+                if (stats.Min[ch] > stats.Max[ch])
+                {   // every value was NaN or infinite.
+                    fprintf(fp, "  %c -", channels[c]);
+                    continue;
+                }
+                fprintf(fp, "  %c %.4f/%.4f/%.4f", channels[c], stats.Min[ch], stats.Max[ch], mean);
+            }
+            fprintf(fp, "\n");
+            if (stats.NonFinite > 0)
+            {
+                fprintf(fp, "ERROR: %s: Item %u level %u contains %llu NaN or infinite values.\n", path,
+                    unsigned(i / file->LevelCount), unsigned(desc.Index), (unsigned long long) stats.NonFinite);
+                errors++;
+            }
+        }
+        free(bands);
+    }
+
+    if (errors > 0) fprintf(fp, "%s: FAILED (%u error(s))\n", path, unsigned(errors));
+    else fprintf(fp, "%s: OK\n", path);
+    data::dds_close(file);
+    return errors == 0;
+}
+
+/// @summary Implements the --info and --verify modes, which examine a list of
+/// existing DDS files instead of generating one.
+/// @param fp The output stream.
+/// @param argc The number of command-line arguments.
+/// @param argv The command-line arguments. argv[1] is --info or --verify.
+/// @return true if every file is valid.
+static bool inspect_files(FILE *fp, int argc, char **argv)
+{
+    bool   verify   = 0 == stricmp_fn(argv[1], "--verify");
+    size_t nthreads = cpu_count();
+    size_t nfiles   = 0;
+    size_t nfailed  = 0;
+    for (int i = 2; i < argc - 1; ++i)
+    {
+        if (0 == stricmp_fn(argv[i], "--threads"))
+        {
+            nthreads = size_t(strtoul(argv[i + 1], NULL, 10));
+            if (nthreads < 1) nthreads = 1;
+        }
+    }
+
+    scratch_pool_t pool;
+    init_scratch_pool(&pool);
+    for (int i = 2; i < argc; ++i)
+    {
+        if (0 == stricmp_fn(argv[i], "--threads"))
+        {   // skip the thread count.
+            ++i;
+            continue;
+        }
+        bool valid = verify ? verify_dds(fp, &pool, nthreads, argv[i]) : print_dds_info(fp, argv[i]);
+        if (!valid) nfailed++;
+        nfiles++;
+    }
+    delete_scratch_pool(&pool);
+
+    if (nfiles == 0)
+    {
+        print_usage(fp);
+        return false;
+    }
+    fprintf(fp, "%s %u file(s), %u failed.\n", verify ? "Verified" : "Inspected", unsigned(nfiles), unsigned(nfailed));
+    return nfailed == 0;
+}
+
+/// @summary Decodes a run of rows of one slice of a DDS subresource into a
+/// working image. Block-compressed data is decoded one row of blocks at a
+/// time, so only the requested rows of the memory-mapped file are touched.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param pool The scratch pool used for decoded blocks and float rows.
+/// @param level The subresource to decode.
+/// @param slice The zero-based slice within the subresource.
+/// @param first_row The first row to decode. Must be a multiple of four.
+/// @param out The working image receiving the rows. Pixels, Width, Height
+/// and HDR must be set; Height is the number of rows to decode.
+/// @return true if the rows were decoded.
+static bool decode_subresource_rows(FILE *fp, scratch_pool_t *pool, data::dds_level_desc_t const *level, size_t slice, size_t first_row, image_info_t &out)
+{
+    uint32_t const format = level->Format;
+    bool     const bcn    = data::dds_block_compressed(format);
+    uint32_t const rowfmt = bcn ? data::bc_decode_format(format) : format;
+    size_t   const width  = size_t(out.Width);
+    size_t   const rows   = size_t(out.Height);
+    size_t   const bpitch = level->Width * 4;
+    size_t   const nbytes = (bcn ? bpitch * 4 : 0) + width * 4 * sizeof(float);
+    uint8_t       *buffer = (uint8_t*) scratch_alloc(pool, nbytes);
+    if (buffer == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate %u bytes for decoded rows.\n", unsigned(nbytes));
+        return false;
+    }
+    float         *rowf   = (float*) (buffer + (bcn ? bpitch * 4 : 0));
+    uint8_t const *data   = (uint8_t const*) level->LevelData + slice * level->BytesPerSlice;
+    bool           res    = true;
+    for (size_t y = 0; y < rows && res; ++y)
+    {
+        size_t         sy  = first_row + y;
+        uint8_t const *src = data + sy * level->BytesPerRow;
+        if (bcn)
+        {   // decode the row of blocks holding this row when first needed.
+            if (y == 0 || (sy & 3) == 0) res = data::bc_decode_rows(buffer, bpitch, level, slice, sy / 4, 1);
+            src = buffer + (sy & 3) * bpitch;
+        }
+        if (out.HDR)
+        {
+            res = res && decode_row_float(rowfmt, src, width, (float*) out.Pixels + y * width * 4);
+            continue;
+        }
+        uint8_t       *dst = (uint8_t*) out.Pixels + y * width * 4;
+        uint8_t const *p   = res ? decode_row_rgba8(rowfmt, src, width, dst) : NULL;
+        if (p != NULL)
+        {
+            if (p != dst) memcpy(dst, p, width * 4);
+        }
+        else if (res && decode_row_float(rowfmt, src, width, rowf))
+        {   // packed and 16-bit UNORM data is quantized to 8 bits.
+            for (size_t i = 0; i < width * 4; ++i)
+            {
+                float v = rowf[i] < 0.0f ? 0.0f : (rowf[i] > 1.0f ? 1.0f : rowf[i]);
+                dst[i]  = uint8_t(v * 255.0f + 0.5f);
+            }
+        }
+        else res = false;
+    }
+    scratch_free(pool, buffer);
+    if (!res) fprintf(fp, "ERROR: Unable to decode DXGI format %s.\n", format_name(format));
+    return res;
+}
+
+/// @summary Re-encodes the slices of one level of a DDS source in the output
+/// format. Each slice is decoded and written in strips of rows when a memory
+/// limit is set, or all at once otherwise.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for strip buffers.
+/// @param params Image processing parameters.
+/// @param header The base surface header of the source file.
+/// @param level The source subresource.
+/// @param hdr true if the working image is RGBA32F, or false if it is RGBA8.
+/// @return true if every slice of the level was written to stream dds.
+static bool transcode_level(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t const &params, data::dds_header_t const &header, data::dds_level_desc_t const *level, bool hdr)
+{
+    image_info_t strip;
+    strip.Pool     = pool;
+    strip.Width    = int(level_dimension(header.Width , level->Index));
+    strip.Height   = int(level_dimension(header.Height, level->Index));
+    strip.Channels = 4;
+    strip.Format   = hdr ? data::DXGI_FORMAT_R32G32B32A32_FLOAT : data::DXGI_FORMAT_R8G8B8A8_UNORM;
+    strip.HDR      = hdr;
+
+    size_t const width  = size_t(strip.Width);
+    size_t const height = size_t(strip.Height);
+    size_t const rowsz  = width * 4 * (hdr ? sizeof(float) : sizeof(uint8_t));
+    size_t       nrows  = height;
+    if (params.MemoryLimit > 0)
+    {   // each strip row is decoded, held and encoded; nothing is resampled.
+        nrows  = params.MemoryLimit / (rowsz + data::dds_pitch(params.Format, width)) & ~size_t(3);
+        if (nrows < 4) nrows = 4;
+        if (nrows > height) nrows = height;
+    }
+    size_t const nbytes = nrows * rowsz;
+    if ((strip.Pixels = scratch_alloc(pool, nbytes)) == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate %u bytes for image strip.\n", unsigned(nbytes));
+        return false;
+    }
+
+    bool res = true;
+    for (size_t z = 0; z < level->Slices && res; ++z)
+    {
+        for (size_t y0 = 0; y0 < height && res; y0 += nrows)
+        {
+            strip.Height = int(y0 + nrows < height ? nrows : height - y0);
+            res = decode_subresource_rows(fp, pool, level, z, y0, strip) && write_pixels(fp, dds, pool, params, strip);
+        }
+    }
+    scratch_free(pool, strip.Pixels);
+    return res;
+}
+
+/// @summary Re-encodes an existing DDS file, one subresource at a time, from
+/// a mapping of the file. The levels of each item are either each re-encoded,
+/// or regenerated from the first level of the item. The pages of each source
+/// subresource are released once it has been consumed, so the resident set
+/// stays bounded by the largest subresource for arrays of any size.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param dds The output stream to which the image data will be written.
+/// @param pool The scratch pool used for decoded and resampled images.
+/// @param params Image processing parameters.
+/// @return true if the entire image was written to stream dds.
+static bool write_transcoded_image(FILE *fp, FILE *dds, scratch_pool_t *pool, dds_params_t &params)
+{
+    data::dds_file_t *src = data::dds_open(params.SourceFiles[0]);
+    if (src == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to load DDS input \'%s\'.\n", params.SourceFiles[0]);
+        return false;
+    }
+
+    bool hdr = false;
+    transcode_source_format(src->Format, hdr);
+    if (!transcode_target_format(params.Format, hdr))
+    {
+        fprintf(fp, "ERROR: Unable to transcode %s data to DXGI format %s.\n", format_name(src->Format), format_name(params.Format));
+        data::dds_close(src);
+        return false;
+    }
+    if (params.FormatDefaulted)
+    {   // the output format differs from the source; make sure the user knows.
+        fprintf(fp, "WARNING: %s data in \'%s\' cannot be re-encoded as-is; writing %s. Specify a Format to choose the output format.\n", format_name(src->Format), params.SourceFiles[0], format_name(params.Format));
+    }
+
+    bool resized = params.Width != params.BaseWidth || params.Height != params.BaseHeight;
+    if (params.Volume && (resized || !params.KeepMipmaps))
+    {   // volume mip-levels are never regenerated; the slices of each level are re-encoded.
+        fprintf(fp, "WARNING: Volume images are transcoded without resizing or regenerating mipmaps.\n");
+        params.Width        = params.BaseWidth;
+        params.Height       = params.BaseHeight;
+        params.MaxMipLevels = src->LevelCount;
+        params.Mipmaps      = src->LevelCount > 1;
+        params.KeepMipmaps  = true;
+        resized             = false;
+    }
+
+    // levels that are kept in the same format are copied without re-encoding,
+    // unless re-encoding was asked for through RDO or metrics.
+    bool   keep    = params.KeepMipmaps && !resized;
+    bool   copy    = keep && src->Format == params.Format && params.RdoLambda <= 0.0f && !params.Metrics;
+    size_t nlevels = params.Mipmaps && params.MaxMipLevels > 1 ? params.MaxMipLevels : 1;
+    bool   res     = true;
+    for (size_t i = 0; i < src->ItemCount && res; ++i)
+    {
+        data::dds_level_desc_t const *chain = &src->Levels[i * src->LevelCount];
+        if (keep)
+        {   // each existing level is decoded and re-encoded in turn.
+            for (size_t j = 0; j < nlevels && res; ++j)
+            {
+                if (copy) res = fwrite(chain[j].LevelData, chain[j].DataSize, 1, dds) == 1;
+                else res = transcode_level(fp, dds, pool, params, src->Header, &chain[j], hdr);
+                data::dds_discard(src, &chain[j]);
+            }
+            continue;
+        }
+
+        // the first level is decoded in full and used as the source for the
+        // regenerated (and possibly resized) mipmap chain.
+        image_info_t base;
+        size_t       nbytes = params.BaseWidth * params.BaseHeight * 4 * (hdr ? sizeof(float) : sizeof(uint8_t));
+        base.Pool     = pool;
+        base.Pixels   = scratch_alloc(pool, nbytes);
+        base.Width    = int(params.BaseWidth);
+        base.Height   = int(params.BaseHeight);
+        base.Channels = 4;
+        base.Format   = hdr ? data::DXGI_FORMAT_R32G32B32A32_FLOAT : data::DXGI_FORMAT_R8G8B8A8_UNORM;
+        base.HDR      = hdr;
+        if (base.Pixels == NULL)
+        {
+            fprintf(fp, "ERROR: Unable to allocate %u bytes for the base level of item %u.\n", unsigned(nbytes), unsigned(i));
+            res = false;
+            break;
+        }
+        res = decode_subresource_rows(fp, pool, &chain[0], 0, 0, base);
+        data::dds_discard(src, &chain[0]);
+        res = res && write_image_chain(fp, dds, pool, params, base);
+        free_image(base);
+    }
+    data::dds_close(src);
+    return res;
+}
+
+/// @summary Encodes one band of rows of an image for write_encoded_image().
+/// @param index The zero-based index of the band.
+/// @param context Pointer to the encode_job_t.
+static void encode_band_work(size_t index, void *context)
+{
+    encode_job_t  *job   = (encode_job_t*) context;
+    encode_band_t &band  = job->Bands[index];
+    size_t  const  pitch = job->Width * 4;
+    size_t  const  bound = job->TGA ? data::tga_encode_bound(job->Width, band.RowCount, 32) : data::png_band_bound(job->Width, band.RowCount, 4);
+
+    band.Size = 0;
+    if ((band.Data = (uint8_t*) scratch_alloc(job->Pool, bound)) == NULL)
+    {   // the caller reports the failure.
+        return;
+    }
+    if (job->TGA)
+    {
+        band.Size = data::tga_encode_rows(band.Data, bound, job->Pixels + band.FirstRow * pitch, pitch, job->Width, band.RowCount, data::TGA_PIXEL_ORDER_RGBA, 32, true);
+    }
+    else
+    {
+        bool last = band.FirstRow + band.RowCount == job->Height;
+        band.Size = data::png_encode_band(band.Data, bound, job->Pixels, pitch, job->Width, band.FirstRow, band.RowCount, 4, job->Compression, last, &band.PNG);
+    }
+}
+
+/// @summary Writes an RGBA8 image as a PNG or RLE TGA file. The image is split
+/// into bands of at least ENCODE_BAND_ROWS rows that are filtered and
+/// compressed (or run-length encoded) in parallel, then written in order.
+/// @param path The path of the file to write.
+/// @param pool The scratch pool used for the encoded bands.
+/// @param thread_count The maximum number of threads encoding bands.
+/// @param rgba The image data, in RGBA order, with rows of width * 4 bytes.
+/// @param width The width of the image, in pixels.
+/// @param height The height of the image, in pixels.
+/// @param tga true to write an RLE TGA, or false to write a PNG.
+/// @param compression One of data::png_compression_e, for PNG output.
+/// @return true if the file was written.
+static bool write_encoded_image(char const *path, scratch_pool_t *pool, size_t thread_count, uint8_t const *rgba, size_t width, size_t height, bool tga, uint32_t compression)
+{
+    encode_band_t bands[MAX_WORKER_THREADS];
+    encode_job_t  job;
+    size_t        nbands = height / ENCODE_BAND_ROWS;
+    if (nbands > thread_count) nbands = thread_count;
+    if (nbands > MAX_WORKER_THREADS) nbands = MAX_WORKER_THREADS;
+    if (nbands < 1) nbands = 1;
+    for (size_t i = 0; i < nbands; ++i)
+    {
+        bands[i].FirstRow = height * i / nbands;
+        bands[i].RowCount = height * (i + 1) / nbands - bands[i].FirstRow;
+        bands[i].Data     = NULL;
+        bands[i].Size     = 0;
+    }
+    job.Pixels      = rgba;
+    job.Width       = width;
+    job.Height      = height;
+    job.TGA         = tga;
+    job.Compression = compression;
+    job.Pool        = pool;
+    job.Bands       = bands;
+    parallel_for(thread_count, nbands, encode_band_work, &job);
+
+    bool res = true;
+    for (size_t i = 0; i < nbands; ++i)
+    {
+        res = res && bands[i].Size > 0;
+    }
+
+    // PNG bands are combined into a complete file in memory; TGA bands are
+    // written directly after the header.
+    uint8_t  header[sizeof(data::tga_header_t)];
+    uint8_t *file  = NULL;
+    size_t   nfile = 0;
+    if (res && tga)
+    {
+        res = (nfile = data::tga_encode_header(header, sizeof(header), width, height, 32, true)) > 0;
+    }
+    if (res && !tga)
+    {
+        data::png_band_t png[MAX_WORKER_THREADS];
+        for (size_t i = 0; i < nbands; ++i)
+        {
+            png[i] = bands[i].PNG;
+        }
+        size_t need = data::png_encode_bands(NULL, 0, width, height, 4, png, nbands);
+        res = need > 0 && (file = (uint8_t*) scratch_alloc(pool, need)) != NULL;
+        res = res && (nfile = data::png_encode_bands(file, need, width, height, 4, png, nbands)) > 0;
+    }
+
+    FILE *out = res ? fopen(path, "wb") : NULL;
+    if (out != NULL)
+    {
+        if (tga)
+        {
+            res = fwrite(header, 1, nfile, out) == nfile;
+            for (size_t i = 0; i < nbands && res; ++i)
+            {
+                res = fwrite(bands[i].Data, 1, bands[i].Size, out) == bands[i].Size;
+            }
+        }
+        else res = fwrite(file, 1, nfile, out) == nfile;
+        res = fclose(out) == 0 && res;
+    }
+    else res = false;
+
+    for (size_t i = 0; i < nbands; ++i)
+    {
+        scratch_free(pool, bands[i].Data);
+    }
+    scratch_free(pool, file);
+    return res;
+}
+
+/// @summary Creates a directory, if it does not already exist.
+/// @param path The path of the directory. Parent directories must exist.
+/// @return true if the directory exists.
+static bool make_directory(char const *path)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+/// @summary Builds the path of the file receiving one item of --extract.
+/// @param dst The buffer receiving the path.
+/// @param dst_size The size of the dst buffer, in bytes.
+/// @param job The extraction job.
+/// @param item The slice being written.
+/// @return true if the path fits in the dst buffer.
+static bool extract_path(char *dst, size_t dst_size, extract_job_t const *job, extract_item_t const &item)
+{
+    data::dds_file_t       const *file = job->File;
+    data::dds_level_desc_t const &desc = file->Levels[item.Subresource];
+    size_t      dirlen = strlen(job->Directory);
+    char        last   = dirlen > 0 ? job->Directory[dirlen - 1] : '/';
+    char const *sep    = (last == '/' || last == '\\') ? "" : "/";
+    char        slice[32] = "";
+    if (data::dds_volume(&file->Header, file->HasHeaderEx ? &file->HeaderEx : NULL))
+    {
+        snprintf(slice, sizeof(slice), "_z%u", unsigned(item.Slice));
+    }
+    char const *ext = job->Output == EXTRACT_PNG ? ".png" : (job->Output == EXTRACT_TGA ? ".tga" : ".raw");
+    int n = snprintf(dst, dst_size, "%s%s%s_i%u_m%u%s%s", job->Directory, sep, job->Stem,
+        unsigned(item.Subresource / file->LevelCount), unsigned(desc.Index), slice, ext);
+    return n > 0 && size_t(n) < dst_size;
+}
+
+/// @summary Writes one slice of a subresource to its own file for --extract.
+/// @param index The zero-based index of the slice.
+/// @param context Pointer to the extract_job_t.
+static void extract_work(size_t index, void *context)
+{
+    extract_job_t                *job  = (extract_job_t*) context;
+    extract_item_t               &item = job->Items[index];
+    data::dds_level_desc_t const &desc = job->File->Levels[item.Subresource];
+    char                          path[4096];
+
+    item.Written = false;
+    if (!extract_path(path, sizeof(path), job, item))
+    {   // the caller reports the failure.
+        return;
+    }
+    if (job->Output == EXTRACT_RAW)
+    {   // the slice is copied exactly as stored.
+        uint8_t const *data = (uint8_t const*) desc.LevelData + item.Slice * desc.BytesPerSlice;
+        FILE          *out  = fopen(path, "wb");
+        if (out != NULL)
+        {
+            bool ok = fwrite(data, 1, desc.BytesPerSlice, out) == desc.BytesPerSlice;
+            item.Written = fclose(out) == 0 && ok;
+        }
+        return;
+    }
+
+    image_info_t image;
+    size_t       width  = level_dimension(job->File->Header.Width , desc.Index);
+    size_t       height = level_dimension(job->File->Header.Height, desc.Index);
+    image.Pool     = job->Pool;
+    image.Pixels   = scratch_alloc(job->Pool, width * height * 4);
+    image.Width    = int(width);
+    image.Height   = int(height);
+    image.Channels = 4;
+    image.Format   = data::DXGI_FORMAT_R8G8B8A8_UNORM;
+    image.HDR      = false;
+    if (image.Pixels == NULL)
+    {
+        fprintf(job->Errors, "ERROR: Unable to allocate %u bytes for decoded image.\n", unsigned(width * height * 4));
+        return;
+    }
+    if (decode_subresource_rows(job->Errors, job->Pool, &desc, item.Slice, 0, image))
+    {
+        item.Written = write_encoded_image(path, job->Pool, job->BandThreads, (uint8_t const*) image.Pixels, width, height, job->Output == EXTRACT_TGA, job->Compression);
+    }
+    scratch_free(job->Pool, image.Pixels);
+}
+
+/// @summary Writes every slice of every subresource of a DDS to its own file.
+/// Slices are decoded and written in parallel, and threads left over when
+/// there are fewer slices than threads encode the bands of each slice.
+/// @param fp The output stream.
+/// @param pool The scratch pool used for decoded images.
+/// @param thread_count The maximum number of worker threads.
+/// @param dir The directory receiving the files.
+/// @param path The path of the DDS.
+/// @param output One of extract_output_e. Data that cannot be decoded to RGBA8
+/// is always copied as stored.
+/// @param compression One of data::png_compression_e, for PNG output.
+/// @return true if every slice was written.
+static bool extract_dds(FILE *fp, scratch_pool_t *pool, size_t thread_count, char const *dir, char const *path, uint32_t output, uint32_t compression)
+{
+    data::dds_file_t *file = data::dds_open(path);
+    if (file == NULL)
+    {   // diagnose_dds() outputs error messages.
+        diagnose_dds(fp, path);
+        fprintf(fp, "%s: FAILED\n", path);
+        return false;
+    }
+
+    bool hdr = false;
+    if (output != EXTRACT_RAW && !(transcode_source_format(file->Format, hdr) && !hdr))
+    {
+        fprintf(fp, "WARNING: %s: %s data cannot be stored as %s; copying it to .raw files.\n", path, format_name(file->Format), output == EXTRACT_TGA ? "TGA" : "PNG");
+        output = EXTRACT_RAW;
+    }
+
+    // the stem is the file name without its directory or extension.
+    char        stem[4096];
+    char const *name = stem;
+    replace_extension(stem, sizeof(stem), path, "");
+    for (char const *p = stem; *p != '\0'; ++p)
+    {
+        if (*p == '/' || *p == '\\') name = p + 1;
+    }
+
+    size_t nitems = 0;
+    for (size_t i = 0; i < file->SubresourceCount; ++i)
+    {
+        nitems += file->Levels[i].Slices;
+    }
+    extract_item_t *items = (extract_item_t*) malloc(nitems * sizeof(extract_item_t));
+    if (items == NULL)
+    {
+        fprintf(fp, "ERROR: %s: Unable to allocate %u work items.\n", path, unsigned(nitems));
+        fprintf(fp, "%s: FAILED\n", path);
+        data::dds_close(file);
+        return false;
+    }
+    for (size_t i = 0, n = 0; i < file->SubresourceCount; ++i)
+    {
+        for (size_t z = 0; z < file->Levels[i].Slices; ++z, ++n)
+        {
+            items[n].Subresource = i;
+            items[n].Slice       = z;
+            items[n].Written     = false;
+        }
+    }
+
+    extract_job_t job;
+    job.File      = file;
+    job.Pool      = pool;
+    job.Errors    = fp;
+    job.Directory = dir;
+    job.Stem      = name;
+    job.Output      = output;
+    job.Compression = compression;
+    job.BandThreads = nitems == 1 ? thread_count : 1; // nested parallel_for() calls run inline.
+    job.Items       = items;
+    parallel_for(thread_count, nitems, extract_work, &job);
+
+    size_t nwritten = 0;
+    for (size_t i = 0; i < nitems; ++i)
+    {
+        char target[4096];
+        if (items[i].Written)
+        {
+            nwritten++;
+            continue;
+        }
+        if (extract_path(target, sizeof(target), &job, items[i]))
+        {
+            fprintf(fp, "ERROR: %s: Unable to write \'%s\'.\n", path, target);
+        }
+        else fprintf(fp, "ERROR: %s: The output path for item %u level %u is too long.\n", path,
+            unsigned(items[i].Subresource / file->LevelCount), unsigned(file->Levels[items[i].Subresource].Index));
+    }
+    if (nwritten == nitems) fprintf(fp, "%s: wrote %u file(s) to %s\n", path, unsigned(nwritten), dir);
+    else fprintf(fp, "%s: FAILED (%u of %u file(s) written)\n", path, unsigned(nwritten), unsigned(nitems));
+    free(items);
+    data::dds_close(file);
+    return nwritten == nitems;
+}
+
+/// @summary Implements the --extract mode, which writes the subresources of
+/// a list of existing DDS files to individual image files.
+/// @param fp The output stream.
+/// @param argc The number of command-line arguments.
+/// @param argv The command-line arguments. argv[1] is --extract and argv[2]
+/// is the output directory.
+/// @return true if every file was extracted.
+static bool extract_files(FILE *fp, int argc, char **argv)
+{
+    uint32_t output   = EXTRACT_PNG;
+    uint32_t compress = data::PNG_COMPRESSION_FAST;
+    size_t   nthreads = cpu_count();
+    size_t   nfiles   = 0;
+    size_t   nfailed  = 0;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (0 == stricmp_fn(argv[i], "--raw"))
+        {
+            output = EXTRACT_RAW;
+        }
+        if (0 == stricmp_fn(argv[i], "--tga") && output != EXTRACT_RAW)
+        {
+            output = EXTRACT_TGA;
+        }
+        if (0 == stricmp_fn(argv[i], "--store"))
+        {
+            compress = data::PNG_COMPRESSION_STORE;
+        }
+        if (0 == stricmp_fn(argv[i], "--threads") && i + 1 < argc)
+        {
+            nthreads = size_t(strtoul(argv[i + 1], NULL, 10));
+            if (nthreads < 1) nthreads = 1;
+        }
+    }
+    if (argc < 4)
+    {
+        print_usage(fp);
+        return false;
+    }
+    if (!make_directory(argv[2]))
+    {
+        fprintf(fp, "ERROR: Unable to create output directory \'%s\'.\n", argv[2]);
+        return false;
+    }
+
+    scratch_pool_t pool;
+    init_scratch_pool(&pool);
+    for (int i = 3; i < argc; ++i)
+    {
+        if (0 == stricmp_fn(argv[i], "--raw") || 0 == stricmp_fn(argv[i], "--tga") || 0 == stricmp_fn(argv[i], "--store"))
+        {
+            continue;
+        }
+        if (0 == stricmp_fn(argv[i], "--threads"))
+        {   // skip the thread count.
+            ++i;
+            continue;
+        }
+        if (!extract_dds(fp, &pool, nthreads, argv[2], argv[i], output, compress)) nfailed++;
+        nfiles++;
+    }
+    delete_scratch_pool(&pool);
+
+    if (nfiles == 0)
+    {
+        print_usage(fp);
+        return false;
+    }
+    fprintf(fp, "Extracted %u file(s), %u failed.\n", unsigned(nfiles), unsigned(nfailed));
+    return nfailed == 0;
+}
+
+/// @summary Prints the RMSE, PSNR and SSIM4x4 of a set of metrics sums as JSON
+/// fields. PSNR is null if the data was encoded without error.
+/// @param out The output stream.
+/// @param sums The metrics sums.
+/// @param channels The number of channels measured.
+/// @param indent The indentation string for each field.
+/// @param more true if further fields follow the last field.
+static void print_metrics_fields(FILE *out, metrics_sums_t const &sums, size_t channels, char const *indent, bool more)
+{
+    double error = 0.0;
+    for (size_t c = 0; c < channels; ++c)
+        error += sums.SquaredError[c];
+
+    double mse   = sums.Texels > 0 ? error / double(sums.Texels * channels) : 0.0;
+    fprintf(out, "%s\"Texels\": %llu,\n", indent, (unsigned long long) sums.Texels);
+    fprintf(out, "%s\"RMSE\": %.6f,\n", indent, sqrt(mse));
+    if (mse > 0.0) fprintf(out, "%s\"PSNR\": %.4f,\n", indent, 10.0 * log10(255.0 * 255.0 / mse));
+    else fprintf(out, "%s\"PSNR\": null,\n", indent);
+    fprintf(out, "%s\"SSIM4x4\": %.6f,\n", indent, sums.Windows > 0 ? sums.Ssim / double(sums.Windows) : 1.0);
+    fprintf(out, "%s\"ChannelRMSE\": [", indent);
+    for (size_t c = 0; c < channels; ++c)
+    {
+        double cmse = sums.Texels > 0 ? sums.SquaredError[c] / double(sums.Texels) : 0.0;
+        fprintf(out, "%s%.6f", c > 0 ? ", " : "", sqrt(cmse));
+    }
+    fprintf(out, "]%s\n", more ? "," : "");
+}
+
+/// @summary Attributes the error measured by the encoders to the mip-levels
+/// of the output file and writes the RMSE, PSNR and SSIM4x4 of each level, taken
+/// over every item, face and slice, to a JSON file.
+/// @param fp The output stream to which errors and warnings will be written.
+/// @param params Image processing parameters.
+/// @param job The metrics job holding the error measured by the encoders.
+/// @return true if the metrics file was written.
+static bool write_metrics(FILE *fp, dds_params_t const &params, metrics_job_t const *job)
+{
+    if (!data::dds_block_compressed(params.Format) || data::bc_decode_format(params.Format) == data::DXGI_FORMAT_UNKNOWN)
+    {
+        fprintf(fp, "WARNING: Metrics are only measured for block-compressed output; none written.\n");
+        return true;
+    }
+
+    char        path[4096];
+    char const *target = params.MetricsFile;
+    if (target == NULL)
+    {   // replace the extension of the output file with '.metrics.json'.
+        if (!replace_extension(path, sizeof(path), params.OutputFile, ".metrics.json"))
+        {
+            fprintf(fp, "ERROR: The output path is too long to derive the metrics path.\n");
+            return false;
+        }
+        target = path;
+    }
+
+    data::dds_file_t *file = data::dds_open(params.OutputFile);
+    if (file == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to reload '%s' to attribute the metrics.\n", params.OutputFile);
+        return false;
+    }
+
+    metrics_sums_t  total;
+    metrics_sums_t *levels = (metrics_sums_t*) calloc(file->LevelCount, sizeof(metrics_sums_t));
+    if (levels == NULL)
+    {
+        fprintf(fp, "ERROR: Unable to allocate the per-level metrics.\n");
+        data::dds_close(file);
+        return false;
+    }
+    memset(&total, 0, sizeof(total));
+    for (size_t i = 0; i < job->Count; ++i)
+    {   // find the last subresource starting at or before the sample.
+        metrics_sample_t const &sample = job->Samples[i];
+        size_t lo = 0;
+        size_t hi = file->SubresourceCount;
+        while (hi - lo > 1)
+        {
+            size_t  mid = (lo + hi) / 2;
+            ptrdiff_t s = (uint8_t const*) file->Levels[mid].LevelData - (uint8_t const*) file->Data;
+            if (int64_t(s) <= sample.Offset) lo = mid;
+            else hi = mid;
+        }
+        metrics_sums_t *dst = &levels[file->Levels[lo].Index];
+        for (size_t c = 0; c < 4; ++c)
+        {
+            dst->SquaredError[c]   += sample.Sums.SquaredError[c];
+            total.SquaredError[c]  += sample.Sums.SquaredError[c];
+        }
+        dst->Ssim    += sample.Sums.Ssim;    total.Ssim    += sample.Sums.Ssim;
+        dst->Windows += sample.Sums.Windows; total.Windows += sample.Sums.Windows;
+        dst->Texels  += sample.Sums.Texels;  total.Texels  += sample.Sums.Texels;
+    }
+
+    size_t const nch = metrics_channel_count(params.Format);
+    FILE        *out = fopen(target, "wt");
+    bool         res = out != NULL;
+    if (res)
+    {
+        fprintf(out, "{\n");
+        fprintf(out, "    \"Format\": \"%s\",\n", format_name(params.Format));
+        fprintf(out, "    \"Channels\": \"%.*s\",\n", int(nch), "RGBA");
+        print_metrics_fields(out, total, nch, "    ", true);
+        fprintf(out, "    \"Levels\": [\n");
+        for (size_t i = 0; i < file->LevelCount; ++i)
+        {
+            fprintf(out, "        {\n");
+            fprintf(out, "            \"Level\": %u,\n" , unsigned(i));
+            fprintf(out, "            \"Width\": %u,\n" , unsigned(level_dimension(file->Header.Width , i)));
+            fprintf(out, "            \"Height\": %u,\n", unsigned(level_dimension(file->Header.Height, i)));
+            print_metrics_fields(out, levels[i], nch, "            ", false);
+            fprintf(out, "        }%s\n", i + 1 < file->LevelCount ? "," : "");
+        }
+        fprintf(out, "    ]\n}\n");
+        res = fclose(out) == 0;
+    }
+    if (!res) fprintf(fp, "ERROR: Cannot write metrics file '%s'.\n", target);
+    free(levels);
+    data::dds_close(file);
+    return res;
+}
+
 /*////////////////////////
 //   Public Functions   //
 ////////////////////////*/
@@ -1575,7 +9382,19 @@ static bool write_volume_image(FILE *fp, FILE *dds, dds_params_t &params)
 /// @return EXIT_SUCCESS or EXIT_FAILURE.
 int main(int argc, char **argv)
 {
+    // worker threads are started on first use and joined at exit.
+    start_worker_pool();
+    atexit(stop_worker_pool);
+
     print_header(stdout);
+    if (argc >= 2 && (0 == stricmp_fn(argv[1], "--info") || 0 == stricmp_fn(argv[1], "--verify")))
+    {   // inspect_files() outputs error messages.
+        exit(inspect_files(stdout, argc, argv) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (argc >= 2 && 0 == stricmp_fn(argv[1], "--extract"))
+    {   // extract_files() outputs error messages.
+        exit(extract_files(stdout, argc, argv) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
     if (argc < 3)
     {
         print_usage(stdout);
@@ -1612,14 +9431,43 @@ int main(int argc, char **argv)
     {   // params_from_path() outputs error messages.
         exit(EXIT_FAILURE);
     }
-    modify_params(argc, argv, params);
+    if (modify_params(argc, argv, params) == false)
+    {   // modify_params() outputs error messages.
+        free_image(image0);
+        if (params.JsonBuffer != NULL) free(params.JsonBuffer);
+        exit(EXIT_FAILURE);
+    }
     params.OutputFile = argv[last_path];
+    if (image0.Pixels != NULL && image0.Channels == 4 && bgra_format(image0.Format) && !bgra_format(params.Format))
+    {   // --format replaced the BGRA8 format the image was decoded for.
+        uint8_t *px = (uint8_t*) image0.Pixels;
+        for (size_t i = 0, n = size_t(image0.Width) * size_t(image0.Height); i < n; ++i, px += 4)
+        {
+            uint8_t t = px[0]; px[0] = px[2]; px[2] = t;
+        }
+        image0.Format = data::DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
 
     // generate the DDS headers based on the image processing 
     // parameters describing the attributes of the DDS file.
     data::dds_header_t        dds;
     data::dds_header_dxt10_t dx10;
 
+    // the scratch pool holds resampled levels and stb_image_resize working
+    // memory, and is shared by every face, slice and element in the job.
+    scratch_pool_t           pool;
+    init_scratch_pool(&pool);
+    init_bc_encoder();
+
+    // the encoders report their error to the metrics job, which is
+    // attributed to mip-levels once the file is complete.
+    metrics_job_t            metrics;
+    metrics.Samples  = NULL;
+    metrics.Count    = 0;
+    metrics.Capacity = 0;
+    mutex_init(&metrics.Mutex);
+    if (params.Metrics) params.MetricsJob = &metrics;
+
     // open up the output DDS. any existing file is overwritten.
     bool  res = true;
     FILE *fp  = fopen(params.OutputFile, "w+b");
@@ -1645,18 +9493,21 @@ int main(int argc, char **argv)
         if (image0.Pixels != NULL)
         {   // generate and write the entire mipmap chain. the base level
             // is written first, followed by the downsampled miplevels.
-            res = write_image_chain(stdout, fp, params, image0);
+            res = write_image_chain(stdout, fp, &pool, params, image0);
             free_image(image0);
         }
         else
         {   // we are generating either a cubemap (which can have mipmaps), 
-            // a volume image (which currently cannot have mipmaps) or an 
-            // image array (which can have mipmaps, but only be 1D/2D/Cubemap).
+            // a volume image (which can have mipmaps), an atlas (whose pages
+            // form an image array), an image array (which can have
+            // mipmaps, but only be 1D/2D/Cubemap) or a re-encoded DDS.
             // in all of these cases, we have not loaded any image, and so we
             // have to handle defaulting of any parameter values specified as
             // 'default to source image'.
-            if (params.Volume) res = write_volume_image(stdout, fp, params);
-            else res = write_array_image(stdout, fp, params);
+            if (params.Transcode) res = write_transcoded_image(stdout, fp, &pool, params);
+            else if (params.Atlas) res = write_atlas_image(stdout, fp, &pool, params);
+            else if (params.Volume) res = write_volume_image(stdout, fp, &pool, params);
+            else res = write_array_image(stdout, fp, &pool, params);
         }
 
         // seek back to the start of the file and write the header data.
@@ -1668,7 +9519,24 @@ int main(int argc, char **argv)
         fwrite(&dx10 , sizeof(data::dds_header_dxt10_t), 1, fp);
 
         // the entire file has been written, so we're done.
+        delete_scratch_pool(&pool);
         fclose(fp);
+
+        // the KTX2 file is built from the encoded data in the DDS.
+        if (res && params.Ktx2)
+        {   // write_ktx2() outputs error messages.
+            res = write_ktx2(stdout, params);
+        }
+        if (res && params.Supercompress)
+        {   // write_ddsz() outputs error messages.
+            res = write_ddsz(stdout, params);
+        }
+        if (res && params.Metrics)
+        {   // write_metrics() outputs error messages.
+            res = write_metrics(stdout, params, &metrics);
+        }
+        free(metrics.Samples);
+        mutex_delete(&metrics.Mutex);
     }
     else
     {